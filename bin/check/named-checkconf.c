@@ -448,6 +448,8 @@ configure_zone(const char *vclass, const char *view, const cfg_obj_t *zconfig,
 			masterformat = dns_masterformat_text;
 		} else if (strcasecmp(masterformatstr, "raw") == 0) {
 			masterformat = dns_masterformat_raw;
+		} else if (strcasecmp(masterformatstr, "image") == 0) {
+			masterformat = dns_masterformat_image;
 		} else {
 			UNREACHABLE();
 		}
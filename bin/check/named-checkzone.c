@@ -460,6 +460,8 @@ main(int argc, char **argv) {
 			inputformat = dns_masterformat_raw;
 			fprintf(stderr, "WARNING: input format raw, version "
 					"ignored\n");
+		} else if (strcasecmp(inputformatstr, "image") == 0) {
+			inputformat = dns_masterformat_image;
 		} else {
 			fprintf(stderr, "unknown file format: %s\n",
 				inputformatstr);
@@ -472,6 +474,8 @@ main(int argc, char **argv) {
 			outputformat = dns_masterformat_text;
 		} else if (strcasecmp(outputformatstr, "raw") == 0) {
 			outputformat = dns_masterformat_raw;
+		} else if (strcasecmp(outputformatstr, "image") == 0) {
+			outputformat = dns_masterformat_image;
 		} else if (strncasecmp(outputformatstr, "raw=", 4) == 0) {
 			char *end;
 
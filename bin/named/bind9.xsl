@@ -931,6 +931,8 @@
                   <th>Messages Received</th>
                   <th>Records Received</th>
                   <th>Bytes Received</th>
+                  <th>Bytes per Second</th>
+                  <th>Peak Pending Bytes</th>
                 </tr>
               </thead>
               <tbody>
@@ -959,6 +961,8 @@
                     <td><xsl:value-of select="nmsg"/></td>
                     <td><xsl:value-of select="nrecs"/></td>
                     <td><xsl:value-of select="nbytes"/></td>
+                    <td><xsl:value-of select="rate"/></td>
+                    <td><xsl:value-of select="peakmem"/></td>
                   </tr>
                 </xsl:for-each>
               </tbody>
@@ -121,14 +121,24 @@ options {\n\
 	tcp-send-buffer 0;\n\
 #	tkey-domain <none>\n\
 #	tkey-gssapi-credential <none>\n\
+	transfer-cache-size 0;\n\
 	transfer-message-size 20480;\n\
 	transfers-in 10;\n\
 	transfers-out 10;\n\
 	transfers-per-ns 2;\n\
 	trust-anchor-telemetry yes;\n\
-	udp-receive-buffer 0;\n\
+	udp-receive-buffer 0;\n"
+#if HAVE_UDP_SEND_BATCHING
+			    "\
+	udp-send-batching yes;\n"
+#else
+			    "\
+	udp-send-batching no;\n"
+#endif
+			    "\
 	udp-send-buffer 0;\n\
 	update-quota 100;\n\
+	zone-load-concurrency 0;\n\
 \n\
 	/* view */\n\
 	allow-new-zones no;\n\
@@ -165,7 +175,8 @@ options {\n\
 #ifdef HAVE_LMDB
 			    "	lmdb-mapsize 32M;\n"
 #endif /* ifdef HAVE_LMDB */
-			    "	max-cache-size 90%;\n\
+			    "	loop-cache-size 0;\n\
+	max-cache-size 90%;\n\
 	max-cache-ttl 604800; /* 1 week */\n\
 	max-clients-per-query 100;\n\
 	max-ncache-ttl 10800; /* 3 hours */\n\
@@ -190,6 +201,7 @@ options {\n\
 	request-expire true;\n\
 	request-ixfr true;\n\
 	require-server-cookie no;\n\
+	response-cache-size 0;\n\
 	root-key-sentinel yes;\n\
 	servfail-ttl 1;\n\
 #	sortlist <none>\n\
@@ -50,6 +50,14 @@ named_os_adjustnofile(void);
 void
 named_os_minprivs(void);
 
+void
+named_os_listenerprivs(bool raw_udp, bool steer_cpu);
+/*%<
+ * Drop CAP_NET_RAW unless 'raw_udp' is set and CAP_BPF unless
+ * 'steer_cpu' is set, once the configuration shows that no listener
+ * needs them.  They cannot be regained without restarting named.
+ */
+
 FILE *
 named_os_openfile(const char *filename, mode_t mode, bool switch_user);
 
@@ -375,3 +375,11 @@ named_server_servestale(named_server_t *server, isc_lex_t *lex,
 isc_result_t
 named_server_fetchlimit(named_server_t *server, isc_lex_t *lex,
 			isc_buffer_t **text);
+
+/*%
+ * Set the resolver fetch tracing sample rate, or report the sampled
+ * fetch traces.
+ */
+isc_result_t
+named_server_fetchtrace(named_server_t *server, isc_lex_t *lex,
+			isc_buffer_t **text);
@@ -32,6 +32,7 @@
 #include <isc/fips.h>
 #include <isc/hash.h>
 #include <isc/httpd.h>
+#include <isc/loop.h>
 #include <isc/managers.h>
 #include <isc/netmgr.h>
 #include <isc/os.h>
@@ -306,8 +307,8 @@ library_unexpected_error(const char *file, int line, const char *func,
 
 static void
 usage(void) {
-	fprintf(stderr, "usage: named [-4|-6] [-c conffile] [-d debuglevel] "
-			"[-D comment] [-E engine]\n"
+	fprintf(stderr, "usage: named [-4|-6] [-a] [-c conffile] "
+			"[-d debuglevel] [-D comment] [-E engine]\n"
 			"             [-f|-g] [-L logfile] [-n number_of_cpus] "
 			"[-p port] [-s]\n"
 			"             [-S sockets] [-t chrootdir] [-u "
@@ -881,6 +882,9 @@ parse_command_line(int argc, char *argv[]) {
 			isc_net_disableipv4();
 			disable4 = true;
 			break;
+		case 'a':
+			isc_loopmgr_affinity = true;
+			break;
 		case 'A':
 			parse_fuzz_arg();
 			break;
@@ -1038,6 +1042,14 @@ create_managers(void) {
 		named_g_cpus_detected, named_g_cpus_detected == 1 ? "" : "s",
 		named_g_cpus, named_g_cpus == 1 ? "" : "s");
 
+	if (isc_loopmgr_affinity) {
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+			      "pinning worker threads to CPUs on %u NUMA "
+			      "node%s", isc_os_numanodes(),
+			      isc_os_numanodes() == 1 ? "" : "s");
+	}
+
 	isc_managers_create(&named_g_mctx, named_g_cpus, &named_g_loopmgr,
 			    &named_g_netmgr);
 
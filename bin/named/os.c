@@ -66,6 +66,13 @@ static int dfd[2] = { -1, -1 };
 static bool non_root = false;
 static bool non_root_caps = false;
 
+/*
+ * Whether the listeners that were configured last need CAP_NET_RAW
+ * and CAP_BPF; see named_os_listenerprivs().
+ */
+static bool keep_net_raw = true;
+static bool keep_bpf = true;
+
 #include <sys/capability.h>
 #include <sys/prctl.h>
 
@@ -151,6 +158,23 @@ linux_initialprivs(void) {
 	 */
 	SET_CAP(CAP_NET_BIND_SERVICE);
 
+#if HAVE_DECL_TPACKET_V3
+	/*
+	 * The "raw-udp" listeners need to open AF_PACKET sockets.  The
+	 * configuration hasn't been read yet, so keep this until
+	 * named_os_listenerprivs() knows whether there are any.
+	 */
+	SET_CAP(CAP_NET_RAW);
+#endif /* HAVE_DECL_TPACKET_V3 */
+
+#if HAVE_DECL_BPF_MAP_TYPE_REUSEPORT_SOCKARRAY && defined(CAP_BPF)
+	/*
+	 * The "steering cpu" listeners need to load a BPF program.  Like
+	 * CAP_NET_RAW, this is kept until the configuration is read.
+	 */
+	SET_CAP(CAP_BPF);
+#endif /* HAVE_DECL_BPF_MAP_TYPE_REUSEPORT_SOCKARRAY && defined(CAP_BPF) */
+
 	/*
 	 * We need chroot() initially too.
 	 */
@@ -212,6 +236,24 @@ linux_minprivs(void) {
 
 	SET_CAP(CAP_NET_BIND_SERVICE);
 
+#if HAVE_DECL_TPACKET_V3
+	/*
+	 * The "raw-udp" listeners are (re)created on interface rescans.
+	 */
+	if (keep_net_raw) {
+		SET_CAP(CAP_NET_RAW);
+	}
+#endif /* HAVE_DECL_TPACKET_V3 */
+
+#if HAVE_DECL_BPF_MAP_TYPE_REUSEPORT_SOCKARRAY && defined(CAP_BPF)
+	/*
+	 * So are the "steering cpu" listeners.
+	 */
+	if (keep_bpf) {
+		SET_CAP(CAP_BPF);
+	}
+#endif /* HAVE_DECL_BPF_MAP_TYPE_REUSEPORT_SOCKARRAY && defined(CAP_BPF) */
+
 	/*
 	 * XXX  We might want to add CAP_SYS_RESOURCE, though it's not
 	 *      clear it would work right given the way linuxthreads work.
@@ -665,6 +707,40 @@ named_os_minprivs(void) {
 #endif /* HAVE_LIBCAP */
 }
 
+void
+named_os_listenerprivs(bool raw_udp, bool steer_cpu) {
+#if HAVE_LIBCAP
+	bool drop = false;
+
+	if (raw_udp && !keep_net_raw) {
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_MAIN, ISC_LOG_WARNING,
+			      "CAP_NET_RAW has been dropped: restart named "
+			      "to use the new raw-udp listeners");
+	} else if (!raw_udp && keep_net_raw) {
+		keep_net_raw = false;
+		drop = true;
+	}
+
+	if (steer_cpu && !keep_bpf) {
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_MAIN, ISC_LOG_WARNING,
+			      "CAP_BPF has been dropped: restart named "
+			      "to use the new 'steering cpu' listeners");
+	} else if (!steer_cpu && keep_bpf) {
+		keep_bpf = false;
+		drop = true;
+	}
+
+	if (drop) {
+		linux_minprivs();
+	}
+#else  /* HAVE_LIBCAP */
+	UNUSED(raw_udp);
+	UNUSED(steer_cpu);
+#endif /* HAVE_LIBCAP */
+}
+
 static int
 safe_open(const char *filename, mode_t mode, bool append) {
 	int fd;
@@ -91,11 +91,13 @@
 #include <dns/peer.h>
 #include <dns/private.h>
 #include <dns/rbt.h>
+#include <dns/rcode.h>
 #include <dns/rdataclass.h>
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdatastruct.h>
 #include <dns/resolver.h>
+#include <dns/respcache.h>
 #include <dns/rootns.h>
 #include <dns/rriterator.h>
 #include <dns/secalg.h>
@@ -120,6 +122,7 @@
 #include <ns/hooks.h>
 #include <ns/interfacemgr.h>
 #include <ns/listenlist.h>
+#include <ns/xfrcache.h>
 
 #include <named/config.h>
 #include <named/control.h>
@@ -452,6 +455,9 @@ listenlist_fromconfig(const cfg_obj_t *listenlist, const cfg_obj_t *config,
 		      isc_tlsctx_cache_t *tlsctx_cache,
 		      ns_listenlist_t **target);
 
+static void
+listenlist_privs(const ns_listenlist_t *list, bool *raw_udp, bool *steer_cpu);
+
 static isc_result_t
 configure_forward(const cfg_obj_t *config, dns_view_t *view,
 		  const dns_name_t *origin, const cfg_obj_t *forwarders,
@@ -3194,7 +3200,7 @@ cleanup:
 		} else {                                                    \
 			rrl->rate.r = def;                                  \
 		}                                                           \
-		rrl->rate.scaled = rrl->rate.r;                             \
+		atomic_init(&rrl->rate.scaled, rrl->rate.r);                \
 	} while (0)
 
 static isc_result_t
@@ -3268,7 +3274,6 @@ configure_rrl(dns_view_t *view, const cfg_obj_t *config, const cfg_obj_t *map) {
 		CHECK_RRL(i >= 1, "invalid 'qps-scale %d'%s", i, "");
 	}
 	rrl->qps_scale = i;
-	rrl->qps = 1.0;
 
 	i = 24;
 	obj = NULL;
@@ -3733,7 +3738,7 @@ configure_dnstap(const cfg_obj_t **maps, dns_view_t *view) {
 
 	if (named_g_server->dtenv == NULL && dttypes != 0) {
 		dns_dtmode_t dmode;
-		uint64_t max_size = 0;
+		uint64_t max_size = 0, ringsize = 0;
 		uint32_t rolls = 0;
 		isc_log_rollsuffix_t suffix = isc_log_rollsuffix_increment;
 
@@ -3786,6 +3791,12 @@ configure_dnstap(const cfg_obj_t **maps, dns_view_t *view) {
 			suffix = isc_log_rollsuffix_timestamp;
 		}
 
+		obj = NULL;
+		result = named_config_get(maps, "dnstap-ring-size", &obj);
+		if (result == ISC_R_SUCCESS && dmode == dns_dtmode_file) {
+			ringsize = ISC_MIN(cfg_obj_asuint64(obj), SIZE_MAX / 2);
+		}
+
 		fopt = fstrm_iothr_options_init();
 		/*
 		 * Both network threads and worker threads may log dnstap data.
@@ -3854,9 +3865,17 @@ configure_dnstap(const cfg_obj_t **maps, dns_view_t *view) {
 			fstrm_iothr_options_set_reopen_interval(fopt, i);
 		}
 
-		CHECKM(dns_dt_create(named_g_mctx, dmode, dpath, &fopt,
-				     named_g_mainloop, &named_g_server->dtenv),
-		       "unable to create dnstap environment");
+		if (ringsize != 0) {
+			CHECKM(dns_dt_createring(named_g_mctx, dpath, ringsize,
+						 named_g_mainloop,
+						 &named_g_server->dtenv),
+			       "unable to create dnstap environment");
+		} else {
+			CHECKM(dns_dt_create(named_g_mctx, dmode, dpath, &fopt,
+					     named_g_mainloop,
+					     &named_g_server->dtenv),
+			       "unable to create dnstap environment");
+		}
 
 		CHECKM(dns_dt_setupfile(named_g_server->dtenv, max_size, rolls,
 					suffix),
@@ -3903,6 +3922,98 @@ cleanup:
 
 	return (result);
 }
+
+static isc_result_t
+configure_dnstapfilter(dns_view_t *view, const cfg_obj_t *config,
+		       const cfg_obj_t *map) {
+	isc_result_t result = ISC_R_SUCCESS;
+	const cfg_obj_t *obj = NULL;
+	const cfg_listelt_t *element = NULL;
+	dns_dtfilter_t *filter = NULL;
+	dns_nametree_t *qnames = NULL;
+	dns_acl_t *clients = NULL;
+
+	dns_dtfilter_create(view->mctx, &filter);
+
+	obj = NULL;
+	result = cfg_map_get(map, "sample", &obj);
+	if (result == ISC_R_SUCCESS && cfg_obj_asuint32(obj) > 0) {
+		dns_dtfilter_setsample(filter, cfg_obj_asuint32(obj));
+	}
+
+	obj = NULL;
+	result = cfg_map_get(map, "latency", &obj);
+	if (result == ISC_R_SUCCESS) {
+		dns_dtfilter_setlatency(filter, cfg_obj_asuint32(obj));
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(map, "rcodes", &obj);
+	for (element = cfg_list_first(obj); element != NULL;
+	     element = cfg_list_next(element))
+	{
+		isc_textregion_t r;
+		dns_rcode_t rcode;
+
+		r.base = UNCONST(cfg_obj_asstring(cfg_listelt_value(element)));
+		r.length = strlen(r.base);
+
+		result = dns_rcode_fromtext(&rcode, &r);
+		if (result != ISC_R_SUCCESS || rcode > 15) {
+			cfg_obj_log(cfg_listelt_value(element), named_g_lctx,
+				    ISC_LOG_ERROR,
+				    "invalid dnstap-filter rcode '%s'", r.base);
+			CHECK(ISC_R_FAILURE);
+		}
+		dns_dtfilter_addrcode(filter, rcode);
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(map, "qnames", &obj);
+	if (obj != NULL) {
+		dns_nametree_create(view->mctx, DNS_NAMETREE_BOOL,
+				    "dnstap-filter", &qnames);
+		for (element = cfg_list_first(obj); element != NULL;
+		     element = cfg_list_next(element))
+		{
+			const char *str =
+				cfg_obj_asstring(cfg_listelt_value(element));
+			dns_fixedname_t fixed;
+			dns_name_t *name = dns_fixedname_initname(&fixed);
+
+			CHECK(dns_name_fromstring(name, str, dns_rootname, 0,
+						  NULL));
+			result = dns_nametree_add(qnames, name, true);
+			if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS) {
+				goto cleanup;
+			}
+		}
+		dns_dtfilter_setqnames(filter, qnames);
+	}
+
+	obj = NULL;
+	result = cfg_map_get(map, "clients", &obj);
+	if (result == ISC_R_SUCCESS) {
+		CHECK(cfg_acl_fromconfig(obj, config, named_g_lctx,
+					 named_g_aclconfctx, named_g_mctx, 0,
+					 &clients));
+		dns_dtfilter_setclients(filter, clients);
+	}
+
+	dns_dtfilter_attach(filter, &view->dtfilter);
+	result = ISC_R_SUCCESS;
+
+cleanup:
+	if (clients != NULL) {
+		dns_acl_detach(&clients);
+	}
+	if (qnames != NULL) {
+		dns_nametree_detach(&qnames);
+	}
+	dns_dtfilter_detach(&filter);
+
+	return (result);
+}
 #endif /* HAVE_DNSTAP */
 
 static isc_result_t
@@ -4037,6 +4148,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	dns_cache_t *cache = NULL;
 	isc_result_t result;
 	size_t max_cache_size;
+	uint64_t respcache_size;
 	uint32_t max_cache_size_percent = 0;
 	size_t max_adb_size;
 	uint32_t lame_ttl, fail_ttl;
@@ -4063,6 +4175,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	const cfg_obj_t *disablelist = NULL;
 	isc_stats_t *resstats = NULL;
 	dns_stats_t *resquerystats = NULL;
+	dns_stats_t *latencystats = NULL;
 	bool auto_root = false;
 	named_cache_t *nsc;
 	bool zero_no_soattl;
@@ -4556,11 +4669,22 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 				   view->rdclass, &pview);
 	if (result == ISC_R_SUCCESS) {
 		view->staleanswersok = pview->staleanswersok;
+		dns_view_getlatencystats(pview, &latencystats);
 		dns_view_detach(&pview);
 	} else {
 		view->staleanswersok = dns_stale_answer_conf;
 	}
 
+	/*
+	 * The query latency statistics carry over from the view being
+	 * replaced, like the resolver statistics do.
+	 */
+	if (latencystats == NULL) {
+		dns_latencystats_create(mctx, &latencystats);
+	}
+	dns_view_setlatencystats(view, latencystats);
+	dns_stats_detach(&latencystats);
+
 	obj = NULL;
 	result = named_config_get(maps, "stale-answer-client-timeout", &obj);
 	INSIST(result == ISC_R_SUCCESS);
@@ -4709,6 +4833,11 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	dns_cache_setservestalettl(cache, max_stale_ttl);
 	dns_cache_setservestalerefresh(cache, stale_refresh_time);
 
+	obj = NULL;
+	result = named_config_get(maps, "loop-cache-size", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_cache_setloopcachesize(cache, cfg_obj_asuint32(obj));
+
 	dns_cache_detach(&cache);
 
 	obj = NULL;
@@ -5922,6 +6051,26 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	}
 	dns_view_setfailttl(view, fail_ttl);
 
+	/*
+	 * Set up the pre-rendered response cache.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "response-cache-size", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	respcache_size = cfg_obj_asuint64(obj);
+	if (respcache_size != 0) {
+		if (respcache_size > SIZE_MAX) {
+			cfg_obj_log(obj, named_g_lctx, ISC_LOG_WARNING,
+				    "'response-cache-size "
+				    "%" PRIu64 "' is too large for this "
+				    "system; reducing to %lu",
+				    respcache_size, (unsigned long)SIZE_MAX);
+			respcache_size = SIZE_MAX;
+		}
+		view->respcache = dns_respcache_new(mctx,
+						    (size_t)respcache_size);
+	}
+
 	/*
 	 * Name space to look up redirect information in.
 	 */
@@ -5967,6 +6116,12 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	 * types to log.
 	 */
 	CHECK(configure_dnstap(maps, view));
+
+	obj = NULL;
+	result = named_config_get(maps, "dnstap-filter", &obj);
+	if (result == ISC_R_SUCCESS && view->dtenv != NULL) {
+		CHECK(configure_dnstapfilter(view, config, obj));
+	}
 #endif /* HAVE_DNSTAP */
 
 	result = ISC_R_SUCCESS;
@@ -8230,6 +8385,7 @@ load_configuration(const char *filename, named_server_t *server,
 	uint64_t initial, idle, keepalive, advertised;
 	bool loadbalancesockets;
 	bool exclusive = true;
+	bool raw_udp = false, steer_cpu = false;
 	dns_aclenv_t *env =
 		ns_interfacemgr_getaclenv(named_g_server->interfacemgr);
 
@@ -8594,6 +8750,18 @@ load_configuration(const char *filename, named_server_t *server,
 
 #undef CAP_IF_NOT_ZERO
 
+	obj = NULL;
+	result = named_config_get(maps, "udp-send-batching", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+#if HAVE_UDP_SEND_BATCHING
+	isc_nm_setudpsendbatching(named_g_netmgr, cfg_obj_asboolean(obj));
+#else
+	if (cfg_obj_asboolean(obj)) {
+		cfg_obj_log(obj, named_g_lctx, ISC_LOG_WARNING,
+			    "udp-send-batching has no effect on this system");
+	}
+#endif
+
 	/*
 	 * Configure sets of UDP query source ports.
 	 */
@@ -8715,6 +8883,13 @@ load_configuration(const char *filename, named_server_t *server,
 	server->sctx->transfer_tcp_message_size =
 		(uint16_t)transfer_message_size;
 
+	/* Set the memory budget for rendered outgoing transfers */
+	obj = NULL;
+	result = named_config_get(maps, "transfer-cache-size", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	ns_xfrcache_setsize(server->sctx->xfrcache,
+			    ISC_MIN(cfg_obj_asuint64(obj), SIZE_MAX));
+
 	/*
 	 * Configure the zone manager.
 	 */
@@ -8744,6 +8919,11 @@ load_configuration(const char *filename, named_server_t *server,
 	INSIST(result == ISC_R_SUCCESS);
 	dns_zonemgr_setserialqueryrate(server->zonemgr, cfg_obj_asuint32(obj));
 
+	obj = NULL;
+	result = named_config_get(maps, "zone-load-concurrency", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_zonemgr_setloadconcurrency(server->zonemgr, cfg_obj_asuint32(obj));
+
 	/*
 	 * Determine which port to use for listening for incoming connections.
 	 */
@@ -8822,6 +9002,7 @@ load_configuration(const char *filename, named_server_t *server,
 		}
 
 		if (listenon != NULL) {
+			listenlist_privs(listenon, &raw_udp, &steer_cpu);
 			ns_interfacemgr_setlistenon4(server->interfacemgr,
 						     listenon);
 			ns_listenlist_detach(&listenon);
@@ -8855,12 +9036,18 @@ load_configuration(const char *filename, named_server_t *server,
 			goto cleanup_v6portset;
 		}
 		if (listenon != NULL) {
+			listenlist_privs(listenon, &raw_udp, &steer_cpu);
 			ns_interfacemgr_setlistenon6(server->interfacemgr,
 						     listenon);
 			ns_listenlist_detach(&listenon);
 		}
 	}
 
+	/*
+	 * Give up the capabilities that only some listeners need.
+	 */
+	named_os_listenerprivs(raw_udp, steer_cpu);
+
 	if (first_time) {
 		/*
 		 * Rescan the interface list to pick up changes in the
@@ -9898,6 +10085,7 @@ run_server(void *arg) {
 	dns_geoip_databases_t *geoip = NULL;
 
 	dns_zonemgr_create(named_g_mctx, named_g_netmgr, &server->zonemgr);
+	dns_zonemgr_setstats(server->zonemgr, server->zonestats);
 
 	CHECKFATAL(dns_dispatchmgr_create(named_g_mctx, named_g_loopmgr,
 					  named_g_netmgr, &named_g_dispatchmgr),
@@ -11056,6 +11244,20 @@ cleanup:
 	return (result);
 }
 
+/*
+ * Note whether any listener in 'list' needs the privileges kept for
+ * "raw-udp" or "steering cpu".
+ */
+static void
+listenlist_privs(const ns_listenlist_t *list, bool *raw_udp, bool *steer_cpu) {
+	for (const ns_listenelt_t *elt = ISC_LIST_HEAD(list->elts);
+	     elt != NULL; elt = ISC_LIST_NEXT(elt, link))
+	{
+		*raw_udp = *raw_udp || elt->raw_udp;
+		*steer_cpu = *steer_cpu || elt->steer_cpu;
+	}
+}
+
 static const cfg_obj_t *
 find_maplist(const cfg_obj_t *config, const char *listname, const char *name) {
 	isc_result_t result;
@@ -11099,6 +11301,8 @@ listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 	const cfg_obj_t *portobj = NULL;
 	const cfg_obj_t *http_server = NULL;
 	const cfg_obj_t *proxyobj = NULL;
+	const cfg_obj_t *rawobj = NULL;
+	const cfg_obj_t *steerobj = NULL;
 	in_port_t port = 0;
 	const char *key = NULL, *cert = NULL, *ca_file = NULL,
 		   *dhparam_file = NULL, *ciphers = NULL, *cipher_suites = NULL;
@@ -11328,6 +11532,17 @@ listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 		CHECK(ns_listenelt_create(mctx, port, NULL, family, do_tls,
 					  &tls_params, tlsctx_cache, proxy,
 					  &delt));
+
+		rawobj = cfg_tuple_get(ltup, "raw-udp");
+		if (rawobj != NULL && cfg_obj_isboolean(rawobj)) {
+			delt->raw_udp = cfg_obj_asboolean(rawobj);
+		}
+
+		steerobj = cfg_tuple_get(ltup, "steering");
+		if (steerobj != NULL && cfg_obj_isstring(steerobj)) {
+			delt->steer_cpu = (strcasecmp(cfg_obj_asstring(steerobj),
+						      "cpu") == 0);
+		}
 	}
 
 	result = cfg_acl_fromconfig(cfg_tuple_get(listener, "acl"), config,
@@ -16563,3 +16778,95 @@ cleanup:
 
 	return (result);
 }
+
+isc_result_t
+named_server_fetchtrace(named_server_t *server, isc_lex_t *lex,
+			isc_buffer_t **text) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_view_t *view = NULL;
+	char *ptr = NULL, *viewname = NULL;
+	bool first = true, setrate = false;
+	unsigned int rate = 0;
+
+	REQUIRE(text != NULL);
+
+	/* Skip the command name. */
+	ptr = next_token(lex, text);
+	if (ptr == NULL) {
+		return (ISC_R_UNEXPECTEDEND);
+	}
+
+	ptr = next_token(lex, text);
+	if (ptr != NULL && strcasecmp(ptr, "-rate") == 0) {
+		ptr = next_token(lex, text);
+		if (ptr == NULL) {
+			return (ISC_R_UNEXPECTEDEND);
+		}
+		if (sscanf(ptr, "%u", &rate) != 1) {
+			return (ISC_R_BADNUMBER);
+		}
+		setrate = true;
+		ptr = next_token(lex, text);
+	}
+
+	/* Look for the view name. */
+	viewname = ptr;
+	for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		char tbuf[100];
+		unsigned int used;
+		uint32_t val;
+		int s;
+
+		if (view->rdclass != dns_rdataclass_in ||
+		    view->resolver == NULL)
+		{
+			continue;
+		}
+
+		if (viewname != NULL && strcasecmp(view->name, viewname) != 0) {
+			continue;
+		}
+
+		if (setrate) {
+			dns_resolver_setfetchtrace(view->resolver, rate);
+		}
+
+		if (!first) {
+			CHECK(putstr(text, "\n"));
+		}
+		first = false;
+
+		CHECK(putstr(text, "Fetch traces, view "));
+		CHECK(putstr(text, view->name));
+		val = dns_resolver_getfetchtrace(view->resolver);
+		if (val == 0) {
+			s = snprintf(tbuf, sizeof(tbuf), " (tracing off)");
+		} else {
+			s = snprintf(tbuf, sizeof(tbuf), " (1 in %u fetches)",
+				     val);
+		}
+		if (s < 0 || (unsigned int)s > sizeof(tbuf)) {
+			CHECK(ISC_R_NOSPACE);
+		}
+		CHECK(putstr(text, tbuf));
+
+		if (setrate) {
+			continue;
+		}
+
+		CHECK(putstr(text, ":"));
+		used = isc_buffer_usedlength(*text);
+		CHECK(dns_resolver_dumpfetchtrace(view->resolver, text));
+		if (used == isc_buffer_usedlength(*text)) {
+			CHECK(putstr(text, "\n  None."));
+		}
+	}
+cleanup:
+	if (isc_buffer_usedlength(*text) > 0) {
+		(void)putnull(text);
+	}
+
+	return (result);
+}
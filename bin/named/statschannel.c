@@ -97,6 +97,20 @@ typedef struct stats_dumparg {
 	isc_result_t result;
 } stats_dumparg_t;
 
+/*%
+ * State for rendering in the OpenMetrics text format.  The samples are
+ * written straight into 'buffer' as they are dumped, as
+ * '<name>{<labels>,<key>="<counter>"} <value>'.
+ */
+typedef struct metrics {
+	isc_buffer_t *buffer;
+	const char *name;    /* metric family */
+	const char *labels;  /* labels common to the samples, or "" */
+	const char *key;     /* label for the counter name */
+	const bool *isgauge; /* which of the counters are gauges */
+	bool gauges;	     /* render the gauges rather than the counters */
+} metrics_t;
+
 static isc_once_t once = ISC_ONCE_INIT;
 
 #if defined(HAVE_LIBXML2) || defined(HAVE_JSON_C)
@@ -159,7 +173,6 @@ static const char *tcpinsizestats_desc[dns_sizecounter_in_max];
 static const char *tcpoutsizestats_desc[dns_sizecounter_out_max];
 static const char *dnstapstats_desc[dns_dnstapcounter_max];
 static const char *gluecachestats_desc[dns_gluecachestatscounter_max];
-#if defined(EXTENDED_STATS)
 static const char *nsstats_xmldesc[ns_statscounter_max];
 static const char *resstats_xmldesc[dns_resstatscounter_max];
 static const char *adbstats_xmldesc[dns_adbstats_max];
@@ -172,20 +185,17 @@ static const char *tcpinsizestats_xmldesc[dns_sizecounter_in_max];
 static const char *tcpoutsizestats_xmldesc[dns_sizecounter_out_max];
 static const char *dnstapstats_xmldesc[dns_dnstapcounter_max];
 static const char *gluecachestats_xmldesc[dns_gluecachestatscounter_max];
-#else /* if defined(EXTENDED_STATS) */
-#define nsstats_xmldesc		NULL
-#define resstats_xmldesc	NULL
-#define adbstats_xmldesc	NULL
-#define zonestats_xmldesc	NULL
-#define sockstats_xmldesc	NULL
-#define dnssecstats_xmldesc	NULL
-#define udpinsizestats_xmldesc	NULL
-#define udpoutsizestats_xmldesc NULL
-#define tcpinsizestats_xmldesc	NULL
-#define tcpoutsizestats_xmldesc NULL
-#define dnstapstats_xmldesc	NULL
-#define gluecachestats_xmldesc	NULL
-#endif /* EXTENDED_STATS */
+
+/*%
+ * The counters that are really gauges, going up and down or recording
+ * a high-water mark, rather than counting events.  The OpenMetrics
+ * renderer puts these in a separate metric family.
+ */
+static bool nsstats_gauge[ns_statscounter_max];
+static bool resstats_gauge[dns_resstatscounter_max];
+static bool adbstats_gauge[dns_adbstats_max];
+static bool zonestats_gauge[dns_zonestatscounter_max];
+static bool sockstats_gauge[isc_sockstatscounter_max];
 
 #define TRY0(a)                       \
 	do {                          \
@@ -217,17 +227,10 @@ set_desc(int counter, int maxcounter, const char *fdesc, const char **fdescs,
 	 const char *xdesc, const char **xdescs) {
 	REQUIRE(counter < maxcounter);
 	REQUIRE(fdescs != NULL && fdescs[counter] == NULL);
-#if defined(EXTENDED_STATS)
 	REQUIRE(xdescs != NULL && xdescs[counter] == NULL);
-#endif /* if defined(EXTENDED_STATS) */
 
 	fdescs[counter] = fdesc;
-#if defined(EXTENDED_STATS)
 	xdescs[counter] = xdesc;
-#else  /* if defined(EXTENDED_STATS) */
-	UNUSED(xdesc);
-	UNUSED(xdescs);
-#endif /* if defined(EXTENDED_STATS) */
 }
 
 static const char *
@@ -261,12 +264,11 @@ init_desc(void) {
 	/* Initialize name server statistics */
 	for (i = 0; i < ns_statscounter_max; i++) {
 		nsstats_desc[i] = NULL;
+		nsstats_gauge[i] = false;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < ns_statscounter_max; i++) {
 		nsstats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_NSSTATDESC(counterid, desc, xmldesc)                           \
 	do {                                                               \
@@ -274,6 +276,11 @@ init_desc(void) {
 			 desc, nsstats_desc, xmldesc, nsstats_xmldesc);    \
 		nsstats_index[i++] = ns_statscounter_##counterid;          \
 	} while (0)
+#define SET_NSSTATGAUGE(counterid, desc, xmldesc)            \
+	do {                                                 \
+		nsstats_gauge[ns_statscounter_##counterid] = true; \
+		SET_NSSTATDESC(counterid, desc, xmldesc);     \
+	} while (0)
 
 	i = 0;
 	SET_NSSTATDESC(requestv4, "IPv4 requests received", "Requestv4");
@@ -287,8 +294,8 @@ init_desc(void) {
 	SET_NSSTATDESC(invalidsig, "requests with invalid signature",
 		       "ReqBadSIG");
 	SET_NSSTATDESC(requesttcp, "TCP requests received", "ReqTCP");
-	SET_NSSTATDESC(tcphighwater, "TCP connection high-water",
-		       "TCPConnHighWater");
+	SET_NSSTATGAUGE(tcphighwater, "TCP connection high-water",
+		        "TCPConnHighWater");
 	SET_NSSTATDESC(authrej, "auth queries rejected", "AuthQryRej");
 	SET_NSSTATDESC(recurserej, "recursive queries rejected", "RecQryRej");
 	SET_NSSTATDESC(xfrrej, "transfer requests rejected", "XfrRej");
@@ -327,9 +334,9 @@ init_desc(void) {
 	SET_NSSTATDESC(updatebadprereq,
 		       "updates rejected due to prerequisite failure",
 		       "UpdateBadPrereq");
-	SET_NSSTATDESC(recurshighwater, "Recursive clients high-water",
-		       "RecursHighwater");
-	SET_NSSTATDESC(recursclients, "recursing clients", "RecursClients");
+	SET_NSSTATGAUGE(recurshighwater, "Recursive clients high-water",
+		        "RecursHighwater");
+	SET_NSSTATGAUGE(recursclients, "recursing clients", "RecursClients");
 	SET_NSSTATDESC(dns64, "queries answered by DNS64", "DNS64");
 	SET_NSSTATDESC(ratedropped, "responses dropped for rate limits",
 		       "RateDropped");
@@ -379,18 +386,22 @@ init_desc(void) {
 		       "queries dropped due to recursive client limit",
 		       "RecLimitDropped");
 	SET_NSSTATDESC(updatequota, "Update quota exceeded", "UpdateQuota");
+	SET_NSSTATDESC(respcachehit, "responses sent from the response cache",
+		       "RespCacheHit");
+	SET_NSSTATDESC(respcachemiss,
+		       "queries not found in the response cache",
+		       "RespCacheMiss");
 
 	INSIST(i == ns_statscounter_max);
 
 	/* Initialize resolver statistics */
 	for (i = 0; i < dns_resstatscounter_max; i++) {
 		resstats_desc[i] = NULL;
+		resstats_gauge[i] = false;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < dns_resstatscounter_max; i++) {
 		resstats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_RESSTATDESC(counterid, desc, xmldesc)                      \
 	do {                                                           \
@@ -399,6 +410,11 @@ init_desc(void) {
 			 xmldesc, resstats_xmldesc);                   \
 		resstats_index[i++] = dns_resstatscounter_##counterid; \
 	} while (0)
+#define SET_RESSTATGAUGE(counterid, desc, xmldesc)                 \
+	do {                                                       \
+		resstats_gauge[dns_resstatscounter_##counterid] = true; \
+		SET_RESSTATDESC(counterid, desc, xmldesc);          \
+	} while (0)
 
 	i = 0;
 	SET_RESSTATDESC(queryv4, "IPv4 queries sent", "Queryv4");
@@ -418,8 +434,8 @@ init_desc(void) {
 			"QueryAbort");
 	SET_RESSTATDESC(dispsockfail, "failures in opening query sockets",
 			"QuerySockFail");
-	SET_RESSTATDESC(disprequdp, "UDP queries in progress", "QueryCurUDP");
-	SET_RESSTATDESC(dispreqtcp, "TCP queries in progress", "QueryCurTCP");
+	SET_RESSTATGAUGE(disprequdp, "UDP queries in progress", "QueryCurUDP");
+	SET_RESSTATGAUGE(dispreqtcp, "TCP queries in progress", "QueryCurTCP");
 	SET_RESSTATDESC(querytimeout, "query timeouts", "QueryTimeout");
 	SET_RESSTATDESC(gluefetchv4, "IPv4 NS address fetches", "GlueFetchv4");
 	SET_RESSTATDESC(gluefetchv6, "IPv6 NS address fetches", "GlueFetchv6");
@@ -454,8 +470,8 @@ init_desc(void) {
 	SET_RESSTATDESC(queryrtt5,
 			"queries with RTT > " DNS_RESOLVER_QRYRTTCLASS4STR "ms",
 			"QryRTT" DNS_RESOLVER_QRYRTTCLASS4STR "+");
-	SET_RESSTATDESC(nfetch, "active fetches", "NumFetch");
-	SET_RESSTATDESC(buckets, "bucket size", "BucketSize");
+	SET_RESSTATGAUGE(nfetch, "active fetches", "NumFetch");
+	SET_RESSTATGAUGE(buckets, "bucket size", "BucketSize");
 	SET_RESSTATDESC(refused, "REFUSED received", "REFUSED");
 	SET_RESSTATDESC(cookienew, "COOKIE send with client cookie only",
 			"ClientCookieOut");
@@ -472,18 +488,29 @@ init_desc(void) {
 			"ClientQuota");
 	SET_RESSTATDESC(nextitem, "waited for next item", "NextItem");
 	SET_RESSTATDESC(priming, "priming queries", "Priming");
+	SET_RESSTATGAUGE(verifyqueued, "signature verifications queued",
+			 "VerifyQueued");
+	SET_RESSTATDESC(verifybatches, "signature verification batches",
+			"VerifyBatches");
+	SET_RESSTATDESC(verifybatched, "signatures verified in batches",
+			"VerifyBatched");
+	SET_RESSTATGAUGE(verifybatchmax, "largest signature verification batch",
+			 "VerifyBatchMax");
+	SET_RESSTATDESC(sigcachehit, "verified signature cache hits",
+			"SigCacheHit");
+	SET_RESSTATDESC(sigcachemiss, "verified signature cache misses",
+			"SigCacheMiss");
 
 	INSIST(i == dns_resstatscounter_max);
 
 	/* Initialize adb statistics */
 	for (i = 0; i < dns_adbstats_max; i++) {
 		adbstats_desc[i] = NULL;
+		adbstats_gauge[i] = false;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < dns_adbstats_max; i++) {
 		adbstats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_ADBSTATDESC(id, desc, xmldesc)                          \
 	do {                                                        \
@@ -491,23 +518,27 @@ init_desc(void) {
 			 adbstats_desc, xmldesc, adbstats_xmldesc); \
 		adbstats_index[i++] = dns_adbstats_##id;            \
 	} while (0)
+#define SET_ADBSTATGAUGE(id, desc, xmldesc)           \
+	do {                                          \
+		adbstats_gauge[dns_adbstats_##id] = true; \
+		SET_ADBSTATDESC(id, desc, xmldesc);    \
+	} while (0)
 	i = 0;
-	SET_ADBSTATDESC(nentries, "Address hash table size", "nentries");
-	SET_ADBSTATDESC(entriescnt, "Addresses in hash table", "entriescnt");
-	SET_ADBSTATDESC(nnames, "Name hash table size", "nnames");
-	SET_ADBSTATDESC(namescnt, "Names in hash table", "namescnt");
+	SET_ADBSTATGAUGE(nentries, "Address hash table size", "nentries");
+	SET_ADBSTATGAUGE(entriescnt, "Addresses in hash table", "entriescnt");
+	SET_ADBSTATGAUGE(nnames, "Name hash table size", "nnames");
+	SET_ADBSTATGAUGE(namescnt, "Names in hash table", "namescnt");
 
 	INSIST(i == dns_adbstats_max);
 
 	/* Initialize zone statistics */
 	for (i = 0; i < dns_zonestatscounter_max; i++) {
 		zonestats_desc[i] = NULL;
+		zonestats_gauge[i] = false;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < dns_zonestatscounter_max; i++) {
 		zonestats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_ZONESTATDESC(counterid, desc, xmldesc)                       \
 	do {                                                             \
@@ -516,6 +547,11 @@ init_desc(void) {
 			 xmldesc, zonestats_xmldesc);                    \
 		zonestats_index[i++] = dns_zonestatscounter_##counterid; \
 	} while (0)
+#define SET_ZONESTATGAUGE(counterid, desc, xmldesc)                  \
+	do {                                                         \
+		zonestats_gauge[dns_zonestatscounter_##counterid] = true; \
+		SET_ZONESTATDESC(counterid, desc, xmldesc);           \
+	} while (0)
 
 	i = 0;
 	SET_ZONESTATDESC(notifyoutv4, "IPv4 notifies sent", "NotifyOutv4");
@@ -532,17 +568,28 @@ init_desc(void) {
 	SET_ZONESTATDESC(xfrsuccess, "transfer requests succeeded",
 			 "XfrSuccess");
 	SET_ZONESTATDESC(xfrfail, "transfer requests failed", "XfrFail");
+	SET_ZONESTATDESC(loadqueued, "zone loads queued", "LoadQueued");
+	SET_ZONESTATGAUGE(loadactive, "zone loads in progress", "LoadActive");
+	SET_ZONESTATDESC(loadsuccess, "zone loads succeeded", "LoadSuccess");
+	SET_ZONESTATDESC(loadfail, "zone loads failed", "LoadFail");
+	SET_ZONESTATDESC(loadbytes, "zone file bytes loaded", "LoadBytes");
+	SET_ZONESTATDESC(loadusecs, "microseconds spent loading zones",
+			 "LoadUsecs");
+	SET_ZONESTATDESC(compactbytes, "journal bytes compacted",
+			 "CompactBytes");
+	SET_ZONESTATDESC(compactusecs,
+			 "microseconds spent compacting journals",
+			 "CompactUsecs");
 	INSIST(i == dns_zonestatscounter_max);
 
 	/* Initialize socket statistics */
 	for (i = 0; i < isc_sockstatscounter_max; i++) {
 		sockstats_desc[i] = NULL;
+		sockstats_gauge[i] = false;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < isc_sockstatscounter_max; i++) {
 		sockstats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_SOCKSTATDESC(counterid, desc, xmldesc)                       \
 	do {                                                             \
@@ -551,6 +598,11 @@ init_desc(void) {
 			 xmldesc, sockstats_xmldesc);                    \
 		sockstats_index[i++] = isc_sockstatscounter_##counterid; \
 	} while (0)
+#define SET_SOCKSTATGAUGE(counterid, desc, xmldesc)                  \
+	do {                                                         \
+		sockstats_gauge[isc_sockstatscounter_##counterid] = true; \
+		SET_SOCKSTATDESC(counterid, desc, xmldesc);           \
+	} while (0)
 
 	i = 0;
 	SET_SOCKSTATDESC(udp4open, "UDP/IPv4 sockets opened", "UDP4Open");
@@ -609,25 +661,35 @@ init_desc(void) {
 	SET_SOCKSTATDESC(udp6recvfail, "UDP/IPv6 recv errors", "UDP6RecvErr");
 	SET_SOCKSTATDESC(tcp4recvfail, "TCP/IPv4 recv errors", "TCP4RecvErr");
 	SET_SOCKSTATDESC(tcp6recvfail, "TCP/IPv6 recv errors", "TCP6RecvErr");
-	SET_SOCKSTATDESC(udp4active, "UDP/IPv4 sockets active", "UDP4Active");
-	SET_SOCKSTATDESC(udp6active, "UDP/IPv6 sockets active", "UDP6Active");
-	SET_SOCKSTATDESC(tcp4active, "TCP/IPv4 sockets active", "TCP4Active");
-	SET_SOCKSTATDESC(tcp6active, "TCP/IPv6 sockets active", "TCP6Active");
-	SET_SOCKSTATDESC(tcp4clients, "TCP/IPv4 clients currently connected",
-			 "TCP4Clients");
-	SET_SOCKSTATDESC(tcp6clients, "TCP/IPv6 clients currently connected",
-			 "TCP6Clients");
+	SET_SOCKSTATGAUGE(udp4active, "UDP/IPv4 sockets active", "UDP4Active");
+	SET_SOCKSTATGAUGE(udp6active, "UDP/IPv6 sockets active", "UDP6Active");
+	SET_SOCKSTATGAUGE(tcp4active, "TCP/IPv4 sockets active", "TCP4Active");
+	SET_SOCKSTATGAUGE(tcp6active, "TCP/IPv6 sockets active", "TCP6Active");
+	SET_SOCKSTATGAUGE(tcp4clients, "TCP/IPv4 clients currently connected",
+			  "TCP4Clients");
+	SET_SOCKSTATGAUGE(tcp6clients, "TCP/IPv6 clients currently connected",
+			  "TCP6Clients");
+	SET_SOCKSTATDESC(udp4sendbatch, "UDP/IPv4 batched send calls",
+			 "UDP4SendBatch");
+	SET_SOCKSTATDESC(udp6sendbatch, "UDP/IPv6 batched send calls",
+			 "UDP6SendBatch");
+	SET_SOCKSTATDESC(udp4sendbatchmsg, "UDP/IPv4 datagrams sent in batches",
+			 "UDP4SendBatchMsg");
+	SET_SOCKSTATDESC(udp6sendbatchmsg, "UDP/IPv6 datagrams sent in batches",
+			 "UDP6SendBatchMsg");
+	SET_SOCKSTATDESC(udp4sendgso, "UDP/IPv4 datagrams sent with GSO",
+			 "UDP4SendGSO");
+	SET_SOCKSTATDESC(udp6sendgso, "UDP/IPv6 datagrams sent with GSO",
+			 "UDP6SendGSO");
 	INSIST(i == isc_sockstatscounter_max);
 
 	/* Initialize DNSSEC statistics */
 	for (i = 0; i < dns_dnssecstats_max; i++) {
 		dnssecstats_desc[i] = NULL;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < dns_dnssecstats_max; i++) {
 		dnssecstats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_DNSSECSTATDESC(counterid, desc, xmldesc)                       \
 	do {                                                               \
@@ -655,11 +717,9 @@ init_desc(void) {
 	for (i = 0; i < dns_dnstapcounter_max; i++) {
 		dnstapstats_desc[i] = NULL;
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < dns_dnstapcounter_max; i++) {
 		dnstapstats_xmldesc[i] = NULL;
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 #define SET_DNSTAPSTATDESC(counterid, desc, xmldesc)                           \
 	do {                                                                   \
@@ -671,6 +731,8 @@ init_desc(void) {
 	i = 0;
 	SET_DNSTAPSTATDESC(success, "dnstap messages written", "DNSTAPsuccess");
 	SET_DNSTAPSTATDESC(drop, "dnstap messages dropped", "DNSTAPdropped");
+	SET_DNSTAPSTATDESC(filtered, "dnstap messages filtered",
+			   "DNSTAPfiltered");
 	INSIST(i == dns_dnstapcounter_max);
 
 #define SET_GLUECACHESTATDESC(counterid, desc, xmldesc)         \
@@ -721,7 +783,6 @@ init_desc(void) {
 	for (i = 0; i < dns_gluecachestatscounter_max; i++) {
 		INSIST(gluecachestats_desc[i] != NULL);
 	}
-#if defined(EXTENDED_STATS)
 	for (i = 0; i < ns_statscounter_max; i++) {
 		INSIST(nsstats_xmldesc[i] != NULL);
 	}
@@ -746,7 +807,6 @@ init_desc(void) {
 	for (i = 0; i < dns_gluecachestatscounter_max; i++) {
 		INSIST(gluecachestats_xmldesc[i] != NULL);
 	}
-#endif /* if defined(EXTENDED_STATS) */
 
 	/* Initialize traffic size statistics */
 
@@ -756,11 +816,9 @@ init_desc(void) {
 		udpoutsizestats_desc[i] = get_histo_desc(
 			"responses sent", i, DNS_SIZEHISTO_MAXOUT, false);
 		tcpoutsizestats_desc[i] = udpoutsizestats_desc[i];
-#if defined(EXTENDED_STATS)
 		udpoutsizestats_xmldesc[i] = get_histo_desc(
 			"responses sent", i, DNS_SIZEHISTO_MAXOUT, true);
 		tcpoutsizestats_xmldesc[i] = udpoutsizestats_xmldesc[i];
-#endif /* if defined(EXTENDED_STATS) */
 	}
 
 	for (i = 0; i <= DNS_SIZEHISTO_MAXIN; i++) {
@@ -769,7 +827,6 @@ init_desc(void) {
 		udpinsizestats_desc[i] = get_histo_desc(
 			"requests received", i, DNS_SIZEHISTO_MAXIN, false);
 		tcpinsizestats_desc[i] = udpinsizestats_desc[i];
-#if defined(EXTENDED_STATS)
 		if (i < DNS_SIZEHISTO_MAXIN) {
 			udpinsizestats_xmldesc[i] = udpoutsizestats_xmldesc[i];
 			tcpinsizestats_xmldesc[i] = tcpoutsizestats_xmldesc[i];
@@ -779,7 +836,6 @@ init_desc(void) {
 					       DNS_SIZEHISTO_MAXIN, true);
 			tcpinsizestats_xmldesc[i] = udpinsizestats_xmldesc[i];
 		}
-#endif /* if defined(EXTENDED_STATS) */
 	}
 }
 
@@ -836,6 +892,35 @@ dump_histo(isc_histomulti_t *hm, isc_statsformat_t type, void *arg,
 }
 #endif /* defined(EXTENDED_STATS) */
 
+static isc_result_t
+metrics_family(metrics_t *metrics, const char *name, const char *type,
+	       const char *help) {
+	metrics->name = name;
+	metrics->labels = "";
+	metrics->isgauge = NULL;
+	metrics->gauges = (strcmp(type, "gauge") == 0);
+
+	return (isc_buffer_printf(metrics->buffer,
+				  "# TYPE %s %s\n# HELP %s %s\n", name, type,
+				  name, help));
+}
+
+static isc_result_t
+metrics_sample(metrics_t *metrics, const char *counter, uint64_t value) {
+	return (isc_buffer_printf(
+		metrics->buffer, "%s%s{%s%s%s=\"%s\"} %" PRIu64 "\n",
+		metrics->name, metrics->gauges ? "" : "_total",
+		metrics->labels, metrics->labels[0] != '\0' ? "," : "",
+		metrics->key, counter, value));
+}
+
+static void
+metrics_dump(stats_dumparg_t *dumparg, const char *counter, uint64_t value) {
+	if (dumparg->result == ISC_R_SUCCESS) {
+		dumparg->result = metrics_sample(dumparg->arg, counter, value);
+	}
+}
+
 static isc_result_t
 dump_counters(isc_statsformat_t type, void *arg, const char *category,
 	      const char **desc, int ncounters, int *indices, uint64_t *values,
@@ -843,6 +928,8 @@ dump_counters(isc_statsformat_t type, void *arg, const char *category,
 	int i, idx;
 	uint64_t value;
 	FILE *fp;
+	metrics_t *metrics;
+	isc_result_t result;
 #ifdef HAVE_LIBXML2
 	void *writer;
 	int xmlrc;
@@ -931,6 +1018,18 @@ dump_counters(isc_statsformat_t type, void *arg, const char *category,
 			json_object_object_add(cat, desc[idx], counter);
 #endif /* ifdef HAVE_JSON_C */
 			break;
+		case isc_statsformat_metrics:
+			metrics = arg;
+			if ((metrics->isgauge != NULL &&
+			     metrics->isgauge[idx]) != metrics->gauges)
+			{
+				break;
+			}
+			result = metrics_sample(metrics, desc[idx], value);
+			if (result != ISC_R_SUCCESS) {
+				return (result);
+			}
+			break;
 		}
 	}
 	return (ISC_R_SUCCESS);
@@ -995,6 +1094,9 @@ rdtypestat_dump(dns_rdatastatstype_t type, uint64_t val, void *arg) {
 		json_object_object_add(zoneobj, typestr, obj);
 #endif /* ifdef HAVE_JSON_C */
 		break;
+	case isc_statsformat_metrics:
+		metrics_dump(dumparg, typestr, val);
+		break;
 	}
 	return;
 #ifdef HAVE_LIBXML2
@@ -1017,6 +1119,7 @@ rdatasetstats_dump(dns_rdatastatstype_t type, uint64_t val, void *arg) {
 	stats_dumparg_t *dumparg = arg;
 	FILE *fp;
 	char typebuf[64];
+	char namebuf[68];
 	const char *typestr;
 	bool nxrrset = false;
 	bool stale = false;
@@ -1084,6 +1187,12 @@ rdatasetstats_dump(dns_rdatastatstype_t type, uint64_t val, void *arg) {
 		json_object_object_add(zoneobj, buf, obj);
 #endif /* ifdef HAVE_JSON_C */
 		break;
+	case isc_statsformat_metrics:
+		snprintf(namebuf, sizeof(namebuf), "%s%s%s%s",
+			 ancient ? "~" : "", stale ? "#" : "",
+			 nxrrset ? "!" : "", typestr);
+		metrics_dump(dumparg, namebuf, val);
+		break;
 	}
 	return;
 #ifdef HAVE_LIBXML2
@@ -1138,6 +1247,9 @@ opcodestat_dump(dns_opcode_t code, uint64_t val, void *arg) {
 		json_object_object_add(zoneobj, codebuf, obj);
 #endif /* ifdef HAVE_JSON_C */
 		break;
+	case isc_statsformat_metrics:
+		metrics_dump(dumparg, codebuf, val);
+		break;
 	}
 	return;
 
@@ -1194,6 +1306,9 @@ rcodestat_dump(dns_rcode_t code, uint64_t val, void *arg) {
 		json_object_object_add(zoneobj, codebuf, obj);
 #endif /* ifdef HAVE_JSON_C */
 		break;
+	case isc_statsformat_metrics:
+		metrics_dump(dumparg, codebuf, val);
+		break;
 	}
 	return;
 
@@ -1207,6 +1322,202 @@ cleanup:
 #endif /* ifdef HAVE_LIBXML2 */
 }
 
+/*%
+ * Query latency summaries.  The quantiles are listed in the decreasing
+ * order that isc_histo_quantiles() wants them in; the values are in
+ * microseconds.
+ */
+static const double latency_fractions[] = { 0.999, 0.99, 0.5 };
+static const char *latency_names[] = { "p999", "p99", "p50" };
+static const char *latency_transports[dns_latency_max] = { "udp", "tcp",
+							   "tls", "https" };
+
+#define LATENCY_QUANTILES ARRAY_SIZE(latency_fractions)
+
+static void
+latency_dump(stats_dumparg_t *dumparg, const char *key, const char *value,
+	     const char *key2, const char *value2, const isc_histomulti_t *hm) {
+	isc_histo_t *hg = NULL;
+	isc_result_t result;
+	uint64_t quantiles[LATENCY_QUANTILES];
+	double count, mean;
+	metrics_t *metrics = NULL;
+	char labels[sizeof("view=\"\"") + DNS_NAME_FORMATSIZE + 64];
+	int n;
+#ifdef HAVE_LIBXML2
+	void *writer;
+	int xmlrc;
+#endif /* ifdef HAVE_LIBXML2 */
+#ifdef HAVE_JSON_C
+	json_object *parent, *summary, *obj;
+#endif /* ifdef HAVE_JSON_C */
+
+	if (dumparg->result != ISC_R_SUCCESS) {
+		return;
+	}
+
+	isc_histomulti_merge(&hg, hm);
+	isc_histo_moments(hg, &count, &mean, NULL);
+	result = isc_histo_quantiles(hg, LATENCY_QUANTILES, latency_fractions,
+				     quantiles);
+	isc_histo_destroy(&hg);
+	if (result != ISC_R_SUCCESS) {
+		/* Nothing recorded */
+		return;
+	}
+
+	switch (dumparg->type) {
+	case isc_statsformat_file:
+		break;
+	case isc_statsformat_xml:
+#ifdef HAVE_LIBXML2
+		writer = dumparg->arg;
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "summary"));
+		TRY0(xmlTextWriterWriteAttribute(writer, ISC_XMLCHAR key,
+						 ISC_XMLCHAR value));
+		if (key2 != NULL) {
+			TRY0(xmlTextWriterWriteAttribute(writer,
+							 ISC_XMLCHAR key2,
+							 ISC_XMLCHAR value2));
+		}
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "counter"));
+		TRY0(xmlTextWriterWriteAttribute(writer, ISC_XMLCHAR "name",
+						 ISC_XMLCHAR "count"));
+		TRY0(xmlTextWriterWriteFormatString(writer, "%.0f", count));
+		TRY0(xmlTextWriterEndElement(writer)); /* counter */
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "counter"));
+		TRY0(xmlTextWriterWriteAttribute(writer, ISC_XMLCHAR "name",
+						 ISC_XMLCHAR "mean"));
+		TRY0(xmlTextWriterWriteFormatString(writer, "%.0f", mean));
+		TRY0(xmlTextWriterEndElement(writer)); /* counter */
+		for (size_t i = LATENCY_QUANTILES; i-- > 0;) {
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counter"));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "name",
+				ISC_XMLCHAR latency_names[i]));
+			TRY0(xmlTextWriterWriteFormatString(
+				writer, "%" PRIu64, quantiles[i]));
+			TRY0(xmlTextWriterEndElement(writer)); /* counter */
+		}
+		TRY0(xmlTextWriterEndElement(writer)); /* summary */
+#endif /* ifdef HAVE_LIBXML2 */
+		break;
+	case isc_statsformat_json:
+#ifdef HAVE_JSON_C
+		parent = dumparg->arg;
+		if (key2 != NULL) {
+			/* e.g. "udp": { "local": {...}, "recursion": {...} } */
+			if (!json_object_object_get_ex(parent, value, &obj)) {
+				obj = json_object_new_object();
+				if (obj == NULL) {
+					goto nomem;
+				}
+				json_object_object_add(parent, value, obj);
+			}
+			parent = obj;
+			value = value2;
+		}
+		summary = json_object_new_object();
+		if (summary == NULL) {
+			goto nomem;
+		}
+		json_object_object_add(parent, value, summary);
+		obj = json_object_new_int64((int64_t)count);
+		if (obj == NULL) {
+			goto nomem;
+		}
+		json_object_object_add(summary, "count", obj);
+		obj = json_object_new_int64((int64_t)mean);
+		if (obj == NULL) {
+			goto nomem;
+		}
+		json_object_object_add(summary, "mean", obj);
+		for (size_t i = LATENCY_QUANTILES; i-- > 0;) {
+			obj = json_object_new_int64(quantiles[i]);
+			if (obj == NULL) {
+				goto nomem;
+			}
+			json_object_object_add(summary, latency_names[i], obj);
+		}
+#endif /* ifdef HAVE_JSON_C */
+		break;
+	case isc_statsformat_metrics:
+		/* An OpenMetrics summary, in seconds */
+		metrics = dumparg->arg;
+		n = snprintf(labels, sizeof(labels), "%s%s%s=\"%s\"",
+			     metrics->labels,
+			     metrics->labels[0] != '\0' ? "," : "", key, value);
+		if (key2 != NULL && (size_t)n < sizeof(labels)) {
+			snprintf(labels + n, sizeof(labels) - n, ",%s=\"%s\"",
+				 key2, value2);
+		}
+		for (size_t i = LATENCY_QUANTILES; i-- > 0;) {
+			result = isc_buffer_printf(
+				metrics->buffer, "%s{%s,quantile=\"%g\"} %.6f\n",
+				metrics->name, labels, latency_fractions[i],
+				(double)quantiles[i] / US_PER_SEC);
+			if (result != ISC_R_SUCCESS) {
+				dumparg->result = result;
+				return;
+			}
+		}
+		dumparg->result = isc_buffer_printf(
+			metrics->buffer, "%s_sum{%s} %.6f\n%s_count{%s} %.0f\n",
+			metrics->name, labels, count * mean / US_PER_SEC,
+			metrics->name, labels, count);
+		break;
+	}
+	return;
+
+#ifdef HAVE_JSON_C
+nomem:
+	dumparg->result = ISC_R_NOMEMORY;
+	return;
+#endif /* ifdef HAVE_JSON_C */
+#ifdef HAVE_LIBXML2
+cleanup:
+	isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+		      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
+		      "failed at latency_dump()");
+	dumparg->result = ISC_R_FAILURE;
+	return;
+#endif /* ifdef HAVE_LIBXML2 */
+}
+
+static void
+latencystat_dump(dns_rdatatype_t type, const isc_histomulti_t *hm,
+		 void *arg) {
+	char typebuf[64];
+	const char *typestr = "Others";
+
+	if (type != 0) {
+		dns_rdatatype_format(type, typebuf, sizeof(typebuf));
+		typestr = typebuf;
+	}
+
+	latency_dump(arg, "qtype", typestr, NULL, NULL, hm);
+}
+
+/*%
+ * Dump the latency summaries of a view by transport and by whether
+ * the answers needed recursion; the ones by query type are dumped
+ * with dns_latencystats_dump() and latencystat_dump().
+ */
+static isc_result_t
+dump_latency(stats_dumparg_t *dumparg, dns_stats_t *stats) {
+	for (int t = 0; t < dns_latency_max; t++) {
+		latency_dump(dumparg, "transport", latency_transports[t],
+			     "answer", "local",
+			     dns_latencystats_get(stats, t, false));
+		latency_dump(dumparg, "transport", latency_transports[t],
+			     "answer", "recursion",
+			     dns_latencystats_get(stats, t, true));
+	}
+
+	return (dumparg->result);
+}
+
 #if defined(EXTENDED_STATS)
 static void
 dnssecsignstat_dump(uint32_t kval, uint64_t val, void *arg) {
@@ -1252,6 +1563,9 @@ dnssecsignstat_dump(uint32_t kval, uint64_t val, void *arg) {
 		json_object_object_add(zoneobj, tagbuf, obj);
 #endif /* ifdef HAVE_JSON_C */
 		break;
+	case isc_statsformat_metrics:
+		metrics_dump(dumparg, tagbuf, val);
+		break;
 	}
 	return;
 #ifdef HAVE_LIBXML2
@@ -1478,6 +1792,8 @@ xfrin_xmlrender(dns_zone_t *zone, void *arg) {
 	unsigned int nmsg = 0;
 	unsigned int nrecs = 0;
 	uint64_t nbytes = 0;
+	uint64_t rate = 0;
+	uint64_t peak = 0;
 
 	statlevel = dns_zone_getstatlevel(zone);
 	if (statlevel == dns_zonestat_none) {
@@ -1691,7 +2007,7 @@ xfrin_xmlrender(dns_zone_t *zone, void *arg) {
 	TRY0(xmlTextWriterEndElement(writer));
 
 	if (is_running) {
-		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes);
+		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes, &rate, &peak);
 	}
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "nmsg"));
 	TRY0(xmlTextWriterWriteFormatString(writer, "%u", nmsg));
@@ -1702,6 +2018,12 @@ xfrin_xmlrender(dns_zone_t *zone, void *arg) {
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "nbytes"));
 	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, nbytes));
 	TRY0(xmlTextWriterEndElement(writer));
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "rate"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, rate));
+	TRY0(xmlTextWriterEndElement(writer));
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "peakmem"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, peak));
+	TRY0(xmlTextWriterEndElement(writer));
 
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "ixfr"));
 	if (is_running && is_first_data_received) {
@@ -2072,6 +2394,21 @@ generatexml(named_server_t *server, uint32_t flags, int *buflen,
 		isc_stats_detach(&istats);
 		TRY0(xmlTextWriterEndElement(writer)); /* </resstats> */
 
+		/* <latency> */
+		dns_view_getlatencystats(view, &dstats);
+		if (dstats != NULL) {
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "latency"));
+			dumparg.result = ISC_R_SUCCESS;
+			if (dump_latency(&dumparg, dstats) == ISC_R_SUCCESS) {
+				dns_latencystats_dump(dstats, latencystat_dump,
+						      &dumparg);
+			}
+			dns_stats_detach(&dstats);
+			CHECK(dumparg.result);
+			TRY0(xmlTextWriterEndElement(writer)); /* </latency> */
+		}
+
 		cacherrstats = dns_db_getrrsetstats(view->cachedb);
 		if (cacherrstats != NULL) {
 			TRY0(xmlTextWriterStartElement(writer,
@@ -2552,6 +2889,8 @@ xfrin_jsonrender(dns_zone_t *zone, void *arg) {
 	unsigned int nmsg = 0;
 	unsigned int nrecs = 0;
 	uint64_t nbytes = 0;
+	uint64_t rate = 0;
+	uint64_t peak = 0;
 
 	statlevel = dns_zone_getstatlevel(zone);
 	if (statlevel == dns_zonestat_none) {
@@ -2749,7 +3088,7 @@ xfrin_jsonrender(dns_zone_t *zone, void *arg) {
 	}
 
 	if (is_running) {
-		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes);
+		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes, &rate, &peak);
 	}
 	json_object_object_add(xfrinobj, "nmsg",
 			       json_object_new_int64((int64_t)nmsg));
@@ -2759,6 +3098,14 @@ xfrin_jsonrender(dns_zone_t *zone, void *arg) {
 		xfrinobj, "nbytes",
 		json_object_new_int64(nbytes > INT64_MAX ? INT64_MAX
 							 : (int64_t)nbytes));
+	json_object_object_add(
+		xfrinobj, "rate",
+		json_object_new_int64(rate > INT64_MAX ? INT64_MAX
+						       : (int64_t)rate));
+	json_object_object_add(
+		xfrinobj, "peakmem",
+		json_object_new_int64(peak > INT64_MAX ? INT64_MAX
+						       : (int64_t)peak));
 
 	if (is_running && is_first_data_received) {
 		json_object_object_add(
@@ -3157,6 +3504,27 @@ generatejson(named_server_t *server, size_t *msglen, const char **msg,
 					json_object_object_add(res, "adb",
 							       counters);
 				}
+
+				dns_view_getlatencystats(view, &dstats);
+				if (dstats != NULL) {
+					counters = json_object_new_object();
+					CHECKMEM(counters);
+					json_object_object_add(v, "latency",
+							       counters);
+
+					dumparg.arg = counters;
+					dumparg.result = ISC_R_SUCCESS;
+					if (dump_latency(&dumparg, dstats) ==
+					    ISC_R_SUCCESS)
+					{
+						dns_latencystats_dump(
+							dstats,
+							latencystat_dump,
+							&dumparg);
+					}
+					dns_stats_detach(&dstats);
+					CHECK(dumparg.result);
+				}
 			}
 
 			view = ISC_LIST_NEXT(view, link);
@@ -3474,6 +3842,417 @@ render_json_traffic(const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo,
 
 #endif /* HAVE_JSON_C */
 
+/*
+ * Render the statistics in the OpenMetrics text format.  Unlike the XML
+ * and JSON renderers, this doesn't build a document first: the counters
+ * are written into the response buffer as they are dumped.  The per-zone
+ * statistics are left out, so that the size of the output doesn't grow
+ * with the number of zones.
+ */
+#define METRICS_BUFSIZE (64 * 1024)
+
+static void
+metrics_escape(const char *value, char *buf, size_t size) {
+	size_t n = 0;
+
+	for (; *value != '\0' && n + 2 < size; value++) {
+		switch (*value) {
+		case '\\':
+		case '"':
+			buf[n++] = '\\';
+			buf[n++] = *value;
+			break;
+		case '\n':
+			buf[n++] = '\\';
+			buf[n++] = 'n';
+			break;
+		default:
+			buf[n++] = *value;
+			break;
+		}
+	}
+	buf[n] = '\0';
+}
+
+static void
+metrics_setview(metrics_t *metrics, dns_view_t *view, char *labels,
+		size_t size) {
+	char name[DNS_NAME_FORMATSIZE];
+
+	metrics_escape(view->name, name, sizeof(name));
+	snprintf(labels, size, "view=\"%s\"", name);
+	metrics->labels = labels;
+}
+
+static isc_result_t
+metrics_stats(metrics_t *metrics, const char *name, const char *gaugename,
+	      const char *help, isc_stats_t *stats, const char **desc,
+	      const bool *isgauge, int ncounters, int *indices,
+	      uint64_t *values) {
+	isc_result_t result;
+
+	CHECK(metrics_family(metrics, name, "counter", help));
+	metrics->key = "name";
+	metrics->isgauge = isgauge;
+	CHECK(dump_stats(stats, isc_statsformat_metrics, metrics, NULL, desc,
+			 ncounters, indices, values, ISC_STATSDUMP_VERBOSE));
+
+	if (gaugename != NULL) {
+		CHECK(metrics_family(metrics, gaugename, "gauge", help));
+		metrics->key = "name";
+		metrics->isgauge = isgauge;
+		CHECK(dump_counters(isc_statsformat_metrics, metrics, NULL,
+				    desc, ncounters, indices, values,
+				    ISC_STATSDUMP_VERBOSE));
+	}
+
+cleanup:
+	return (result);
+}
+
+static isc_result_t
+metrics_histo(metrics_t *metrics, isc_histomulti_t *hm, const char *labels,
+	      unsigned int max) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_histo_t *hg = NULL;
+	uint64_t count, total = 0;
+
+	/*
+	 * Bucket 'i' holds the sizes from DNS_SIZEHISTO_QUANTUM * i up,
+	 * and the last one everything larger.  The sizes themselves are
+	 * not kept, so there is no _sum, and without one OpenMetrics does
+	 * not allow a _count either; the "+Inf" bucket has the total.
+	 * The bounds must be written as canonical floats.
+	 */
+	isc_histomulti_merge(&hg, hm);
+	for (unsigned int i = 0; i < max; i++) {
+		isc_histo_get(hg, i, NULL, NULL, &count);
+		total += count;
+		CHECK(isc_buffer_printf(
+			metrics->buffer,
+			"%s_bucket{%s,le=\"%u.0\"} %" PRIu64 "\n",
+			metrics->name, labels,
+			DNS_SIZEHISTO_QUANTUM * (i + 1) - 1, total));
+	}
+	isc_histo_get(hg, max, NULL, NULL, &count);
+	total += count;
+	CHECK(isc_buffer_printf(metrics->buffer,
+				"%s_bucket{%s,le=\"+Inf\"} %" PRIu64 "\n",
+				metrics->name, labels, total));
+
+cleanup:
+	isc_histo_destroy(&hg);
+	return (result);
+}
+
+static isc_result_t
+generatemetrics(named_server_t *server, metrics_t *metrics) {
+	isc_result_t result;
+	stats_dumparg_t dumparg = {
+		.type = isc_statsformat_metrics,
+		.arg = metrics,
+	};
+	dns_view_t *view = NULL;
+	char labels[sizeof("view=\"\"") + DNS_NAME_FORMATSIZE];
+	uint64_t nsstat_values[ns_statscounter_max];
+	uint64_t resstat_values[dns_resstatscounter_max];
+	uint64_t adbstat_values[dns_adbstats_max];
+	uint64_t zonestat_values[dns_zonestatscounter_max];
+	uint64_t sockstat_values[isc_sockstatscounter_max];
+#ifdef HAVE_DNSTAP
+	uint64_t dnstapstat_values[dns_dnstapcounter_max];
+#endif /* ifdef HAVE_DNSTAP */
+
+	CHECK(metrics_family(metrics, "bind_build", "info",
+			     "The version of named."));
+	CHECK(isc_buffer_printf(metrics->buffer,
+				"bind_build_info{version=\"%s\"} 1\n",
+				PACKAGE_VERSION));
+	CHECK(metrics_family(metrics, "bind_boot_time_seconds", "gauge",
+			     "When named was started."));
+	CHECK(isc_buffer_printf(metrics->buffer, "bind_boot_time_seconds %u\n",
+				isc_time_seconds(&named_g_boottime)));
+	CHECK(metrics_family(metrics, "bind_config_time_seconds", "gauge",
+			     "When the configuration was last loaded."));
+	CHECK(isc_buffer_printf(metrics->buffer,
+				"bind_config_time_seconds %u\n",
+				isc_time_seconds(&named_g_configtime)));
+
+	/* Server */
+	CHECK(metrics_family(metrics, "bind_opcode", "counter",
+			     "Requests received by opcode."));
+	metrics->key = "opcode";
+	dns_opcodestats_dump(server->sctx->opcodestats, opcodestat_dump,
+			     &dumparg, ISC_STATSDUMP_VERBOSE);
+	CHECK(dumparg.result);
+
+	CHECK(metrics_family(metrics, "bind_rcode", "counter",
+			     "Responses sent by rcode."));
+	metrics->key = "rcode";
+	dns_rcodestats_dump(server->sctx->rcodestats, rcodestat_dump, &dumparg,
+			    ISC_STATSDUMP_VERBOSE);
+	CHECK(dumparg.result);
+
+	CHECK(metrics_family(metrics, "bind_qtype", "counter",
+			     "Queries received by type."));
+	metrics->key = "type";
+	dns_rdatatypestats_dump(server->sctx->rcvquerystats, rdtypestat_dump,
+				&dumparg, 0);
+	CHECK(dumparg.result);
+
+	CHECK(metrics_stats(metrics, "bind_nsstat", "bind_nsstat_current",
+			    "Name server statistics.",
+			    ns_stats_get(server->sctx->nsstats),
+			    nsstats_xmldesc, nsstats_gauge, ns_statscounter_max,
+			    nsstats_index, nsstat_values));
+	CHECK(metrics_stats(metrics, "bind_zonestat", "bind_zonestat_current",
+			    "Zone maintenance statistics.", server->zonestats,
+			    zonestats_xmldesc, zonestats_gauge,
+			    dns_zonestatscounter_max, zonestats_index,
+			    zonestat_values));
+	CHECK(metrics_stats(metrics, "bind_resstat", "bind_resstat_current",
+			    "Resolver statistics common to all views.",
+			    server->resolverstats, resstats_xmldesc,
+			    resstats_gauge, dns_resstatscounter_max,
+			    resstats_index, resstat_values));
+	CHECK(metrics_stats(metrics, "bind_sockstat", "bind_sockstat_current",
+			    "Socket I/O statistics.", server->sockstats,
+			    sockstats_xmldesc, sockstats_gauge,
+			    isc_sockstatscounter_max, sockstats_index,
+			    sockstat_values));
+#ifdef HAVE_DNSTAP
+	if (server->dtenv != NULL) {
+		isc_stats_t *dnstapstats = NULL;
+
+		dns_dt_getstats(server->dtenv, &dnstapstats);
+		result = metrics_stats(metrics, "bind_dnstap", NULL,
+				       "dnstap statistics.", dnstapstats,
+				       dnstapstats_xmldesc, NULL,
+				       dns_dnstapcounter_max,
+				       dnstapstats_index, dnstapstat_values);
+		isc_stats_detach(&dnstapstats);
+		CHECK(result);
+	}
+#endif /* ifdef HAVE_DNSTAP */
+
+	/* Traffic */
+	CHECK(metrics_family(metrics, "bind_request_size_bytes", "histogram",
+			     "Sizes of the requests received."));
+	CHECK(metrics_histo(metrics, server->sctx->udpinstats4,
+			    "transport=\"udp\",family=\"ipv4\"",
+			    DNS_SIZEHISTO_MAXIN));
+	CHECK(metrics_histo(metrics, server->sctx->udpinstats6,
+			    "transport=\"udp\",family=\"ipv6\"",
+			    DNS_SIZEHISTO_MAXIN));
+	CHECK(metrics_histo(metrics, server->sctx->tcpinstats4,
+			    "transport=\"tcp\",family=\"ipv4\"",
+			    DNS_SIZEHISTO_MAXIN));
+	CHECK(metrics_histo(metrics, server->sctx->tcpinstats6,
+			    "transport=\"tcp\",family=\"ipv6\"",
+			    DNS_SIZEHISTO_MAXIN));
+
+	CHECK(metrics_family(metrics, "bind_response_size_bytes", "histogram",
+			     "Sizes of the responses sent."));
+	CHECK(metrics_histo(metrics, server->sctx->udpoutstats4,
+			    "transport=\"udp\",family=\"ipv4\"",
+			    DNS_SIZEHISTO_MAXOUT));
+	CHECK(metrics_histo(metrics, server->sctx->udpoutstats6,
+			    "transport=\"udp\",family=\"ipv6\"",
+			    DNS_SIZEHISTO_MAXOUT));
+	CHECK(metrics_histo(metrics, server->sctx->tcpoutstats4,
+			    "transport=\"tcp\",family=\"ipv4\"",
+			    DNS_SIZEHISTO_MAXOUT));
+	CHECK(metrics_histo(metrics, server->sctx->tcpoutstats6,
+			    "transport=\"tcp\",family=\"ipv6\"",
+			    DNS_SIZEHISTO_MAXOUT));
+
+	/*
+	 * Views.  The samples of a family have to be kept together, so
+	 * there is one pass over the views for each family.
+	 */
+	CHECK(metrics_family(metrics, "bind_view_resqtype", "counter",
+			     "Outgoing queries by type."));
+	for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		dns_stats_t *dstats = NULL;
+
+		metrics_setview(metrics, view, labels, sizeof(labels));
+		metrics->key = "type";
+		dns_resolver_getquerystats(view->resolver, &dstats);
+		if (dstats != NULL) {
+			dns_rdatatypestats_dump(dstats, rdtypestat_dump,
+						&dumparg, 0);
+			dns_stats_detach(&dstats);
+			CHECK(dumparg.result);
+		}
+	}
+
+	for (int gauges = 0; gauges <= 1; gauges++) {
+		if (gauges) {
+			CHECK(metrics_family(metrics,
+					     "bind_view_resstat_current",
+					     "gauge", "Resolver statistics."));
+		} else {
+			CHECK(metrics_family(metrics, "bind_view_resstat",
+					     "counter",
+					     "Resolver statistics."));
+		}
+		for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+		     view = ISC_LIST_NEXT(view, link))
+		{
+			isc_stats_t *istats = NULL;
+
+			metrics_setview(metrics, view, labels, sizeof(labels));
+			metrics->key = "name";
+			metrics->isgauge = resstats_gauge;
+			dns_resolver_getstats(view->resolver, &istats);
+			if (istats != NULL) {
+				result = dump_stats(
+					istats, isc_statsformat_metrics,
+					metrics, NULL, resstats_xmldesc,
+					dns_resstatscounter_max, resstats_index,
+					resstat_values, ISC_STATSDUMP_VERBOSE);
+				isc_stats_detach(&istats);
+				CHECK(result);
+			}
+		}
+	}
+
+	CHECK(metrics_family(metrics, "bind_view_query_latency_seconds",
+			     "summary",
+			     "Time from receiving a query to sending the "
+			     "response, by transport and answer source."));
+	for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		dns_stats_t *dstats = NULL;
+
+		dns_view_getlatencystats(view, &dstats);
+		if (dstats != NULL) {
+			metrics_setview(metrics, view, labels, sizeof(labels));
+			result = dump_latency(&dumparg, dstats);
+			dns_stats_detach(&dstats);
+			CHECK(result);
+		}
+	}
+
+	CHECK(metrics_family(metrics, "bind_view_qtype_latency_seconds",
+			     "summary",
+			     "Time from receiving a query to sending the "
+			     "response, by query type."));
+	for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		dns_stats_t *dstats = NULL;
+
+		dns_view_getlatencystats(view, &dstats);
+		if (dstats != NULL) {
+			metrics_setview(metrics, view, labels, sizeof(labels));
+			dns_latencystats_dump(dstats, latencystat_dump,
+					      &dumparg);
+			dns_stats_detach(&dstats);
+			CHECK(dumparg.result);
+		}
+	}
+
+	CHECK(metrics_family(metrics, "bind_view_adbstat", "gauge",
+			     "Address database statistics."));
+	for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		dns_adb_t *adb = NULL;
+
+		metrics_setview(metrics, view, labels, sizeof(labels));
+		metrics->key = "name";
+		metrics->isgauge = adbstats_gauge;
+		dns_view_getadb(view, &adb);
+		if (adb != NULL) {
+			result = dump_stats(dns_adb_getstats(adb),
+					    isc_statsformat_metrics, metrics,
+					    NULL, adbstats_xmldesc,
+					    dns_adbstats_max, adbstats_index,
+					    adbstat_values,
+					    ISC_STATSDUMP_VERBOSE);
+			dns_adb_detach(&adb);
+			CHECK(result);
+		}
+	}
+
+	CHECK(metrics_family(metrics, "bind_view_cache_rrsets", "gauge",
+			     "RRsets in the cache by type."));
+	for (view = ISC_LIST_HEAD(server->viewlist); view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		dns_stats_t *cacherrstats = NULL;
+
+		if (view->cachedb == NULL) {
+			continue;
+		}
+		cacherrstats = dns_db_getrrsetstats(view->cachedb);
+		if (cacherrstats != NULL) {
+			metrics_setview(metrics, view, labels, sizeof(labels));
+			metrics->key = "type";
+			dns_rdatasetstats_dump(cacherrstats, rdatasetstats_dump,
+					       &dumparg, 0);
+			CHECK(dumparg.result);
+		}
+	}
+
+	isc_buffer_putstr(metrics->buffer, "# EOF\n");
+
+cleanup:
+	return (result);
+}
+
+static void
+wrap_metricsfree(isc_buffer_t *buffer, void *arg) {
+	isc_buffer_t *dynbuf = arg;
+
+	UNUSED(buffer);
+
+	isc_buffer_free(&dynbuf);
+}
+
+static isc_result_t
+render_metrics(const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo,
+	       void *arg, unsigned int *retcode, const char **retmsg,
+	       const char **mimetype, isc_buffer_t *b, isc_httpdfree_t **freecb,
+	       void **freecb_args) {
+	named_server_t *server = arg;
+	isc_buffer_t *dynbuf = NULL;
+	metrics_t metrics;
+	isc_result_t result;
+
+	UNUSED(httpd);
+	UNUSED(urlinfo);
+
+	isc_buffer_allocate(server->mctx, &dynbuf, METRICS_BUFSIZE);
+	metrics = (metrics_t){ .buffer = dynbuf, .labels = "" };
+
+	result = generatemetrics(server, &metrics);
+	if (result != ISC_R_SUCCESS) {
+		isc_buffer_free(&dynbuf);
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
+			      "failed at rendering metrics: %s",
+			      isc_result_totext(result));
+		return (result);
+	}
+
+	*retcode = 200;
+	*retmsg = "OK";
+	*mimetype = "application/openmetrics-text; version=1.0.0; "
+		    "charset=utf-8";
+	isc_buffer_reinit(b, isc_buffer_base(dynbuf),
+			  isc_buffer_usedlength(dynbuf));
+	isc_buffer_add(b, isc_buffer_usedlength(dynbuf));
+	*freecb = wrap_metricsfree;
+	*freecb_args = dynbuf;
+
+	return (ISC_R_SUCCESS);
+}
+
 static isc_result_t
 render_xsl(const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo, void *args,
 	   unsigned int *retcode, const char **retmsg, const char **mimetype,
@@ -3685,6 +4464,8 @@ add_listener(named_server_t *server, named_statschannel_t **listenerp,
 			    "/json/v" STATS_JSON_VERSION_MAJOR "/traffic",
 			    false, render_json_traffic, server);
 #endif /* ifdef HAVE_JSON_C */
+	isc_httpdmgr_addurl(listener->httpdmgr, "/metrics", false, render_metrics,
+			    server);
 	isc_httpdmgr_addurl(listener->httpdmgr, "/bind9.xsl", true, render_xsl,
 			    server);
 
@@ -3788,20 +4569,23 @@ named_statschannels_configure(named_server_t *server, const cfg_obj_t *config,
 #ifndef EXTENDED_STATS
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
-			      "statistics-channels specified but not effective "
-			      "due to missing XML and/or JSON library");
+			      "statistics-channels: XML and JSON libraries "
+			      "missing, only OpenMetrics stats will be "
+			      "available");
 #else /* EXTENDED_STATS */
 #ifndef HAVE_LIBXML2
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
 			      "statistics-channels: XML library missing, "
-			      "only JSON stats will be available");
+			      "only JSON and OpenMetrics stats will be "
+			      "available");
 #endif /* !HAVE_LIBXML2 */
 #ifndef HAVE_JSON_C
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
 			      "statistics-channels: JSON library missing, "
-			      "only XML stats will be available");
+			      "only XML and OpenMetrics stats will be "
+			      "available");
 #endif /* !HAVE_JSON_C */
 #endif /* EXTENDED_STATS */
 
@@ -1038,6 +1038,8 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 			masterformat = dns_masterformat_text;
 		} else if (strcasecmp(masterformatstr, "raw") == 0) {
 			masterformat = dns_masterformat_raw;
+		} else if (strcasecmp(masterformatstr, "image") == 0) {
+			masterformat = dns_masterformat_image;
 		} else {
 			UNREACHABLE();
 		}
@@ -120,6 +120,10 @@ command is one of the following:\n\
 		Close, rename and re-open the DNSTAP output file(s).\n\
   dumpdb [-all|-cache|-zones|-adb|-bad|-expired|-fail] [view ...]\n\
 		Dump cache(s) to the dump file (named_dump.db).\n\
+  fetchtrace [-rate count] [view]\n\
+		Show the per-stage timing of recently traced fetches,\n\
+		or with -rate, trace one in every 'count' fetches\n\
+		(0 disables tracing).\n\
   flush         Flushes all of the server's caches.\n\
   flush [view]	Flushes the server's cache for a view.\n\
   flushname name [view]\n\
@@ -48,7 +48,7 @@ status=$((status + ret))
 n=$((n + 1))
 echo_i "check outdated journals were updated or removed (dynamic) ($n)"
 ret=0
-cat -v ns1/changed.db.jnl | grep "BIND LOG V9.2" >/dev/null || ret=1
+cat -v ns1/changed.db.jnl | grep "BIND LOG V9.3" >/dev/null || ret=1
 [ -f ns1/unchanged.db.jnl ] && ret=1
 [ $ret -eq 0 ] || echo_i "failed"
 status=$((status + ret))
@@ -85,7 +85,7 @@ status=$((status + ret))
 n=$((n + 1))
 echo_i "check new-format journals were updated or removed (dynamic) ($n)"
 ret=0
-cat -v ns1/changed2.db.jnl | grep "BIND LOG V9.2" >/dev/null || ret=1
+cat -v ns1/changed2.db.jnl | grep -E "BIND LOG V9\.[23]" >/dev/null || ret=1
 [ -f ns1/unchanged2.db.jnl ] && ret=1
 [ $ret -eq 0 ] || echo_i "failed"
 status=$((status + ret))
@@ -103,7 +103,7 @@ status=$((status + ret))
 n=$((n + 1))
 echo_i "check outdated journal was updated (ixfr-from-differences) ($n)"
 ret=0
-cat -v ns1/ixfr.db.jnl | grep "BIND LOG V9.2" >/dev/null || ret=1
+cat -v ns1/ixfr.db.jnl | grep "BIND LOG V9.3" >/dev/null || ret=1
 [ $ret -eq 0 ] || echo_i "failed"
 status=$((status + ret))
 
@@ -155,7 +155,7 @@ n=$((n + 1))
 echo_i "check there are no journals left un-updated ($n)"
 ret=0
 c1=$(cat -v ns1/*.jnl | grep -c "BIND LOG V9")
-c2=$(cat -v ns1/*.jnl | grep -c "BIND LOG V9.2")
+c2=$(cat -v ns1/*.jnl | grep -cE "BIND LOG V9\.[23]")
 [ ${c1} -eq ${c2} ] || ret=1
 [ $ret -eq 0 ] || echo_i "failed"
 status=$((status + ret))
@@ -200,7 +200,11 @@ cp ns1/changed.db.jnl ns1/temp.jnl
 $JOURNALPRINT -d ns1/temp.jnl
 [ $($JOURNALPRINT -x ns1/temp.jnl | grep -c "version 1") -eq 1 ] || ret=1
 $JOURNALPRINT -x ns1/temp.jnl | grep -q "Header version = 1" || ret=1
+$JOURNALPRINT -2 ns1/temp.jnl
+cat -v ns1/temp.jnl | grep -q "BIND LOG V9.2" || ret=1
+$JOURNALPRINT -x ns1/temp.jnl | grep -q "Header version = 2" || ret=1
 $JOURNALPRINT -u ns1/temp.jnl
+cat -v ns1/temp.jnl | grep -q "BIND LOG V9.3" || ret=1
 $JOURNALPRINT -x ns1/temp.jnl | grep -q "Header version = 2" || ret=1
 [ $($JOURNALPRINT -x ns1/temp.jnl | grep -c "version 2") -eq 1 ] || ret=1
 [ $ret -eq 0 ] || echo_i "failed"
@@ -0,0 +1,109 @@
+#!/usr/bin/python3
+
+# Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+#
+# SPDX-License-Identifier: MPL-2.0
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0.  If a copy of the MPL was not distributed with this
+# file, you can obtain one at https://mozilla.org/MPL/2.0/.
+#
+# See the COPYRIGHT file distributed with this work for additional
+# information regarding copyright ownership.
+
+import re
+
+import pytest
+
+import isctest
+
+pytest.register_assert_rewrite("generic")
+import generic
+
+requests = pytest.importorskip("requests")
+parser = pytest.importorskip("prometheus_client.openmetrics.parser")
+
+
+def fetch_text(statsip, statsport):
+    r = requests.get("http://{}:{}/metrics".format(statsip, statsport), timeout=600)
+    assert r.status_code == 200
+    assert r.headers["Content-Type"].startswith("application/openmetrics-text")
+    return r.text
+
+
+def fetch_metrics(statsip, statsport):
+    # The parser is lazy: it only checks the exposition, including the
+    # trailing "# EOF", as the families are read
+    return {
+        family.name: family
+        for family in parser.text_string_to_metric_families(
+            fetch_text(statsip, statsport)
+        )
+    }
+
+
+def sample_names(family):
+    return {sample.labels.get("name") for sample in family.samples}
+
+
+def test_metrics_parse(statsport):
+    statsip = "10.53.0.2"
+
+    msg = generic.create_msg("short.example.", "TXT")
+    isctest.check.noerror(isctest.query.udp(msg, statsip))
+    isctest.check.noerror(isctest.query.tcp(msg, statsip))
+
+    families = fetch_metrics(statsip, statsport)
+
+    assert families["bind_build"].type == "info"
+    assert families["bind_nsstat"].type == "counter"
+    assert families["bind_nsstat_current"].type == "gauge"
+    assert families["bind_request_size_bytes"].type == "histogram"
+    assert families["bind_response_size_bytes"].type == "histogram"
+
+    # The gauges are only in the gauge families, and vice versa
+    assert "Requestv4" in sample_names(families["bind_nsstat"])
+    assert "Requestv4" not in sample_names(families["bind_nsstat_current"])
+    assert "RecursClients" in sample_names(families["bind_nsstat_current"])
+    assert "RecursClients" not in sample_names(families["bind_nsstat"])
+    assert "UDP4Active" in sample_names(families["bind_sockstat_current"])
+    assert "UDP4Active" not in sample_names(families["bind_sockstat"])
+    assert "VerifyQueued" in sample_names(families["bind_resstat_current"])
+    assert "VerifyQueued" not in sample_names(families["bind_resstat"])
+
+    # The size histograms have no _sum, so they must not have a _count
+    for name in ("bind_request_size_bytes", "bind_response_size_bytes"):
+        for sample in families[name].samples:
+            assert sample.name == name + "_bucket"
+
+
+def test_metrics_buckets(statsport):
+    statsip = "10.53.0.2"
+
+    msg = generic.create_msg("short.example.", "TXT")
+    isctest.check.noerror(isctest.query.udp(msg, statsip))
+
+    text = fetch_text(statsip, statsport)
+    bucket = re.compile(r'^(bind_\w+_size_bytes)_bucket\{(.*),le="([^"]*)"\} (\d+)$')
+
+    buckets = {}
+    for line in text.splitlines():
+        match = bucket.match(line)
+        if match is not None:
+            name, labels, le, value = match.groups()
+            buckets.setdefault((name, labels), []).append((le, int(value)))
+    names = {name for name, _ in buckets}
+    assert "bind_request_size_bytes" in names
+    assert "bind_response_size_bytes" in names
+
+    # The bounds of each histogram are canonical floats, increasing up
+    # to "+Inf"; the counts are cumulative
+    for name, samples in buckets.items():
+        bounds = [le for le, _ in samples]
+        values = [value for _, value in samples]
+        assert bounds[-1] == "+Inf", name
+        for le in bounds:
+            assert le == "+Inf" or re.fullmatch(r"\d+\.0", le), (name, le)
+        finite = [float(le) for le in bounds if le != "+Inf"]
+        assert finite == sorted(finite), name
+        assert values == sorted(values), name
@@ -29,7 +29,7 @@ const char *progname = NULL;
 
 static void
 usage(void) {
-	fprintf(stderr, "Usage: %s [-dux] journal\n", progname);
+	fprintf(stderr, "Usage: %s [-2dux] journal\n", progname);
 	exit(EXIT_FAILURE);
 }
 
@@ -71,13 +71,17 @@ main(int argc, char **argv) {
 	int ch;
 	bool compact = false;
 	bool downgrade = false;
+	bool downgrade2 = false;
 	bool upgrade = false;
 	unsigned int serial = 0;
 	char *endp = NULL;
 
 	progname = argv[0];
-	while ((ch = isc_commandline_parse(argc, argv, "c:dux")) != -1) {
+	while ((ch = isc_commandline_parse(argc, argv, "2c:dux")) != -1) {
 		switch (ch) {
+		case '2':
+			downgrade2 = true;
+			break;
 		case 'c':
 			compact = true;
 			serial = strtoul(isc_commandline_argument, &endp, 0);
@@ -118,6 +122,9 @@ main(int argc, char **argv) {
 	} else if (downgrade) {
 		flags = DNS_JOURNAL_COMPACTALL | DNS_JOURNAL_VERSION1;
 		result = dns_journal_compact(mctx, file, 0, flags, 0);
+	} else if (downgrade2) {
+		flags = DNS_JOURNAL_COMPACTALL | DNS_JOURNAL_VERSION2;
+		result = dns_journal_compact(mctx, file, 0, flags, 0);
 	} else if (compact) {
 		flags = 0;
 		result = dns_journal_compact(mctx, file, serial, flags, 0);
@@ -58,6 +58,15 @@
  ***	Types
  ***/
 
+/*%
+ * Loop cache counters carried over from databases that have been
+ * replaced by dns_cache_flush().
+ */
+typedef struct cache_loopstats {
+	uint64_t hits;
+	uint64_t misses;
+} cache_loopstats_t;
+
 /*%
  * The actual cache object.
  */
@@ -82,6 +91,9 @@ struct dns_cache {
 	isc_stats_t *stats;
 	uint32_t maxrrperset;
 	uint32_t maxtypepername;
+	uint32_t loopcachesize;
+	uint32_t nloops;
+	cache_loopstats_t *loopstats;
 };
 
 /***
@@ -132,6 +144,7 @@ cache_create_db(dns_cache_t *cache, dns_db_t **dbp, isc_mem_t **tmctxp,
 	dns_db_setservestalerefresh(db, cache->serve_stale_refresh);
 	dns_db_setmaxrrperset(db, cache->maxrrperset);
 	dns_db_setmaxtypepername(db, cache->maxtypepername);
+	dns_db_setloopcache(db, cache->loopcachesize);
 
 	/*
 	 * XXX this is only used by the RBT cache, and can
@@ -157,6 +170,8 @@ cleanup_mctx:
 static void
 cache_destroy(dns_cache_t *cache) {
 	isc_stats_detach(&cache->stats);
+	isc_mem_cput(cache->mctx, cache->loopstats, cache->nloops,
+		     sizeof(cache->loopstats[0]));
 	isc_mutex_destroy(&cache->lock);
 	isc_mem_free(cache->mctx, cache->name);
 	if (cache->hmctx != NULL) {
@@ -183,6 +198,7 @@ dns_cache_create(isc_loopmgr_t *loopmgr, dns_rdataclass_t rdclass,
 		.rdclass = rdclass,
 		.name = isc_mem_strdup(mctx, cachename),
 		.loopmgr = loopmgr,
+		.nloops = isc_loopmgr_nloops(loopmgr),
 		.references = ISC_REFCOUNT_INITIALIZER(1),
 		.magic = CACHE_MAGIC,
 	};
@@ -191,6 +207,8 @@ dns_cache_create(isc_loopmgr_t *loopmgr, dns_rdataclass_t rdclass,
 	isc_mem_attach(mctx, &cache->mctx);
 
 	isc_stats_create(mctx, &cache->stats, dns_cachestatscounter_max);
+	cache->loopstats = isc_mem_cget(mctx, cache->nloops,
+					sizeof(cache->loopstats[0]));
 
 	/*
 	 * Create the database
@@ -357,6 +375,20 @@ dns_cache_flush(dns_cache_t *cache) {
 	updatewater(cache);
 	olddb = cache->db;
 	cache->db = db;
+
+	/*
+	 * Keep the loop cache counters going across the flush.
+	 */
+	for (uint32_t i = 0; i < cache->nloops; i++) {
+		uint64_t hits, misses;
+
+		if (dns_db_getloopcachestats(olddb, i, &hits, &misses) ==
+		    ISC_R_SUCCESS)
+		{
+			cache->loopstats[i].hits += hits;
+			cache->loopstats[i].misses += misses;
+		}
+	}
 	UNLOCK(&cache->lock);
 
 	dns_db_detach(&olddb);
@@ -570,6 +602,34 @@ dns_cache_setmaxtypepername(dns_cache_t *cache, uint32_t value) {
 	}
 }
 
+void
+dns_cache_setloopcachesize(dns_cache_t *cache, uint32_t size) {
+	REQUIRE(VALID_CACHE(cache));
+
+	LOCK(&cache->lock);
+	cache->loopcachesize = size;
+	if (cache->db != NULL) {
+		dns_db_setloopcache(cache->db, size);
+	}
+	UNLOCK(&cache->lock);
+}
+
+/*
+ * Get the loop cache counters for loop 'tid', including the ones from
+ * databases that have been flushed.
+ */
+static void
+getloopstats(dns_cache_t *cache, uint32_t tid, uint64_t *hitsp,
+	     uint64_t *missesp) {
+	uint64_t hits = 0, misses = 0;
+
+	LOCK(&cache->lock);
+	(void)dns_db_getloopcachestats(cache->db, tid, &hits, &misses);
+	*hitsp = cache->loopstats[tid].hits + hits;
+	*missesp = cache->loopstats[tid].misses + misses;
+	UNLOCK(&cache->lock);
+}
+
 /*
  * XXX: Much of the following code has been copied in from statschannel.c.
  * We should refactor this into a generic function in stats.c that can be
@@ -648,6 +708,17 @@ dns_cache_dumpstats(dns_cache_t *cache, FILE *fp) {
 
 	fprintf(fp, "%20" PRIu64 " %s\n", (uint64_t)isc_mem_inuse(cache->hmctx),
 		"cache heap memory in use");
+
+	if (cache->loopcachesize == 0) {
+		return;
+	}
+	for (uint32_t i = 0; i < cache->nloops; i++) {
+		uint64_t hits, misses;
+
+		getloopstats(cache, i, &hits, &misses);
+		fprintf(fp, "%20" PRIu64 " loop %u cache hits\n", hits, i);
+		fprintf(fp, "%20" PRIu64 " loop %u cache misses\n", misses, i);
+	}
 }
 
 #ifdef HAVE_LIBXML2
@@ -706,6 +777,24 @@ dns_cache_renderxml(dns_cache_t *cache, void *writer0) {
 	TRY0(renderstat("TreeMemInUse", isc_mem_inuse(cache->tmctx), writer));
 
 	TRY0(renderstat("HeapMemInUse", isc_mem_inuse(cache->hmctx), writer));
+
+	if (cache->loopcachesize == 0) {
+		return (xmlrc);
+	}
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "loopcaches"));
+	for (uint32_t i = 0; i < cache->nloops; i++) {
+		uint64_t hits, misses;
+
+		getloopstats(cache, i, &hits, &misses);
+		TRY0(xmlTextWriterStartElement(writer,
+					       ISC_XMLCHAR "loopcache"));
+		TRY0(xmlTextWriterWriteFormatAttribute(writer, ISC_XMLCHAR "id",
+						       "%u", i));
+		TRY0(renderstat("Hits", hits, writer));
+		TRY0(renderstat("Misses", misses, writer));
+		TRY0(xmlTextWriterEndElement(writer)); /* loopcache */
+	}
+	TRY0(xmlTextWriterEndElement(writer)); /* loopcaches */
 error:
 	return (xmlrc);
 }
@@ -783,6 +872,29 @@ dns_cache_renderjson(dns_cache_t *cache, void *cstats0) {
 	CHECKMEM(obj);
 	json_object_object_add(cstats, "HeapMemInUse", obj);
 
+	if (cache->loopcachesize != 0) {
+		json_object *loops = json_object_new_array();
+		CHECKMEM(loops);
+		json_object_object_add(cstats, "LoopCaches", loops);
+
+		for (uint32_t i = 0; i < cache->nloops; i++) {
+			uint64_t hits, misses;
+			json_object *loop = json_object_new_object();
+			CHECKMEM(loop);
+			json_object_array_add(loops, loop);
+
+			getloopstats(cache, i, &hits, &misses);
+
+			obj = json_object_new_int64(hits);
+			CHECKMEM(obj);
+			json_object_object_add(loop, "Hits", obj);
+
+			obj = json_object_new_int64(misses);
+			CHECKMEM(obj);
+			json_object_object_add(loop, "Misses", obj);
+		}
+	}
+
 	result = ISC_R_SUCCESS;
 error:
 	return (result);
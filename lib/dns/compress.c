@@ -19,16 +19,24 @@
 #include <isc/buffer.h>
 #include <isc/hash.h>
 #include <isc/mem.h>
+#include <isc/once.h>
 #include <isc/util.h>
 
 #include <dns/compress.h>
 #include <dns/name.h>
 
+#include "compress_p.h"
+
 #define HASH_INIT_DJB2 5381
 
 #define CCTX_MAGIC    ISC_MAGIC('C', 'C', 'T', 'X')
 #define CCTX_VALID(x) ISC_MAGIC_VALID(x, CCTX_MAGIC)
 
+static isc_once_t init_once = ISC_ONCE_INIT;
+
+static void
+compress_initialize(void);
+
 void
 dns_compress_init(dns_compress_t *cctx, isc_mem_t *mctx,
 		  dns_compress_flags_t flags) {
@@ -38,6 +46,8 @@ dns_compress_init(dns_compress_t *cctx, isc_mem_t *mctx,
 	REQUIRE(cctx != NULL);
 	REQUIRE(mctx != NULL);
 
+	isc_once_do(&init_once, compress_initialize);
+
 	if ((flags & DNS_COMPRESS_LARGE) != 0) {
 		size_t count = (1 << DNS_COMPRESS_LARGEBITS);
 		mask = count - 1;
@@ -92,12 +102,19 @@ dns_compress_getpermitted(dns_compress_t *cctx) {
  * lot faster, and we limit the impact of collision attacks by restricting
  * the size and occupancy of the hash set.) The accumulator is 32 bits to
  * keep more of the fun mixing that happens in the upper bits.
+ *
+ * `avail` is the number of bytes that can be read starting at `ptr`,
+ * which is at least the length of the label; the vector implementations
+ * below use it to avoid reading beyond the end of the name.
  */
 static uint16_t
-hash_label(uint16_t init, uint8_t *ptr, bool sensitive) {
+hash_label_scalar(uint16_t init, const uint8_t *ptr, unsigned int avail,
+		  bool sensitive) {
 	unsigned int len = ptr[0] + 1;
 	uint32_t hash = init;
 
+	UNUSED(avail);
+
 	if (sensitive) {
 		while (len-- > 0) {
 			hash = hash * 33 + *ptr++;
@@ -112,14 +129,310 @@ hash_label(uint16_t init, uint8_t *ptr, bool sensitive) {
 	return (isc_hash_bits32(hash, 16));
 }
 
+/*
+ * Only the hashing has vector implementations here; the comparison uses
+ * the ones in libisc, like dns_name_caseequal().
+ */
 static bool
-match_wirename(uint8_t *a, uint8_t *b, unsigned int len, bool sensitive) {
+match_wirename(const uint8_t *a, const uint8_t *b, unsigned int len,
+	       bool sensitive) {
 	if (sensitive) {
 		return (memcmp(a, b, len) == 0);
-	} else {
-		/* label lengths are < 'A' so unaffected by tolower() */
+	}
+	/* label lengths are < 'A' so unaffected by tolower() */
+	if (len < ISC_ASCII_WIDE) {
 		return (isc_ascii_lowerequal(a, b, len));
 	}
+	return (isc_ascii_lowerequal_wide(a, b, len));
+}
+
+#if HAVE_X86_SIMD_TARGET
+
+#include <immintrin.h>
+
+/*
+ * The djb2 hash of a string c[0] .. c[n-1] mixed into an existing hash h
+ * is h * 33^n + c[0] * 33^(n-1) + ... + c[n-1] * 33^0, modulo 2^32, so
+ * we can hash a vector of bytes with a multiply by a vector of powers of
+ * 33 and a horizontal sum, and get exactly the same result as the scalar
+ * code above.
+ *
+ * pow33[k] is 33^k. weights[] holds 33^31 .. 33^0 followed by zeroes:
+ * the last 16 powers weight a full 16 byte chunk, and loading them from
+ * 16 - n entries earlier weights the first n bytes of a chunk and ignores
+ * the rest. tailmask[] is used the other way around, to keep only the
+ * last n bytes of a chunk that ends at the end of a label.
+ */
+static uint32_t pow33[65];
+static uint32_t weights[48];
+static const uint8_t tailmask[32] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+#define WEIGHTS16(n) (weights + 32 - (n))
+#define WEIGHTS32    (weights)
+
+static void
+hash_initialize(void) {
+	pow33[0] = 1;
+	for (size_t k = 1; k < ARRAY_SIZE(pow33); k++) {
+		pow33[k] = pow33[k - 1] * 33;
+	}
+	for (size_t i = 0; i < 32; i++) {
+		weights[i] = pow33[31 - i];
+	}
+}
+
+__attribute__((target("sse4.2"))) static __m128i
+tolower_sse(__m128i bytes) {
+	/* signed comparisons, so non-ASCII bytes are not upper case */
+	__m128i ge_A = _mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1));
+	__m128i gt_Z = _mm_cmpgt_epi8(bytes, _mm_set1_epi8('Z'));
+	__m128i upper = _mm_andnot_si128(gt_Z, ge_A);
+	return (_mm_add_epi8(bytes,
+			     _mm_and_si128(upper, _mm_set1_epi8('a' - 'A'))));
+}
+
+/*
+ * Mix `n` bytes into `hash`, weighting the 16 bytes in `bytes` with the
+ * 16 powers of 33 at `w`.
+ */
+__attribute__((target("sse4.2"))) static uint32_t
+hash_sse(uint32_t hash, __m128i bytes, const uint32_t *w, unsigned int n) {
+	const __m128i *wv = (const __m128i *)w;
+	__m128i sum;
+
+	sum = _mm_mullo_epi32(_mm_cvtepu8_epi32(bytes), _mm_loadu_si128(wv));
+	sum = _mm_add_epi32(sum,
+			    _mm_mullo_epi32(_mm_cvtepu8_epi32(
+						    _mm_srli_si128(bytes, 4)),
+					    _mm_loadu_si128(wv + 1)));
+	sum = _mm_add_epi32(sum,
+			    _mm_mullo_epi32(_mm_cvtepu8_epi32(
+						    _mm_srli_si128(bytes, 8)),
+					    _mm_loadu_si128(wv + 2)));
+	sum = _mm_add_epi32(sum,
+			    _mm_mullo_epi32(_mm_cvtepu8_epi32(
+						    _mm_srli_si128(bytes, 12)),
+					    _mm_loadu_si128(wv + 3)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+
+	return (hash * pow33[n] + (uint32_t)_mm_cvtsi128_si32(sum));
+}
+
+/*
+ * Hash the `len` bytes at `ptr`, 16 at a time. A label that does not
+ * fill the last chunk is handled with a load that ends at the end of
+ * the label if it is long enough, or with a load that runs over the end
+ * of the label if there is enough of the name left after it.
+ */
+__attribute__((target("sse4.2"))) static uint32_t
+hash_bytes_sse(uint32_t hash, const uint8_t *ptr, unsigned int len,
+	       unsigned int avail, bool sensitive) {
+	__m128i bytes;
+
+	if (len < 16 && avail < 16) {
+		while (len-- > 0) {
+			uint8_t c = *ptr++;
+			if (!sensitive) {
+				c = isc__ascii_tolower1(c);
+			}
+			hash = hash * 33 + c;
+		}
+		return (hash);
+	}
+
+	if (len < 16) {
+		bytes = _mm_loadu_si128((const __m128i *)ptr);
+		if (!sensitive) {
+			bytes = tolower_sse(bytes);
+		}
+		return (hash_sse(hash, bytes, WEIGHTS16(len), len));
+	}
+
+	while (len >= 16) {
+		bytes = _mm_loadu_si128((const __m128i *)ptr);
+		if (!sensitive) {
+			bytes = tolower_sse(bytes);
+		}
+		hash = hash_sse(hash, bytes, WEIGHTS16(16), 16);
+		ptr += 16;
+		len -= 16;
+	}
+
+	if (len > 0) {
+		__m128i mask = _mm_loadu_si128((const __m128i *)(tailmask +
+								 len));
+		bytes = _mm_loadu_si128((const __m128i *)(ptr + len - 16));
+		if (!sensitive) {
+			bytes = tolower_sse(bytes);
+		}
+		bytes = _mm_and_si128(bytes, mask);
+		hash = hash_sse(hash, bytes, WEIGHTS16(16), len);
+	}
+
+	return (hash);
+}
+
+__attribute__((target("sse4.2"))) static uint16_t
+hash_label_sse(uint16_t init, const uint8_t *ptr, unsigned int avail,
+	       bool sensitive) {
+	uint32_t hash = hash_bytes_sse(init, ptr, ptr[0] + 1, avail, sensitive);
+	return (isc_hash_bits32(hash, 16));
+}
+
+__attribute__((target("avx2"))) static __m256i
+tolower_avx2(__m256i bytes) {
+	__m256i ge_A = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('A' - 1));
+	__m256i gt_Z = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('Z'));
+	__m256i upper = _mm256_andnot_si256(gt_Z, ge_A);
+	return (_mm256_add_epi8(
+		bytes, _mm256_and_si256(upper, _mm256_set1_epi8('a' - 'A'))));
+}
+
+__attribute__((target("avx2"))) static uint32_t
+hash_avx2(uint32_t hash, __m256i bytes) {
+	const __m256i *wv = (const __m256i *)WEIGHTS32;
+	__m128i lo = _mm256_castsi256_si128(bytes);
+	__m128i hi = _mm256_extracti128_si256(bytes, 1);
+	__m256i sum;
+	__m128i sum128;
+
+	sum = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(lo),
+				 _mm256_loadu_si256(wv));
+	sum = _mm256_add_epi32(
+		sum, _mm256_mullo_epi32(
+			     _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)),
+			     _mm256_loadu_si256(wv + 1)));
+	sum = _mm256_add_epi32(sum,
+			       _mm256_mullo_epi32(_mm256_cvtepu8_epi32(hi),
+						  _mm256_loadu_si256(wv + 2)));
+	sum = _mm256_add_epi32(
+		sum, _mm256_mullo_epi32(
+			     _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)),
+			     _mm256_loadu_si256(wv + 3)));
+
+	sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+			       _mm256_extracti128_si256(sum, 1));
+	sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4e));
+	sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xb1));
+
+	return (hash * pow33[32] + (uint32_t)_mm_cvtsi128_si32(sum128));
+}
+
+/*
+ * Labels are at most 64 bytes including the length, so this takes one
+ * or two 32 byte chunks and leaves the rest to the 16 byte code.
+ */
+__attribute__((target("avx2,sse4.2"))) static uint16_t
+hash_label_avx2(uint16_t init, const uint8_t *ptr, unsigned int avail,
+		bool sensitive) {
+	unsigned int len = ptr[0] + 1;
+	uint32_t hash = init;
+
+	while (len >= 32) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *)ptr);
+		if (!sensitive) {
+			bytes = tolower_avx2(bytes);
+		}
+		hash = hash_avx2(hash, bytes);
+		ptr += 32;
+		len -= 32;
+		avail -= 32;
+	}
+
+	/* avoid the AVX to SSE transition penalty */
+	_mm256_zeroupper();
+
+	hash = hash_bytes_sse(hash, ptr, len, avail, sensitive);
+	return (isc_hash_bits32(hash, 16));
+}
+
+#endif /* HAVE_X86_SIMD_TARGET */
+
+typedef uint16_t
+hash_label_fn(uint16_t init, const uint8_t *ptr, unsigned int avail,
+	      bool sensitive);
+
+static struct {
+	const char *name;
+	hash_label_fn *hash_label;
+} impls[DNS__COMPRESS_IMPLS] = {
+	[DNS__COMPRESS_SCALAR] = { "scalar", hash_label_scalar },
+#if HAVE_X86_SIMD_TARGET
+	[DNS__COMPRESS_SSE42] = { "sse4.2", hash_label_sse },
+	[DNS__COMPRESS_AVX2] = { "avx2", hash_label_avx2 },
+#else
+	[DNS__COMPRESS_SSE42] = { "sse4.2", NULL },
+	[DNS__COMPRESS_AVX2] = { "avx2", NULL },
+#endif /* HAVE_X86_SIMD_TARGET */
+};
+
+static dns__compress_impl_t impl = DNS__COMPRESS_SCALAR;
+static hash_label_fn *hash_label = hash_label_scalar;
+
+static bool
+impl_supported(dns__compress_impl_t i) {
+	switch (i) {
+	case DNS__COMPRESS_SCALAR:
+		return (true);
+#if HAVE_X86_SIMD_TARGET
+	case DNS__COMPRESS_SSE42:
+		return (__builtin_cpu_supports("sse4.2"));
+	case DNS__COMPRESS_AVX2:
+		return (__builtin_cpu_supports("sse4.2") &&
+			__builtin_cpu_supports("avx2"));
+#endif /* HAVE_X86_SIMD_TARGET */
+	default:
+		return (false);
+	}
+}
+
+static void
+impl_set(dns__compress_impl_t i) {
+	impl = i;
+	hash_label = impls[i].hash_label;
+}
+
+static void
+compress_initialize(void) {
+#if HAVE_X86_SIMD_TARGET
+	hash_initialize();
+#endif /* HAVE_X86_SIMD_TARGET */
+	for (dns__compress_impl_t i = DNS__COMPRESS_IMPLS; i-- > 0;) {
+		if (impl_supported(i)) {
+			impl_set(i);
+			break;
+		}
+	}
+}
+
+bool
+dns__compress_setimpl(dns__compress_impl_t i) {
+	REQUIRE(i < DNS__COMPRESS_IMPLS);
+
+	isc_once_do(&init_once, compress_initialize);
+
+	if (!impl_supported(i)) {
+		return (false);
+	}
+	impl_set(i);
+	return (true);
+}
+
+dns__compress_impl_t
+dns__compress_getimpl(void) {
+	isc_once_do(&init_once, compress_initialize);
+	return (impl);
+}
+
+const char *
+dns__compress_impltext(dns__compress_impl_t i) {
+	REQUIRE(i < DNS__COMPRESS_IMPLS);
+	return (impls[i].name);
 }
 
 /*
@@ -264,8 +577,9 @@ insert(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
 	       label-- > 0)
 	{
 		unsigned int prefix_len = name->offsets[label];
+		unsigned int suffix_len = name->length - prefix_len;
 		uint8_t *suffix_ptr = name->ndata + prefix_len;
-		hash = hash_label(hash, suffix_ptr, sensitive);
+		hash = hash_label(hash, suffix_ptr, suffix_len, sensitive);
 		probe = 0;
 	}
 }
@@ -300,7 +614,7 @@ dns_compress_name(dns_compress_t *cctx, isc_buffer_t *buffer,
 		unsigned int prefix_len = name->offsets[label];
 		unsigned int suffix_len = name->length - prefix_len;
 		uint8_t *suffix_ptr = name->ndata + prefix_len;
-		hash = hash_label(hash, suffix_ptr, sensitive);
+		hash = hash_label(hash, suffix_ptr, suffix_len, sensitive);
 
 		for (unsigned int probe = 0; true; probe++) {
 			unsigned int slot = slot_index(cctx, hash, probe);
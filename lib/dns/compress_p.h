@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include <isc/lang.h>
+
+/*! \file */
+
+/*%
+ *     Types and functions below not be used outside this module and its
+ *     associated unit tests and benchmarks.
+ */
+
+ISC_LANG_BEGINDECLS
+
+/*%
+ * The implementations of label hashing used by dns_compress_name(). The
+ * fastest one supported by the CPU is selected the first time a
+ * compression context is initialized.
+ */
+typedef enum {
+	DNS__COMPRESS_SCALAR = 0,
+	DNS__COMPRESS_SSE42,
+	DNS__COMPRESS_AVX2,
+	DNS__COMPRESS_IMPLS, /* number of implementations */
+} dns__compress_impl_t;
+
+bool
+dns__compress_setimpl(dns__compress_impl_t impl);
+/*%<
+ * Switch to implementation 'impl'. Must not be called while another
+ * thread is compressing names.
+ *
+ * Returns false (and keeps the current implementation) if 'impl' is not
+ * supported by this build or this CPU.
+ */
+
+dns__compress_impl_t
+dns__compress_getimpl(void);
+/*%<
+ * Return the implementation currently in use.
+ */
+
+const char *
+dns__compress_impltext(dns__compress_impl_t impl);
+/*%<
+ * Return the name of implementation 'impl'.
+ */
+
+ISC_LANG_ENDDECLS
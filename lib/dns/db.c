@@ -1188,3 +1188,25 @@ dns_db_setmaxtypepername(dns_db_t *db, uint32_t value) {
 		(db->methods->setmaxtypepername)(db, value);
 	}
 }
+
+void
+dns_db_setloopcache(dns_db_t *db, uint32_t size) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->setloopcache != NULL) {
+		(db->methods->setloopcache)(db, size);
+	}
+}
+
+isc_result_t
+dns_db_getloopcachestats(dns_db_t *db, uint32_t tid, uint64_t *hitsp,
+			 uint64_t *missesp) {
+	REQUIRE(DNS_DB_VALID(db));
+	REQUIRE(hitsp != NULL && missesp != NULL);
+
+	if (db->methods->getloopcachestats != NULL) {
+		return ((db->methods->getloopcachestats)(db, tid, hitsp,
+							 missesp));
+	}
+	return (ISC_R_NOTIMPLEMENTED);
+}
@@ -49,29 +49,43 @@
 #error DNSTAP not configured.
 #endif /* HAVE_DNSTAP */
 
+#include <fcntl.h>
 #include <fstrm.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include <isc/async.h>
+#include <isc/atomic.h>
 #include <isc/buffer.h>
+#include <isc/condition.h>
+#include <isc/errno.h>
 #include <isc/file.h>
+#include <isc/hash.h>
 #include <isc/log.h>
 #include <isc/mem.h>
 #include <isc/mutex.h>
+#include <isc/netaddr.h>
 #include <isc/once.h>
+#include <isc/os.h>
 #include <isc/result.h>
 #include <isc/sockaddr.h>
 #include <isc/thread.h>
+#include <isc/tid.h>
 #include <isc/time.h>
 #include <isc/types.h>
 #include <isc/util.h>
 
+#include <dns/acl.h>
 #include <dns/dnstap.h>
+#include <dns/fixedname.h>
 #include <dns/log.h>
 #include <dns/message.h>
 #include <dns/name.h>
+#include <dns/nametree.h>
 #include <dns/rdataset.h>
 #include <dns/stats.h>
 #include <dns/types.h>
@@ -82,9 +96,19 @@
 #define DTENV_MAGIC	 ISC_MAGIC('D', 't', 'n', 'v')
 #define VALID_DTENV(env) ISC_MAGIC_VALID(env, DTENV_MAGIC)
 
+#define DTFILTER_MAGIC	      ISC_MAGIC('D', 't', 'f', 'l')
+#define VALID_DTFILTER(filter) ISC_MAGIC_VALID(filter, DTFILTER_MAGIC)
+
 #define DNSTAP_CONTENT_TYPE	"protobuf:dnstap.Dnstap"
 #define DNSTAP_INITIAL_BUF_SIZE 256
 
+#define DTRING_MINSIZE	   (64 * 1024)
+#define DTRING_FLUSH_MSECS 10
+
+#ifndef IOV_MAX
+#define IOV_MAX 16 /* _XOPEN_IOV_MAX */
+#endif /* ifndef IOV_MAX */
+
 struct dns_dtmsg {
 	void *buf;
 	size_t len;
@@ -92,6 +116,30 @@ struct dns_dtmsg {
 	Dnstap__Message m;
 };
 
+/*%
+ * A ring of Frame Streams data frames, serialized in place by a single
+ * producer (the loop that owns it) and written out by the writer
+ * thread.  'head' and 'tail' only ever grow; their difference is the
+ * number of bytes waiting to be written.
+ */
+typedef struct dtring {
+	uint8_t *base;
+	size_t size; /*%< a power of two */
+	atomic_uint_fast64_t head;
+	uint8_t __padding[ISC_OS_CACHELINE_SIZE - sizeof(atomic_uint_fast64_t)];
+	atomic_uint_fast64_t tail;
+} dtring_t;
+
+/*%
+ * A ProtobufCBuffer that appends to a ring at 'pos', wrapping around
+ * at the end.  The caller has checked that there is enough room.
+ */
+typedef struct dtringbuf {
+	ProtobufCBuffer base;
+	dtring_t *ring;
+	uint64_t pos;
+} dtringbuf_t;
+
 struct dns_dthandle {
 	dns_dtmode_t mode;
 	struct fstrm_reader *reader;
@@ -119,6 +167,38 @@ struct dns_dtenv {
 	int rolls;
 	isc_log_rollsuffix_t suffix;
 	isc_stats_t *stats;
+
+	/*
+	 * Ring buffer output (see dns_dt_createring()); one ring per
+	 * loop, plus a shared one for any other thread.
+	 */
+	dtring_t *rings;
+	unsigned int nrings;
+	isc_mutex_t sharedlock; /* serializes the shared ring's producers */
+	int fd;
+	isc_thread_t writer;
+	isc_mutex_t writerlock; /* locks 'writerstop' */
+	isc_condition_t writercond;
+	bool writerstop;
+	bool writerfailed;
+	struct iovec *iov;
+	uint64_t *heads;
+};
+
+/*
+ * A dnstap filter is built while configuring a view and is not changed
+ * once it has been attached to it, so it needs no locking.
+ */
+struct dns_dtfilter {
+	unsigned int magic;
+	isc_refcount_t references;
+	isc_mem_t *mctx;
+
+	uint32_t sample;	/* log one in 'sample' transactions */
+	dns_nametree_t *qnames; /* query name suffixes */
+	dns_acl_t *clients;	/* query initiators */
+	uint16_t rcodes;	/* bitmap of response codes */
+	uint32_t latency;	/* minimum response time, in ms */
 };
 
 #define CHECK(x)                             \
@@ -244,6 +324,419 @@ cleanup:
 	return (result);
 }
 
+/*%
+ * Roll the output file, keeping 'roll' old versions.
+ */
+static isc_result_t
+roll_file(dns_dtenv_t *env, int roll) {
+	isc_result_t result;
+	isc_logfile_t file;
+
+	/*
+	 * Create a temporary isc_logfile_t structure so we can
+	 * take advantage of the logfile rolling facility.
+	 */
+	char *filename = isc_mem_strdup(env->mctx, env->path);
+	file.name = filename;
+	file.stream = NULL;
+	file.versions = roll;
+	file.maximum_size = 0;
+	file.maximum_reached = false;
+	file.suffix = env->suffix;
+	result = isc_logfile_roll(&file);
+	isc_mem_free(env->mctx, filename);
+
+	return (result);
+}
+
+/*
+ * Ring buffer output.
+ *
+ * Every loop serializes its messages directly into its own ring as
+ * Frame Streams data frames, without allocating or copying them, and
+ * never waits for the output: when a ring is full the message is
+ * dropped and counted.  A dedicated writer thread gathers whatever is
+ * queued in all the rings and writes it to the output file with a
+ * single writev(), which is also what makes the framing of the file
+ * our responsibility rather than libfstrm's.
+ */
+static isc_result_t
+dtring_writev(int fd, struct iovec *iov, int iovcnt) {
+	while (iovcnt > 0) {
+		ssize_t n = writev(fd, iov, ISC_MIN(iovcnt, IOV_MAX));
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return (isc_errno_toresult(errno));
+		}
+
+		while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*%
+ * Write a Frame Streams START or STOP control frame.
+ */
+static isc_result_t
+dtring_control(dns_dtenv_t *env, fstrm_control_type type) {
+	isc_result_t result = ISC_R_FAILURE;
+	struct fstrm_control *control = NULL;
+	uint8_t data[64];
+	size_t len = sizeof(data);
+	struct iovec iov;
+
+	control = fstrm_control_init();
+	if (control == NULL) {
+		return (ISC_R_NOMEMORY);
+	}
+
+	if (fstrm_control_set_type(control, type) != fstrm_res_success) {
+		goto cleanup;
+	}
+	if (type == FSTRM_CONTROL_START &&
+	    fstrm_control_add_field_content_type(
+		    control, (const uint8_t *)DNSTAP_CONTENT_TYPE,
+		    sizeof(DNSTAP_CONTENT_TYPE) - 1) != fstrm_res_success)
+	{
+		goto cleanup;
+	}
+	if (fstrm_control_encode(control, data, &len,
+				 FSTRM_CONTROL_FLAG_WITH_HEADER) !=
+	    fstrm_res_success)
+	{
+		goto cleanup;
+	}
+
+	iov.iov_base = data;
+	iov.iov_len = len;
+	result = dtring_writev(env->fd, &iov, 1);
+
+cleanup:
+	fstrm_control_destroy(&control);
+	return (result);
+}
+
+static isc_result_t
+dtring_open(dns_dtenv_t *env) {
+	isc_result_t result;
+
+	env->fd = open(env->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (env->fd < 0) {
+		result = isc_errno_toresult(errno);
+		goto failure;
+	}
+
+	result = dtring_control(env, FSTRM_CONTROL_START);
+	if (result != ISC_R_SUCCESS) {
+		(void)close(env->fd);
+		env->fd = -1;
+		goto failure;
+	}
+
+	return (ISC_R_SUCCESS);
+
+failure:
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_DNSTAP, DNS_LOGMODULE_DNSTAP,
+		      ISC_LOG_WARNING, "unable to open dnstap output '%s': %s",
+		      env->path, isc_result_totext(result));
+	return (result);
+}
+
+static void
+dtring_close(dns_dtenv_t *env) {
+	if (env->fd == -1) {
+		return;
+	}
+
+	(void)dtring_control(env, FSTRM_CONTROL_STOP);
+	(void)close(env->fd);
+	env->fd = -1;
+}
+
+/*%
+ * Write out everything queued in the rings; returns false if there
+ * was nothing to write.
+ */
+static bool
+dtring_flush(dns_dtenv_t *env) {
+	isc_result_t result = ISC_R_SUCCESS;
+	int iovcnt = 0;
+
+	for (unsigned int i = 0; i < env->nrings; i++) {
+		dtring_t *ring = &env->rings[i];
+		uint64_t head = atomic_load_acquire(&ring->head);
+		uint64_t tail = atomic_load_relaxed(&ring->tail);
+		size_t off = tail & (ring->size - 1);
+		size_t len = head - tail;
+		size_t first = ISC_MIN(len, ring->size - off);
+
+		env->heads[i] = head;
+		if (len == 0) {
+			continue;
+		}
+
+		env->iov[iovcnt].iov_base = ring->base + off;
+		env->iov[iovcnt++].iov_len = first;
+		if (len > first) {
+			env->iov[iovcnt].iov_base = ring->base;
+			env->iov[iovcnt++].iov_len = len - first;
+		}
+	}
+
+	if (iovcnt == 0) {
+		return (false);
+	}
+
+	if (env->fd != -1) {
+		result = dtring_writev(env->fd, env->iov, iovcnt);
+	}
+	if (result != ISC_R_SUCCESS && !env->writerfailed) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DNSTAP,
+			      DNS_LOGMODULE_DNSTAP, ISC_LOG_ERROR,
+			      "writing dnstap output '%s' failed: %s",
+			      env->path, isc_result_totext(result));
+	}
+	env->writerfailed = (result != ISC_R_SUCCESS);
+
+	/* On failure the frames are discarded all the same. */
+	for (unsigned int i = 0; i < env->nrings; i++) {
+		atomic_store_release(&env->rings[i].tail, env->heads[i]);
+	}
+
+	return (true);
+}
+
+static void *
+dtring_writer(void *arg) {
+	dns_dtenv_t *env = (dns_dtenv_t *)arg;
+
+	LOCK(&env->writerlock);
+	while (!env->writerstop) {
+		bool flushed;
+
+		UNLOCK(&env->writerlock);
+		flushed = dtring_flush(env);
+		LOCK(&env->writerlock);
+
+		if (!flushed && !env->writerstop) {
+			isc_interval_t interval;
+			isc_time_t until;
+
+			isc_interval_set(&interval, 0,
+					 DTRING_FLUSH_MSECS * NS_PER_MS);
+			(void)isc_time_nowplusinterval(&until, &interval);
+			(void)isc_condition_waituntil(&env->writercond,
+						      &env->writerlock, &until);
+		}
+	}
+	UNLOCK(&env->writerlock);
+
+	/* Write out whatever was queued before we were stopped. */
+	(void)dtring_flush(env);
+
+	return (NULL);
+}
+
+static void
+dtring_start(dns_dtenv_t *env) {
+	env->writerstop = false;
+	isc_thread_create(dtring_writer, env, &env->writer);
+	isc_thread_setname(env->writer, "isc-dnstap");
+}
+
+static void
+dtring_stop(dns_dtenv_t *env) {
+	LOCK(&env->writerlock);
+	env->writerstop = true;
+	SIGNAL(&env->writercond);
+	UNLOCK(&env->writerlock);
+
+	isc_thread_join(env->writer, NULL);
+}
+
+static void
+dtring_free(dns_dtenv_t *env) {
+	for (unsigned int i = 0; i < env->nrings; i++) {
+		isc_mem_put(env->mctx, env->rings[i].base, env->rings[i].size);
+	}
+	isc_mem_cput(env->mctx, env->rings, env->nrings,
+		     sizeof(env->rings[0]));
+	isc_mem_cput(env->mctx, env->iov, 2 * env->nrings,
+		     sizeof(env->iov[0]));
+	isc_mem_cput(env->mctx, env->heads, env->nrings,
+		     sizeof(env->heads[0]));
+	env->rings = NULL;
+
+	isc_condition_destroy(&env->writercond);
+	isc_mutex_destroy(&env->writerlock);
+	isc_mutex_destroy(&env->sharedlock);
+}
+
+isc_result_t
+dns_dt_createring(isc_mem_t *mctx, const char *path, size_t size,
+		  isc_loop_t *loop, dns_dtenv_t **envp) {
+	isc_result_t result;
+	dns_dtenv_t *env = NULL;
+	size_t ringsize = DTRING_MINSIZE;
+
+	REQUIRE(path != NULL);
+	REQUIRE(envp != NULL && *envp == NULL);
+
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_DNSTAP, DNS_LOGMODULE_DNSTAP,
+		      ISC_LOG_INFO,
+		      "opening dnstap destination '%s' (ring buffer)", path);
+
+	while (ringsize < size) {
+		ringsize <<= 1;
+	}
+
+	env = isc_mem_get(mctx, sizeof(*env));
+	*env = (dns_dtenv_t){
+		.loop = loop,
+		.mode = dns_dtmode_file,
+		.rolls = ISC_LOG_ROLLINFINITE,
+		.nrings = isc_tid_count() + 1,
+		.fd = -1,
+	};
+
+	isc_mem_attach(mctx, &env->mctx);
+	isc_mutex_init(&env->reopen_lock);
+	env->path = isc_mem_strdup(env->mctx, path);
+	isc_refcount_init(&env->refcount, 1);
+	isc_stats_create(env->mctx, &env->stats, dns_dnstapcounter_max);
+
+	env->rings = isc_mem_cget(env->mctx, env->nrings,
+				  sizeof(env->rings[0]));
+	for (unsigned int i = 0; i < env->nrings; i++) {
+		env->rings[i].base = isc_mem_get(env->mctx, ringsize);
+		env->rings[i].size = ringsize;
+		atomic_init(&env->rings[i].head, 0);
+		atomic_init(&env->rings[i].tail, 0);
+	}
+	env->iov = isc_mem_cget(env->mctx, 2 * env->nrings,
+				sizeof(env->iov[0]));
+	env->heads = isc_mem_cget(env->mctx, env->nrings,
+				  sizeof(env->heads[0]));
+	isc_mutex_init(&env->sharedlock);
+	isc_mutex_init(&env->writerlock);
+	isc_condition_init(&env->writercond);
+
+	result = dtring_open(env);
+	if (result != ISC_R_SUCCESS) {
+		dtring_free(env);
+		isc_mutex_destroy(&env->reopen_lock);
+		isc_mem_free(env->mctx, env->path);
+		isc_stats_detach(&env->stats);
+		isc_mem_putanddetach(&env->mctx, env, sizeof(*env));
+		return (result);
+	}
+
+	dtring_start(env);
+
+	env->magic = DTENV_MAGIC;
+	*envp = env;
+
+	return (ISC_R_SUCCESS);
+}
+
+static isc_result_t
+dtring_reopen(dns_dtenv_t *env, int roll) {
+	isc_result_t result = ISC_R_SUCCESS;
+
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_DNSTAP, DNS_LOGMODULE_DNSTAP,
+		      ISC_LOG_INFO, "%s dnstap destination '%s'",
+		      (roll < 0) ? "reopening" : "rolling", env->path);
+
+	/*
+	 * The loops keep queueing messages while the writer is stopped;
+	 * anything that does not fit is dropped as usual.
+	 */
+	dtring_stop(env);
+	dtring_close(env);
+
+	if (roll == 0) {
+		roll = env->rolls;
+	}
+	if (roll != 0) {
+		result = roll_file(env, roll);
+	}
+
+	if (result == ISC_R_SUCCESS) {
+		result = dtring_open(env);
+	}
+
+	dtring_start(env);
+
+	return (result);
+}
+
+static void
+dtring_append(ProtobufCBuffer *buffer, size_t len, const uint8_t *data) {
+	dtringbuf_t *rb = (dtringbuf_t *)buffer;
+	dtring_t *ring = rb->ring;
+	size_t off = rb->pos & (ring->size - 1);
+	size_t first = ISC_MIN(len, ring->size - off);
+
+	memmove(ring->base + off, data, first);
+	if (len > first) {
+		memmove(ring->base, data + first, len - first);
+	}
+	rb->pos += len;
+}
+
+static void
+dtring_send(dns_dtenv_t *env, const Dnstap__Dnstap *d) {
+	uint32_t tid = isc_tid();
+	bool shared = (tid == ISC_TID_UNKNOWN || tid >= env->nrings - 1);
+	dtring_t *ring = &env->rings[shared ? env->nrings - 1 : tid];
+	size_t len = dnstap__dnstap__get_packed_size(d);
+	uint64_t head, tail;
+	bool queued = false;
+
+	if (shared) {
+		LOCK(&env->sharedlock);
+	}
+
+	head = atomic_load_relaxed(&ring->head);
+	tail = atomic_load_acquire(&ring->tail);
+	if (sizeof(uint32_t) + len <= ring->size - (head - tail)) {
+		dtringbuf_t rb = {
+			.base.append = dtring_append,
+			.ring = ring,
+			.pos = head,
+		};
+		uint8_t frame[4] = { len >> 24, len >> 16, len >> 8, len };
+
+		dtring_append(&rb.base, sizeof(frame), frame);
+		(void)dnstap__dnstap__pack_to_buffer(d, &rb.base);
+		INSIST(rb.pos == head + sizeof(frame) + len);
+
+		atomic_store_release(&ring->head, rb.pos);
+		queued = true;
+	}
+
+	if (shared) {
+		UNLOCK(&env->sharedlock);
+	}
+
+	if (env->stats != NULL) {
+		isc_stats_increment(env->stats,
+				    queued ? dns_dnstapcounter_success
+					   : dns_dnstapcounter_drop);
+	}
+}
+
 isc_result_t
 dns_dt_setupfile(dns_dtenv_t *env, uint64_t max_size, int rolls,
 		 isc_log_rollsuffix_t suffix) {
@@ -274,7 +767,6 @@ isc_result_t
 dns_dt_reopen(dns_dtenv_t *env, int roll) {
 	isc_result_t result = ISC_R_SUCCESS;
 	fstrm_res res;
-	isc_logfile_t file;
 	struct fstrm_unix_writer_options *fuwopt = NULL;
 	struct fstrm_file_options *ffwopt = NULL;
 	struct fstrm_writer_options *fwopt = NULL;
@@ -283,6 +775,10 @@ dns_dt_reopen(dns_dtenv_t *env, int roll) {
 
 	REQUIRE(VALID_DTENV(env));
 
+	if (env->rings != NULL) {
+		return (dtring_reopen(env, roll));
+	}
+
 	loopmgr = isc_loop_getloopmgr(env->loop);
 	isc_loopmgr_pause(loopmgr);
 
@@ -339,20 +835,7 @@ dns_dt_reopen(dns_dtenv_t *env, int roll) {
 	}
 
 	if (env->mode == dns_dtmode_file && roll != 0) {
-		/*
-		 * Create a temporary isc_logfile_t structure so we can
-		 * take advantage of the logfile rolling facility.
-		 */
-		char *filename = isc_mem_strdup(env->mctx, env->path);
-		file.name = filename;
-		file.stream = NULL;
-		file.versions = roll;
-		file.maximum_size = 0;
-		file.maximum_reached = false;
-		file.suffix = env->suffix;
-		result = isc_logfile_roll(&file);
-		isc_mem_free(env->mctx, filename);
-		CHECK(result);
+		CHECK(roll_file(env, roll));
 	}
 
 	env->iothr = fstrm_iothr_init(env->fopt, &fw);
@@ -480,6 +963,11 @@ destroy(dns_dtenv_t *env) {
 
 	atomic_fetch_add(&global_generation, 1);
 
+	if (env->rings != NULL) {
+		dtring_stop(env);
+		dtring_close(env);
+		dtring_free(env);
+	}
 	if (env->iothr != NULL) {
 		fstrm_iothr_destroy(&env->iothr);
 	}
@@ -742,6 +1230,195 @@ unlock_and_return:
 	UNLOCK(&env->reopen_lock);
 }
 
+void
+dns_dtfilter_create(isc_mem_t *mctx, dns_dtfilter_t **filterp) {
+	dns_dtfilter_t *filter = NULL;
+
+	REQUIRE(filterp != NULL && *filterp == NULL);
+
+	filter = isc_mem_get(mctx, sizeof(*filter));
+	*filter = (dns_dtfilter_t){
+		.magic = DTFILTER_MAGIC,
+		.references = ISC_REFCOUNT_INITIALIZER(1),
+		.sample = 1,
+	};
+	isc_mem_attach(mctx, &filter->mctx);
+
+	*filterp = filter;
+}
+
+static void
+dtfilter_destroy(dns_dtfilter_t *filter) {
+	filter->magic = 0;
+	if (filter->qnames != NULL) {
+		dns_nametree_detach(&filter->qnames);
+	}
+	if (filter->clients != NULL) {
+		dns_acl_detach(&filter->clients);
+	}
+	isc_mem_putanddetach(&filter->mctx, filter, sizeof(*filter));
+}
+
+ISC_REFCOUNT_IMPL(dns_dtfilter, dtfilter_destroy);
+
+void
+dns_dtfilter_setsample(dns_dtfilter_t *filter, uint32_t sample) {
+	REQUIRE(VALID_DTFILTER(filter));
+	REQUIRE(sample > 0);
+
+	filter->sample = sample;
+}
+
+void
+dns_dtfilter_setqnames(dns_dtfilter_t *filter, dns_nametree_t *qnames) {
+	REQUIRE(VALID_DTFILTER(filter));
+
+	if (filter->qnames != NULL) {
+		dns_nametree_detach(&filter->qnames);
+	}
+	if (qnames != NULL) {
+		dns_nametree_attach(qnames, &filter->qnames);
+	}
+}
+
+void
+dns_dtfilter_setclients(dns_dtfilter_t *filter, dns_acl_t *acl) {
+	REQUIRE(VALID_DTFILTER(filter));
+
+	if (filter->clients != NULL) {
+		dns_acl_detach(&filter->clients);
+	}
+	if (acl != NULL) {
+		dns_acl_attach(acl, &filter->clients);
+	}
+}
+
+void
+dns_dtfilter_addrcode(dns_dtfilter_t *filter, dns_rcode_t rcode) {
+	REQUIRE(VALID_DTFILTER(filter));
+	REQUIRE(rcode < 16);
+
+	filter->rcodes |= (1 << rcode);
+}
+
+void
+dns_dtfilter_setlatency(dns_dtfilter_t *filter, uint32_t msecs) {
+	REQUIRE(VALID_DTFILTER(filter));
+
+	filter->latency = msecs;
+}
+
+/*
+ * Decide whether a message passes the view's filter, looking only at
+ * the raw wire data so that nothing is serialized for messages that
+ * are thrown away.  The checks are ordered from cheapest to most
+ * expensive.
+ */
+static bool
+dtfilter_match(dns_view_t *view, dns_dtmsgtype_t msgtype,
+	       isc_sockaddr_t *qaddr, isc_time_t *qtime, isc_time_t *rtime,
+	       isc_buffer_t *buf) {
+	dns_dtfilter_t *filter = view->dtfilter;
+	bool response = ((msgtype & DNS_DTTYPE_RESPONSE) != 0);
+	isc_region_t r;
+
+	if (buf == NULL) {
+		return (false);
+	}
+
+	isc_buffer_usedregion(buf, &r);
+	if (r.length < DNS_MESSAGE_HEADERLEN) {
+		return (false);
+	}
+
+	/*
+	 * The response code and latency are only known for responses;
+	 * queries are not affected by these two criteria.
+	 */
+	if (response && filter->rcodes != 0 &&
+	    (filter->rcodes & (1 << (r.base[3] & 0x0f))) == 0)
+	{
+		return (false);
+	}
+
+	if (response && filter->latency != 0) {
+		isc_time_t now;
+
+		if (qtime == NULL) {
+			return (false);
+		}
+		if (rtime == NULL) {
+			now = isc_time_now();
+			rtime = &now;
+		}
+		if (isc_time_microdiff(rtime, qtime) <
+		    (uint64_t)filter->latency * 1000)
+		{
+			return (false);
+		}
+	}
+
+	/*
+	 * Sample by transaction rather than by message: the query ID and
+	 * the address of the query initiator are the same in a query and
+	 * its response, so either both of them are logged or neither is.
+	 */
+	if (filter->sample > 1) {
+		isc_hash32_t state;
+		uint32_t hash;
+
+		isc_hash32_init(&state);
+		isc_hash32_hash(&state, r.base, 2, true);
+		if (qaddr != NULL) {
+			isc_sockaddr_hash_ex(&state, qaddr, false);
+		}
+		hash = isc_hash32_finalize(&state);
+		if (hash % filter->sample != 0) {
+			return (false);
+		}
+	}
+
+	if (filter->clients != NULL) {
+		isc_netaddr_t netaddr;
+		int match = 0;
+
+		if (qaddr == NULL) {
+			return (false);
+		}
+		isc_netaddr_fromsockaddr(&netaddr, qaddr);
+		if (dns_acl_match(&netaddr, NULL, filter->clients,
+				  view->aclenv, &match,
+				  NULL) != ISC_R_SUCCESS ||
+		    match <= 0)
+		{
+			return (false);
+		}
+	}
+
+	if (filter->qnames != NULL) {
+		dns_fixedname_t fixed;
+		dns_name_t *qname = dns_fixedname_initname(&fixed);
+		isc_buffer_t source;
+
+		/* QDCOUNT */
+		if (r.base[4] == 0 && r.base[5] == 0) {
+			return (false);
+		}
+
+		isc_buffer_init(&source, r.base, r.length);
+		isc_buffer_add(&source, r.length);
+		isc_buffer_forward(&source, DNS_MESSAGE_HEADERLEN);
+		if (dns_name_fromwire(qname, &source, DNS_DECOMPRESS_NEVER,
+				      NULL) != ISC_R_SUCCESS ||
+		    !dns_nametree_covered(filter->qnames, qname, NULL, 0))
+		{
+			return (false);
+		}
+	}
+
+	return (true);
+}
+
 void
 dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype, isc_sockaddr_t *qaddr,
 	    isc_sockaddr_t *raddr, dns_transport_type_t transport,
@@ -762,6 +1439,14 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype, isc_sockaddr_t *qaddr,
 
 	REQUIRE(VALID_DTENV(view->dtenv));
 
+	if (view->dtfilter != NULL &&
+	    !dtfilter_match(view, msgtype, qaddr, qtime, rtime, buf))
+	{
+		isc_stats_increment(view->dtenv->stats,
+				    dns_dnstapcounter_filtered);
+		return;
+	}
+
 	if (view->dtenv->max_size != 0) {
 		check_file_size_and_maybe_reopen(view->dtenv);
 	}
@@ -856,7 +1541,9 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype, isc_sockaddr_t *qaddr,
 			&dm.m.has_response_port);
 	}
 
-	if (pack_dt(&dm.d, &dm.buf, &dm.len) == ISC_R_SUCCESS) {
+	if (view->dtenv->rings != NULL) {
+		dtring_send(view->dtenv, &dm.d);
+	} else if (pack_dt(&dm.d, &dm.buf, &dm.len) == ISC_R_SUCCESS) {
 		send_dt(view->dtenv, dm.buf, dm.len);
 	}
 }
@@ -258,6 +258,14 @@ dns_cache_setmaxtypepername(dns_cache_t *cache, uint32_t value);
  * Set the maximum resource record types per owner name that can be cached.
  */
 
+void
+dns_cache_setloopcachesize(dns_cache_t *cache, uint32_t size);
+/*%<
+ * Set the number of entries in the per-loop caches of recent lookups
+ * kept in front of the cache database; zero disables them.  See
+ * dns_db_setloopcache().
+ */
+
 #ifdef HAVE_LIBXML2
 int
 dns_cache_renderxml(dns_cache_t *cache, void *writer0);
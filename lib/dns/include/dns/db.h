@@ -185,6 +185,9 @@ typedef struct dns_dbmethods {
 				     dns_name_t *name);
 	void (*setmaxrrperset)(dns_db_t *db, uint32_t value);
 	void (*setmaxtypepername)(dns_db_t *db, uint32_t value);
+	void (*setloopcache)(dns_db_t *db, uint32_t size);
+	isc_result_t (*getloopcachestats)(dns_db_t *db, uint32_t tid,
+					  uint64_t *hitsp, uint64_t *missesp);
 } dns_dbmethods_t;
 
 typedef isc_result_t (*dns_dbcreatefunc_t)(isc_mem_t	    *mctx,
@@ -1821,4 +1824,38 @@ dns_db_setmaxtypepername(dns_db_t *db, uint32_t value);
  * stored at a given node, then any subsequent attempt to add an rdataset
  * with a new RR type will return ISC_R_TOOMANYRECORDS.
  */
+
+void
+dns_db_setloopcache(dns_db_t *db, uint32_t size);
+/*%<
+ * Set the number of entries in the per-loop caches of recent lookups
+ * that a cache database may keep in front of its main data structure;
+ * the value may be rounded up.  Zero disables the loop caches.
+ *
+ * Each loop cache is only used by lookups running on its own loop, and
+ * is resized the next time that loop uses it.
+ *
+ * Requires:
+ *
+ * \li	'db' is a valid database.
+ */
+
+isc_result_t
+dns_db_getloopcachestats(dns_db_t *db, uint32_t tid, uint64_t *hitsp,
+			 uint64_t *missesp);
+/*%<
+ * Get the number of lookups that were answered from ('*hitsp') or
+ * missed ('*missesp') the loop cache of loop 'tid'.
+ *
+ * Requires:
+ *
+ * \li	'db' is a valid database.
+ * \li	'hitsp' and 'missesp' are not NULL.
+ *
+ * Returns:
+ *
+ * \li	#ISC_R_SUCCESS
+ * \li	#ISC_R_RANGE		'tid' is not a valid loop number.
+ * \li	#ISC_R_NOTIMPLEMENTED	the database has no loop caches.
+ */
 ISC_LANG_ENDDECLS
@@ -162,6 +162,41 @@ dns_dt_create(isc_mem_t *mctx, dns_dtmode_t mode, const char *path,
  *\li	Other errors are possible.
  */
 
+isc_result_t
+dns_dt_createring(isc_mem_t *mctx, const char *path, size_t size,
+		  isc_loop_t *loop, dns_dtenv_t **envp);
+/*%<
+ * Create and initialize a dnstap environment that writes to the file
+ * 'path' through per-loop ring buffers instead of libfstrm's I/O thread.
+ *
+ * Notes:
+ *
+ *\li	Each loop serializes messages directly into its own ring of 'size'
+ *	bytes (rounded up to a power of two, and at least 64k), and a
+ *	dedicated writer thread writes the rings out.  When a ring is full,
+ *	messages are dropped and counted as such instead of slowing down
+ *	the loop.  Threads that are not loops share one more ring.
+ *
+ *\li	Only file output is supported; the output can be read with
+ *	dns_dt_open() like that of a dns_dtmode_file environment.
+ *
+ *\li	'loop' is as for dns_dt_create().
+ *
+ * Requires:
+ *
+ *\li	'mctx' is a valid memory context.
+ *
+ *\li	'path' is a valid C string.
+ *
+ *\li	envp != NULL && *envp == NULL
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *
+ *\li	Other errors are possible if the file cannot be opened.
+ */
+
 isc_result_t
 dns_dt_setupfile(dns_dtenv_t *env, uint64_t max_size, int rolls,
 		 isc_log_rollsuffix_t suffix);
@@ -268,7 +303,8 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype, isc_sockaddr_t *qaddr,
 	    isc_buffer_t *buf);
 /*%<
  * Sends a dnstap message to the log, if 'msgtype' is one of the message
- * types represented in 'view->dttypes'.
+ * types represented in 'view->dttypes' and the message passes the filter
+ * in 'view->dtfilter', if any.
  *
  * Parameters are: 'qaddr' (query address, i.e, the address of the
  * query initiator); 'raddr' (response address, i.e., the address of
@@ -284,6 +320,88 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype, isc_sockaddr_t *qaddr,
  *	valid dnstap environment.
  */
 
+void
+dns_dtfilter_create(isc_mem_t *mctx, dns_dtfilter_t **filterp);
+/*%<
+ * Create a dnstap message filter that lets every message through.  The
+ * criteria set with the functions below are combined, so a message is
+ * only logged if it passes all of them.  A filter is put into effect by
+ * attaching it to 'view->dtfilter'; it must not be changed after that.
+ *
+ * Messages are filtered in dns_dt_send() before they are serialized,
+ * and the ones thrown away are counted as dns_dnstapcounter_filtered.
+ *
+ * Requires:
+ *
+ *\li	'mctx' is a valid memory context.
+ *
+ *\li	filterp != NULL && *filterp == NULL
+ */
+
+void
+dns_dtfilter_setsample(dns_dtfilter_t *filter, uint32_t sample);
+/*%<
+ * Only log one in 'sample' transactions.  The decision is made from the
+ * message ID and the query initiator's address, so a query and its
+ * response are either both logged or both skipped.
+ *
+ * Requires:
+ *
+ *\li	'filter' is a valid filter, and 'sample' is greater than zero.
+ */
+
+void
+dns_dtfilter_setqnames(dns_dtfilter_t *filter, dns_nametree_t *qnames);
+/*%<
+ * Only log messages whose question name is at or below a name set in
+ * 'qnames', which should be a DNS_NAMETREE_BOOL tree.  Messages without
+ * a question are not logged.  If 'qnames' is NULL, the criterion is
+ * removed.
+ *
+ * Requires:
+ *
+ *\li	'filter' is a valid filter.
+ */
+
+void
+dns_dtfilter_setclients(dns_dtfilter_t *filter, dns_acl_t *acl);
+/*%<
+ * Only log messages whose query initiator address ('qaddr' in
+ * dns_dt_send()) matches 'acl'.  If 'acl' is NULL, the criterion is
+ * removed.
+ *
+ * Requires:
+ *
+ *\li	'filter' is a valid filter.
+ */
+
+void
+dns_dtfilter_addrcode(dns_dtfilter_t *filter, dns_rcode_t rcode);
+/*%<
+ * Log responses with the response code 'rcode'.  Once at least one code
+ * has been added, responses with any other code are not logged.  Only
+ * the four bits in the message header are looked at.  Queries are not
+ * affected.
+ *
+ * Requires:
+ *
+ *\li	'filter' is a valid filter, and 'rcode' is less than 16.
+ */
+
+void
+dns_dtfilter_setlatency(dns_dtfilter_t *filter, uint32_t msecs);
+/*%<
+ * Only log responses that arrived at least 'msecs' milliseconds after
+ * the query was sent; responses for which no query time is known are
+ * not logged.  Queries are not affected.  Zero removes the criterion.
+ *
+ * Requires:
+ *
+ *\li	'filter' is a valid filter.
+ */
+
+ISC_REFCOUNT_DECL(dns_dtfilter);
+
 isc_result_t
 dns_dt_parse(isc_mem_t *mctx, isc_region_t *src, dns_dtdata_t **destp);
 /*%<
@@ -61,6 +61,14 @@ dns_iptable_merge(dns_iptable_t *tab, dns_iptable_t *source, bool pos);
  * Merge one IP table into another one.
  */
 
+void
+dns_iptable_compile(dns_iptable_t *tab);
+/*
+ * Compile the IP table for faster lookups once it is complete; see
+ * isc_radix_compile().  Adding to the table afterwards is allowed, but
+ * drops it back to the slower lookups.
+ */
+
 #if DNS_IPTABLE_TRACE
 #define dns_iptable_ref(ptr) dns_iptable__ref(ptr, __func__, __FILE__, __LINE__)
 #define dns_iptable_unref(ptr) \
@@ -55,6 +55,7 @@
 /*% Rewrite whole journal file instead of compacting */
 #define DNS_JOURNAL_COMPACTALL 0x0001
 #define DNS_JOURNAL_VERSION1   0x0002
+#define DNS_JOURNAL_VERSION2   0x0004
 
 /***
  *** Types
@@ -111,7 +112,8 @@ dns_journal_open(isc_mem_t *mctx, const char *filename, unsigned int mode,
  * DNS_JOURNAL_CREATE open the journal for reading and writing and create
  * the journal if it does not exist.
  * DNS_JOURNAL_WRITE open the journal for reading and writing.
- * DNS_JOURNAL_READ open the journal for reading only.
+ * DNS_JOURNAL_READ open the journal for reading only; the file is
+ * mapped into memory if possible.
  */
 
 void
@@ -311,8 +313,13 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
  * In this case, `serial` is ignored. This flag is used when upgrading or
  * downgrading the format version of the journal. If 'flags' also includes
  * DNS_JOURNAL_VERSION1, then the journal is copied out in the original
- * format used prior to BIND 9.16.12; otherwise it is copied in the
- * current format.
+ * format used prior to BIND 9.16.12; if it includes DNS_JOURNAL_VERSION2,
+ * it is copied out in the format with an unsorted index that was used
+ * before the current one; otherwise it is copied in the current format.
+ *
+ * A journal in the current format gets an index with room for twice
+ * the number of transactions that are kept, within an eighth of
+ * 'target_size' if that is not zero.
  *
  * If _COMPACTALL is not in use, and the journal file exists and is
  * non-empty, then 'serial' must exist in the journal.
@@ -324,6 +331,59 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
  * Other errors may be returned from file operations.
  */
 
+isc_result_t
+dns_journal_truncate(isc_mem_t *mctx, const char *filename, uint32_t serial,
+		     uint32_t target_size, uint32_t *beginp, uint32_t *freedp);
+/*%<
+ * Compact the journal like dns_journal_compact(), but by moving the
+ * beginning of the journal forward instead of copying the transactions
+ * that are kept into a new file.  Only the header of the journal is
+ * written; the transactions that are dropped stay in the file until
+ * dns_journal_punch() releases their disk space.
+ *
+ * The header is not flushed to stable storage.  The journal must not
+ * be open for writing elsewhere.
+ *
+ * On success, '*beginp' is the file offset of the first transaction
+ * of the journal, and '*freedp' the number of bytes that were dropped.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	ISC_R_RANGE	serial is outside the range existing in the journal
+ *\li	ISC_R_NOTIMPLEMENTED
+ *			the journal is not in the current format, its
+ *			file offsets are getting too large, what is
+ *			kept is small, or disk space cannot be released
+ *			on this system; it should be compacted with
+ *			dns_journal_compact() instead.
+ *
+ * Other errors may be returned from file operations.
+ */
+
+isc_result_t
+dns_journal_punch(const char *filename, uint32_t offset);
+/*%<
+ * Flush the journal to stable storage, and then release the disk space
+ * of the transactions that were dropped from it before file offset
+ * 'offset', by punching a hole in the file where the file system
+ * supports it.  Nothing at or after the current beginning of the
+ * journal is released, so 'offset' may be out of date.
+ *
+ * This does not use the journal data structures, and may be called
+ * while the journal is open elsewhere.  The transactions that journals
+ * opened for reading in this process before they were dropped may
+ * still read are not released.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	ISC_R_NOTIMPLEMENTED
+ *			the file system cannot release the space; the
+ *			journal should be compacted with
+ *			dns_journal_compact() instead.
+ *
+ * Other errors may be returned from file operations.
+ */
+
 bool
 dns_journal_get_sourceserial(dns_journal_t *j, uint32_t *sourceserial);
 void
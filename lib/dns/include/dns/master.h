@@ -77,6 +77,7 @@ ISC_LANG_BEGINDECLS
 #define DNS_MASTERRAW_COMPAT	      0x01
 #define DNS_MASTERRAW_SOURCESERIALSET 0x02
 #define DNS_MASTERRAW_LASTXFRINSET    0x04
+#define DNS_MASTERRAW_FIXEDORDER      0x08 /*%< image slabs have load order */
 
 /* Common header */
 struct dns_masterrawheader {
@@ -106,6 +107,22 @@ typedef struct {
 	/* followed by encoded owner name, and then rdata */
 } dns_masterrawrdataset_t;
 
+/*
+ * The "image" format shares the common header with the "raw" format
+ * (with 'format' set to dns_masterformat_image), but each RRset is
+ * stored as a ready-made rdataslab that the loader can hand to the
+ * database without parsing, sorting or deduplicating the rdata:
+ *
+ *	totallen	(4 bytes, including this field)
+ *	class, type, covers (2 bytes each)
+ *	ttl		(4 bytes)
+ *	owner name	(2 bytes of length, then the name in wire format)
+ *	rdataslab	(the rest of the RRset, see rdataslab.c)
+ *
+ * The layout of a slab depends on DNS_RDATASET_FIXED, which is recorded
+ * in the header with DNS_MASTERRAW_FIXEDORDER.
+ */
+
 /*
  * Method prototype: a callback to register each include file as
  * it is encountered.
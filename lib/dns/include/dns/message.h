@@ -697,6 +697,38 @@ dns_message_rendersection(dns_message_t *msg, dns_section_t section,
  *				   are records remaining for this section.
  */
 
+isc_result_t
+dns_message_renderraw(dns_message_t *msg, dns_section_t section,
+		      const isc_region_t *region, unsigned int count);
+/*%<
+ * Append 'count' records that have already been rendered in wire format
+ * in 'region' to the given section, without looking at their contents.
+ *
+ * Notes:
+ *
+ *\li	This is used to replay the sections of a previously rendered
+ *	message.  Any compression pointers in 'region' must be valid at
+ *	the current offset in the buffer, which generally means that the
+ *	data was rendered at the same offset of a message that had the
+ *	same contents up to that point; the compression context is not
+ *	updated, so the caller must not render names after this that
+ *	could be compressed against the raw data.
+ *
+ * Requires:
+ *\li	'msg' be valid.
+ *
+ *\li	'section' be a valid section.
+ *
+ *\li	'region' be valid.
+ *
+ *\li	dns_message_renderbegin() was called.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS		-- the records were written.
+ *\li	#ISC_R_NOSPACE		-- Not enough room in the buffer, allowing
+ *				   for the reserved space.
+ */
+
 void
 dns_message_renderheader(dns_message_t *msg, isc_buffer_t *target);
 /*%<
@@ -132,9 +132,22 @@ struct dns_slabheader {
 	 */
 	unsigned char upper[32];
 
-	isc_heap_t	   *heap;
-	dns_glue_t	   *glue_list;
-	struct cds_wfs_node wfs_node;
+	isc_heap_t *heap;
+	union {
+		struct {
+			dns_glue_t	   *glue_list;
+			struct cds_wfs_node wfs_node;
+		};
+		struct {
+			struct rcu_head rcu_head;
+			isc_mem_t      *mctx;
+		};
+	};
+	/*%<
+	 * Zone databases use the glue list; the cache uses the RCU head
+	 * and memory context to free an unlinked header once concurrent
+	 * lock-free readers are done with it.
+	 */
 };
 
 enum {
@@ -175,6 +188,10 @@ dns_rdataslab_fromrdataset(dns_rdataset_t *rdataset, isc_mem_t *mctx,
  * Slabify a rdataset.  The slab area will be allocated and returned
  * in 'region'.
  *
+ * If 'rdataset' is itself bound to a bare slab (see
+ * dns_rdataslab_tordataset()), the slab is already in DNSSEC order
+ * without duplicates and is copied as it is.
+ *
  * Requires:
  *\li	'rdataset' is valid.
  *
@@ -189,6 +206,43 @@ dns_rdataslab_fromrdataset(dns_rdataset_t *rdataset, isc_mem_t *mctx,
  *\li	XXX others
  */
 
+void
+dns_rdataslab_tordataset(unsigned char *slab, dns_rdataclass_t rdclass,
+			 dns_rdatatype_t type, dns_rdatatype_t covers,
+			 dns_ttl_t ttl, dns_rdataset_t *rdataset);
+/*%<
+ * Make 'rdataset' refer to the bare slab 'slab', i.e. one that has no
+ * reserved header in front of it and does not belong to a database,
+ * such as a slab mapped from a zone image file.  The slab is not copied
+ * and must remain valid for as long as 'rdataset' is associated.
+ *
+ * Requires:
+ *\li	'slab' is a valid slab for 'type' with a reservelen of zero.
+ *\li	'rdataset' is a valid, disassociated rdataset.
+ */
+
+isc_result_t
+dns_rdataslab_check(unsigned char *slab, unsigned int length,
+		    dns_rdataclass_t rdclass, dns_rdatatype_t type,
+		    isc_buffer_t *target, unsigned int *sizep);
+/*%<
+ * Check that the bare slab at 'slab' is well formed and fits in the
+ * 'length' bytes available, that each rdata in it is valid wire format
+ * for 'rdclass' and 'type', and that the rdata are sorted in DNSSEC
+ * order without duplicates.  'target' is used as scratch space when
+ * checking the rdata.  On success the size of the slab is stored in
+ * '*sizep'.
+ *
+ * Requires:
+ *\li	'target' is a valid buffer large enough for any rdata.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	ISC_R_RANGE		- the slab is truncated or malformed.
+ *\li	DNS_R_FORMERR		- the rdata are not sorted or not unique.
+ *\li	Any error returned by dns_rdata_fromwire().
+ */
+
 unsigned int
 dns_rdataslab_size(unsigned char *slab, unsigned int reservelen);
 /*%<
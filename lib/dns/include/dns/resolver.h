@@ -53,8 +53,10 @@
 #include <isc/loop.h>
 #include <isc/refcount.h>
 #include <isc/stats.h>
+#include <isc/stdtime.h>
 #include <isc/tls.h>
 #include <isc/types.h>
+#include <isc/work.h>
 
 #include <dns/fixedname.h>
 #include <dns/types.h>
@@ -471,6 +473,21 @@ dns_resolver_setmustbesecure(dns_resolver_t *resolver, const dns_name_t *name,
 bool
 dns_resolver_getmustbesecure(dns_resolver_t *resolver, const dns_name_t *name);
 
+void
+dns_resolver_verify(dns_resolver_t *resolver, isc_work_cb work_cb,
+		    isc_after_work_cb after_work_cb, void *cbarg);
+/*%<
+ * Run 'work_cb' on the offload threads and then 'after_work_cb' on the
+ * current loop, like isc_work_enqueue().  This is meant for DNSSEC
+ * signature verification: the calls queued on a loop are not offloaded
+ * one by one, but collected and run together in batches.
+ *
+ * Requires:
+ * \li	'resolver' is a valid resolver.
+ * \li	The caller is running on one of the resolver's loops.
+ * \li	'work_cb' and 'after_work_cb' are not NULL.
+ */
+
 void
 dns_resolver_settimeout(dns_resolver_t *resolver, unsigned int timeout);
 /*%<
@@ -575,6 +592,42 @@ dns_resolver_printbadcache(dns_resolver_t *resolver, FILE *fp);
  * \li	resolver to be valid.
  */
 
+void
+dns_resolver_addsigcache(dns_resolver_t *resolver, const unsigned char *digest,
+			 isc_stdtime_t inception, isc_stdtime_t expire);
+/*%<
+ * Remember a successfully verified signature, identified by 'digest'
+ * (see dns_sigcache_digest()), until 'expire'.
+ *
+ * Requires:
+ * \li	resolver to be valid.
+ */
+
+isc_result_t
+dns_resolver_getsigcache(dns_resolver_t *resolver, const unsigned char *digest,
+			 isc_stdtime_t now);
+/*%<
+ * Check whether the signature identified by 'digest' has already been
+ * verified and is still valid at 'now', and count the lookup as a hit
+ * or a miss in the resolver statistics.
+ *
+ * Requires:
+ * \li	resolver to be valid.
+ *
+ * Returns:
+ * \li	ISC_R_SUCCESS if the signature was found.
+ * \li	ISC_R_NOTFOUND otherwise.
+ */
+
+void
+dns_resolver_flushsigcache(dns_resolver_t *resolver);
+/*%<
+ * Forget all of the verified signatures.
+ *
+ * Requires:
+ * \li	resolver to be valid.
+ */
+
 void
 dns_resolver_setmaxvalidations(dns_resolver_t *resolver, uint32_t max);
 void
@@ -634,6 +687,33 @@ dns_resolver_dumpfetches(dns_resolver_t *resolver, isc_statsformat_t format,
 isc_result_t
 dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf);
 
+void
+dns_resolver_setfetchtrace(dns_resolver_t *resolver, uint32_t rate);
+uint32_t
+dns_resolver_getfetchtrace(dns_resolver_t *resolver);
+/*%
+ * Get and set the fetch tracing sample rate: one in every 'rate' new
+ * fetches records how long it took to reach each stage of resolution
+ * (address lookup, sending queries, receiving responses, validation,
+ * caching).  0 disables tracing.
+ *
+ * Requires:
+ * \li	'resolver' to be valid.
+ */
+
+isc_result_t
+dns_resolver_dumpfetchtrace(dns_resolver_t *res, isc_buffer_t **buf);
+/*%
+ * Append the most recent finished fetch traces of each loop to 'buf',
+ * one per line, oldest first.  Stage times are in microseconds since
+ * the fetch was created; a stage reached more than once is shown as
+ * the first and last time with a count.
+ *
+ * Requires:
+ * \li	'res' to be valid.
+ * \li	'buf' to point to a valid, growable buffer.
+ */
+
 #ifdef ENABLE_AFL
 /*%
  * Enable fuzzing of resolver, changes behaviour and eliminates retries
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/respcache.h
+ * \brief
+ * Defines dns_respcache_t, the authoritative response cache.
+ *
+ * Notes:
+ *\li	A response cache holds fully rendered authoritative responses
+ *	in wire format, keyed by the question and the request properties
+ *	that influence rendering (EDNS, the DO/RD/CD/AD bits, the
+ *	transport address family and the available buffer size).  On a
+ *	hit only the message ID and the case of the question name need
+ *	to be patched before the response can be sent.
+ *
+ *\li	Each entry remembers the zone it was built from and the zone
+ *	generation (see dns_zone_getgeneration()) at the time the zone
+ *	data was read; entries are ignored and evicted once the zone
+ *	generation moves on.  The zone is not attached and is only used
+ *	for comparison.
+ *
+ * Reliability:
+ *
+ * Resources:
+ *\li	The cache is bounded by the size given at creation time.
+ *
+ * Security:
+ *
+ * Standards:
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/region.h>
+
+#include <dns/types.h>
+
+/*%
+ * Request properties that change the rendered response.
+ */
+#define DNS_RESPCACHE_EDNS  0x0001 /*%< request had an OPT record */
+#define DNS_RESPCACHE_DO    0x0002 /*%< DNSSEC OK */
+#define DNS_RESPCACHE_RD    0x0004 /*%< recursion desired */
+#define DNS_RESPCACHE_CD    0x0008 /*%< checking disabled */
+#define DNS_RESPCACHE_AD    0x0010 /*%< authentic data requested */
+#define DNS_RESPCACHE_INET6 0x0020 /*%< received over IPv6 */
+
+ISC_LANG_BEGINDECLS
+
+/***
+ ***	Functions
+ ***/
+
+dns_respcache_t *
+dns_respcache_new(isc_mem_t *mctx, size_t maxsize);
+/*%
+ * Allocate and initialize a response cache holding at most 'maxsize'
+ * bytes of entries.
+ *
+ * Requires:
+ * \li	mctx != NULL
+ * \li	maxsize > 0
+ */
+
+void
+dns_respcache_destroy(dns_respcache_t **rcp);
+/*%
+ * Flush and then free the response cache in 'rcp'.  '*rcp' is set to
+ * NULL on return.
+ *
+ * Requires:
+ * \li	'*rcp' to be a valid response cache
+ */
+
+void
+dns_respcache_add(dns_respcache_t *rc, dns_zone_t *zone, uint32_t generation,
+		  const dns_name_t *qname, dns_rdatatype_t qtype,
+		  dns_rdataclass_t qclass, unsigned int flags, uint16_t bufsize,
+		  bool complete, const isc_region_t *r);
+/*%
+ * Add the rendered response in 'r' to the cache.  'bufsize' is the size
+ * of the buffer the response was rendered into; if 'complete' is true
+ * nothing was left out of the response for lack of space and it may be
+ * used for any request with at least 'r->length' bytes of buffer space.
+ *
+ * If the cache is full, a few entries are evicted first; if that does
+ * not make enough room the response is not cached.
+ *
+ * Requires:
+ * \li	'rc' to be a valid response cache
+ * \li	'zone' and 'qname' to be non NULL
+ * \li	'r' to hold a DNS message with 'qname' as its first question
+ */
+
+isc_result_t
+dns_respcache_find(dns_respcache_t *rc, dns_zone_t *zone, uint32_t generation,
+		   const dns_name_t *qname, dns_rdatatype_t qtype,
+		   dns_rdataclass_t qclass, unsigned int flags,
+		   dns_messageid_t id, isc_buffer_t *target);
+/*%
+ * Look for a cached response matching the question and 'flags' that
+ * was built from 'zone' at 'generation' and fits into the available
+ * space of 'target'.  On success, the response is appended to 'target'
+ * with its message ID set to 'id' and its question name replaced by
+ * 'qname' (which may differ in case from the cached one).
+ *
+ * Requires:
+ * \li	'rc' to be a valid response cache
+ * \li	'zone' and 'qname' to be non NULL
+ * \li	'target' to be a valid buffer
+ *
+ * Returns:
+ * \li	#ISC_R_SUCCESS
+ * \li	#ISC_R_NOTFOUND
+ */
+
+void
+dns_respcache_flush(dns_respcache_t *rc);
+/*%
+ * Flush the entire response cache.
+ *
+ * Requires:
+ * \li	'rc' to be a valid response cache
+ */
+
+ISC_LANG_ENDDECLS
@@ -20,7 +20,9 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/atomic.h>
 #include <isc/lang.h>
+#include <isc/mutex.h>
 
 #include <dns/fixedname.h>
 #include <dns/rdata.h>
@@ -187,39 +189,29 @@ struct dns_rrl_qname_buf {
 
 typedef struct dns_rrl_rate dns_rrl_rate_t;
 struct dns_rrl_rate {
-	int	    r;
-	int	    scaled;
-	const char *str;
+	int		    r;
+	atomic_int_fast32_t scaled;
+	const char	   *str;
 };
 
+typedef struct dns_rrl dns_rrl_t;
+
 /*
- * Per-view query rate limit parameters and a pointer to database.
+ * One shard of the rate limit database.
+ * The entry for a response is assigned to a shard by its whole key, so
+ * responses to one client for different names or kinds of response
+ * spread over the shards.  The all-per-second and TCP entries of a
+ * client are assigned by its (masked) address alone; a response only
+ * locks that shard as well when all-per-second is set or the limits
+ * are scaled by qps-scale.
  */
-typedef struct dns_rrl dns_rrl_t;
-struct dns_rrl {
+typedef struct dns_rrl_shard dns_rrl_shard_t;
+struct dns_rrl_shard {
 	isc_mutex_t lock;
-	isc_mem_t  *mctx;
-
-	bool	       log_only;
-	dns_rrl_rate_t responses_per_second;
-	dns_rrl_rate_t referrals_per_second;
-	dns_rrl_rate_t nodata_per_second;
-	dns_rrl_rate_t nxdomains_per_second;
-	dns_rrl_rate_t errors_per_second;
-	dns_rrl_rate_t all_per_second;
-	dns_rrl_rate_t slip;
-	int	       window;
-	double	       qps_scale;
-	int	       max_entries;
-
-	dns_acl_t *exempt;
+	dns_rrl_t  *rrl;
 
 	int num_entries;
 
-	int	      qps_responses;
-	isc_stdtime_t qps_time;
-	double	      qps;
-
 	unsigned int probes;
 	unsigned int searches;
 
@@ -234,11 +226,6 @@ struct dns_rrl {
 #define DNS_RRL_TS_BASES (1 << DNS_RRL_TS_GEN_BITS)
 	isc_stdtime_t ts_bases[DNS_RRL_TS_BASES];
 
-	int	 ipv4_prefixlen;
-	uint32_t ipv4_mask;
-	int	 ipv6_prefixlen;
-	uint32_t ipv6_mask[4];
-
 	isc_stdtime_t	 log_stops_time;
 	dns_rrl_entry_t *last_logged;
 	int		 num_logged;
@@ -248,6 +235,42 @@ struct dns_rrl {
 	dns_rrl_qname_buf_t *qnames[DNS_RRL_QNAMES];
 };
 
+/*
+ * Per-view query rate limit parameters and a pointer to database.
+ */
+struct dns_rrl {
+	isc_mem_t *mctx;
+
+	bool	       log_only;
+	dns_rrl_rate_t responses_per_second;
+	dns_rrl_rate_t referrals_per_second;
+	dns_rrl_rate_t nodata_per_second;
+	dns_rrl_rate_t nxdomains_per_second;
+	dns_rrl_rate_t errors_per_second;
+	dns_rrl_rate_t all_per_second;
+	dns_rrl_rate_t slip;
+	int	       window;
+	double	       qps_scale;
+	int	       max_entries;
+
+	dns_acl_t *exempt;
+
+	/*
+	 * Estimated total responses per second, shared by the shards.
+	 */
+	atomic_uint_fast32_t qps_responses;
+	atomic_uint_fast32_t qps_time;
+	atomic_uint_fast32_t qps;
+
+	int	 ipv4_prefixlen;
+	uint32_t ipv4_mask;
+	int	 ipv6_prefixlen;
+	uint32_t ipv6_mask[4];
+
+	unsigned int	 nshards;
+	dns_rrl_shard_t *shards;
+};
+
 typedef enum {
 	DNS_RRL_RESULT_OK,
 	DNS_RRL_RESULT_DROP,
@@ -265,5 +288,12 @@ dns_rrl_view_destroy(dns_view_t *view);
 
 isc_result_t
 dns_rrl_init(dns_rrl_t **rrlp, dns_view_t *view, int min_entries);
+/*%<
+ * Create the rate limit database for 'view', split into one shard per
+ * loop, with room for at least 'min_entries' entries in total.
+ *
+ * The caller is expected to fill in the limits in '*rrlp' afterwards;
+ * 'max_entries' is also a total for all of the shards.
+ */
 
 ISC_LANG_ENDDECLS
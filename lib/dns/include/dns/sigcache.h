@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/sigcache.h
+ * \brief
+ * Defines dns_sigcache_t, the "verified signature cache" object.
+ *
+ * Notes:
+ *\li	A signature cache remembers which RRSIGs have already been
+ *	successfully verified, so that the validator does not have to
+ *	repeat the public key operation when the same signed RRset shows
+ *	up again in another response.  Entries are keyed by a SHA-256
+ *	digest of the owner name, the type and class, the DNSKEY, the
+ *	RRSIG and the RRset in canonical order, and are only honored
+ *	between the signature's inception and expiration times.
+ *
+ *\li	The cache has a fixed number of slots; a new entry simply
+ *	replaces whatever occupied its slot.
+ *
+ * Reliability:
+ *
+ * Resources:
+ *
+ * Security:
+ *\li	Only successful verifications are remembered, and the digest
+ *	covers everything dns_dnssec_verify() looks at, so a cached
+ *	entry can never make a different signature, key or RRset look
+ *	valid.
+ *
+ * Standards:
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/mem.h>
+#include <isc/stdtime.h>
+
+#include <dns/types.h>
+
+#include <dst/dst.h>
+
+#define DNS_SIGCACHE_DIGESTLEN 32 /* SHA-256 */
+
+ISC_LANG_BEGINDECLS
+
+/***
+ ***	Functions
+ ***/
+
+dns_sigcache_t *
+dns_sigcache_new(isc_mem_t *mctx, unsigned int size);
+/*%
+ * Allocate and initialize a signature cache with room for at least
+ * 'size' entries.
+ *
+ * Requires:
+ * \li	mctx != NULL
+ * \li	size > 0
+ */
+
+void
+dns_sigcache_destroy(dns_sigcache_t **scp);
+/*%
+ * Free the signature cache in 'scp'. '*scp' is set to NULL on return.
+ *
+ * Requires:
+ * \li	'*scp' to be a valid signature cache
+ */
+
+isc_result_t
+dns_sigcache_digest(const dns_name_t *name, dns_rdataset_t *rdataset,
+		    dst_key_t *key, const dns_rdata_t *sigrdata,
+		    isc_mem_t *mctx, unsigned char *digest);
+/*%
+ * Compute the cache key for verifying the RRSIG 'sigrdata' over
+ * 'rdataset' at 'name' with 'key', and store it in 'digest', which
+ * must have room for DNS_SIGCACHE_DIGESTLEN bytes.
+ *
+ * Requires:
+ * \li	name, rdataset, key, sigrdata and digest are not NULL
+ *
+ * Returns:
+ * \li	ISC_R_SUCCESS
+ * \li	Other results if the key or the rdataset could not be rendered.
+ */
+
+isc_result_t
+dns_sigcache_find(dns_sigcache_t *sc, const unsigned char *digest,
+		  isc_stdtime_t now);
+/*%
+ * Returns ISC_R_SUCCESS if the signature cache 'sc' holds a verified
+ * signature with the key 'digest' that is valid at 'now', and
+ * ISC_R_NOTFOUND otherwise.
+ *
+ * Requires:
+ * \li	sc to be a valid signature cache.
+ * \li	digest != NULL
+ */
+
+void
+dns_sigcache_add(dns_sigcache_t *sc, const unsigned char *digest,
+		 isc_stdtime_t inception, isc_stdtime_t expire);
+/*%
+ * Remember that the signature with the key 'digest' was successfully
+ * verified, and that it is valid from 'inception' until 'expire'.
+ *
+ * Requires:
+ * \li	sc to be a valid signature cache.
+ * \li	digest != NULL
+ */
+
+void
+dns_sigcache_flush(dns_sigcache_t *sc);
+/*%
+ * Flush the entire signature cache.
+ *
+ * Requires:
+ * \li	sc to be a valid signature cache
+ */
+
+ISC_LANG_ENDDECLS
@@ -16,6 +16,7 @@
 /*! \file dns/stats.h */
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 #include <isc/histo.h>
 
@@ -74,7 +75,13 @@ enum {
 	dns_resstatscounter_clientquota = 43,
 	dns_resstatscounter_nextitem = 44,
 	dns_resstatscounter_priming = 45,
-	dns_resstatscounter_max = 46,
+	dns_resstatscounter_verifyqueued = 46,
+	dns_resstatscounter_verifybatches = 47,
+	dns_resstatscounter_verifybatched = 48,
+	dns_resstatscounter_verifybatchmax = 49,
+	dns_resstatscounter_sigcachehit = 50,
+	dns_resstatscounter_sigcachemiss = 51,
+	dns_resstatscounter_max = 52,
 
 	/*
 	 * DNSSEC stats.
@@ -102,8 +109,16 @@ enum {
 	dns_zonestatscounter_ixfrreqv6 = 10,
 	dns_zonestatscounter_xfrsuccess = 11,
 	dns_zonestatscounter_xfrfail = 12,
+	dns_zonestatscounter_loadqueued = 13,
+	dns_zonestatscounter_loadactive = 14,
+	dns_zonestatscounter_loadsuccess = 15,
+	dns_zonestatscounter_loadfail = 16,
+	dns_zonestatscounter_loadbytes = 17,
+	dns_zonestatscounter_loadusecs = 18,
+	dns_zonestatscounter_compactbytes = 19,
+	dns_zonestatscounter_compactusecs = 20,
 
-	dns_zonestatscounter_max = 13,
+	dns_zonestatscounter_max = 21,
 
 	/*
 	 * Adb statistics values.
@@ -145,7 +160,8 @@ enum {
 	 */
 	dns_dnstapcounter_success = 0,
 	dns_dnstapcounter_drop = 1,
-	dns_dnstapcounter_max = 2,
+	dns_dnstapcounter_filtered = 2,
+	dns_dnstapcounter_max = 3,
 
 	/*
 	 * Glue cache statistics counters.
@@ -202,6 +218,26 @@ enum {
 	dns_sizecounter_out_max = DNS_SIZEHISTO_MAXOUT + 1,
 };
 
+/*%
+ * Query latency statistics: the time from receiving a query to
+ * completing the send of its response, in microseconds.  They are
+ * kept in histograms broken down by the transport the query arrived
+ * on and by whether answering it needed recursion, and separately by
+ * query type for the most common types.
+ *
+ * Three significant bits give buckets about 12% wide, which is
+ * precise enough for quantiles while keeping the histograms small.
+ */
+#define DNS_LATENCYHISTO_SIGBITS 3
+
+typedef enum {
+	dns_latency_udp = 0,
+	dns_latency_tcp = 1,
+	dns_latency_tls = 2,
+	dns_latency_https = 3,
+	dns_latency_max = 4
+} dns_latencytransport_t;
+
 /*%
  * Attributes for statistics counters of RRset and Rdatatype types.
  *
@@ -255,6 +291,8 @@ typedef void (*dns_rdatatypestats_dumper_t)(dns_rdatastatstype_t, uint64_t,
 typedef void (*dns_dnssecsignstats_dumper_t)(uint32_t, uint64_t, void *);
 typedef void (*dns_opcodestats_dumper_t)(dns_opcode_t, uint64_t, void *);
 typedef void (*dns_rcodestats_dumper_t)(dns_rcode_t, uint64_t, void *);
+typedef void (*dns_latencystats_dumper_t)(dns_rdatatype_t,
+					  const isc_histomulti_t *, void *);
 
 ISC_LANG_BEGINDECLS
 
@@ -316,6 +354,21 @@ dns_rcodestats_create(isc_mem_t *mctx, dns_stats_t **statsp);
  *\li	'statsp' != NULL && '*statsp' == NULL.
  */
 
+void
+dns_latencystats_create(isc_mem_t *mctx, dns_stats_t **statsp);
+/*%<
+ * Create a set of query latency histograms, one per transport and
+ * recursion status, and one per common query type.
+ *
+ * Requires:
+ *\li	'mctx' must be a valid memory context.
+ *
+ *\li	'statsp' != NULL && '*statsp' == NULL.
+ *
+ *\li	The loop manager has been created, so that the number of
+ *	threads is known.
+ */
+
 void
 dns_dnssecsignstats_create(isc_mem_t *mctx, dns_stats_t **statsp);
 /*%<
@@ -408,6 +461,19 @@ dns_rcodestats_increment(dns_stats_t *stats, dns_opcode_t code);
  *\li	'stats' is a valid dns_stats_t created by dns_rcodestats_create().
  */
 
+void
+dns_latencystats_add(dns_stats_t *stats, dns_latencytransport_t transport,
+		     bool recursed, dns_rdatatype_t qtype, uint64_t usecs);
+/*%<
+ * Record a query of type 'qtype' that arrived over 'transport' and
+ * was answered 'usecs' microseconds later, with or without recursion.
+ *
+ * Requires:
+ *\li	'stats' is a valid dns_stats_t created by dns_latencystats_create().
+ *
+ *\li	'transport' < dns_latency_max.
+ */
+
 void
 dns_dnssecsignstats_increment(dns_stats_t *stats, dns_keytag_t id, uint8_t alg,
 			      dnssecsignstats_type_t operation);
@@ -515,4 +581,30 @@ dns_rcodestats_dump(dns_stats_t *stats, dns_rcodestats_dumper_t dump_fn,
  *\li	'stats' is a valid dns_stats_t created by dns_generalstats_create().
  */
 
+const isc_histomulti_t *
+dns_latencystats_get(dns_stats_t *stats, dns_latencytransport_t transport,
+		     bool recursed);
+/*%<
+ * Return the latency histogram for queries that arrived over
+ * 'transport' and were answered with or without recursion.
+ *
+ * Requires:
+ *\li	'stats' is a valid dns_stats_t created by dns_latencystats_create().
+ *
+ *\li	'transport' < dns_latency_max.
+ */
+
+void
+dns_latencystats_dump(dns_stats_t *stats, dns_latencystats_dumper_t dump_fn,
+		      void *arg);
+/*%<
+ * Dump the per query type latency histograms.  For each query type
+ * with a histogram of its own, dump_fn is called with the type, the
+ * histogram and the given argument arg; the histogram shared by all
+ * other query types is dumped last, with type 0.
+ *
+ * Requires:
+ *\li	'stats' is a valid dns_stats_t created by dns_latencystats_create().
+ */
+
 ISC_LANG_ENDDECLS
@@ -82,6 +82,7 @@ typedef ISC_LIST(dns_dnsseckey_t) dns_dnsseckeylist_t;
 typedef uint8_t			   dns_dsdigest_t;
 typedef struct dns_dtdata	   dns_dtdata_t;
 typedef struct dns_dtenv	   dns_dtenv_t;
+typedef struct dns_dtfilter	   dns_dtfilter_t;
 typedef struct dns_dtmsg	   dns_dtmsg_t;
 typedef uint16_t		   dns_dtmsgtype_t;
 typedef struct dns_dumpctx	   dns_dumpctx_t;
@@ -145,10 +146,12 @@ typedef struct dns_remote	dns_remote_t;
 typedef struct dns_request	dns_request_t;
 typedef struct dns_requestmgr	dns_requestmgr_t;
 typedef struct dns_resolver	dns_resolver_t;
+typedef struct dns_respcache	dns_respcache_t;
 typedef struct dns_rpsdb	dns_rpsdb_t;
 typedef struct dns_qpnode	dns_qpnode_t;
 typedef uint8_t			dns_secalg_t;
 typedef uint8_t			dns_secproto_t;
+typedef struct dns_sigcache	dns_sigcache_t;
 typedef struct dns_signature	dns_signature_t;
 typedef struct dns_slabheader	dns_slabheader_t;
 typedef ISC_LIST(dns_slabheader_t) dns_slabheaderlist_t;
@@ -240,6 +243,7 @@ typedef enum {
 	dns_masterformat_none = 0,
 	dns_masterformat_text = 1,
 	dns_masterformat_raw = 2,
+	dns_masterformat_image = 3,
 } dns_masterformat_t;
 
 typedef enum {
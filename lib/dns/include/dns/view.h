@@ -182,6 +182,8 @@ struct dns_view {
 	dns_dlzdblist_t	      dlz_unsearched;
 	uint32_t	      fail_ttl;
 	dns_badcache_t	     *failcache;
+	dns_respcache_t	     *respcache;
+	dns_stats_t	     *latencystats;
 	unsigned int	      udpsize;
 	uint32_t	      maxrrperset;
 	uint32_t	      maxtypepername;
@@ -228,9 +230,10 @@ struct dns_view {
 	unsigned char secret[32]; /* Client secret */
 	unsigned int  v6bias;
 
-	dns_dtenv_t    *dtenv;	 /* Dnstap environment */
-	dns_dtmsgtype_t dttypes; /* Dnstap message types
-				  * to log */
+	dns_dtenv_t    *dtenv;	  /* Dnstap environment */
+	dns_dtmsgtype_t dttypes;  /* Dnstap message types
+				   * to log */
+	dns_dtfilter_t *dtfilter; /* Dnstap message filter */
 
 	/* Registered module instances */
 	void *plugins;
@@ -459,6 +462,28 @@ dns_view_getdynamickeyring(dns_view_t *view, dns_tsigkeyring_t **ringp);
  *   \li  'ringp' != NULL && ringp == NULL.
  */
 
+void
+dns_view_setlatencystats(dns_view_t *view, dns_stats_t *stats);
+/*%<
+ * Set the query latency statistics of the view, replacing any that
+ * were set before.
+ *
+ * Requires:
+ *\li	'view' is a valid, unfrozen view.
+ *\li	'stats' is a valid dns_stats_t created by dns_latencystats_create().
+ */
+
+void
+dns_view_getlatencystats(dns_view_t *view, dns_stats_t **statsp);
+/*%<
+ * Attach '*statsp' to the query latency statistics of the view, if
+ * there are any.
+ *
+ * Requires:
+ *\li	'view' is a valid view.
+ *\li	'statsp' != NULL && '*statsp' == NULL.
+ */
+
 void
 dns_view_setdstport(dns_view_t *view, in_port_t dstport);
 /*%<
@@ -133,13 +133,18 @@ dns_xfrin_getendserial(dns_xfrin_t *xfr);
 
 void
 dns_xfrin_getstats(dns_xfrin_t *xfr, unsigned int *nmsgp, unsigned int *nrecsp,
-		   uint64_t *nbytesp);
+		   uint64_t *nbytesp, uint64_t *ratep, uint64_t *peakp);
 /*%<
  * Get various statistics values of the xfrin object: number of the received
- * messages, number of the received records, number of the received bytes.
+ * messages, number of the received records, number of the received bytes,
+ * the average number of bytes received per second so far, and the largest
+ * amount of memory used at one time by received records that were not yet
+ * loaded into the database.
  *
  * Requires:
  *\li	'xfr' is a valid dns_xfrin_t.
+ *\li	'nmsgp', 'nrecsp' and 'nbytesp' are not NULL; 'ratep' and 'peakp'
+ *	may be NULL.
  *
  */
 
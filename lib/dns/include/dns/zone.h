@@ -490,6 +490,12 @@ dns_zone_asyncload(dns_zone_t *zone, bool newonly, dns_zt_callback_t done,
  * its argument. (Normally, 'arg' is expected to point to the zone table
  * but is left undefined for testing purposes.)
  *
+ * The load is queued in the zone manager, which starts queued loads on
+ * their zones' loops subject to the limit set with
+ * dns_zonemgr_setloadconcurrency(): zones that have never been loaded
+ * first, smallest zone file first, then reloads, quickest previous load
+ * first.
+ *
  * Require:
  *\li	'zone' to be a valid zone.
  *
@@ -1832,6 +1838,38 @@ dns_zonemgr_gettransfersin(dns_zonemgr_t *zmgr);
  *\li	'zmgr' to be a valid zone manager.
  */
 
+void
+dns_zonemgr_setloadconcurrency(dns_zonemgr_t *zmgr, unsigned int value);
+/*%<
+ *	Set the maximum number of zone loads started by dns_zone_asyncload()
+ *	that may be in progress at the same time.  Zero means one per loop.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
+unsigned int
+dns_zonemgr_getloadconcurrency(dns_zonemgr_t *zmgr);
+/*%<
+ *	Return the maximum number of simultaneous zone loads.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
+void
+dns_zonemgr_setstats(dns_zonemgr_t *zmgr, isc_stats_t *stats);
+/*%<
+ *	Set a general zone statistics set 'stats' in which the zone manager
+ *	reports the progress of scheduled zone loads.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ *\li	'stats' is a valid statistics set that supports the
+ *	dns_zonestatscounter_ counters, and no statistics set has been
+ *	set for 'zmgr' yet.
+ */
+
 void
 dns_zonemgr_settransfersperns(dns_zonemgr_t *zmgr, uint32_t value);
 /*%<
@@ -2661,6 +2699,18 @@ dns_zone_getgluecachestats(dns_zone_t *zone);
  *	otherwise NULL.
  */
 
+uint32_t
+dns_zone_getgeneration(dns_zone_t *zone);
+/*%<
+ * Return a counter which changes whenever the zone's database is
+ * replaced or a new version of it is committed, so that data derived
+ * from the zone contents can be tested for staleness.  Zero is returned
+ * if the zone's current database does not report updates.
+ *
+ * Requires:
+ * \li	'zone' to be a valid zone.
+ */
+
 bool
 dns_zone_isloaded(dns_zone_t *zone);
 /*%<
@@ -127,6 +127,13 @@ dns_iptable_merge(dns_iptable_t *tab, dns_iptable_t *source, bool pos) {
 	return (ISC_R_SUCCESS);
 }
 
+void
+dns_iptable_compile(dns_iptable_t *tab) {
+	REQUIRE(DNS_IPTABLE_VALID(tab));
+
+	isc_radix_compile(tab->radix);
+}
+
 static void
 dns__iptable_destroy(dns_iptable_t *dtab) {
 	REQUIRE(DNS_IPTABLE_VALID(dtab));
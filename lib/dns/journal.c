@@ -12,14 +12,20 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include <isc/dir.h>
+#include <isc/errno.h>
 #include <isc/file.h>
+#include <isc/list.h>
 #include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/once.h>
 #include <isc/overflow.h>
 #include <isc/result.h>
 #include <isc/serial.h>
@@ -45,7 +51,7 @@
  *
  *   \li A fixed-size header of type journal_rawheader_t.
  *
- *   \li The index.  This is an unordered array of index entries
+ *   \li The index.  This is an array of index entries
  *     of type journal_rawpos_t giving the locations
  *     of some arbitrary subset of the journal's addressable
  *     transactions.  The index entries are used as hints to
@@ -55,6 +61,18 @@
  *     journal files, but does not change during the lifetime
  *     of a file.  The size can be zero.
  *
+ *     In format version 2 the index is unordered.  In format
+ *     version 3 the used entries are kept at the front of the
+ *     index in the order of the transactions they point to, so
+ *     that a transaction can be found with a binary search.  Every
+ *     committed transaction gets an entry as long as there is room
+ *     for it.  Entries for transactions that are no longer
+ *     addressable may remain at the front, and are only removed
+ *     when the index is full; if that does not make room, every
+ *     other entry is dropped as in version 2.  The index of a
+ *     version 3 journal is sized
+ *     for the number of transactions kept when it is compacted.
+ *
  *   \li The journal data.  This  consists of one or more transactions.
  *     Each transaction begins with a transaction header of type
  *     journal_rawxhdr_t.  The transaction header is followed by a
@@ -74,6 +92,12 @@
  *     appended to the journal but never committed by updating
  *     the "end" position in the header.  The latter will
  *     be overwritten when new transactions are added.
+ *
+ *     A version 3 journal can be compacted in place by moving
+ *     the "begin" position forward (dns_journal_truncate()).
+ *     The transactions before it are no longer addressable,
+ *     and their space may later be punched out of the file
+ *     (dns_journal_punch()), leaving a hole that reads as zeros.
  */
 
 /**************************************************************************/
@@ -107,6 +131,26 @@
 
 #define JOURNAL_SERIALSET 0x01U
 
+/*%
+ * Number of index entries in a newly created journal, and the most a
+ * compacted version 3 journal gets.
+ */
+#define JOURNAL_INDEX_SIZE     56
+#define JOURNAL_INDEX_SIZE_MAX (1U << 20)
+
+/*%
+ * dns_journal_truncate() leaves a journal to be rewritten when its
+ * file offsets get this large, or when it keeps this little data.
+ */
+#define JOURNAL_TRUNCATE_MAX (DNS_JOURNAL_SIZE_MAX / 2)
+#define JOURNAL_REWRITE_SIZE (1024 * 1024)
+
+static isc_result_t
+index_load(dns_journal_t *);
+
+static isc_result_t
+index_count(dns_journal_t *);
+
 static isc_result_t
 index_to_disk(dns_journal_t *);
 
@@ -203,6 +247,12 @@ typedef enum {
 	XHDR_VERSION2 = 2,
 } xhdr_version_t;
 
+typedef enum {
+	JOURNAL_VERSION1 = 1,
+	JOURNAL_VERSION2 = 2,
+	JOURNAL_VERSION3 = 3,
+} journal_version_t;
+
 /*%
  * The on-disk representation of the journal header.
  * All numbers are stored in big-endian order.
@@ -291,11 +341,22 @@ typedef struct {
 	uint32_t size;
 } journal_rrhdr_t;
 
+/*%
+ * A journal open for reading, as seen by dns_journal_punch().
+ */
+typedef struct journal_reader journal_reader_t;
+struct journal_reader {
+	const char *filename; /*%< Journal file name */
+	uint32_t begin;	      /*%< Offset of the first transaction it
+			       *   may read */
+	ISC_LINK(journal_reader_t) link;
+};
+
 /*%
  * Initial contents to store in the header of a newly created
  * journal file.
  *
- * The header starts with the magic string ";BIND LOG V9.2\n"
+ * The header starts with the magic string ";BIND LOG V9.3\n"
  * to identify the file as a BIND 9 journal file.  An ASCII
  * identification string is used rather than a binary magic
  * number to be consistent with BIND 8 (BIND 8 journal files
@@ -305,9 +366,12 @@ typedef struct {
 static journal_header_t journal_header_ver1 = {
 	";BIND LOG V9\n", { 0, 0 }, { 0, 0 }, 0, 0, 0
 };
-static journal_header_t initial_journal_header = {
+static journal_header_t journal_header_ver2 = {
 	";BIND LOG V9.2\n", { 0, 0 }, { 0, 0 }, 0, 0, 0
 };
+static journal_header_t initial_journal_header = {
+	";BIND LOG V9.3\n", { 0, 0 }, { 0, 0 }, 0, 0, 0
+};
 
 #define JOURNAL_EMPTY(h) ((h)->begin.offset == (h)->end.offset)
 
@@ -328,14 +392,24 @@ struct dns_journal {
 				      *   mode is allowed */
 	bool recovered;		     /*%< A recoverable error was found
 				      *   while reading the journal */
+	bool sorted;		     /*%< The index is sorted (version 3) */
 	char *filename;		     /*%< Journal file name */
 	FILE *fp;		     /*%< File handle */
+	unsigned char *map;	     /*%< File image, when reading */
+	size_t maplen;		     /*%< Size of the file image */
 	off_t offset;		     /*%< Current file offset */
 	journal_xhdr_t curxhdr;	     /*%< Current transaction header */
 	journal_header_t header;     /*%< In-core journal header */
 	unsigned char *rawindex;     /*%< In-core buffer for journal index
 				      * in on-disk format */
 	journal_pos_t *index;	     /*%< In-core journal index */
+	unsigned int index_used;     /*%< Used entries of a sorted index */
+	unsigned int index_lo;	     /*%< Range of index entries not */
+	unsigned int index_hi;	     /*%< yet written to disk */
+	journal_pos_t index_new;     /*%< Sorted index entry not yet
+				      *   written to disk, when the index
+				      *   is not in core */
+	journal_reader_t reader;     /*%< On the list of readers */
 
 	/*% Current transaction state (when writing). */
 	struct {
@@ -367,6 +441,20 @@ struct dns_journal {
 #define DNS_JOURNAL_MAGIC    ISC_MAGIC('J', 'O', 'U', 'R')
 #define DNS_JOURNAL_VALID(t) ISC_MAGIC_VALID(t, DNS_JOURNAL_MAGIC)
 
+/*%
+ * The journals open for reading.  dns_journal_punch() does not release
+ * the space of a transaction that one of them may still read.
+ */
+static isc_once_t readers_once = ISC_ONCE_INIT;
+static isc_mutex_t readers_lock;
+static ISC_LIST(journal_reader_t) readers;
+
+static void
+readers_initialize(void) {
+	isc_mutex_init(&readers_lock);
+	ISC_LIST_INIT(readers);
+}
+
 static void
 journal_pos_decode(journal_rawpos_t *raw, journal_pos_t *cooked) {
 	cooked->serial = decode_uint32(raw->serial);
@@ -411,11 +499,19 @@ journal_header_encode(journal_header_t *cooked, journal_rawheader_t *raw) {
 
 /*
  * Journal file I/O subroutines, with error checking and reporting.
+ *
+ * A journal that is opened for reading is mapped into memory when
+ * possible, and read from the mapping rather than through stdio.
  */
 static isc_result_t
 journal_seek(dns_journal_t *j, uint32_t offset) {
 	isc_result_t result;
 
+	if (j->map != NULL) {
+		j->offset = offset;
+		return (ISC_R_SUCCESS);
+	}
+
 	result = isc_stdio_seek(j->fp, (off_t)offset, SEEK_SET);
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(JOURNAL_COMMON_LOGARGS, ISC_LOG_ERROR,
@@ -431,6 +527,17 @@ static isc_result_t
 journal_read(dns_journal_t *j, void *mem, size_t nbytes) {
 	isc_result_t result;
 
+	if (j->map != NULL) {
+		if (j->offset < 0 || (size_t)j->offset > j->maplen ||
+		    nbytes > j->maplen - (size_t)j->offset)
+		{
+			return (ISC_R_NOMORE);
+		}
+		memmove(mem, j->map + j->offset, nbytes);
+		j->offset += (off_t)nbytes;
+		return (ISC_R_SUCCESS);
+	}
+
 	result = isc_stdio_read(mem, 1, nbytes, j->fp, NULL);
 	if (result != ISC_R_SUCCESS) {
 		if (result == ISC_R_EOF) {
@@ -561,12 +668,12 @@ journal_read_rrhdr(dns_journal_t *j, journal_rrhdr_t *rrhdr) {
 }
 
 static isc_result_t
-journal_file_create(isc_mem_t *mctx, bool downgrade, const char *filename) {
+journal_file_create(isc_mem_t *mctx, journal_version_t version,
+		    unsigned int index_size, const char *filename) {
 	FILE *fp = NULL;
 	isc_result_t result;
 	journal_header_t header;
 	journal_rawheader_t rawheader;
-	int index_size = 56; /* XXX configurable */
 	int size;
 	void *mem = NULL; /* Memory for temporary index image. */
 
@@ -580,10 +687,16 @@ journal_file_create(isc_mem_t *mctx, bool downgrade, const char *filename) {
 		return (ISC_R_UNEXPECTED);
 	}
 
-	if (downgrade) {
+	switch (version) {
+	case JOURNAL_VERSION1:
 		header = journal_header_ver1;
-	} else {
+		break;
+	case JOURNAL_VERSION2:
+		header = journal_header_ver2;
+		break;
+	default:
 		header = initial_journal_header;
+		break;
 	}
 	header.index_size = index_size;
 	journal_header_encode(&header, &rawheader);
@@ -618,9 +731,38 @@ journal_file_create(isc_mem_t *mctx, bool downgrade, const char *filename) {
 	return (ISC_R_SUCCESS);
 }
 
+/*
+ * Map a journal that is opened for reading into memory.  If that is
+ * not possible, it is read through stdio instead.
+ */
+static void
+journal_map(dns_journal_t *j) {
+	void *map = NULL;
+	off_t size;
+
+	if (isc_file_getsizefd(fileno(j->fp), &size) != ISC_R_SUCCESS ||
+	    size <= 0 || (uintmax_t)size > SIZE_MAX)
+	{
+		return;
+	}
+
+	map = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fileno(j->fp),
+		   0);
+	if (map == MAP_FAILED) {
+		isc_log_write(JOURNAL_DEBUG_LOGARGS(3), "%s: mmap: %s",
+			      j->filename,
+			      isc_result_totext(isc_errno_toresult(errno)));
+		return;
+	}
+
+	j->map = map;
+	j->maplen = (size_t)size;
+}
+
 static isc_result_t
 journal_open(isc_mem_t *mctx, const char *filename, bool writable, bool create,
-	     bool downgrade, dns_journal_t **journalp) {
+	     journal_version_t version, unsigned int index_size,
+	     dns_journal_t **journalp) {
 	FILE *fp = NULL;
 	isc_result_t result;
 	journal_rawheader_t rawheader;
@@ -631,7 +773,8 @@ journal_open(isc_mem_t *mctx, const char *filename, bool writable, bool create,
 	j = isc_mem_get(mctx, sizeof(*j));
 	*j = (dns_journal_t){ .state = JOURNAL_STATE_INVALID,
 			      .filename = isc_mem_strdup(mctx, filename),
-			      .xhdr_version = XHDR_VERSION2 };
+			      .xhdr_version = XHDR_VERSION2,
+			      .reader.link = ISC_LINK_INITIALIZER };
 	isc_mem_attach(mctx, &j->mctx);
 
 	result = isc_stdio_open(j->filename, writable ? "rb+" : "rb", &fp);
@@ -641,7 +784,8 @@ journal_open(isc_mem_t *mctx, const char *filename, bool writable, bool create,
 				      "journal file %s does not exist, "
 				      "creating it",
 				      j->filename);
-			CHECK(journal_file_create(mctx, downgrade, filename));
+			CHECK(journal_file_create(mctx, version, index_size,
+						  filename));
 			/*
 			 * Retry.
 			 */
@@ -658,6 +802,9 @@ journal_open(isc_mem_t *mctx, const char *filename, bool writable, bool create,
 	}
 
 	j->fp = fp;
+	if (!writable) {
+		journal_map(j);
+	}
 
 	/*
 	 * Set magic early so that seek/read can succeed.
@@ -681,14 +828,23 @@ journal_open(isc_mem_t *mctx, const char *filename, bool writable, bool create,
 		 * corrupt transaction.
 		 */
 		j->header_ver1 = true;
-	} else if (memcmp(rawheader.h.format, initial_journal_header.format,
-			  sizeof(initial_journal_header.format)) == 0)
+	} else if (memcmp(rawheader.h.format, journal_header_ver2.format,
+			  sizeof(journal_header_ver2.format)) == 0)
 	{
 		/*
 		 * File header says this is format version 2; all
 		 * transactions have to match.
 		 */
 		j->header_ver1 = false;
+	} else if (memcmp(rawheader.h.format, initial_journal_header.format,
+			  sizeof(initial_journal_header.format)) == 0)
+	{
+		/*
+		 * Format version 3 has the same transactions as version 2,
+		 * and a sorted index.
+		 */
+		j->header_ver1 = false;
+		j->sorted = true;
 	} else {
 		isc_log_write(JOURNAL_COMMON_LOGARGS, ISC_LOG_ERROR,
 			      "%s: journal format not recognized", j->filename);
@@ -696,32 +852,33 @@ journal_open(isc_mem_t *mctx, const char *filename, bool writable, bool create,
 	}
 	journal_header_decode(&rawheader, &j->header);
 
+	/*
+	 * If transactions were committed between mapping the file and
+	 * reading its header, the image is too short; read through stdio.
+	 */
+	if (j->map != NULL && (size_t)j->header.end.offset > j->maplen) {
+		(void)munmap(j->map, j->maplen);
+		j->map = NULL;
+		j->maplen = 0;
+	}
+
 	/*
 	 * If there is an index, read the raw index into a dynamically
 	 * allocated buffer and then convert it into a cooked index.
+	 *
+	 * A sorted index is searched directly in the file image or the
+	 * file instead, so that neither opening a journal for an IXFR nor
+	 * adding a transaction to it has to read the whole index of a
+	 * large journal.  Writers only need to know where its used
+	 * entries end.
 	 */
-	if (j->header.index_size != 0) {
-		unsigned int i;
-		unsigned int rawbytes;
-		unsigned char *p;
-
-		rawbytes = ISC_CHECKED_MUL(j->header.index_size,
-					   sizeof(journal_rawpos_t));
-		j->rawindex = isc_mem_get(mctx, rawbytes);
-
-		CHECK(journal_read(j, j->rawindex, rawbytes));
-
-		j->index = isc_mem_cget(mctx, j->header.index_size,
-					sizeof(journal_pos_t));
-
-		p = j->rawindex;
-		for (i = 0; i < j->header.index_size; i++) {
-			j->index[i].serial = decode_uint32(p);
-			p += 4;
-			j->index[i].offset = decode_uint32(p);
-			p += 4;
+	j->index_lo = j->header.index_size;
+	if (j->sorted) {
+		if (writable) {
+			CHECK(index_count(j));
 		}
-		INSIST(p == j->rawindex + rawbytes);
+	} else if (j->header.index_size != 0) {
+		CHECK(index_load(j));
 	}
 	j->offset = -1; /* Invalid, must seek explicitly. */
 
@@ -756,6 +913,9 @@ failure:
 			     sizeof(journal_pos_t));
 	}
 	isc_mem_free(j->mctx, j->filename);
+	if (j->map != NULL) {
+		(void)munmap(j->map, j->maplen);
+	}
 	if (j->fp != NULL) {
 		(void)isc_stdio_close(j->fp);
 	}
@@ -770,12 +930,27 @@ dns_journal_open(isc_mem_t *mctx, const char *filename, unsigned int mode,
 	size_t namelen;
 	char backup[1024];
 	bool writable, create;
+	journal_reader_t opening = { .filename = filename,
+				     .begin = 0,
+				     .link = ISC_LINK_INITIALIZER };
 
 	create = ((mode & DNS_JOURNAL_CREATE) != 0);
 	writable = ((mode & (DNS_JOURNAL_WRITE | DNS_JOURNAL_CREATE)) != 0);
 
-	result = journal_open(mctx, filename, writable, create, false,
-			      journalp);
+	/*
+	 * A reader is listed before dns_journal_punch() can look at the
+	 * journal header again, so that what it is going to read stays.
+	 * Until its header has been read, it may read anything.
+	 */
+	if (!writable) {
+		isc_once_do(&readers_once, readers_initialize);
+		LOCK(&readers_lock);
+		ISC_LIST_APPEND(readers, &opening, link);
+		UNLOCK(&readers_lock);
+	}
+
+	result = journal_open(mctx, filename, writable, create,
+			      JOURNAL_VERSION3, JOURNAL_INDEX_SIZE, journalp);
 	if (result == ISC_R_NOTFOUND) {
 		namelen = strlen(filename);
 		if (namelen > 4U && strcmp(filename + namelen - 4, ".jnl") == 0)
@@ -786,11 +961,27 @@ dns_journal_open(isc_mem_t *mctx, const char *filename, unsigned int mode,
 		result = snprintf(backup, sizeof(backup), "%.*s.jbk",
 				  (int)namelen, filename);
 		if (result >= sizeof(backup)) {
-			return (ISC_R_NOSPACE);
+			result = ISC_R_NOSPACE;
+			goto done;
 		}
-		result = journal_open(mctx, backup, writable, writable, false,
+		result = journal_open(mctx, backup, writable, writable,
+				      JOURNAL_VERSION3, JOURNAL_INDEX_SIZE,
 				      journalp);
 	}
+
+done:
+	if (!writable) {
+		LOCK(&readers_lock);
+		ISC_LIST_UNLINK(readers, &opening, link);
+		if (result == ISC_R_SUCCESS) {
+			dns_journal_t *j = *journalp;
+
+			j->reader.filename = j->filename;
+			j->reader.begin = (uint32_t)j->header.begin.offset;
+			ISC_LIST_APPEND(readers, &j->reader, link);
+		}
+		UNLOCK(&readers_lock);
+	}
 	return (result);
 }
 
@@ -1005,6 +1196,169 @@ failure:
 	return (result);
 }
 
+/*
+ * Get entry 'i' of the index, from the in-core index or, for a sorted
+ * index, which is not read in as a whole, from the file image or the
+ * file itself.
+ */
+static isc_result_t
+index_get(dns_journal_t *j, unsigned int i, journal_pos_t *pos) {
+	isc_result_t result;
+	journal_rawpos_t raw;
+
+	INSIST(i < j->header.index_size);
+
+	if (j->index != NULL) {
+		*pos = j->index[i];
+		return (ISC_R_SUCCESS);
+	}
+
+	INSIST(j->sorted);
+	if (j->map != NULL) {
+		memmove(&raw,
+			j->map + sizeof(journal_rawheader_t) +
+				(size_t)i * sizeof(journal_rawpos_t),
+			sizeof(raw));
+	} else {
+		result = journal_seek(j, sizeof(journal_rawheader_t) +
+						 i * sizeof(journal_rawpos_t));
+		if (result == ISC_R_SUCCESS) {
+			result = journal_read(j, &raw, sizeof(raw));
+		}
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+	journal_pos_decode(&raw, pos);
+	return (ISC_R_SUCCESS);
+}
+
+static bool
+index_present(dns_journal_t *j) {
+	return (j->index != NULL || (j->sorted && j->header.index_size != 0));
+}
+
+/*
+ * Read the whole index into memory.
+ */
+static isc_result_t
+index_load(dns_journal_t *j) {
+	isc_result_t result;
+	unsigned int i;
+	unsigned int rawbytes;
+	unsigned char *p;
+
+	if (j->index != NULL || j->header.index_size == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	rawbytes = ISC_CHECKED_MUL(j->header.index_size,
+				   sizeof(journal_rawpos_t));
+	j->rawindex = isc_mem_get(j->mctx, rawbytes);
+
+	result = journal_seek(j, sizeof(journal_rawheader_t));
+	if (result == ISC_R_SUCCESS) {
+		result = journal_read(j, j->rawindex, rawbytes);
+	}
+	if (result != ISC_R_SUCCESS) {
+		isc_mem_put(j->mctx, j->rawindex, rawbytes);
+		return (result);
+	}
+
+	j->index = isc_mem_cget(j->mctx, j->header.index_size,
+				sizeof(journal_pos_t));
+
+	p = j->rawindex;
+	for (i = 0; i < j->header.index_size; i++) {
+		j->index[i].serial = decode_uint32(p);
+		p += 4;
+		j->index[i].offset = decode_uint32(p);
+		p += 4;
+	}
+	INSIST(p == j->rawindex + rawbytes);
+
+	/* A pending new entry was only stored in 'index_new' */
+	if (j->index_lo < j->index_hi) {
+		INSIST(j->index_hi == j->index_lo + 1);
+		j->index[j->index_lo] = j->index_new;
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Mark index entries 'lo' to 'hi' as changed, to be written out by
+ * index_to_disk().
+ */
+static void
+index_touch(dns_journal_t *j, unsigned int lo, unsigned int hi) {
+	j->index_lo = ISC_MIN(j->index_lo, lo);
+	j->index_hi = ISC_MAX(j->index_hi, hi);
+}
+
+/*
+ * Binary search of a sorted index: the entries for transactions that
+ * are no longer addressable come first, then the addressable ones in
+ * increasing serial number order, then the unused entries.  Entries
+ * that cannot be read are treated as unused, and entries at or after
+ * 'limit' are not used.
+ */
+static void
+index_search(dns_journal_t *j, uint32_t serial, uint32_t limit,
+	     journal_pos_t *best_guess) {
+	unsigned int lo = 0, hi = j->header.index_size;
+	journal_pos_t pos;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (index_get(j, mid, &pos) == ISC_R_SUCCESS &&
+		    POS_VALID(pos) &&
+		    (pos.offset < j->header.begin.offset ||
+		     (DNS_SERIAL_GE(serial, pos.serial) && pos.offset < limit)))
+		{
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == 0 || index_get(j, lo - 1, &pos) != ISC_R_SUCCESS) {
+		return;
+	}
+
+	if (pos.offset >= j->header.begin.offset && pos.offset < limit &&
+	    DNS_SERIAL_GT(pos.serial, best_guess->serial))
+	{
+		*best_guess = pos;
+	}
+}
+
+/*
+ * Count the used entries at the front of a sorted index.
+ */
+static isc_result_t
+index_count(dns_journal_t *j) {
+	isc_result_t result;
+	unsigned int lo = 0, hi = j->header.index_size;
+	journal_pos_t pos;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		result = index_get(j, mid, &pos);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		if (POS_VALID(pos)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	j->index_used = lo;
+	return (ISC_R_SUCCESS);
+}
+
 /*
  * If the index of the journal 'j' contains an entry "better"
  * than '*best_guess', replace '*best_guess' with it.
@@ -1015,7 +1369,11 @@ failure:
 static void
 index_find(dns_journal_t *j, uint32_t serial, journal_pos_t *best_guess) {
 	unsigned int i;
-	if (j->index == NULL) {
+	if (!index_present(j)) {
+		return;
+	}
+	if (j->sorted) {
+		index_search(j, serial, j->header.end.offset, best_guess);
 		return;
 	}
 	for (i = 0; i < j->header.index_size; i++) {
@@ -1036,21 +1394,66 @@ index_find(dns_journal_t *j, uint32_t serial, journal_pos_t *best_guess) {
  * of recent serial numbers than of old ones.  This is deliberate -
  * most index searches are for outgoing IXFR, and IXFR tends to request
  * recent versions more often than old ones.
+ *
+ * A sorted index is first rid of the entries for transactions that
+ * are no longer addressable; it is only read in when that has to be
+ * done.  Until then, the new entry is kept in 'index_new'.
  */
-static void
+static isc_result_t
 index_add(dns_journal_t *j, journal_pos_t *pos) {
+	isc_result_t result;
 	unsigned int i;
 
+	if (j->sorted && j->index == NULL) {
+		if (j->header.index_size == 0) {
+			return (ISC_R_SUCCESS);
+		}
+		if (j->index_used < j->header.index_size &&
+		    j->index_lo == j->header.index_size)
+		{
+			j->index_new = *pos;
+			index_touch(j, j->index_used, j->index_used + 1);
+			j->index_used++;
+			return (ISC_R_SUCCESS);
+		}
+		result = index_load(j);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+
 	if (j->index == NULL) {
-		return;
+		return (ISC_R_SUCCESS);
 	}
 
 	/*
-	 * Search for a vacant position.
+	 * Search for a vacant position.  In a sorted index, that is
+	 * the one after the last used entry.
 	 */
-	for (i = 0; i < j->header.index_size; i++) {
-		if (!POS_VALID(j->index[i])) {
-			break;
+	if (j->sorted) {
+		i = j->index_used;
+		if (i == j->header.index_size) {
+			unsigned int k = 0;
+
+			for (i = 0; i < j->header.index_size; i++) {
+				if (j->index[i].offset >=
+				    j->header.begin.offset)
+				{
+					j->index[k++] = j->index[i];
+				}
+			}
+			i = k;
+			while (k < j->header.index_size) {
+				POS_INVALIDATE(j->index[k]);
+				k++;
+			}
+			index_touch(j, 0, j->header.index_size);
+		}
+	} else {
+		for (i = 0; i < j->header.index_size; i++) {
+			if (!POS_VALID(j->index[i])) {
+				break;
+			}
 		}
 	}
 	if (i == j->header.index_size) {
@@ -1066,6 +1469,7 @@ index_add(dns_journal_t *j, journal_pos_t *pos) {
 			POS_INVALIDATE(j->index[k]);
 			k++;
 		}
+		index_touch(j, 0, j->header.index_size);
 	}
 	INSIST(i < j->header.index_size);
 	INSIST(!POS_VALID(j->index[i]));
@@ -1074,25 +1478,57 @@ index_add(dns_journal_t *j, journal_pos_t *pos) {
 	 * Store the new index entry.
 	 */
 	j->index[i] = *pos;
+	index_touch(j, i, i + 1);
+	if (j->sorted) {
+		j->index_used = i + 1;
+	}
+	return (ISC_R_SUCCESS);
 }
 
 /*
  * Invalidate any existing index entries that could become
  * ambiguous when a new transaction with number 'serial' is added.
+ *
+ * In a sorted index, those are the entries for transactions before
+ * the beginning of the journal, at the front of the index.  They are
+ * skipped by index_search(), and are only removed by index_add() when
+ * the index is full.
  */
 static void
 index_invalidate(dns_journal_t *j, uint32_t serial) {
 	unsigned int i;
-	if (j->index == NULL) {
+	if (j->index == NULL || j->sorted) {
 		return;
 	}
 	for (i = 0; i < j->header.index_size; i++) {
 		if (!DNS_SERIAL_GT(serial, j->index[i].serial)) {
 			POS_INVALIDATE(j->index[i]);
+			index_touch(j, i, i + 1);
 		}
 	}
 }
 
+/*
+ * A journal that is being read may be written to at the same time,
+ * so check that an index entry read from disk does point to the
+ * beginning of a transaction.
+ */
+static bool
+index_check(dns_journal_t *j, journal_pos_t *pos) {
+	journal_rawxhdr_t raw;
+
+	if (j->header_ver1) {
+		return (true);
+	}
+	if (journal_seek(j, pos->offset) != ISC_R_SUCCESS ||
+	    journal_read(j, &raw, sizeof(raw)) != ISC_R_SUCCESS)
+	{
+		return (false);
+	}
+	return (decode_uint32(raw.serial0) == pos->serial &&
+		isc_serial_gt(decode_uint32(raw.serial1), pos->serial));
+}
+
 /*
  * Try to find a transaction with initial serial number 'serial'
  * in the journal 'j'.
@@ -1132,6 +1568,12 @@ journal_find(dns_journal_t *j, uint32_t serial, journal_pos_t *pos) {
 
 	current_pos = j->header.begin;
 	index_find(j, serial, &current_pos);
+	if (j->state == JOURNAL_STATE_READ &&
+	    current_pos.offset != j->header.begin.offset &&
+	    !index_check(j, &current_pos))
+	{
+		current_pos = j->header.begin;
+	}
 
 	while (current_pos.serial != serial) {
 		if (DNS_SERIAL_GT(current_pos.serial, serial)) {
@@ -1396,7 +1838,7 @@ dns_journal_commit(dns_journal_t *j) {
 	/*
 	 * Update the index.
 	 */
-	index_add(j, &j->x.pos[0]);
+	CHECK(index_add(j, &j->x.pos[0]));
 
 	/*
 	 * Convert the index into on-disk format and write
@@ -1443,6 +1885,12 @@ dns_journal_destroy(dns_journal_t **journalp) {
 	j = *journalp;
 	*journalp = NULL;
 
+	if (ISC_LINK_LINKED(&j->reader, link)) {
+		LOCK(&readers_lock);
+		ISC_LIST_UNLINK(readers, &j->reader, link);
+		UNLOCK(&readers_lock);
+	}
+
 	j->it.result = ISC_R_FAILURE;
 	dns_name_invalidate(&j->it.name);
 	if (j->rawindex != NULL) {
@@ -1462,6 +1910,9 @@ dns_journal_destroy(dns_journal_t **journalp) {
 	if (j->filename != NULL) {
 		isc_mem_free(j->mctx, j->filename);
 	}
+	if (j->map != NULL) {
+		(void)munmap(j->map, j->maplen);
+	}
 	if (j->fp != NULL) {
 		(void)isc_stdio_close(j->fp);
 	}
@@ -1657,11 +2108,15 @@ dns_journal_print(isc_mem_t *mctx, uint32_t flags, const char *filename,
 		fprintf(file, "End serial = %u\n", j->header.end.serial);
 		fprintf(file, "Index (size = %u):\n", j->header.index_size);
 		for (uint32_t i = 0; i < j->header.index_size; i++) {
-			if (j->index[i].offset == 0) {
+			journal_pos_t pos;
+
+			if (index_get(j, i, &pos) != ISC_R_SUCCESS ||
+			    pos.offset == 0)
+			{
 				fputc('\n', file);
 				break;
 			}
-			fprintf(file, "%lld", (long long)j->index[i].offset);
+			fprintf(file, "%lld", (long long)pos.offset);
 			fputc((i + 1) % 8 == 0 ? '\n' : ' ', file);
 		}
 	}
@@ -1713,20 +2168,34 @@ dns_journal_print(isc_mem_t *mctx, uint32_t flags, const char *filename,
 		}
 
 		if (print) {
+			journal_pos_t pos;
+
 			fprintf(file,
 				"Transaction: version %d offset %lld size %u "
 				"rrcount %u start %u end %u\n",
 				j->xhdr_version, (long long)j->it.cpos.offset,
 				j->curxhdr.size, j->curxhdr.count,
 				j->curxhdr.serial0, j->curxhdr.serial1);
-			if (j->it.cpos.offset > j->index[i].offset) {
-				fprintf(file,
-					"ERROR: Offset mismatch, "
-					"expected %lld\n",
-					(long long)j->index[i].offset);
-			} else if (j->it.cpos.offset == j->index[i].offset) {
+			/* Skip the entries for truncated transactions */
+			while (j->sorted && i < j->header.index_size &&
+			       index_get(j, i, &pos) == ISC_R_SUCCESS &&
+			       POS_VALID(pos) &&
+			       pos.offset < j->header.begin.offset)
+			{
 				i++;
 			}
+			if (i < j->header.index_size &&
+			    index_get(j, i, &pos) == ISC_R_SUCCESS)
+			{
+				if (j->it.cpos.offset > pos.offset) {
+					fprintf(file,
+						"ERROR: Offset mismatch, "
+						"expected %lld\n",
+						(long long)pos.offset);
+				} else if (j->it.cpos.offset == pos.offset) {
+					i++;
+				}
+			}
 		}
 		CHECK(dns_difftuple_create(
 			diff.mctx, n_soa == 1 ? DNS_DIFFOP_DEL : DNS_DIFFOP_ADD,
@@ -2459,6 +2928,96 @@ check_delta(unsigned char *buf, size_t size) {
 	return (true);
 }
 
+/*
+ * Adjust the target size of a compacted journal for very small sizes,
+ * so that it leaves room for more than the header and index of 'j'.
+ */
+static uint32_t
+journal_target_size(dns_journal_t *j, uint32_t target_size) {
+	unsigned int indexend;
+
+	indexend = sizeof(journal_rawheader_t) +
+		   ISC_CHECKED_MUL(j->header.index_size,
+				   sizeof(journal_rawpos_t));
+	if (target_size < DNS_JOURNAL_SIZE_MIN) {
+		target_size = DNS_JOURNAL_SIZE_MIN;
+	}
+	if (target_size < indexend * 2) {
+		target_size = target_size / 2 + indexend;
+	}
+	return (target_size);
+}
+
+/*
+ * Find the transaction that the journal 'j' is to begin with when
+ * it is compacted: the one with serial 'serial', or a later one if
+ * that leaves at least 'keep' bytes of transactions.
+ */
+static isc_result_t
+journal_trimpoint(dns_journal_t *j, uint32_t serial, uint32_t keep,
+		  journal_pos_t *posp) {
+	isc_result_t result;
+	unsigned int i;
+	journal_pos_t best_guess;
+	journal_pos_t current_pos;
+
+	/*
+	 * Find if we can create enough free space.
+	 */
+	best_guess = j->header.begin;
+	if (j->sorted) {
+		if ((uint32_t)j->header.end.offset >= keep) {
+			index_search(j, serial,
+				     (uint32_t)j->header.end.offset - keep + 1,
+				     &best_guess);
+		}
+	} else {
+		for (i = 0; index_present(j) && i < j->header.index_size; i++)
+		{
+			journal_pos_t pos;
+
+			if (index_get(j, i, &pos) == ISC_R_SUCCESS &&
+			    POS_VALID(pos) &&
+			    DNS_SERIAL_GE(serial, pos.serial) &&
+			    ((uint32_t)(j->header.end.offset - pos.offset) >=
+			     keep) &&
+			    pos.offset > best_guess.offset &&
+			    pos.offset < j->header.end.offset)
+			{
+				best_guess = pos;
+			}
+		}
+	}
+
+	current_pos = best_guess;
+	while (current_pos.serial != serial) {
+		CHECK(journal_next(j, &current_pos));
+		if (current_pos.serial == j->header.end.serial) {
+			break;
+		}
+
+		if (DNS_SERIAL_GE(serial, current_pos.serial) &&
+		    ((uint32_t)(j->header.end.offset - current_pos.offset) >=
+		     keep) &&
+		    current_pos.offset > best_guess.offset)
+		{
+			best_guess = current_pos;
+		} else {
+			break;
+		}
+	}
+
+	INSIST(best_guess.serial != j->header.end.serial);
+	if (best_guess.serial != serial) {
+		CHECK(journal_next(j, &best_guess));
+	}
+	*posp = best_guess;
+	result = ISC_R_SUCCESS;
+
+failure:
+	return (result);
+}
+
 isc_result_t
 dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		    uint32_t flags, uint32_t target_size) {
@@ -2478,7 +3037,9 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 	char backup[PATH_MAX];
 	bool is_backup = false;
 	bool rewrite = false;
-	bool downgrade = false;
+	journal_version_t version = JOURNAL_VERSION3;
+	unsigned int index_size = JOURNAL_INDEX_SIZE;
+	unsigned int max_index_size = JOURNAL_INDEX_SIZE_MAX;
 
 	REQUIRE(filename != NULL);
 
@@ -2495,10 +3056,12 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 			  filename);
 	RUNTIME_CHECK(result < sizeof(backup));
 
-	result = journal_open(mctx, filename, false, false, false, &j1);
+	result = journal_open(mctx, filename, false, false, version,
+			      index_size, &j1);
 	if (result == ISC_R_NOTFOUND) {
 		is_backup = true;
-		result = journal_open(mctx, backup, false, false, false, &j1);
+		result = journal_open(mctx, backup, false, false, version,
+				      index_size, &j1);
 	}
 	if (result != ISC_R_SUCCESS) {
 		return (result);
@@ -2515,7 +3078,9 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 	 */
 	if ((flags & DNS_JOURNAL_COMPACTALL) != 0) {
 		if ((flags & DNS_JOURNAL_VERSION1) != 0) {
-			downgrade = true;
+			version = JOURNAL_VERSION1;
+		} else if ((flags & DNS_JOURNAL_VERSION2) != 0) {
+			version = JOURNAL_VERSION2;
 		}
 		rewrite = true;
 		serial = dns_journal_first_serial(j1);
@@ -2531,18 +3096,23 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		return (ISC_R_RANGE);
 	}
 
+	/*
+	 * Do not let the index take up more than an eighth of the
+	 * journal size that was asked for.
+	 */
+	if (target_size != 0) {
+		max_index_size = ISC_MIN(max_index_size,
+					 target_size / 8 /
+						 sizeof(journal_rawpos_t));
+	}
+
 	/*
 	 * Cope with very small target sizes.
 	 */
 	indexend = sizeof(journal_rawheader_t) +
 		   ISC_CHECKED_MUL(j1->header.index_size,
 				   sizeof(journal_rawpos_t));
-	if (target_size < DNS_JOURNAL_SIZE_MIN) {
-		target_size = DNS_JOURNAL_SIZE_MIN;
-	}
-	if (target_size < indexend * 2) {
-		target_size = target_size / 2 + indexend;
-	}
+	target_size = journal_target_size(j1, target_size);
 
 	/*
 	 * See if there is any work to do.
@@ -2552,9 +3122,6 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		return (ISC_R_SUCCESS);
 	}
 
-	CHECK(journal_open(mctx, newname, true, true, downgrade, &j2));
-	CHECK(journal_seek(j2, indexend));
-
 	/*
 	 * Remove overhead so space test below can succeed.
 	 */
@@ -2562,44 +3129,35 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		target_size -= indexend;
 	}
 
+	CHECK(journal_trimpoint(j1, serial, target_size / 2, &best_guess));
+
 	/*
-	 * Find if we can create enough free space.
+	 * Give a version 3 index room for twice the number of
+	 * transactions that are kept, so that it can index all of them
+	 * until the journal is compacted again.  The transaction headers
+	 * of a version 1 journal are not trusted to be counted.
 	 */
-	best_guess = j1->header.begin;
-	for (i = 0; i < j1->header.index_size; i++) {
-		if (POS_VALID(j1->index[i]) &&
-		    DNS_SERIAL_GE(serial, j1->index[i].serial) &&
-		    ((uint32_t)(j1->header.end.offset - j1->index[i].offset) >=
-		     target_size / 2) &&
-		    j1->index[i].offset > best_guess.offset)
-		{
-			best_guess = j1->index[i];
-		}
-	}
-
-	current_pos = best_guess;
-	while (current_pos.serial != serial) {
-		CHECK(journal_next(j1, &current_pos));
-		if (current_pos.serial == j1->header.end.serial) {
-			break;
-		}
+	if (version == JOURNAL_VERSION3 && !j1->header_ver1) {
+		uint32_t count = 0;
 
-		if (DNS_SERIAL_GE(serial, current_pos.serial) &&
-		    ((uint32_t)(j1->header.end.offset - current_pos.offset) >=
-		     (target_size / 2)) &&
-		    current_pos.offset > best_guess.offset)
+		current_pos = best_guess;
+		while (current_pos.serial != j1->header.end.serial &&
+		       count < max_index_size)
 		{
-			best_guess = current_pos;
-		} else {
-			break;
+			CHECK(journal_next(j1, &current_pos));
+			count++;
 		}
+		index_size = ISC_CLAMP(count * 2, JOURNAL_INDEX_SIZE,
+				       ISC_MAX(max_index_size,
+					       JOURNAL_INDEX_SIZE));
 	}
 
-	INSIST(best_guess.serial != j1->header.end.serial);
-	if (best_guess.serial != serial) {
-		CHECK(journal_next(j1, &best_guess));
-		serial = best_guess.serial;
-	}
+	CHECK(journal_open(mctx, newname, true, true, version, index_size,
+			   &j2));
+	indexend = sizeof(journal_rawheader_t) +
+		   ISC_CHECKED_MUL(j2->header.index_size,
+				   sizeof(journal_rawpos_t));
+	CHECK(journal_seek(j2, indexend));
 
 	/*
 	 * We should now be roughly half target_size provided
@@ -2759,9 +3317,10 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		/*
 		 * Build new index.
 		 */
+		CHECK(index_load(j2));
 		current_pos = j2->header.begin;
 		while (current_pos.serial != j2->header.end.serial) {
-			index_add(j2, &current_pos);
+			CHECK(index_add(j2, &current_pos));
 			CHECK(journal_next(j2, &current_pos));
 		}
 
@@ -2830,29 +3389,227 @@ failure:
 	return (result);
 }
 
+isc_result_t
+dns_journal_truncate(isc_mem_t *mctx, const char *filename, uint32_t serial,
+		     uint32_t target_size, uint32_t *beginp, uint32_t *freedp) {
+	dns_journal_t *j = NULL;
+	journal_pos_t best_guess;
+	journal_rawheader_t rawheader;
+	unsigned int indexend;
+	uint32_t freed;
+	isc_result_t result;
+
+	REQUIRE(filename != NULL);
+	REQUIRE(beginp != NULL);
+	REQUIRE(freedp != NULL);
+
+	*freedp = 0;
+
+#if !defined(HAVE_FALLOCATE) || !defined(FALLOC_FL_PUNCH_HOLE)
+	/*
+	 * The space of the dropped transactions could never be released.
+	 */
+	UNUSED(mctx);
+	UNUSED(serial);
+	UNUSED(target_size);
+	*beginp = 0;
+	return (ISC_R_NOTIMPLEMENTED);
+#endif /* if !defined(HAVE_FALLOCATE) || !defined(FALLOC_FL_PUNCH_HOLE) */
+
+	result = journal_open(mctx, filename, true, false, JOURNAL_VERSION3,
+			      JOURNAL_INDEX_SIZE, &j);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	*beginp = j->header.begin.offset;
+
+	/*
+	 * Only a version 3 journal can be searched without reading it
+	 * all, and the offsets of its transactions only ever grow until
+	 * it is rewritten.
+	 */
+	if (!j->sorted || j->header_ver1 ||
+	    (uint32_t)j->header.end.offset > JOURNAL_TRUNCATE_MAX)
+	{
+		FAIL(ISC_R_NOTIMPLEMENTED);
+	}
+	if (JOURNAL_EMPTY(&j->header)) {
+		goto failure;
+	}
+	if (DNS_SERIAL_GT(j->header.begin.serial, serial) ||
+	    DNS_SERIAL_GT(serial, j->header.end.serial))
+	{
+		FAIL(ISC_R_RANGE);
+	}
+
+	indexend = sizeof(journal_rawheader_t) +
+		   ISC_CHECKED_MUL(j->header.index_size,
+				   sizeof(journal_rawpos_t));
+	target_size = journal_target_size(j, target_size);
+	if ((uint32_t)(j->header.end.offset - j->header.begin.offset) +
+		    indexend <
+	    target_size)
+	{
+		goto failure;
+	}
+	if (target_size >= indexend) {
+		target_size -= indexend;
+	}
+
+	CHECK(journal_trimpoint(j, serial, target_size / 2, &best_guess));
+	if (best_guess.offset == j->header.begin.offset) {
+		goto failure;
+	}
+
+	/*
+	 * What is left is cheaper to copy than to keep its file offsets.
+	 */
+	if ((uint32_t)(j->header.end.offset - best_guess.offset) <=
+	    JOURNAL_REWRITE_SIZE)
+	{
+		FAIL(ISC_R_NOTIMPLEMENTED);
+	}
+
+	/*
+	 * The transactions before the new beginning are left in place;
+	 * the index entries pointing to them are skipped by searches.
+	 */
+	freed = best_guess.offset - j->header.begin.offset;
+	j->header.begin = best_guess;
+	journal_header_encode(&j->header, &rawheader);
+	CHECK(journal_seek(j, 0));
+	CHECK(journal_write(j, &rawheader, sizeof(rawheader)));
+
+	*beginp = best_guess.offset;
+	*freedp = freed;
+
+failure:
+	dns_journal_destroy(&j);
+	return (result);
+}
+
+isc_result_t
+dns_journal_punch(const char *filename, uint32_t offset) {
+	FILE *fp = NULL;
+	journal_rawheader_t rawheader;
+	journal_header_t header;
+	journal_reader_t *reader = NULL;
+	uint32_t start, end;
+	isc_result_t result;
+
+	REQUIRE(filename != NULL);
+
+	result = isc_stdio_open(filename, "rb+", &fp);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	CHECK(isc_stdio_read(&rawheader, sizeof(rawheader), 1, fp, NULL));
+	CHECK(isc_stdio_sync(fp));
+
+	/*
+	 * The journal may have been rewritten since 'offset' was taken;
+	 * nothing at or after its current beginning is ever released.
+	 */
+	if (memcmp(rawheader.h.format, initial_journal_header.format,
+		   sizeof(initial_journal_header.format)) != 0)
+	{
+		goto failure;
+	}
+	journal_header_decode(&rawheader, &header);
+	start = sizeof(journal_rawheader_t) +
+		ISC_CHECKED_MUL(header.index_size, sizeof(journal_rawpos_t));
+	end = ISC_MIN(offset, (uint32_t)header.begin.offset);
+
+	/*
+	 * Nor is anything a reader that opened the journal before its
+	 * beginning moved may still read.  Readers opened from now on
+	 * start at the current beginning.
+	 */
+	isc_once_do(&readers_once, readers_initialize);
+	LOCK(&readers_lock);
+	ISC_LIST_FOREACH (readers, reader, link) {
+		if (strcmp(reader->filename, filename) == 0) {
+			end = ISC_MIN(end, reader->begin);
+		}
+	}
+	UNLOCK(&readers_lock);
+
+	if (start >= end) {
+		goto failure;
+	}
+
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_PUNCH_HOLE)
+	if (fallocate(fileno(fp), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+		      start, end - start) != 0)
+	{
+		if (errno == EOPNOTSUPP || errno == ENOSYS) {
+			FAIL(ISC_R_NOTIMPLEMENTED);
+		}
+		result = isc_errno_toresult(errno);
+		isc_log_write(JOURNAL_COMMON_LOGARGS, ISC_LOG_ERROR,
+			      "%s: fallocate: %s", filename,
+			      isc_result_totext(result));
+	}
+#else  /* if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_PUNCH_HOLE) */
+	result = ISC_R_NOTIMPLEMENTED;
+#endif /* if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_PUNCH_HOLE) */
+
+failure:
+	(void)isc_stdio_close(fp);
+	return (result);
+}
+
+/*
+ * Write the index entries that changed since the last call.  When a
+ * transaction is added to a sorted index, that is only the new entry.
+ */
 static isc_result_t
 index_to_disk(dns_journal_t *j) {
 	isc_result_t result = ISC_R_SUCCESS;
 
-	if (j->header.index_size != 0) {
+	if (j->header.index_size != 0 && j->index_lo < j->index_hi &&
+	    j->index == NULL)
+	{
+		journal_rawpos_t raw;
+
+		INSIST(j->sorted && j->index_hi == j->index_lo + 1);
+
+		journal_pos_encode(&raw, &j->index_new);
+		CHECK(journal_seek(j, sizeof(journal_rawheader_t) +
+					      j->index_lo *
+						      sizeof(journal_rawpos_t)));
+		CHECK(journal_write(j, &raw, sizeof(raw)));
+
+		j->index_lo = j->header.index_size;
+		j->index_hi = 0;
+	} else if (j->header.index_size != 0 && j->index_lo < j->index_hi) {
 		unsigned int i;
-		unsigned char *p;
+		unsigned char *p, *start;
 		unsigned int rawbytes;
 
-		rawbytes = ISC_CHECKED_MUL(j->header.index_size,
+		INSIST(j->index_hi <= j->header.index_size);
+
+		rawbytes = ISC_CHECKED_MUL(j->index_hi - j->index_lo,
 					   sizeof(journal_rawpos_t));
 
-		p = j->rawindex;
-		for (i = 0; i < j->header.index_size; i++) {
+		start = p = j->rawindex +
+			    j->index_lo * sizeof(journal_rawpos_t);
+		for (i = j->index_lo; i < j->index_hi; i++) {
 			encode_uint32(j->index[i].serial, p);
 			p += 4;
 			encode_uint32(j->index[i].offset, p);
 			p += 4;
 		}
-		INSIST(p == j->rawindex + rawbytes);
+		INSIST(p == start + rawbytes);
+
+		CHECK(journal_seek(j, sizeof(journal_rawheader_t) +
+					      j->index_lo *
+						      sizeof(journal_rawpos_t)));
+		CHECK(journal_write(j, start, rawbytes));
 
-		CHECK(journal_seek(j, sizeof(journal_rawheader_t)));
-		CHECK(journal_write(j, j->rawindex, rawbytes));
+		j->index_lo = j->header.index_size;
+		j->index_hi = 0;
 	}
 failure:
 	return (result);
@@ -13,11 +13,15 @@
 
 /*! \file */
 
+#include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <sys/mman.h>
 
 #include <isc/async.h>
 #include <isc/atomic.h>
+#include <isc/errno.h>
+#include <isc/file.h>
 #include <isc/lex.h>
 #include <isc/loop.h>
 #include <isc/magic.h>
@@ -39,6 +43,7 @@
 #include <dns/rdataclass.h>
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
+#include <dns/rdataslab.h>
 #include <dns/rdatastruct.h>
 #include <dns/rdatatype.h>
 #include <dns/soa.h>
@@ -129,7 +134,7 @@ struct dns_loadctx {
 	dns_fixedname_t fixed_top;
 	dns_name_t *top; /*%< top of zone */
 
-	/* Members specific to the raw format: */
+	/* Members specific to the raw and image formats: */
 	FILE *f;
 	bool first;
 	dns_masterrawheader_t header;
@@ -166,6 +171,15 @@ struct dns_incctx {
 	unsigned int current_line;
 };
 
+/*%
+ * Header flags that an image file must have to be loadable by this build.
+ */
+#if DNS_RDATASET_FIXED
+#define IMAGE_FIXEDORDER DNS_MASTERRAW_FIXEDORDER
+#else /* if DNS_RDATASET_FIXED */
+#define IMAGE_FIXEDORDER 0
+#endif /* if DNS_RDATASET_FIXED */
+
 #define DNS_LCTX_MAGIC	     ISC_MAGIC('L', 'c', 't', 'x')
 #define DNS_LCTX_VALID(lctx) ISC_MAGIC_VALID(lctx, DNS_LCTX_MAGIC)
 
@@ -183,6 +197,9 @@ openfile_raw(dns_loadctx_t *lctx, const char *master_file);
 static isc_result_t
 load_raw(dns_loadctx_t *lctx);
 
+static isc_result_t
+load_image(dns_loadctx_t *lctx);
+
 static isc_result_t
 pushfile(const char *master_file, dns_name_t *origin, dns_loadctx_t *lctx);
 
@@ -193,6 +210,9 @@ commit(dns_rdatacallbacks_t *, dns_loadctx_t *, rdatalist_head_t *,
 static bool
 is_glue(rdatalist_head_t *, dns_name_t *);
 
+static uint32_t
+resign_fromrdataset(dns_rdataset_t *, dns_loadctx_t *);
+
 static dns_rdatalist_t *
 grow_rdatalist(int, dns_rdatalist_t *, int, rdatalist_head_t *,
 	       rdatalist_head_t *, isc_mem_t *mctx);
@@ -548,6 +568,10 @@ loadctx_create(dns_masterformat_t format, isc_mem_t *mctx, unsigned int options,
 		lctx->openfile = openfile_raw;
 		lctx->load = load_raw;
 		break;
+	case dns_masterformat_image:
+		lctx->openfile = openfile_raw;
+		lctx->load = load_image;
+		break;
 	default:
 		UNREACHABLE();
 	}
@@ -2272,7 +2296,9 @@ load_header(dns_loadctx_t *lctx) {
 
 	REQUIRE(DNS_LCTX_VALID(lctx));
 
-	if (lctx->format != dns_masterformat_raw) {
+	if (lctx->format != dns_masterformat_raw &&
+	    lctx->format != dns_masterformat_image)
+	{
 		return (ISC_R_NOTIMPLEMENTED);
 	}
 
@@ -2294,7 +2320,10 @@ load_header(dns_loadctx_t *lctx) {
 	if (header.format != lctx->format) {
 		(*callbacks->error)(callbacks,
 				    "dns_master_load: "
-				    "file format mismatch (not raw)");
+				    "file format mismatch (not %s)",
+				    lctx->format == dns_masterformat_raw
+					    ? "raw"
+					    : "image");
 		return (ISC_R_NOTIMPLEMENTED);
 	}
 
@@ -2329,6 +2358,19 @@ load_header(dns_loadctx_t *lctx) {
 		header.lastxfrin = isc_buffer_getuint32(&target);
 	}
 
+	/*
+	 * The slabs in an image file can only be used by a build that
+	 * lays them out the same way.
+	 */
+	if (header.format == dns_masterformat_image &&
+	    (header.version != DNS_RAWFORMAT_VERSION ||
+	     (header.flags & DNS_MASTERRAW_FIXEDORDER) != IMAGE_FIXEDORDER))
+	{
+		(*callbacks->error)(callbacks, "dns_master_load: "
+					       "incompatible image file");
+		return (ISC_R_NOTIMPLEMENTED);
+	}
+
 	lctx->first = false;
 	lctx->header = header;
 
@@ -2652,6 +2694,207 @@ cleanup:
 	return (result);
 }
 
+/*
+ * Load a zone image.  The file is mapped into memory and every RRset is
+ * handed to the database as a bare slab pointing into the mapping, so
+ * that the rdata need not be copied, sorted or deduplicated again.  As
+ * with the raw format, every rdata is still checked, and so is the order
+ * of the rdata in each slab, so that a damaged or hand-edited image is
+ * rejected instead of being trusted.  The database makes its own copy of
+ * each slab, so the mapping is released once the whole file has been
+ * loaded.
+ */
+static isc_result_t
+load_image(dns_loadctx_t *lctx) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_rdatacallbacks_t *callbacks = lctx->callbacks;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	char namebuf[DNS_NAME_FORMATSIZE];
+	unsigned char *image = MAP_FAILED;
+	size_t imagelen = 0;
+	off_t offset, size;
+	isc_buffer_t source, target;
+	unsigned char *target_mem = NULL;
+	int target_size = MINTSIZ; /* only one rdata at a time */
+
+	if (lctx->first) {
+		result = load_header(lctx);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+
+	result = isc_stdio_tell(lctx->f, &offset);
+	if (result == ISC_R_SUCCESS) {
+		result = isc_file_getsizefd(fileno(lctx->f), &size);
+	}
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+	if (size < offset || (uintmax_t)size > SIZE_MAX) {
+		result = ISC_R_RANGE;
+		goto cleanup;
+	}
+	if (size == offset) {
+		/* Nothing but the header */
+		goto done;
+	}
+
+	imagelen = (size_t)size;
+	image = mmap(NULL, imagelen, PROT_READ, MAP_PRIVATE, fileno(lctx->f),
+		     0);
+	if (image == MAP_FAILED) {
+		result = isc_errno_toresult(errno);
+		goto cleanup;
+	}
+	(void)posix_madvise(image, imagelen, POSIX_MADV_SEQUENTIAL);
+
+	isc_buffer_init(&source, image + offset, (unsigned int)(size - offset));
+	isc_buffer_add(&source, (unsigned int)(size - offset));
+
+	target_mem = isc_mem_get(lctx->mctx, target_size);
+	isc_buffer_init(&target, target_mem, target_size);
+
+	/* open a database transaction */
+	if (callbacks->setup != NULL) {
+		callbacks->setup(callbacks->add_private);
+	}
+
+	/*
+	 * As with the raw format, any error in the data is fatal.
+	 */
+	while (isc_buffer_remaininglength(&source) > 0) {
+		dns_rdataset_t rdataset;
+		dns_rdataclass_t rdclass;
+		dns_rdatatype_t type, covers;
+		dns_ttl_t ttl;
+		isc_buffer_t rrset;
+		uint32_t totallen;
+		uint16_t namelen;
+		unsigned int slablen;
+		size_t minlen = sizeof(totallen) + 3 * sizeof(uint16_t) +
+				sizeof(uint32_t) + sizeof(namelen);
+
+		if (isc_buffer_remaininglength(&source) < minlen) {
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+		totallen = isc_buffer_getuint32(&source);
+		if (totallen < minlen ||
+		    totallen - sizeof(totallen) >
+			    isc_buffer_remaininglength(&source))
+		{
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+		totallen -= sizeof(totallen);
+
+		isc_buffer_init(&rrset, isc_buffer_current(&source), totallen);
+		isc_buffer_add(&rrset, totallen);
+		isc_buffer_forward(&source, totallen);
+
+		rdclass = isc_buffer_getuint16(&rrset);
+		if (lctx->zclass != rdclass) {
+			result = DNS_R_BADCLASS;
+			goto cleanup;
+		}
+		type = isc_buffer_getuint16(&rrset);
+		covers = isc_buffer_getuint16(&rrset);
+		ttl = isc_buffer_getuint32(&rrset);
+
+		/* Owner name: length followed by name */
+		namelen = isc_buffer_getuint16(&rrset);
+		if (namelen > isc_buffer_remaininglength(&rrset)) {
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+		isc_buffer_setactive(&rrset, namelen);
+		result = dns_name_fromwire(name, &rrset, DNS_DECOMPRESS_NEVER,
+					   NULL);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+
+		if ((lctx->options & DNS_MASTER_CHECKTTL) != 0 &&
+		    ttl > lctx->maxttl)
+		{
+			(callbacks->error)(callbacks,
+					   "dns_master_load: "
+					   "TTL %d exceeds configured "
+					   "max-zone-ttl %d",
+					   ttl, lctx->maxttl);
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+
+		/* The rest of the RRset is the slab */
+		result = dns_rdataslab_check(isc_buffer_current(&rrset),
+					     isc_buffer_remaininglength(&rrset),
+					     rdclass, type, &target, &slablen);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+		if (slablen != isc_buffer_remaininglength(&rrset)) {
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+
+		dns_rdataset_init(&rdataset);
+		dns_rdataslab_tordataset(isc_buffer_current(&rrset), rdclass,
+					 type, covers, ttl, &rdataset);
+		rdataset.trust = dns_trust_ultimate;
+		if (type == dns_rdatatype_rrsig &&
+		    (lctx->options & DNS_MASTER_RESIGN) != 0)
+		{
+			rdataset.attributes |= DNS_RDATASETATTR_RESIGN;
+			rdataset.resign = resign_fromrdataset(&rdataset, lctx);
+		}
+
+		result = callbacks->add(callbacks->add_private, name,
+					&rdataset DNS__DB_FILELINE);
+		dns_rdataset_disassociate(&rdataset);
+		if (result != ISC_R_SUCCESS) {
+			dns_name_format(name, namebuf, sizeof(namebuf));
+			(*callbacks->error)(callbacks, "%s: %s: %s",
+					    "dns_master_load", namebuf,
+					    isc_result_totext(result));
+		}
+		if (MANYERRS(lctx, result)) {
+			SETRESULT(lctx, result);
+		} else if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+done:
+	if (result == ISC_R_SUCCESS && lctx->result != ISC_R_SUCCESS) {
+		result = lctx->result;
+	}
+
+	if (result == ISC_R_SUCCESS && callbacks->rawdata != NULL) {
+		(*callbacks->rawdata)(callbacks->zone, &lctx->header);
+	}
+
+cleanup:
+	if (image != MAP_FAILED) {
+		/* commit the database transaction */
+		if (callbacks->commit != NULL) {
+			callbacks->commit(callbacks->add_private);
+		}
+		(void)munmap(image, imagelen);
+	}
+	if (target_mem != NULL) {
+		isc_mem_put(lctx->mctx, target_mem, target_size);
+	}
+	if (result != ISC_R_SUCCESS) {
+		(*callbacks->error)(callbacks, "dns_master_load: %s",
+				    isc_result_totext(result));
+	}
+
+	return (result);
+}
+
 isc_result_t
 dns_master_loadfile(const char *master_file, dns_name_t *top,
 		    dns_name_t *origin, dns_rdataclass_t zclass,
@@ -2890,30 +3133,26 @@ grow_rdata(int new_len, dns_rdata_t *oldlist, int old_len,
 }
 
 static uint32_t
-resign_fromlist(dns_rdatalist_t *this, dns_loadctx_t *lctx) {
-	dns_rdata_t *rdata;
+resign_fromrdataset(dns_rdataset_t *rdataset, dns_loadctx_t *lctx) {
 	dns_rdata_rrsig_t sig;
-	uint32_t when;
+	uint32_t when = 0;
+	bool first = true;
 
-	rdata = ISC_LIST_HEAD(this->rdata);
-	INSIST(rdata != NULL);
-	(void)dns_rdata_tostruct(rdata, &sig, NULL);
-	if (isc_serial_gt(sig.timesigned, lctx->now)) {
-		when = lctx->now;
-	} else {
-		when = sig.timeexpire - lctx->resign;
-	}
+	for (isc_result_t result = dns_rdataset_first(rdataset);
+	     result == ISC_R_SUCCESS; result = dns_rdataset_next(rdataset))
+	{
+		dns_rdata_t rdata = DNS_RDATA_INIT;
 
-	rdata = ISC_LIST_NEXT(rdata, link);
-	while (rdata != NULL) {
-		(void)dns_rdata_tostruct(rdata, &sig, NULL);
+		dns_rdataset_current(rdataset, &rdata);
+		(void)dns_rdata_tostruct(&rdata, &sig, NULL);
 		if (isc_serial_gt(sig.timesigned, lctx->now)) {
 			when = lctx->now;
-		} else if (sig.timeexpire - lctx->resign < when) {
+		} else if (first || sig.timeexpire - lctx->resign < when) {
 			when = sig.timeexpire - lctx->resign;
 		}
-		rdata = ISC_LIST_NEXT(rdata, link);
+		first = false;
 	}
+	INSIST(!first);
 	return (when);
 }
 
@@ -2946,7 +3185,7 @@ commit(dns_rdatacallbacks_t *callbacks, dns_loadctx_t *lctx,
 		    (lctx->options & DNS_MASTER_RESIGN) != 0)
 		{
 			dataset.attributes |= DNS_RDATASETATTR_RESIGN;
-			dataset.resign = resign_fromlist(this, lctx);
+			dataset.resign = resign_fromrdataset(&dataset, lctx);
 		}
 		result = callbacks->add(callbacks->add_private, owner,
 					&dataset DNS__DB_FILELINE);
@@ -44,6 +44,7 @@
 #include <dns/rdataclass.h>
 #include <dns/rdataset.h>
 #include <dns/rdatasetiter.h>
+#include <dns/rdataslab.h>
 #include <dns/rdatatype.h>
 #include <dns/time.h>
 #include <dns/ttl.h>
@@ -1282,10 +1283,68 @@ restart:
 	return (result);
 }
 
+/*
+ * Dump given RRsets in the "image" format: the same per-RRset header as
+ * the "raw" format, followed by the RRset as a ready-made rdataslab.
+ */
 static isc_result_t
-dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
-		   dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
-		   isc_buffer_t *buffer, FILE *f) {
+dump_rdataset_image(isc_mem_t *mctx, const dns_name_t *name,
+		    dns_rdataset_t *rdataset, isc_buffer_t *buffer, FILE *f) {
+	isc_result_t result;
+	isc_region_t r, slab;
+	uint32_t totallen;
+
+	REQUIRE(buffer->length > 0);
+	REQUIRE(DNS_RDATASET_VALID(rdataset));
+
+	/*
+	 * Build the slab in load order, so that its order table (if any)
+	 * records the order in which the records were loaded originally.
+	 */
+	rdataset->attributes |= DNS_RDATASETATTR_LOADORDER;
+	result = dns_rdataslab_fromrdataset(rdataset, mctx, &slab, 0, 0);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	dns_name_toregion(name, &r);
+	totallen = sizeof(totallen) + 3 * sizeof(uint16_t) + sizeof(uint32_t) +
+		   sizeof(uint16_t) + r.length + slab.length;
+
+	isc_buffer_clear(buffer);
+	INSIST(isc_buffer_availablelength(buffer) >=
+	       totallen - slab.length);
+	isc_buffer_putuint32(buffer, totallen);
+	isc_buffer_putuint16(buffer, rdataset->rdclass);
+	isc_buffer_putuint16(buffer, rdataset->type);
+	isc_buffer_putuint16(buffer, rdataset->covers);
+	isc_buffer_putuint32(buffer, rdataset->ttl);
+	isc_buffer_putuint16(buffer, (uint16_t)r.length);
+	isc_buffer_copyregion(buffer, &r);
+
+	isc_buffer_usedregion(buffer, &r);
+	result = isc_stdio_write(r.base, 1, (size_t)r.length, f, NULL);
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_write(slab.base, 1, (size_t)slab.length, f,
+					 NULL);
+	}
+	isc_mem_put(mctx, slab.base, slab.length);
+
+	if (result != ISC_R_SUCCESS) {
+		UNEXPECTED_ERROR("image master file write failed: %s",
+				 isc_result_totext(result));
+	}
+
+	return (result);
+}
+
+static isc_result_t
+dump_rdatasets_binary(isc_mem_t *mctx, const dns_name_t *owner_name,
+		      dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
+		      isc_buffer_t *buffer, FILE *f,
+		      isc_result_t (*dump)(isc_mem_t *, const dns_name_t *,
+					   dns_rdataset_t *, isc_buffer_t *,
+					   FILE *)) {
 	isc_result_t result;
 	dns_rdataset_t rdataset;
 	dns_fixedname_t fixed;
@@ -1306,8 +1365,7 @@ dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 		{
 			/* Omit negative cache entries */
 		} else {
-			result = dump_rdataset_raw(mctx, name, &rdataset,
-						   buffer, f);
+			result = dump(mctx, name, &rdataset, buffer, f);
 		}
 		dns_rdataset_disassociate(&rdataset);
 		if (result != ISC_R_SUCCESS) {
@@ -1322,6 +1380,22 @@ dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 	return (result);
 }
 
+static isc_result_t
+dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
+		   dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
+		   isc_buffer_t *buffer, FILE *f) {
+	return (dump_rdatasets_binary(mctx, owner_name, rdsiter, ctx, buffer,
+				      f, dump_rdataset_raw));
+}
+
+static isc_result_t
+dump_rdatasets_image(isc_mem_t *mctx, const dns_name_t *owner_name,
+		     dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
+		     isc_buffer_t *buffer, FILE *f) {
+	return (dump_rdatasets_binary(mctx, owner_name, rdsiter, ctx, buffer,
+				      f, dump_rdataset_image));
+}
+
 /*
  * Initial size of text conversion buffer.  The buffer is used
  * for several purposes: converting origin names, rdatasets,
@@ -1542,6 +1616,9 @@ dumpctx_create(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 	case dns_masterformat_raw:
 		dctx->dumpsets = dump_rdatasets_raw;
 		break;
+	case dns_masterformat_image:
+		dctx->dumpsets = dump_rdatasets_image;
+		break;
 	default:
 		UNREACHABLE();
 	}
@@ -1632,12 +1709,19 @@ writeheader(dns_dumpctx_t *dctx) {
 		}
 		break;
 	case dns_masterformat_raw:
+	case dns_masterformat_image:
 		r.base = (unsigned char *)&rawheader;
 		r.length = sizeof(rawheader);
 		isc_buffer_region(&buffer, &r);
 		now32 = dctx->now;
 		rawversion = 1;
-		if ((dctx->header.flags & DNS_MASTERRAW_COMPAT) != 0) {
+		dctx->header.flags &= ~DNS_MASTERRAW_FIXEDORDER;
+		if (dctx->format == dns_masterformat_image) {
+			dctx->header.flags &= ~DNS_MASTERRAW_COMPAT;
+#if DNS_RDATASET_FIXED
+			dctx->header.flags |= DNS_MASTERRAW_FIXEDORDER;
+#endif /* if DNS_RDATASET_FIXED */
+		} else if ((dctx->header.flags & DNS_MASTERRAW_COMPAT) != 0) {
 			rawversion = 0;
 		}
 
@@ -2251,6 +2251,30 @@ dns_message_rendersection(dns_message_t *msg, dns_section_t sectionid,
 	return (ISC_R_SUCCESS);
 }
 
+isc_result_t
+dns_message_renderraw(dns_message_t *msg, dns_section_t sectionid,
+		      const isc_region_t *region, unsigned int count) {
+	unsigned int available;
+
+	REQUIRE(DNS_MESSAGE_VALID(msg));
+	REQUIRE(msg->buffer != NULL);
+	REQUIRE(VALID_NAMED_SECTION(sectionid));
+	REQUIRE(region != NULL);
+
+	available = isc_buffer_availablelength(msg->buffer);
+	if (available < msg->reserved ||
+	    available - msg->reserved < region->length ||
+	    msg->counts[sectionid] + count > 65535)
+	{
+		return (ISC_R_NOSPACE);
+	}
+
+	isc_buffer_putmem(msg->buffer, region->base, region->length);
+	msg->counts[sectionid] += count;
+
+	return (ISC_R_SUCCESS);
+}
+
 void
 dns_message_renderheader(dns_message_t *msg, isc_buffer_t *target) {
 	uint16_t tmp;
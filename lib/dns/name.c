@@ -418,7 +418,11 @@ dns_name_fullcompare(const dns_name_t *name1, const dns_name_t *name2,
 			count = count2;
 		}
 
-		diff = isc_ascii_lowercmp(label1, label2, count);
+		if (count < ISC_ASCII_WIDE) {
+			diff = isc_ascii_lowercmp(label1, label2, count);
+		} else {
+			diff = isc_ascii_lowercmp_wide(label1, label2, count);
+		}
 		if (diff != 0) {
 			*orderp = diff;
 			goto done;
@@ -501,7 +505,11 @@ dns_name_equal(const dns_name_t *name1, const dns_name_t *name2) {
 	}
 
 	/* label lengths are < 64 so tolower() does not affect them */
-	return (isc_ascii_lowerequal(name1->ndata, name2->ndata, length));
+	if (length < ISC_ASCII_WIDE) {
+		return (isc_ascii_lowerequal(name1->ndata, name2->ndata,
+					     length));
+	}
+	return (isc_ascii_lowerequal_wide(name1->ndata, name2->ndata, length));
 }
 
 bool
@@ -535,6 +543,8 @@ dns_name_caseequal(const dns_name_t *name1, const dns_name_t *name2) {
 
 int
 dns_name_rdatacompare(const dns_name_t *name1, const dns_name_t *name2) {
+	unsigned int length;
+
 	/*
 	 * Compare two absolute names as rdata.
 	 */
@@ -547,8 +557,11 @@ dns_name_rdatacompare(const dns_name_t *name1, const dns_name_t *name2) {
 	REQUIRE(name2->attributes.absolute);
 
 	/* label lengths are < 64 so tolower() does not affect them */
-	return (isc_ascii_lowercmp(name1->ndata, name2->ndata,
-				   ISC_MIN(name1->length, name2->length)));
+	length = ISC_MIN(name1->length, name2->length);
+	if (length < ISC_ASCII_WIDE) {
+		return (isc_ascii_lowercmp(name1->ndata, name2->ndata, length));
+	}
+	return (isc_ascii_lowercmp_wide(name1->ndata, name2->ndata, length));
 }
 
 bool
@@ -30,6 +30,7 @@
 #include <isc/mem.h>
 #include <isc/mutex.h>
 #include <isc/once.h>
+#include <isc/os.h>
 #include <isc/queue.h>
 #include <isc/random.h>
 #include <isc/refcount.h>
@@ -37,6 +38,7 @@
 #include <isc/rwlock.h>
 #include <isc/stdio.h>
 #include <isc/string.h>
+#include <isc/tid.h>
 #include <isc/time.h>
 #include <isc/urcu.h>
 #include <isc/util.h>
@@ -113,6 +115,15 @@
 #define ACTIVE(header, now) \
 	(((header)->ttl > (now)) || ((header)->ttl == (now) && ZEROTTL(header)))
 
+/*%
+ * A header found without holding the node lock may only be used if it is
+ * active and has not been marked for cleanup; anything else is left to
+ * the locked path.
+ */
+#define USABLE(header, now)                                           \
+	(ACTIVE(header, now) && EXISTS(header) && !ANCIENT(header) && \
+	 !STALE(header))
+
 #define EXPIREDOK(rbtiterator) \
 	(((rbtiterator)->common.options & DNS_DB_EXPIREDOK) != 0)
 
@@ -137,6 +148,11 @@
  */
 #define QPDB_VIRTUAL 300
 
+/*%
+ * Upper bound on the number of loop cache entries per loop.
+ */
+#define QPDB_LOOPCACHE_MAX (1U << 20)
+
 /*%
  * Whether to rate-limit updating the LRU to avoid possible thread contention.
  * Updating LRU requires write locking, so we don't do it every time the
@@ -178,6 +194,13 @@ struct qpcnode {
 	uint16_t locknum;
 	void *data;
 
+	/*%
+	 * Bumped, under the node lock, whenever add() changes the data
+	 * at the node, so that loop cache entries pointing to it can
+	 * tell that they are out of date.
+	 */
+	atomic_uint_fast32_t generation;
+
 	/*%
 	 * NOTE: The 'dirty' flag is protected by the node lock, so
 	 * this bitfield has to be separated from the one above.
@@ -197,6 +220,46 @@ struct qpcnode {
 	isc_queue_node_t deadlink;
 };
 
+/*%
+ * The loop cache: a small direct-mapped table per loop that remembers
+ * the outcome of recent successful find() calls, so that lookups of
+ * popular names don't have to touch the tree lock or anything else
+ * that is shared with the other loops.  Each entry holds a reference
+ * to its node, which keeps the headers it points to from being freed;
+ * entries are checked against the node generation and the header TTLs
+ * when they are used and are simply dropped when they are stale.
+ *
+ * A table is only ever used by the loop that owns it.  When the cache
+ * goes over its memory limit, the owners are asked to empty their tables
+ * (see loopcache_flushall()), so that the node references don't keep the
+ * data that overmem() purges from being freed.
+ */
+typedef struct qpc_lcentry {
+	qpcnode_t *node;
+	dns_slabheader_t *header;
+	dns_slabheader_t *sigheader;
+	uint32_t hashval;
+	uint32_t generation;
+	uint32_t dname_generation;
+	dns_rdatatype_t type;
+	unsigned int options;
+	isc_result_t result;
+} qpc_lcentry_t;
+
+typedef struct qpc_loopcache {
+	qpc_lcentry_t *entries;
+	uint32_t size;
+	atomic_uint_fast64_t hits;
+	atomic_uint_fast64_t misses;
+	atomic_uint_fast32_t used; /* entries holding a node */
+	atomic_bool flushing;	   /* loopcache_flush_cb() is scheduled */
+	uint8_t __padding[ISC_OS_CACHELINE_SIZE -
+			  (sizeof(qpc_lcentry_t *) + sizeof(uint32_t) +
+			   2 * sizeof(atomic_uint_fast64_t) +
+			   sizeof(atomic_uint_fast32_t) + sizeof(atomic_bool)) %
+				  ISC_OS_CACHELINE_SIZE];
+} qpc_loopcache_t;
+
 typedef struct qpcache qpcache_t;
 struct qpcache {
 	/* Unlocked. */
@@ -260,6 +323,19 @@ struct qpcache {
 	isc_mem_t *hmctx;
 	isc_heap_t **heaps;
 
+	/*
+	 * Loop caches, one per loop, and the number of entries each of
+	 * them should have; see dns_db_setloopcache().
+	 */
+	qpc_loopcache_t *loopcaches;
+	atomic_uint_fast32_t loopcachesize;
+
+	/*
+	 * Bumped whenever a DNAME is added or removed anywhere in the
+	 * cache, since that can change the answer for names below it.
+	 */
+	atomic_uint_fast32_t dname_generation;
+
 	/* Locked by tree_lock. */
 	dns_qp_t *tree;
 	dns_qp_t *nsec;
@@ -404,6 +480,9 @@ typedef struct qpc_dbit {
 static void
 free_qpdb(qpcache_t *qpdb, bool log);
 
+static void
+detachnode(dns_db_t *db, dns_dbnode_t **targetp DNS__DB_FLARG);
+
 static dns_dbmethods_t qpdb_cachemethods;
 
 /*%
@@ -519,6 +598,56 @@ update_header(qpcache_t *qpdb, dns_slabheader_t *header, isc_stdtime_t now) {
  * For zone databases the node for the origin of the zone MUST NOT be deleted.
  */
 
+/*
+ * Lock-free readers:
+ * The header chains hanging off a node are published with
+ * rcu_assign_pointer(), so find() and findrdataset() can walk them
+ * inside an RCU read-side critical section without taking the node
+ * lock.  Writers are still serialized by the node lock.  A header that
+ * has been unlinked from a live node is retired with retire_header():
+ * its bookkeeping is torn down right away, but the memory itself is only
+ * released after a grace period.
+ *
+ * A lock-free reader that binds a header to an rdataset must re-check
+ * the header with USABLE() after the node reference has been taken;
+ * headers are only freed when they are no longer usable and the node
+ * has no external references, so if the check still passes, the
+ * reference keeps the header alive.
+ */
+
+static void
+free_header_rcu(struct rcu_head *rcu_head) {
+	dns_slabheader_t *header = caa_container_of(rcu_head, dns_slabheader_t,
+						    rcu_head);
+	isc_mem_t *mctx = header->mctx;
+	unsigned int size;
+
+	if (NONEXISTENT(header)) {
+		size = sizeof(*header);
+	} else {
+		size = dns_rdataslab_size((unsigned char *)header,
+					  sizeof(*header));
+	}
+
+	isc_mem_putanddetach(&mctx, header, size);
+}
+
+/*
+ * Caller must be holding the node (write) lock.
+ */
+static void
+retire_header(dns_slabheader_t **headerp) {
+	dns_slabheader_t *header = *headerp;
+
+	*headerp = NULL;
+
+	dns_db_deletedata(header->db, header->node, header);
+
+	header->mctx = NULL;
+	isc_mem_attach(header->db->mctx, &header->mctx);
+	call_rcu(&header->rcu_head, free_header_rcu);
+}
+
 /*
  * DB Routines
  */
@@ -529,7 +658,7 @@ clean_stale_headers(dns_slabheader_t *top) {
 
 	for (d = top->down; d != NULL; d = down_next) {
 		down_next = d->down;
-		dns_slabheader_destroy(&d);
+		retire_header(&d);
 	}
 	top->down = NULL;
 }
@@ -553,11 +682,12 @@ clean_cache_node(qpcache_t *qpdb, qpcnode_t *node) {
 		    (STALE(current) && !KEEPSTALE(qpdb)))
 		{
 			if (top_prev != NULL) {
-				top_prev->next = current->next;
+				rcu_assign_pointer(top_prev->next,
+						   current->next);
 			} else {
-				node->data = current->next;
+				rcu_assign_pointer(node->data, current->next);
 			}
-			dns_slabheader_destroy(&current);
+			retire_header(&current);
 		} else {
 			top_prev = current;
 		}
@@ -1231,11 +1361,13 @@ check_stale_header(qpcnode_t *node, dns_slabheader_t *header,
 				 */
 				clean_stale_headers(header);
 				if (*header_prev != NULL) {
-					(*header_prev)->next = header->next;
+					rcu_assign_pointer((*header_prev)->next,
+							   header->next);
 				} else {
-					node->data = header->next;
+					rcu_assign_pointer(node->data,
+							   header->next);
 				}
-				dns_slabheader_destroy(&header);
+				retire_header(&header);
 			} else {
 				mark(header, DNS_SLABHEADERATTR_ANCIENT);
 				HEADERNODE(header)->dirty = 1;
@@ -1249,6 +1381,31 @@ check_stale_header(qpcnode_t *node, dns_slabheader_t *header,
 	return (false);
 }
 
+/*
+ * Return true if there is a DNAME or RRSIG DNAME rdataset at 'node',
+ * whatever its state.  No locks need to be held.
+ */
+static bool
+has_dname(qpcnode_t *node) {
+	dns_slabheader_t *header = NULL;
+	bool found = false;
+
+	rcu_read_lock();
+	for (header = rcu_dereference(node->data); header != NULL;
+	     header = rcu_dereference(header->next))
+	{
+		if (header->type == dns_rdatatype_dname ||
+		    header->type == DNS_SIGTYPE(dns_rdatatype_dname))
+		{
+			found = true;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	return (found);
+}
+
 static isc_result_t
 check_zonecut(qpcnode_t *node, void *arg DNS__DB_FLARG) {
 	qpc_search_t *search = arg;
@@ -1261,6 +1418,14 @@ check_zonecut(qpcnode_t *node, void *arg DNS__DB_FLARG) {
 
 	REQUIRE(search->zonecut == NULL);
 
+	/*
+	 * Most nodes above the query name have no DNAME; find that out
+	 * without taking the node lock.
+	 */
+	if (!has_dname(node)) {
+		return (DNS_R_CONTINUE);
+	}
+
 	lock = &(search->qpdb->node_locks[node->locknum].lock);
 	NODE_RDLOCK(lock, &nlocktype);
 
@@ -1532,6 +1697,392 @@ find_coveringnsec(qpc_search_t *search, const dns_name_t *name,
 	return (result);
 }
 
+/*
+ * Move the headers returned by a lookup that didn't hold the node lock
+ * to the head of the LRU list if they are due.  The LRU list is only
+ * updated every now and then, so taking the node lock for that doesn't
+ * hurt.
+ */
+static void
+update_headers(qpcache_t *qpdb, qpcnode_t *node, dns_slabheader_t *found,
+	       dns_slabheader_t *foundsig, isc_stdtime_t now) {
+	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	isc_rwlock_t *lock = &qpdb->node_locks[node->locknum].lock;
+
+	if (!need_headerupdate(found, now) &&
+	    (foundsig == NULL || !need_headerupdate(foundsig, now)))
+	{
+		return;
+	}
+
+	NODE_WRLOCK(lock, &nlocktype);
+	if (need_headerupdate(found, now)) {
+		update_header(qpdb, found, now);
+	}
+	if (foundsig != NULL && need_headerupdate(foundsig, now)) {
+		update_header(qpdb, foundsig, now);
+	}
+	NODE_UNLOCK(lock, &nlocktype);
+}
+
+/*
+ * Try to answer an exact match at 'node' without taking the node lock.
+ * This only handles the common case of a positive or negative answer
+ * for a specific type that is active and trusted enough; anything else
+ * (ANY queries, stale data when serve-stale is enabled, referrals and
+ * covering NSECs) returns DNS_R_CONTINUE, and the caller must repeat the
+ * search with the node lock held.
+ *
+ * The caller must be holding the tree (read) lock, which is what allows
+ * us to take the first external reference to the node.
+ *
+ * On success, the answer is also described in 'entry', so that the
+ * caller can remember it in the loop cache.
+ */
+static isc_result_t
+find_unlocked(qpc_search_t *search, qpcnode_t *node, dns_rdatatype_t type,
+	      bool cname_ok, dns_dbnode_t **nodep, dns_rdataset_t *rdataset,
+	      dns_rdataset_t *sigrdataset, qpc_lcentry_t *entry,
+	      isc_rwlocktype_t tlocktype DNS__DB_FLARG) {
+	qpcache_t *qpdb = search->qpdb;
+	dns_slabheader_t *header = NULL;
+	dns_slabheader_t *found = NULL, *foundsig = NULL, *cnamesig = NULL;
+	dns_typepair_t sigtype = DNS_SIGTYPE(type);
+	dns_typepair_t negtype = DNS_TYPEPAIR_VALUE(0, type);
+	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	uint32_t generation;
+	isc_result_t result;
+
+	REQUIRE(tlocktype != isc_rwlocktype_none);
+
+	if (type == dns_rdatatype_any || (nodep == NULL && rdataset == NULL)) {
+		return (DNS_R_CONTINUE);
+	}
+
+	/*
+	 * Read the generation before looking at the data, so that an
+	 * update that races with us invalidates the loop cache entry.
+	 */
+	generation = atomic_load_acquire(&node->generation);
+
+	rcu_read_lock();
+
+	for (header = rcu_dereference(node->data); header != NULL;
+	     header = rcu_dereference(header->next))
+	{
+		if (!ACTIVE(header, search->now)) {
+			if (KEEPSTALE(qpdb)) {
+				/*
+				 * Stale data needs the locked path to
+				 * decide whether it may be served.
+				 */
+				goto unlock;
+			}
+			continue;
+		}
+		if (!EXISTS(header) || ANCIENT(header)) {
+			continue;
+		}
+
+		if (header->type == type ||
+		    (cname_ok && header->type == dns_rdatatype_cname))
+		{
+			found = header;
+			if (header->type == dns_rdatatype_cname && cname_ok) {
+				if (cnamesig != NULL) {
+					foundsig = cnamesig;
+				} else {
+					sigtype = DNS_SIGTYPE(
+						dns_rdatatype_cname);
+				}
+			}
+		} else if (header->type == sigtype) {
+			foundsig = header;
+		} else if (header->type == RDATATYPE_NCACHEANY ||
+			   header->type == negtype)
+		{
+			found = header;
+		} else if (cname_ok &&
+			   header->type == DNS_SIGTYPE(dns_rdatatype_cname))
+		{
+			cnamesig = header;
+		}
+	}
+
+	if (found == NULL ||
+	    (DNS_TRUST_ADDITIONAL(found->trust) &&
+	     ((search->options & DNS_DBFIND_ADDITIONALOK) == 0)) ||
+	    (found->trust == dns_trust_glue &&
+	     ((search->options & DNS_DBFIND_GLUEOK) == 0)) ||
+	    (DNS_TRUST_PENDING(found->trust) &&
+	     ((search->options & DNS_DBFIND_PENDINGOK) == 0)))
+	{
+		goto unlock;
+	}
+
+	if (NEGATIVE(found)) {
+		foundsig = NULL;
+		if (NXDOMAIN(found)) {
+			result = DNS_R_NCACHENXDOMAIN;
+		} else {
+			result = DNS_R_NCACHENXRRSET;
+		}
+	} else if (type != found->type && found->type == dns_rdatatype_cname) {
+		result = DNS_R_CNAME;
+	} else {
+		result = ISC_R_SUCCESS;
+	}
+
+	if (nodep != NULL) {
+		newref(qpdb, node, nlocktype, tlocktype DNS__DB_FLARG_PASS);
+		*nodep = node;
+	}
+	bindrdataset(qpdb, node, found, search->now, nlocktype, tlocktype,
+		     rdataset DNS__DB_FLARG_PASS);
+	if (foundsig != NULL) {
+		bindrdataset(qpdb, node, foundsig, search->now, nlocktype,
+			     tlocktype, sigrdataset DNS__DB_FLARG_PASS);
+	}
+
+	/*
+	 * Now that we hold a node reference, make sure that the headers
+	 * were not retired in the meantime; if they were, undo the work
+	 * and let the caller do it under the lock.
+	 */
+	if (!USABLE(found, search->now) ||
+	    (foundsig != NULL && !USABLE(foundsig, search->now)))
+	{
+		rcu_read_unlock();
+		if (nodep != NULL) {
+			dns__db_detachnode((dns_db_t *)qpdb,
+					   nodep DNS__DB_FLARG_PASS);
+		}
+		if (rdataset != NULL && dns_rdataset_isassociated(rdataset)) {
+			dns_rdataset_disassociate(rdataset);
+		}
+		if (sigrdataset != NULL &&
+		    dns_rdataset_isassociated(sigrdataset))
+		{
+			dns_rdataset_disassociate(sigrdataset);
+		}
+		return (DNS_R_CONTINUE);
+	}
+
+	rcu_read_unlock();
+
+	update_headers(qpdb, node, found, foundsig, search->now);
+
+	*entry = (qpc_lcentry_t){
+		.node = node,
+		.header = found,
+		.sigheader = foundsig,
+		.generation = generation,
+		.type = type,
+		.options = search->options,
+		.result = result,
+	};
+
+	return (result);
+
+unlock:
+	rcu_read_unlock();
+	return (DNS_R_CONTINUE);
+}
+
+/*
+ * Drop a loop cache entry and the node reference it holds.
+ */
+static void
+loopcache_evict(qpcache_t *qpdb, qpc_loopcache_t *lc,
+		qpc_lcentry_t *entry DNS__DB_FLARG) {
+	dns_dbnode_t *node = (dns_dbnode_t *)entry->node;
+
+	*entry = (qpc_lcentry_t){ 0 };
+	atomic_fetch_sub_relaxed(&lc->used, 1);
+	detachnode((dns_db_t *)qpdb, &node DNS__DB_FLARG_PASS);
+}
+
+static void
+loopcache_clear(qpcache_t *qpdb, qpc_loopcache_t *lc DNS__DB_FLARG) {
+	for (uint32_t i = 0; i < lc->size; i++) {
+		if (lc->entries[i].node != NULL) {
+			loopcache_evict(qpdb, lc,
+					&lc->entries[i] DNS__DB_FLARG_PASS);
+		}
+	}
+}
+
+static void
+loopcache_flush(qpcache_t *qpdb, qpc_loopcache_t *lc DNS__DB_FLARG) {
+	loopcache_clear(qpdb, lc DNS__DB_FLARG_PASS);
+
+	if (lc->entries != NULL) {
+		isc_mem_cput(qpdb->common.mctx, lc->entries, lc->size,
+			     sizeof(lc->entries[0]));
+		lc->entries = NULL;
+	}
+	lc->size = 0;
+}
+
+/*
+ * Return the loop cache of the current loop, or NULL if the loop cache
+ * is disabled or we aren't running on one of the loops.  If the size
+ * of the loop caches has been changed since we last looked, the table
+ * is emptied and reallocated first.
+ */
+static qpc_loopcache_t *
+loopcache_get(qpcache_t *qpdb DNS__DB_FLARG) {
+	uint32_t tid = isc_tid();
+	qpc_loopcache_t *lc = NULL;
+	uint32_t size;
+
+	if (tid == ISC_TID_UNKNOWN || tid >= qpdb->node_lock_count) {
+		return (NULL);
+	}
+
+	lc = &qpdb->loopcaches[tid];
+	size = atomic_load_relaxed(&qpdb->loopcachesize);
+	if (size != lc->size) {
+		loopcache_flush(qpdb, lc DNS__DB_FLARG_PASS);
+		if (size != 0) {
+			lc->entries = isc_mem_cget(qpdb->common.mctx, size,
+						   sizeof(lc->entries[0]));
+			lc->size = size;
+		}
+	}
+
+	return (lc->size != 0 ? lc : NULL);
+}
+
+static uint32_t
+loopcache_hash(const dns_name_t *name, dns_rdatatype_t type) {
+	return (dns_name_hash(name) ^ ((uint32_t)type * 0x9e3779b1U));
+}
+
+/*
+ * Answer a lookup from the loop cache, if it's there.  The node
+ * reference held by the entry keeps the headers from being freed, so
+ * all we need to check is that they haven't been superseded or expired
+ * since the entry was made.  Returns DNS_R_CONTINUE on a miss, and the
+ * caller must do the full lookup.
+ */
+static isc_result_t
+loopcache_find(qpc_search_t *search, qpc_loopcache_t *lc, uint32_t hashval,
+	       const dns_name_t *name, dns_rdatatype_t type,
+	       dns_dbnode_t **nodep, dns_name_t *foundname,
+	       dns_rdataset_t *rdataset,
+	       dns_rdataset_t *sigrdataset DNS__DB_FLARG) {
+	qpcache_t *qpdb = search->qpdb;
+	qpc_lcentry_t *entry = &lc->entries[hashval & (lc->size - 1)];
+	qpcnode_t *node = entry->node;
+	isc_stdtime_t now = search->now;
+
+	if (node == NULL || entry->hashval != hashval || entry->type != type ||
+	    entry->options != search->options ||
+	    !dns_name_equal(&node->name, name))
+	{
+		goto miss;
+	}
+
+	rcu_read_lock();
+	if (atomic_load_acquire(&node->generation) != entry->generation ||
+	    atomic_load_acquire(&qpdb->dname_generation) !=
+		    entry->dname_generation ||
+	    !USABLE(entry->header, now) ||
+	    (entry->sigheader != NULL && !USABLE(entry->sigheader, now)))
+	{
+		rcu_read_unlock();
+		loopcache_evict(qpdb, lc, entry DNS__DB_FLARG_PASS);
+		goto miss;
+	}
+
+	if (nodep != NULL) {
+		newref(qpdb, node, isc_rwlocktype_none,
+		       isc_rwlocktype_none DNS__DB_FLARG_PASS);
+		*nodep = node;
+	}
+	bindrdataset(qpdb, node, entry->header, now, isc_rwlocktype_none,
+		     isc_rwlocktype_none, rdataset DNS__DB_FLARG_PASS);
+	if (entry->sigheader != NULL) {
+		bindrdataset(qpdb, node, entry->sigheader, now,
+			     isc_rwlocktype_none, isc_rwlocktype_none,
+			     sigrdataset DNS__DB_FLARG_PASS);
+	}
+	rcu_read_unlock();
+
+	if (foundname != NULL) {
+		dns_name_copy(&node->name, foundname);
+	}
+
+	update_headers(qpdb, node, entry->header, entry->sigheader, now);
+
+	atomic_fetch_add_relaxed(&lc->hits, 1);
+	return (entry->result);
+
+miss:
+	atomic_fetch_add_relaxed(&lc->misses, 1);
+	return (DNS_R_CONTINUE);
+}
+
+/*
+ * Remember the answer found by find_unlocked() in the loop cache,
+ * replacing whatever was in the slot before.  The caller must be
+ * holding a reference to the node, through 'nodep' or the rdataset.
+ */
+static void
+loopcache_insert(qpcache_t *qpdb, qpc_loopcache_t *lc, uint32_t hashval,
+		 const qpc_lcentry_t *new DNS__DB_FLARG) {
+	qpc_lcentry_t *entry = &lc->entries[hashval & (lc->size - 1)];
+
+	if (entry->node != NULL) {
+		loopcache_evict(qpdb, lc, entry DNS__DB_FLARG_PASS);
+	}
+
+	newref(qpdb, new->node, isc_rwlocktype_none,
+	       isc_rwlocktype_none DNS__DB_FLARG_PASS);
+	*entry = *new;
+	entry->hashval = hashval;
+	atomic_fetch_add_relaxed(&lc->used, 1);
+}
+
+/*
+ * Empty the loop cache of the current loop; scheduled by
+ * loopcache_flushall().  The table itself is kept.
+ */
+static void
+loopcache_flush_cb(void *arg) {
+	dns_db_t *db = arg;
+	qpcache_t *qpdb = (qpcache_t *)db;
+	qpc_loopcache_t *lc = &qpdb->loopcaches[isc_tid()];
+
+	loopcache_clear(qpdb, lc DNS__DB_FILELINE);
+	atomic_store_release(&lc->flushing, false);
+	dns_db_detach(&db);
+}
+
+/*
+ * Ask each loop that has anything in its loop cache to empty it.  The
+ * tables can only be touched by their own loops, so this is done
+ * asynchronously; a reference to the database is held until then.
+ */
+static void
+loopcache_flushall(qpcache_t *qpdb) {
+	for (uint32_t i = 0; i < qpdb->node_lock_count; i++) {
+		qpc_loopcache_t *lc = &qpdb->loopcaches[i];
+		dns_db_t *db = NULL;
+
+		if (atomic_load_relaxed(&lc->used) == 0 ||
+		    atomic_exchange_acq_rel(&lc->flushing, true))
+		{
+			continue;
+		}
+
+		dns_db_attach((dns_db_t *)qpdb, &db);
+		isc_async_run(isc_loop_get(qpdb->loopmgr, i),
+			      loopcache_flush_cb, db);
+	}
+}
+
 static isc_result_t
 find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
      dns_rdatatype_t type, unsigned int options, isc_stdtime_t now,
@@ -1554,6 +2105,10 @@ find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 	dns_slabheader_t *update = NULL, *updatesig = NULL;
 	dns_slabheader_t *nsecheader = NULL, *nsecsig = NULL;
 	dns_typepair_t sigtype, negtype;
+	qpc_loopcache_t *lc = NULL;
+	qpc_lcentry_t lcentry = { 0 };
+	uint32_t hashval = 0;
+	uint32_t dname_generation;
 
 	UNUSED(version);
 
@@ -1570,6 +2125,26 @@ find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 		.now = now,
 	};
 
+	/*
+	 * Popular names are usually answered from the loop cache,
+	 * without touching anything that is shared with other loops.
+	 */
+	if (type != dns_rdatatype_any && (nodep != NULL || rdataset != NULL)) {
+		lc = loopcache_get(search.qpdb DNS__DB_FLARG_PASS);
+	}
+	if (lc != NULL) {
+		hashval = loopcache_hash(name, type);
+		result = loopcache_find(&search, lc, hashval, name, type, nodep,
+					foundname, rdataset,
+					sigrdataset DNS__DB_FLARG_PASS);
+		if (result != DNS_R_CONTINUE) {
+			update_cachestats(search.qpdb, result);
+			return (result);
+		}
+	}
+
+	dname_generation = atomic_load_acquire(&search.qpdb->dname_generation);
+
 	TREE_RDLOCK(&search.qpdb->tree_lock, &tlocktype);
 
 	/*
@@ -1656,6 +2231,18 @@ find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 		cname_ok = false;
 	}
 
+	/*
+	 * Most lookups are cache hits; try to answer those without
+	 * locking the node.
+	 */
+	result = find_unlocked(&search, node, type, cname_ok, nodep, rdataset,
+			       sigrdataset, &lcentry,
+			       tlocktype DNS__DB_FLARG_PASS);
+	if (result != DNS_R_CONTINUE) {
+		lcentry.dname_generation = dname_generation;
+		goto tree_exit;
+	}
+
 	/*
 	 * We now go looking for rdata...
 	 */
@@ -1973,6 +2560,11 @@ tree_exit:
 		INSIST(tlocktype == isc_rwlocktype_none);
 	}
 
+	if (lc != NULL && lcentry.node != NULL) {
+		loopcache_insert(search.qpdb, lc, hashval,
+				 &lcentry DNS__DB_FLARG_PASS);
+	}
+
 	update_cachestats(search.qpdb, result);
 	return (result);
 }
@@ -2177,9 +2769,6 @@ findrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 		now = isc_stdtime_now();
 	}
 
-	lock = &qpdb->node_locks[qpnode->locknum].lock;
-	NODE_RDLOCK(lock, &nlocktype);
-
 	matchtype = DNS_TYPEPAIR_VALUE(type, covers);
 	negtype = DNS_TYPEPAIR_VALUE(0, type);
 	if (covers == 0) {
@@ -2188,6 +2777,56 @@ findrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 		sigmatchtype = 0;
 	}
 
+	/*
+	 * The caller holds a reference to the node, so none of its headers
+	 * can be freed under us and we don't need the node lock, unless
+	 * there is expired data that should be marked for cleaning.
+	 */
+	rcu_read_lock();
+	for (header = rcu_dereference(qpnode->data); header != NULL;
+	     header = rcu_dereference(header->next))
+	{
+		if (!ACTIVE(header, now)) {
+			if (!ANCIENT(header) &&
+			    header->ttl + STALE_TTL(header, qpdb) <
+				    now - QPDB_VIRTUAL)
+			{
+				break;
+			}
+		} else if (EXISTS(header) && !ANCIENT(header)) {
+			if (header->type == matchtype) {
+				found = header;
+			} else if (header->type == RDATATYPE_NCACHEANY ||
+				   header->type == negtype)
+			{
+				found = header;
+			} else if (header->type == sigmatchtype) {
+				foundsig = header;
+			}
+		}
+	}
+	if (header == NULL) {
+		if (found != NULL) {
+			bindrdataset(qpdb, qpnode, found, now, nlocktype,
+				     isc_rwlocktype_none,
+				     rdataset DNS__DB_FLARG_PASS);
+			if (!NEGATIVE(found) && foundsig != NULL) {
+				bindrdataset(qpdb, qpnode, foundsig, now,
+					     nlocktype, isc_rwlocktype_none,
+					     sigrdataset DNS__DB_FLARG_PASS);
+			}
+		}
+		rcu_read_unlock();
+		goto done;
+	}
+	rcu_read_unlock();
+
+	found = NULL;
+	foundsig = NULL;
+
+	lock = &qpdb->node_locks[qpnode->locknum].lock;
+	NODE_RDLOCK(lock, &nlocktype);
+
 	for (header = qpnode->data; header != NULL; header = header_next) {
 		header_next = header->next;
 		if (!ACTIVE(header, now)) {
@@ -2234,6 +2873,7 @@ findrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 
 	NODE_UNLOCK(lock, &nlocktype);
 
+done:
 	if (found == NULL) {
 		return (ISC_R_NOTFOUND);
 	}
@@ -2401,6 +3041,12 @@ overmem(qpcache_t *qpdb, dns_slabheader_t *newheader,
 	purgesize = 2 * (sizeof(qpcnode_t) +
 			 dns_name_size(&HEADERNODE(newheader)->name)) +
 		    rdataset_size(newheader) + 12288;
+
+	/*
+	 * The nodes held by the loop caches can't be freed, nor can
+	 * the headers on them that are purged below.
+	 */
+	loopcache_flushall(qpdb);
 again:
 	do {
 		isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
@@ -2521,6 +3167,15 @@ free_qpdb(qpcache_t *qpdb, bool log) {
 	isc_mem_cput(qpdb->common.mctx, qpdb->deadnodes, qpdb->node_lock_count,
 		     sizeof(qpdb->deadnodes[0]));
 
+	/*
+	 * Clean up loop caches; the entries are gone already.
+	 */
+	for (i = 0; i < qpdb->node_lock_count; i++) {
+		INSIST(qpdb->loopcaches[i].entries == NULL);
+	}
+	isc_mem_cput(qpdb->common.mctx, qpdb->loopcaches,
+		     qpdb->node_lock_count, sizeof(qpdb->loopcaches[0]));
+
 	/*
 	 * Clean up heap objects.
 	 */
@@ -2566,6 +3221,14 @@ qpdb_destroy(dns_db_t *arg) {
 		qpcnode_detach(&qpdb->origin_node);
 	}
 
+	/*
+	 * The loop cache entries hold node references of their own;
+	 * there is no one left to look them up, so drop them now.
+	 */
+	for (i = 0; i < qpdb->node_lock_count; i++) {
+		loopcache_flush(qpdb, &qpdb->loopcaches[i] DNS__DB_FILELINE);
+	}
+
 	/*
 	 * Even though there are no external direct references, there still
 	 * may be nodes in use.
@@ -3177,13 +3840,14 @@ find_header:
 			 * Since we don't generate changed records when
 			 * loading, we MUST clean up 'header' now.
 			 */
+			newheader->next = topheader->next;
 			if (topheader_prev != NULL) {
-				topheader_prev->next = newheader;
+				rcu_assign_pointer(topheader_prev->next,
+						   newheader);
 			} else {
-				qpnode->data = newheader;
+				rcu_assign_pointer(qpnode->data, newheader);
 			}
-			newheader->next = topheader->next;
-			dns_slabheader_destroy(&header);
+			retire_header(&header);
 		} else {
 			idx = HEADERNODE(newheader)->locknum;
 			INSIST(qpdb->heaps != NULL);
@@ -3197,13 +3861,14 @@ find_header:
 				ISC_LIST_PREPEND(qpdb->lru[idx], newheader,
 						 link);
 			}
+			newheader->next = topheader->next;
+			newheader->down = topheader;
 			if (topheader_prev != NULL) {
-				topheader_prev->next = newheader;
+				rcu_assign_pointer(topheader_prev->next,
+						   newheader);
 			} else {
-				qpnode->data = newheader;
+				rcu_assign_pointer(qpnode->data, newheader);
 			}
-			newheader->next = topheader->next;
-			newheader->down = topheader;
 			topheader->next = newheader;
 			qpnode->dirty = 1;
 			mark_ancient(header);
@@ -3244,13 +3909,14 @@ find_header:
 			 * we INSIST on it.
 			 */
 			INSIST(!loading);
+			newheader->next = topheader->next;
+			newheader->down = topheader;
 			if (topheader_prev != NULL) {
-				topheader_prev->next = newheader;
+				rcu_assign_pointer(topheader_prev->next,
+						   newheader);
 			} else {
-				qpnode->data = newheader;
+				rcu_assign_pointer(qpnode->data, newheader);
 			}
-			newheader->next = topheader->next;
-			newheader->down = topheader;
 			topheader->next = newheader;
 			qpnode->dirty = 1;
 		} else {
@@ -3262,15 +3928,15 @@ find_header:
 			if (prio_header(newheader)) {
 				/* This is a priority type, prepend it */
 				newheader->next = qpnode->data;
-				qpnode->data = newheader;
+				rcu_assign_pointer(qpnode->data, newheader);
 			} else if (prioheader != NULL) {
 				/* Append after the priority headers */
 				newheader->next = prioheader->next;
-				prioheader->next = newheader;
+				rcu_assign_pointer(prioheader->next, newheader);
 			} else {
 				/* There were no priority headers */
 				newheader->next = qpnode->data;
-				qpnode->data = newheader;
+				rcu_assign_pointer(qpnode->data, newheader);
 			}
 
 			if (overmaxtype(qpdb, ntypes)) {
@@ -3299,6 +3965,14 @@ find_header:
 		}
 	}
 
+	/*
+	 * Invalidate the loop cache entries that refer to this node.
+	 */
+	atomic_fetch_add_release(&qpnode->generation, 1);
+	if (newheader->type == dns_rdatatype_dname) {
+		atomic_fetch_add_release(&qpdb->dname_generation, 1);
+	}
+
 	if (addedrdataset != NULL) {
 		bindrdataset(qpdb, qpnode, newheader, now, nlocktype, tlocktype,
 			     addedrdataset DNS__DB_FLARG_PASS);
@@ -3727,6 +4401,12 @@ dns__qpcache_create(isc_mem_t *mctx, const dns_name_t *origin,
 		isc_queue_init(&qpdb->deadnodes[i]);
 	}
 
+	/*
+	 * Create the loop caches; they stay empty until a size is set.
+	 */
+	qpdb->loopcaches = isc_mem_cget(mctx, qpdb->node_lock_count,
+					sizeof(qpdb->loopcaches[0]));
+
 	qpdb->active = qpdb->node_lock_count;
 
 	for (i = 0; i < (int)(qpdb->node_lock_count); i++) {
@@ -4379,6 +5059,45 @@ setmaxtypepername(dns_db_t *db, uint32_t value) {
 	qpdb->maxtypepername = value;
 }
 
+static void
+setloopcache(dns_db_t *db, uint32_t size) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+	uint32_t entries = 0;
+
+	REQUIRE(VALID_QPDB(qpdb));
+
+	/*
+	 * The table is indexed by masking the hash value, so round the
+	 * size up to a power of two.
+	 */
+	if (size != 0) {
+		size = ISC_MIN(size, QPDB_LOOPCACHE_MAX);
+		for (entries = 1; entries < size; entries <<= 1) {
+			;
+		}
+	}
+
+	atomic_store_relaxed(&qpdb->loopcachesize, entries);
+}
+
+static isc_result_t
+getloopcachestats(dns_db_t *db, uint32_t tid, uint64_t *hitsp,
+		  uint64_t *missesp) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+
+	REQUIRE(VALID_QPDB(qpdb));
+	REQUIRE(hitsp != NULL && missesp != NULL);
+
+	if (tid >= qpdb->node_lock_count) {
+		return (ISC_R_RANGE);
+	}
+
+	*hitsp = atomic_load_relaxed(&qpdb->loopcaches[tid].hits);
+	*missesp = atomic_load_relaxed(&qpdb->loopcaches[tid].misses);
+
+	return (ISC_R_SUCCESS);
+}
+
 static dns_dbmethods_t qpdb_cachemethods = {
 	.destroy = qpdb_destroy,
 	.findnode = findnode,
@@ -4405,6 +5124,8 @@ static dns_dbmethods_t qpdb_cachemethods = {
 	.deletedata = deletedata,
 	.setmaxrrperset = setmaxrrperset,
 	.setmaxtypepername = setmaxtypepername,
+	.setloopcache = setloopcache,
+	.getloopcachestats = getloopcachestats,
 };
 
 static void
@@ -223,6 +223,7 @@ typedef struct {
 	dns_qp_t *tree;
 	dns_qp_t *nsec;
 	dns_qp_t *nsec3;
+	qpznode_t *last; /* most recent node in 'tree' */
 } qpz_load_t;
 
 static dns_dbmethods_t qpdb_zonemethods;
@@ -1649,7 +1650,18 @@ loading_addnode(qpz_load_t *loadctx, const dns_name_t *name,
 		return;
 	}
 
-	result = dns_qp_getname(loadctx->tree, name, (void **)&node, NULL);
+	/*
+	 * Zone files and zone transfers are mostly in order, so all the
+	 * rdatasets at a name usually arrive one after another.
+	 */
+	if (loadctx->last != NULL && dns_name_equal(name, &loadctx->last->name))
+	{
+		node = loadctx->last;
+		result = ISC_R_SUCCESS;
+	} else {
+		result = dns_qp_getname(loadctx->tree, name, (void **)&node,
+					NULL);
+	}
 	if (result == ISC_R_SUCCESS) {
 		if (type == dns_rdatatype_nsec &&
 		    node->nsec == DNS_DB_NSEC_HAS_NSEC)
@@ -1681,6 +1693,7 @@ loading_addnode(qpz_load_t *loadctx, const dns_name_t *name,
 	qpznode_detach(&nsecnode);
 
 done:
+	loadctx->last = node;
 	*nodep = node;
 }
 
@@ -2097,6 +2110,7 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	isc_region_t region;
 	dns_slabheader_t *newheader = NULL;
 	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	bool nsec3 = false, samename = false;
 
 	REQUIRE(rdataset->rdclass == qpdb->common.rdclass);
 
@@ -2109,9 +2123,16 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 		return (DNS_R_NOTZONETOP);
 	}
 
-	if (rdataset->type != dns_rdatatype_nsec3 &&
-	    rdataset->covers != dns_rdatatype_nsec3)
-	{
+	nsec3 = (rdataset->type == dns_rdatatype_nsec3 ||
+		 rdataset->covers == dns_rdatatype_nsec3);
+
+	/*
+	 * The wildcard nodes for a name only need to be set up once.
+	 */
+	samename = (!nsec3 && loadctx->last != NULL &&
+		    dns_name_equal(name, &loadctx->last->name));
+
+	if (!nsec3 && !samename) {
 		addwildcards(qpdb, loadctx->tree, name);
 	}
 
@@ -2130,7 +2151,9 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 			return (DNS_R_INVALIDNSEC3);
 		}
 
-		wildcardmagic(qpdb, loadctx->tree, name);
+		if (!samename) {
+			wildcardmagic(qpdb, loadctx->tree, name);
+		}
 	}
 
 	loading_addnode(loadctx, name, rdataset->type, rdataset->covers, &node);
@@ -2186,6 +2209,7 @@ loading_setup(void *arg) {
 	dns_qpmulti_write(qpdb->tree, &loadctx->tree);
 	dns_qpmulti_write(qpdb->nsec, &loadctx->nsec);
 	dns_qpmulti_write(qpdb->nsec3, &loadctx->nsec3);
+	loadctx->last = NULL;
 }
 
 static void
@@ -2193,6 +2217,7 @@ loading_commit(void *arg) {
 	qpz_load_t *loadctx = arg;
 	qpzonedb_t *qpdb = (qpzonedb_t *)loadctx->db;
 
+	loadctx->last = NULL;
 	if (loadctx->tree != NULL) {
 		dns_qp_compact(loadctx->tree, DNS_QPGC_MAYBE);
 		dns_qpmulti_commit(qpdb->tree, &loadctx->tree);
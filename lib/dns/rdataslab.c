@@ -126,6 +126,11 @@ static void
 rdataset_setownercase(dns_rdataset_t *rdataset, const dns_name_t *name);
 static void
 rdataset_getownercase(const dns_rdataset_t *rdataset, dns_name_t *name);
+static void
+rdata_from_slab(unsigned char **current, dns_rdataclass_t rdclass,
+		dns_rdatatype_t type, dns_rdata_t *rdata);
+
+static dns_rdatasetmethods_t bare_rdatasetmethods;
 
 /*% Note: the "const void *" are just to make qsort happy.  */
 static int
@@ -166,6 +171,33 @@ fillin_offsets(unsigned char *offsetbase, unsigned int *offsettable,
 }
 #endif /* if DNS_RDATASET_FIXED */
 
+/*
+ * A bare slab is already in DNSSEC order without duplicates, so it only
+ * needs to be checked against the limits and copied.
+ */
+static isc_result_t
+copy_bare(dns_rdataset_t *rdataset, isc_mem_t *mctx, isc_region_t *region,
+	  unsigned int reservelen, uint32_t maxrrperset) {
+	unsigned char *slab = rdataset->slab.raw;
+	unsigned int nitems = dns_rdataslab_count(slab, 0);
+	unsigned int length = dns_rdataslab_size(slab, 0);
+
+	if (maxrrperset > 0 && nitems > maxrrperset) {
+		return (DNS_R_TOOMANYRECORDS);
+	}
+
+	if (nitems > 1 && dns_rdatatype_issingleton(rdataset->type)) {
+		return (DNS_R_SINGLETON);
+	}
+
+	region->base = isc_mem_get(mctx, reservelen + length);
+	region->length = reservelen + length;
+	memset(region->base, 0, reservelen);
+	memmove(region->base + reservelen, slab, length);
+
+	return (ISC_R_SUCCESS);
+}
+
 isc_result_t
 dns_rdataslab_fromrdataset(dns_rdataset_t *rdataset, isc_mem_t *mctx,
 			   isc_region_t *region, unsigned int reservelen,
@@ -188,6 +220,11 @@ dns_rdataslab_fromrdataset(dns_rdataset_t *rdataset, isc_mem_t *mctx,
 	unsigned int *offsettable = NULL;
 #endif /* if DNS_RDATASET_FIXED */
 
+	if (rdataset->methods == &bare_rdatasetmethods) {
+		return (copy_bare(rdataset, mctx, region, reservelen,
+				  maxrrperset));
+	}
+
 	buflen = reservelen + 2;
 
 	nitems = dns_rdataset_count(rdataset);
@@ -415,6 +452,122 @@ dns_rdataslab_size(unsigned char *slab, unsigned int reservelen) {
 	return ((unsigned int)(current - slab));
 }
 
+isc_result_t
+dns_rdataslab_check(unsigned char *slab, unsigned int length,
+		    dns_rdataclass_t rdclass, dns_rdatatype_t type,
+		    isc_buffer_t *target, unsigned int *sizep) {
+	REQUIRE(slab != NULL);
+	REQUIRE(ISC_BUFFER_VALID(target));
+	REQUIRE(sizep != NULL);
+
+	unsigned char *current = slab;
+	unsigned char *end = slab + length;
+	unsigned int minlength = (type == dns_rdatatype_rrsig) ? 1 : 0;
+	dns_rdata_t prev = DNS_RDATA_INIT;
+	isc_result_t result;
+	uint16_t count;
+
+	if (length < 2) {
+		return (ISC_R_RANGE);
+	}
+	count = get_uint16(current);
+	if (count == 0) {
+		return (ISC_R_RANGE);
+	}
+
+#if DNS_RDATASET_FIXED
+	if ((size_t)(end - current) < 4 * (size_t)count) {
+		return (ISC_R_RANGE);
+	}
+	current += (4 * count);
+#endif /* if DNS_RDATASET_FIXED */
+
+	while (count-- > 0) {
+		unsigned int rdlength;
+
+		if (end - current < 2) {
+			return (ISC_R_RANGE);
+		}
+		rdlength = get_uint16(current);
+		if (rdlength < minlength) {
+			return (ISC_R_RANGE);
+		}
+#if DNS_RDATASET_FIXED
+		rdlength += 2;
+#endif /* if DNS_RDATASET_FIXED */
+		if (end - current < rdlength) {
+			return (ISC_R_RANGE);
+		}
+		current += rdlength;
+	}
+
+#if DNS_RDATASET_FIXED
+	/*
+	 * The load order table is only ever used to find the start of a
+	 * record, so make sure that each record it points to is in bounds.
+	 */
+	unsigned char *offsets = slab + 2;
+	count = peek_uint16(slab);
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned char *record = NULL;
+		uint32_t offset = ((uint32_t)offsets[0] << 24) +
+				  ((uint32_t)offsets[1] << 16) +
+				  ((uint32_t)offsets[2] << 8) + offsets[3];
+		offsets += 4;
+
+		if (offset < 2 + 4 * (uint32_t)count ||
+		    offset > (uint32_t)(current - slab) - 4)
+		{
+			return (ISC_R_RANGE);
+		}
+		record = slab + offset;
+		if (peek_uint16(record) < minlength ||
+		    current - record < 4 + peek_uint16(record))
+		{
+			return (ISC_R_RANGE);
+		}
+	}
+#endif /* if DNS_RDATASET_FIXED */
+
+	*sizep = (unsigned int)(current - slab);
+
+	/*
+	 * The slab is well formed, now check the rdata: each must be
+	 * valid for 'type', and they must be in DNSSEC order without
+	 * duplicates, as merging and subtracting slabs relies on that.
+	 */
+	current = slab;
+	count = get_uint16(current);
+#if DNS_RDATASET_FIXED
+	current += (4 * count);
+#endif /* if DNS_RDATASET_FIXED */
+
+	while (count-- > 0) {
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+		isc_buffer_t source;
+
+		rdata_from_slab(&current, rdclass, type, &rdata);
+
+		isc_buffer_init(&source, rdata.data, rdata.length);
+		isc_buffer_add(&source, rdata.length);
+		isc_buffer_setactive(&source, rdata.length);
+		isc_buffer_clear(target);
+		result = dns_rdata_fromwire(NULL, rdclass, type, &source,
+					    DNS_DECOMPRESS_NEVER, target);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+
+		if (prev.data != NULL && dns_rdata_compare(&prev, &rdata) >= 0)
+		{
+			return (DNS_R_FORMERR);
+		}
+		prev = rdata;
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
 unsigned int
 dns_rdataslab_rdatasize(unsigned char *slab, unsigned int reservelen) {
 	REQUIRE(slab != NULL);
@@ -1478,3 +1631,48 @@ rdataset_getownercase(const dns_rdataset_t *rdataset, dns_name_t *name) {
 unlock:
 	dns_db_unlocknode(header->db, header->node, isc_rwlocktype_read);
 }
+
+/*
+ * Bare slabs don't belong to any database, so there is no node to
+ * attach to or detach from, and no slab header to keep state in.
+ */
+static void
+bare_clone(dns_rdataset_t *source, dns_rdataset_t *target DNS__DB_FLARG) {
+	INSIST(!ISC_LINK_LINKED(target, link));
+	*target = *source;
+	ISC_LINK_INIT(target, link);
+
+	target->slab.iter_pos = NULL;
+	target->slab.iter_count = 0;
+}
+
+static dns_rdatasetmethods_t bare_rdatasetmethods = {
+	.first = rdataset_first,
+	.next = rdataset_next,
+	.current = rdataset_current,
+	.clone = bare_clone,
+	.count = rdataset_count,
+};
+
+void
+dns_rdataslab_tordataset(unsigned char *slab, dns_rdataclass_t rdclass,
+			 dns_rdatatype_t type, dns_rdatatype_t covers,
+			 dns_ttl_t ttl, dns_rdataset_t *rdataset) {
+	REQUIRE(slab != NULL);
+	REQUIRE(DNS_RDATASET_VALID(rdataset));
+	REQUIRE(!dns_rdataset_isassociated(rdataset));
+
+	*rdataset = (dns_rdataset_t){
+		.methods = &bare_rdatasetmethods,
+		.rdclass = rdclass,
+		.type = type,
+		.covers = covers,
+		.ttl = ttl,
+		.slab.raw = slab,
+
+		.link = rdataset->link,
+		.count = rdataset->count,
+		.attributes = rdataset->attributes,
+		.magic = rdataset->magic,
+	};
+}
@@ -37,6 +37,7 @@
 #include <isc/time.h>
 #include <isc/timer.h>
 #include <isc/util.h>
+#include <isc/work.h>
 
 #include <dns/acl.h>
 #include <dns/adb.h>
@@ -69,11 +70,14 @@
 #include <dns/rdatatype.h>
 #include <dns/resolver.h>
 #include <dns/rootns.h>
+#include <dns/sigcache.h>
 #include <dns/stats.h>
 #include <dns/tsig.h>
 #include <dns/validator.h>
 #include <dns/zone.h>
 
+#include "probes.h"
+
 #ifdef WANT_QUERYTRACE
 #define RTRACE(m)                                                             \
 	isc_log_write(dns_lctx, DNS_LOGCATEGORY_RESOLVER,                     \
@@ -232,6 +236,11 @@ STATIC_ASSERT(NS_PROCESSING_LIMIT > NS_RR_LIMIT,
 #define RES_DOMAIN_HASH_BITS 12
 #endif /* ifndef RES_DOMAIN_HASH_BITS */
 
+/* Number of verified signatures remembered by the validator */
+#ifndef RES_SIGCACHE_SIZE
+#define RES_SIGCACHE_SIZE 16384
+#endif /* ifndef RES_SIGCACHE_SIZE */
+
 /*%
  * Maximum EDNS0 input packet size.
  */
@@ -326,6 +335,56 @@ struct fctxcount {
 	isc_stdtime_t logged;
 };
 
+/*%
+ * Sampled fetch tracing.  While it is enabled, one in every 'tracerate'
+ * fetch contexts records when it reached each stage of the resolution,
+ * in microseconds since it was created.  Finished traces are kept in a
+ * small ring per loop, so that the loops never contend with each other
+ * when saving them, until they are dumped.
+ */
+#define RES_TRACE_RINGSIZE 64
+
+typedef enum {
+	fetchstage_create = 0,
+	fetchstage_addrfind,
+	fetchstage_addrdone,
+	fetchstage_send,
+	fetchstage_recv,
+	fetchstage_validate,
+	fetchstage_validated,
+	fetchstage_cache,
+	fetchstage_done,
+	fetchstage_max
+} fetchstage_t;
+
+static const char *fetchstage_names[fetchstage_max] = {
+	[fetchstage_create] = "create",
+	[fetchstage_addrfind] = "addrfind",
+	[fetchstage_addrdone] = "addrdone",
+	[fetchstage_send] = "send",
+	[fetchstage_recv] = "recv",
+	[fetchstage_validate] = "validate",
+	[fetchstage_validated] = "validated",
+	[fetchstage_cache] = "cache",
+	[fetchstage_done] = "done",
+};
+
+typedef struct fetchtrace {
+	char info[DNS_NAME_FORMATSIZE + DNS_RDATATYPE_FORMATSIZE + 1];
+	isc_result_t result;
+	isc_nanosecs_t start;
+	uint32_t first[fetchstage_max]; /*%< usecs since 'start' */
+	uint32_t last[fetchstage_max];
+	uint32_t count[fetchstage_max];
+} fetchtrace_t;
+
+typedef struct restracering {
+	isc_mutex_t lock;
+	fetchtrace_t *traces; /*%< Allocated on first use. */
+	unsigned int next;
+	unsigned int count;
+} restracering_t;
+
 struct fetchctx {
 	/*% Not locked. */
 	unsigned int magic;
@@ -453,6 +512,7 @@ struct fetchctx {
 	isc_time_t start;
 	uint64_t duration;
 	bool logged;
+	fetchtrace_t *trace; /*%< Sampled stage timing, or NULL. */
 	unsigned int querysent;
 	unsigned int referrals;
 	unsigned int lamecount;
@@ -531,6 +591,38 @@ typedef struct alternate {
 	ISC_LINK(struct alternate) link;
 } alternate_t;
 
+/*%
+ * Signature verifications waiting to be run on the offload threads.
+ * Each loop collects the verifications queued by its validators and hands
+ * them to the thread pool together, so that the cost of a thread pool
+ * round trip is shared by the batch.  A flush is split into about as many
+ * batches as there are offload threads (one per loop), but no batch is
+ * larger than RES_VERIFYBATCH, so that a burst isn't verified serially
+ * on one thread while the others are idle.
+ */
+#define RES_VERIFYBATCH 32
+
+typedef struct resverify resverify_t;
+struct resverify {
+	isc_work_cb work_cb;
+	isc_after_work_cb after_work_cb;
+	void *cbarg;
+	ISC_LINK(resverify_t) link;
+};
+
+typedef ISC_LIST(resverify_t) resverifylist_t;
+
+typedef struct resverifyqueue {
+	resverifylist_t verifies;
+	size_t count;
+	bool scheduled;
+} resverifyqueue_t;
+
+typedef struct resverifybatch {
+	dns_resolver_t *res;
+	resverifylist_t verifies;
+} resverifybatch_t;
+
 struct dns_resolver {
 	/* Unlocked. */
 	unsigned int magic;
@@ -581,11 +673,13 @@ struct dns_resolver {
 
 	atomic_uint_fast32_t maxvalidations;
 	atomic_uint_fast32_t maxvalidationfails;
+	atomic_uint_fast32_t tracerate; /* fetch tracing, 0 is off */
 
 	/* Locked by lock. */
 	unsigned int spillat; /* clients-per-query */
 
 	dns_badcache_t *badcache; /* Bad cache. */
+	dns_sigcache_t *sigcache; /* Verified signature cache. */
 
 	/* Locked by primelock. */
 	dns_fetch_t *primefetch;
@@ -597,6 +691,9 @@ struct dns_resolver {
 
 	isc_mempool_t **namepools;
 	isc_mempool_t **rdspools;
+
+	resverifyqueue_t *verifyqueues;
+	restracering_t *tracerings;
 };
 
 #define RES_MAGIC	    ISC_MAGIC('R', 'e', 's', '!')
@@ -956,6 +1053,84 @@ set_stats(dns_resolver_t *res, isc_statscounter_t counter, uint64_t val) {
 	}
 }
 
+/*%
+ * Fetch tracing: see the comment above fetchtrace_t.  The USDT probes
+ * fire for every fetch, whether or not it was sampled.
+ */
+static void
+fctx_tracestart(fetchctx_t *fctx) {
+	uint32_t rate = atomic_load_relaxed(&fctx->res->tracerate);
+
+	LIBDNS_RESOLVER_FETCH_CREATE(fctx, fctx->info);
+
+	if (rate == 0 || isc_random_uniform(rate) != 0) {
+		return;
+	}
+
+	fctx->trace = isc_mem_get(fctx->mctx, sizeof(*fctx->trace));
+	*fctx->trace = (fetchtrace_t){
+		.result = ISC_R_FAILURE,
+		.start = isc_time_monotonic(),
+	};
+	strlcpy(fctx->trace->info, fctx->info, sizeof(fctx->trace->info));
+	fctx->trace->count[fetchstage_create] = 1;
+}
+
+static void
+trace_mark(fetchtrace_t *trace, fetchstage_t stage) {
+	uint32_t usecs = (isc_time_monotonic() - trace->start) / NS_PER_US;
+
+	if (trace->count[stage]++ == 0) {
+		trace->first[stage] = usecs;
+	}
+	trace->last[stage] = usecs;
+}
+
+static void
+fctx_trace(fetchctx_t *fctx, fetchstage_t stage) {
+	LIBDNS_RESOLVER_FETCH_STAGE(fctx, fctx->info,
+				    (char *)fetchstage_names[stage]);
+
+	if (fctx->trace != NULL) {
+		trace_mark(fctx->trace, stage);
+	}
+}
+
+/*%
+ * Save the finished trace of 'fctx' in the ring of the loop it ran on.
+ */
+static void
+fctx_tracedone(fetchctx_t *fctx, isc_result_t result) {
+	dns_resolver_t *res = fctx->res;
+	fetchtrace_t *trace = fctx->trace;
+	restracering_t *ring = NULL;
+
+	LIBDNS_RESOLVER_FETCH_DONE(fctx, fctx->info, result);
+
+	if (trace == NULL) {
+		return;
+	}
+
+	trace_mark(trace, fetchstage_done);
+	trace->result = result;
+
+	ring = &res->tracerings[fctx->tid];
+	LOCK(&ring->lock);
+	if (ring->traces == NULL) {
+		ring->traces = isc_mem_cget(res->mctx, RES_TRACE_RINGSIZE,
+					    sizeof(ring->traces[0]));
+	}
+	ring->traces[ring->next] = *trace;
+	ring->next = (ring->next + 1) % RES_TRACE_RINGSIZE;
+	if (ring->count < RES_TRACE_RINGSIZE) {
+		ring->count++;
+	}
+	UNLOCK(&ring->lock);
+
+	isc_mem_put(fctx->mctx, trace, sizeof(*trace));
+	fctx->trace = NULL;
+}
+
 static isc_result_t
 valcreate(fetchctx_t *fctx, dns_message_t *message, dns_adbaddrinfo_t *addrinfo,
 	  dns_name_t *name, dns_rdatatype_t type, dns_rdataset_t *rdataset,
@@ -964,6 +1139,8 @@ valcreate(fetchctx_t *fctx, dns_message_t *message, dns_adbaddrinfo_t *addrinfo,
 	dns_valarg_t *valarg = NULL;
 	isc_result_t result;
 
+	fctx_trace(fctx, fetchstage_validate);
+
 	valarg = isc_mem_get(fctx->mctx, sizeof(*valarg));
 	*valarg = (dns_valarg_t){
 		.addrinfo = addrinfo,
@@ -1669,6 +1846,8 @@ fctx__done(fetchctx_t *fctx, isc_result_t result, const char *func,
 	FCTX_ATTR_CLR(fctx, FCTX_ATTR_ADDRWAIT);
 	UNLOCK(&fctx->lock);
 
+	fctx_tracedone(fctx, result);
+
 	if (result == ISC_R_SUCCESS) {
 		if (fctx->qmin_warning != ISC_R_SUCCESS) {
 			isc_log_write(dns_lctx, DNS_LOGCATEGORY_LAME_SERVERS,
@@ -2334,6 +2513,8 @@ resquery_send(resquery_t *query) {
 
 	QTRACE("send");
 
+	fctx_trace(fctx, fetchstage_send);
+
 	if (atomic_load_acquire(&res->exiting)) {
 		FCTXTRACE("resquery_send: resolver shutting down");
 		return (ISC_R_SHUTTINGDOWN);
@@ -2887,6 +3068,8 @@ fctx_finddone(void *arg) {
 
 	REQUIRE(fctx->tid == isc_tid());
 
+	fctx_trace(fctx, fetchstage_addrdone);
+
 	LOCK(&fctx->lock);
 	pending = atomic_fetch_sub_release(&fctx->pending, 1);
 	INSIST(pending > 0);
@@ -3987,9 +4170,11 @@ fctx_try(fetchctx_t *fctx, bool retrying, bool badcache) {
 		/* We have no more addresses.  Start over. */
 		fctx_cancelqueries(fctx, true, false);
 		fctx_cleanup(fctx);
+		fctx_trace(fctx, fetchstage_addrfind);
 		result = fctx_getaddresses(fctx, badcache);
 		switch (result) {
 		case ISC_R_SUCCESS:
+			fctx_trace(fctx, fetchstage_addrdone);
 			break;
 		case DNS_R_WAIT:
 			/* Sleep waiting for addresses. */
@@ -4318,6 +4503,9 @@ fctx_destroy(fetchctx_t *fctx) {
 
 	isc_mutex_destroy(&fctx->lock);
 
+	if (fctx->trace != NULL) {
+		isc_mem_put(fctx->mctx, fctx->trace, sizeof(*fctx->trace));
+	}
 	isc_mem_free(fctx->mctx, fctx->info);
 	isc_mem_putanddetach(&fctx->mctx, fctx, sizeof(*fctx));
 }
@@ -4703,6 +4891,8 @@ fctx_create(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 
 	isc_timer_create(fctx->loop, fctx_expired, fctx, &fctx->timer);
 
+	fctx_tracestart(fctx);
+
 	*fctxp = fctx;
 
 	return (ISC_R_SUCCESS);
@@ -5104,6 +5294,8 @@ validated(void *arg) {
 
 	FCTXTRACE("received validation completion event");
 
+	fctx_trace(fctx, fetchstage_validated);
+
 	res = fctx->res;
 	addrinfo = valarg->addrinfo;
 
@@ -6229,6 +6421,8 @@ cache_message(fetchctx_t *fctx, dns_message_t *message,
 
 	FCTX_ATTR_CLR(fctx, FCTX_ATTR_WANTCACHE);
 
+	fctx_trace(fctx, fetchstage_cache);
+
 	LOCK(&fctx->lock);
 
 	for (section = DNS_SECTION_ANSWER; section <= DNS_SECTION_ADDITIONAL;
@@ -6340,6 +6534,8 @@ ncache_message(fetchctx_t *fctx, dns_message_t *message,
 
 	FCTX_ATTR_CLR(fctx, FCTX_ATTR_WANTNCACHE);
 
+	fctx_trace(fctx, fetchstage_cache);
+
 	POST(need_validation);
 
 	/*
@@ -7249,6 +7445,8 @@ resquery_response(isc_result_t eresult, isc_region_t *region, void *arg) {
 
 	QTRACE("response");
 
+	fctx_trace(fctx, fetchstage_recv);
+
 	if (isc_sockaddr_pf(&query->addrinfo->sockaddr) == PF_INET) {
 		inc_stats(fctx->res, dns_resstatscounter_responsev4);
 	} else {
@@ -9862,12 +10060,24 @@ dns_resolver__destroy(dns_resolver_t *res) {
 		isc_mem_put(res->mctx, a, sizeof(*a));
 	}
 	dns_badcache_destroy(&res->badcache);
+	dns_sigcache_destroy(&res->sigcache);
 
 	dns_view_weakdetach(&res->view);
 
 	for (size_t i = 0; i < res->nloops; i++) {
 		dns_message_destroypools(&res->namepools[i], &res->rdspools[i]);
-	}
+		INSIST(ISC_LIST_EMPTY(res->verifyqueues[i].verifies));
+		if (res->tracerings[i].traces != NULL) {
+			isc_mem_cput(res->mctx, res->tracerings[i].traces,
+				     RES_TRACE_RINGSIZE,
+				     sizeof(res->tracerings[i].traces[0]));
+		}
+		isc_mutex_destroy(&res->tracerings[i].lock);
+	}
+	isc_mem_cput(res->mctx, res->tracerings, res->nloops,
+		     sizeof(res->tracerings[0]));
+	isc_mem_cput(res->mctx, res->verifyqueues, res->nloops,
+		     sizeof(res->verifyqueues[0]));
 	isc_mem_cput(res->mctx, res->rdspools, res->nloops,
 		     sizeof(res->rdspools[0]));
 	isc_mem_cput(res->mctx, res->namepools, res->nloops,
@@ -9956,6 +10166,7 @@ dns_resolver_create(dns_view_t *view, isc_loopmgr_t *loopmgr, isc_nm_t *nm,
 	isc_refcount_init(&res->references, 1);
 
 	res->badcache = dns_badcache_new(res->mctx);
+	res->sigcache = dns_sigcache_new(res->mctx, RES_SIGCACHE_SIZE);
 
 	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS, &res->fctxs);
 	isc_rwlock_init(&res->fctxs_lock);
@@ -9995,6 +10206,15 @@ dns_resolver_create(dns_view_t *view, isc_loopmgr_t *loopmgr, isc_nm_t *nm,
 					&res->rdspools[i]);
 	}
 
+	res->verifyqueues = isc_mem_cget(res->mctx, res->nloops,
+					 sizeof(res->verifyqueues[0]));
+
+	res->tracerings = isc_mem_cget(res->mctx, res->nloops,
+				       sizeof(res->tracerings[0]));
+	for (size_t i = 0; i < res->nloops; i++) {
+		isc_mutex_init(&res->tracerings[i].lock);
+	}
+
 	res->magic = RES_MAGIC;
 
 	*resp = res;
@@ -10686,6 +10906,38 @@ dns_resolver_printbadcache(dns_resolver_t *resolver, FILE *fp) {
 	(void)dns_badcache_print(resolver->badcache, "Bad cache", fp);
 }
 
+void
+dns_resolver_addsigcache(dns_resolver_t *resolver, const unsigned char *digest,
+			 isc_stdtime_t inception, isc_stdtime_t expire) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	dns_sigcache_add(resolver->sigcache, digest, inception, expire);
+}
+
+isc_result_t
+dns_resolver_getsigcache(dns_resolver_t *resolver, const unsigned char *digest,
+			 isc_stdtime_t now) {
+	isc_result_t result;
+
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	result = dns_sigcache_find(resolver->sigcache, digest, now);
+	if (result == ISC_R_SUCCESS) {
+		inc_stats(resolver, dns_resstatscounter_sigcachehit);
+	} else {
+		inc_stats(resolver, dns_resstatscounter_sigcachemiss);
+	}
+
+	return (result);
+}
+
+void
+dns_resolver_flushsigcache(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	dns_sigcache_flush(resolver->sigcache);
+}
+
 isc_result_t
 dns_resolver_disable_algorithm(dns_resolver_t *resolver, const dns_name_t *name,
 			       unsigned int alg) {
@@ -10757,6 +11009,111 @@ dns_resolver_getmustbesecure(dns_resolver_t *resolver, const dns_name_t *name) {
 	return (dns_nametree_covered(resolver->mustbesecure, name, NULL, 0));
 }
 
+static void
+verify_batch_work(void *arg) {
+	resverifybatch_t *batch = arg;
+	resverify_t *verify = NULL;
+
+	ISC_LIST_FOREACH (batch->verifies, verify, link) {
+		verify->work_cb(verify->cbarg);
+	}
+}
+
+static void
+verify_batch_done(void *arg) {
+	resverifybatch_t *batch = arg;
+	dns_resolver_t *res = batch->res;
+	resverify_t *verify = NULL;
+
+	while ((verify = ISC_LIST_HEAD(batch->verifies)) != NULL) {
+		ISC_LIST_UNLINK(batch->verifies, verify, link);
+		verify->after_work_cb(verify->cbarg);
+		isc_mem_put(res->mctx, verify, sizeof(*verify));
+	}
+
+	isc_mem_put(res->mctx, batch, sizeof(*batch));
+	dns_resolver_detach(&res);
+}
+
+static void
+verify_flush(void *arg) {
+	dns_resolver_t *res = arg;
+	resverifyqueue_t *queue = &res->verifyqueues[isc_tid()];
+	size_t size = (queue->count + res->nloops - 1) / res->nloops;
+
+	size = ISC_MIN(ISC_MAX(size, 1), RES_VERIFYBATCH);
+
+	while (!ISC_LIST_EMPTY(queue->verifies)) {
+		resverifybatch_t *batch = isc_mem_get(res->mctx,
+						      sizeof(*batch));
+		uint64_t n = 0;
+
+		*batch = (resverifybatch_t){
+			.verifies = ISC_LIST_INITIALIZER,
+		};
+		dns_resolver_attach(res, &batch->res);
+
+		while (n < size && !ISC_LIST_EMPTY(queue->verifies)) {
+			resverify_t *verify = ISC_LIST_HEAD(queue->verifies);
+			ISC_LIST_UNLINK(queue->verifies, verify, link);
+			ISC_LIST_APPEND(batch->verifies, verify, link);
+			queue->count--;
+			dec_stats(res, dns_resstatscounter_verifyqueued);
+			inc_stats(res, dns_resstatscounter_verifybatched);
+			n++;
+		}
+
+		inc_stats(res, dns_resstatscounter_verifybatches);
+		if (res->stats != NULL) {
+			isc_stats_update_if_greater(
+				res->stats, dns_resstatscounter_verifybatchmax,
+				n);
+		}
+
+		isc_work_enqueue(isc_loop(), verify_batch_work,
+				 verify_batch_done, batch);
+	}
+
+	queue->scheduled = false;
+	dns_resolver_detach(&res);
+}
+
+void
+dns_resolver_verify(dns_resolver_t *resolver, isc_work_cb work_cb,
+		    isc_after_work_cb after_work_cb, void *cbarg) {
+	resverifyqueue_t *queue = NULL;
+	resverify_t *verify = NULL;
+
+	REQUIRE(VALID_RESOLVER(resolver));
+	REQUIRE(isc_tid() < resolver->nloops);
+	REQUIRE(work_cb != NULL);
+	REQUIRE(after_work_cb != NULL);
+
+	queue = &resolver->verifyqueues[isc_tid()];
+
+	verify = isc_mem_get(resolver->mctx, sizeof(*verify));
+	*verify = (resverify_t){
+		.work_cb = work_cb,
+		.after_work_cb = after_work_cb,
+		.cbarg = cbarg,
+		.link = ISC_LINK_INITIALIZER,
+	};
+	ISC_LIST_APPEND(queue->verifies, verify, link);
+	queue->count++;
+	inc_stats(resolver, dns_resstatscounter_verifyqueued);
+
+	/*
+	 * Let the loop finish what it is doing first, so that the
+	 * verifications queued meanwhile by other validators on this
+	 * loop end up in the same batch.
+	 */
+	if (!queue->scheduled) {
+		queue->scheduled = true;
+		isc_async_run(isc_loop(), verify_flush,
+			      dns_resolver_ref(resolver));
+	}
+}
+
 void
 dns_resolver_getclientsperquery(dns_resolver_t *resolver, uint32_t *cur,
 				uint32_t *min, uint32_t *max) {
@@ -10964,6 +11321,82 @@ cleanup:
 	return (result);
 }
 
+void
+dns_resolver_setfetchtrace(dns_resolver_t *resolver, uint32_t rate) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	atomic_store_relaxed(&resolver->tracerate, rate);
+}
+
+uint32_t
+dns_resolver_getfetchtrace(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	return (atomic_load_relaxed(&resolver->tracerate));
+}
+
+static isc_result_t
+dumptrace(const fetchtrace_t *trace, isc_buffer_t **buf) {
+	isc_result_t result;
+	char text[DNS_NAME_FORMATSIZE + BUFSIZ];
+	size_t len;
+
+	snprintf(text, sizeof(text), "\n- %s: %s, %" PRIu32 " us:",
+		 trace->info, isc_result_totext(trace->result),
+		 trace->last[fetchstage_done]);
+
+	for (size_t i = 0; i < fetchstage_max; i++) {
+		len = strlen(text);
+		if (trace->count[i] == 0) {
+			continue;
+		} else if (trace->count[i] == 1) {
+			snprintf(text + len, sizeof(text) - len, " %s %" PRIu32,
+				 fetchstage_names[i], trace->first[i]);
+		} else {
+			snprintf(text + len, sizeof(text) - len,
+				 " %s %" PRIu32 "..%" PRIu32 " (x%" PRIu32 ")",
+				 fetchstage_names[i], trace->first[i],
+				 trace->last[i], trace->count[i]);
+		}
+	}
+
+	result = isc_buffer_reserve(*buf, strlen(text));
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	isc_buffer_putstr(*buf, text);
+
+	return (ISC_R_SUCCESS);
+}
+
+isc_result_t
+dns_resolver_dumpfetchtrace(dns_resolver_t *res, isc_buffer_t **buf) {
+	isc_result_t result = ISC_R_SUCCESS;
+
+	REQUIRE(VALID_RESOLVER(res));
+	REQUIRE(buf != NULL && *buf != NULL);
+
+	for (size_t i = 0; i < res->nloops && result == ISC_R_SUCCESS; i++) {
+		restracering_t *ring = &res->tracerings[i];
+
+		LOCK(&ring->lock);
+		for (unsigned int n = 0; n < ring->count; n++) {
+			/* Oldest first */
+			unsigned int slot = (ring->next + RES_TRACE_RINGSIZE -
+					     ring->count + n) %
+					    RES_TRACE_RINGSIZE;
+
+			result = dumptrace(&ring->traces[slot], buf);
+			if (result != ISC_R_SUCCESS) {
+				break;
+			}
+		}
+		UNLOCK(&ring->lock);
+	}
+
+	return (result);
+}
+
 void
 dns_resolver_setquotaresponse(dns_resolver_t *resolver, dns_quotatype_t which,
 			      isc_result_t resp) {
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/atomic.h>
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/region.h>
+#include <isc/string.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdataclass.h>
+#include <dns/rdatatype.h>
+#include <dns/respcache.h>
+#include <dns/types.h>
+
+typedef struct dns_rcentry dns_rcentry_t;
+
+struct dns_respcache {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	struct cds_lfht *ht;
+	size_t maxsize;
+	atomic_size_t size;
+};
+
+#define RESPCACHE_MAGIC	   ISC_MAGIC('R', 's', 'p', 'C')
+#define VALID_RESPCACHE(m) ISC_MAGIC_VALID(m, RESPCACHE_MAGIC)
+
+#define RESPCACHE_INIT_SIZE (1 << 10) /* Must be power of 2 */
+#define RESPCACHE_MIN_SIZE  (1 << 8)  /* Must be power of 2 */
+
+/*%
+ * Number of entries evicted to make room for a new one.
+ */
+#define RESPCACHE_EVICT 8
+
+struct dns_rcentry {
+	isc_mem_t *mctx;
+	dns_zone_t *zone; /* not attached, compared only */
+	uint32_t generation;
+	dns_rdatatype_t qtype;
+	dns_rdataclass_t qclass;
+	unsigned int flags;
+	uint16_t bufsize;
+	bool complete;
+	dns_fixedname_t fname;
+	dns_name_t *name;
+
+	struct cds_lfht_node ht_node;
+	struct rcu_head rcu_head;
+
+	unsigned int length;
+	unsigned char wire[];
+};
+
+#define RCENTRY_SIZE(length) (sizeof(dns_rcentry_t) + (length))
+
+static void
+rcentry_destroy(struct rcu_head *rcu_head);
+
+dns_respcache_t *
+dns_respcache_new(isc_mem_t *mctx, size_t maxsize) {
+	REQUIRE(mctx != NULL);
+	REQUIRE(maxsize > 0);
+
+	dns_respcache_t *rc = isc_mem_get(mctx, sizeof(*rc));
+	*rc = (dns_respcache_t){
+		.magic = RESPCACHE_MAGIC,
+		.maxsize = maxsize,
+	};
+
+	rc->ht = cds_lfht_new(RESPCACHE_INIT_SIZE, RESPCACHE_MIN_SIZE, 0,
+			      CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	INSIST(rc->ht != NULL);
+
+	isc_mem_attach(mctx, &rc->mctx);
+
+	return (rc);
+}
+
+static void
+rcentry_flush(dns_respcache_t *rc, struct cds_lfht *ht) {
+	dns_rcentry_t *entry = NULL;
+	struct cds_lfht_iter iter;
+
+	cds_lfht_for_each_entry(ht, &iter, entry, ht_node) {
+		INSIST(!cds_lfht_del(ht, &entry->ht_node));
+		atomic_fetch_sub_relaxed(&rc->size,
+					 RCENTRY_SIZE(entry->length));
+		rcentry_destroy(&entry->rcu_head);
+	}
+	RUNTIME_CHECK(!cds_lfht_destroy(ht, NULL));
+}
+
+void
+dns_respcache_destroy(dns_respcache_t **rcp) {
+	REQUIRE(rcp != NULL && *rcp != NULL);
+	REQUIRE(VALID_RESPCACHE(*rcp));
+
+	dns_respcache_t *rc = *rcp;
+	*rcp = NULL;
+	rc->magic = 0;
+
+	rcentry_flush(rc, rc->ht);
+
+	isc_mem_putanddetach(&rc->mctx, rc, sizeof(dns_respcache_t));
+}
+
+static int
+rcentry_match(struct cds_lfht_node *ht_node, const void *key) {
+	const dns_name_t *name = key;
+	dns_rcentry_t *entry = caa_container_of(ht_node, dns_rcentry_t,
+						ht_node);
+
+	return (dns_name_equal(entry->name, name));
+}
+
+static void
+rcentry_destroy(struct rcu_head *rcu_head) {
+	dns_rcentry_t *entry = caa_container_of(rcu_head, dns_rcentry_t,
+						rcu_head);
+
+	isc_mem_putanddetach(&entry->mctx, entry, RCENTRY_SIZE(entry->length));
+}
+
+static void
+rcentry_evict(dns_respcache_t *rc, struct cds_lfht *ht, dns_rcentry_t *entry) {
+	/*
+	 * Only the thread that actually removed the entry from the
+	 * hashtable gets to destroy it; see bcentry_evict().
+	 */
+	if (!cds_lfht_del(ht, &entry->ht_node)) {
+		atomic_fetch_sub_relaxed(&rc->size,
+					 RCENTRY_SIZE(entry->length));
+		call_rcu(&entry->rcu_head, rcentry_destroy);
+	}
+}
+
+static bool
+rcentry_samekey(dns_rcentry_t *entry, dns_rdatatype_t qtype,
+		dns_rdataclass_t qclass, unsigned int flags) {
+	return (entry->qtype == qtype && entry->qclass == qclass &&
+		entry->flags == flags);
+}
+
+/*
+ * Check whether 'entry' is still current for 'zone' at 'generation',
+ * evicting it if it is not.
+ */
+static bool
+rcentry_alive(dns_respcache_t *rc, struct cds_lfht *ht, dns_rcentry_t *entry,
+	      dns_zone_t *zone, uint32_t generation) {
+	if (cds_lfht_is_node_deleted(&entry->ht_node)) {
+		return (false);
+	} else if (entry->zone != zone || entry->generation != generation) {
+		rcentry_evict(rc, ht, entry);
+		return (false);
+	}
+
+	return (true);
+}
+
+/*
+ * A response rendered into a buffer of the same size is always usable;
+ * a larger buffer would only matter if something had been left out.
+ */
+static bool
+rcentry_fits(dns_rcentry_t *entry, unsigned int bufsize) {
+	return (entry->bufsize == bufsize ||
+		(entry->complete && entry->length <= bufsize));
+}
+
+static void
+rcentry_makeroom(dns_respcache_t *rc, struct cds_lfht *ht) {
+	size_t count = RESPCACHE_EVICT;
+	dns_rcentry_t *entry = NULL;
+	struct cds_lfht_iter iter;
+
+	/*
+	 * The hashtable is ordered by hash value, so the first few
+	 * entries are as good a choice of victims as any.
+	 */
+	cds_lfht_for_each_entry(ht, &iter, entry, ht_node) {
+		rcentry_evict(rc, ht, entry);
+		if (--count == 0) {
+			break;
+		}
+	}
+}
+
+void
+dns_respcache_add(dns_respcache_t *rc, dns_zone_t *zone, uint32_t generation,
+		  const dns_name_t *qname, dns_rdatatype_t qtype,
+		  dns_rdataclass_t qclass, unsigned int flags, uint16_t bufsize,
+		  bool complete, const isc_region_t *r) {
+	REQUIRE(VALID_RESPCACHE(rc));
+	REQUIRE(zone != NULL);
+	REQUIRE(qname != NULL);
+	REQUIRE(r != NULL && r->length >= DNS_MESSAGE_HEADERLEN +
+						   qname->length + 4);
+
+	size_t size = RCENTRY_SIZE(r->length);
+	if (size > rc->maxsize) {
+		return;
+	}
+
+	rcu_read_lock();
+	struct cds_lfht *ht = rcu_dereference(rc->ht);
+	INSIST(ht != NULL);
+
+	if (atomic_load_relaxed(&rc->size) + size > rc->maxsize) {
+		rcentry_makeroom(rc, ht);
+	}
+
+	dns_rcentry_t *entry = NULL;
+	uint32_t hashval = dns_name_hash(qname);
+
+	struct cds_lfht_iter iter;
+	dns_rcentry_t *found = NULL;
+	cds_lfht_for_each_entry_duplicate(ht, hashval, rcentry_match, qname,
+					  &iter, entry, ht_node) {
+		if (rcentry_samekey(entry, qtype, qclass, flags) &&
+		    rcentry_alive(rc, ht, entry, zone, generation) &&
+		    entry->bufsize == bufsize)
+		{
+			found = entry;
+		}
+	}
+
+	/*
+	 * Give up if another thread already cached the same response,
+	 * or if evicting didn't make enough room.
+	 */
+	if (found == NULL &&
+	    atomic_load_relaxed(&rc->size) + size <= rc->maxsize)
+	{
+		entry = isc_mem_get(rc->mctx, size);
+		*entry = (dns_rcentry_t){
+			.zone = zone,
+			.generation = generation,
+			.qtype = qtype,
+			.qclass = qclass,
+			.flags = flags,
+			.bufsize = bufsize,
+			.complete = complete,
+			.length = r->length,
+		};
+		isc_mem_attach(rc->mctx, &entry->mctx);
+
+		entry->name = dns_fixedname_initname(&entry->fname);
+		dns_name_copy(qname, entry->name);
+		memmove(entry->wire, r->base, r->length);
+
+		atomic_fetch_add_relaxed(&rc->size, size);
+		cds_lfht_add(ht, hashval, &entry->ht_node);
+	}
+
+	rcu_read_unlock();
+}
+
+isc_result_t
+dns_respcache_find(dns_respcache_t *rc, dns_zone_t *zone, uint32_t generation,
+		   const dns_name_t *qname, dns_rdatatype_t qtype,
+		   dns_rdataclass_t qclass, unsigned int flags,
+		   dns_messageid_t id, isc_buffer_t *target) {
+	REQUIRE(VALID_RESPCACHE(rc));
+	REQUIRE(zone != NULL);
+	REQUIRE(qname != NULL);
+	REQUIRE(ISC_BUFFER_VALID(target));
+
+	isc_result_t result = ISC_R_NOTFOUND;
+	unsigned int bufsize = isc_buffer_availablelength(target);
+
+	rcu_read_lock();
+	struct cds_lfht *ht = rcu_dereference(rc->ht);
+	INSIST(ht != NULL);
+
+	dns_rcentry_t *entry = NULL;
+	uint32_t hashval = dns_name_hash(qname);
+
+	struct cds_lfht_iter iter;
+	dns_rcentry_t *found = NULL;
+	cds_lfht_for_each_entry_duplicate(ht, hashval, rcentry_match, qname,
+					  &iter, entry, ht_node) {
+		if (rcentry_samekey(entry, qtype, qclass, flags) &&
+		    rcentry_alive(rc, ht, entry, zone, generation) &&
+		    rcentry_fits(entry, bufsize))
+		{
+			found = entry;
+			break;
+		}
+	}
+
+	if (found != NULL) {
+		unsigned char *base = isc_buffer_used(target);
+
+		INSIST(found->name->length == qname->length);
+
+		isc_buffer_putmem(target, found->wire, found->length);
+		base[0] = (id >> 8) & 0xff;
+		base[1] = id & 0xff;
+		memmove(base + DNS_MESSAGE_HEADERLEN, qname->ndata,
+			qname->length);
+
+		result = ISC_R_SUCCESS;
+	}
+
+	rcu_read_unlock();
+
+	return (result);
+}
+
+void
+dns_respcache_flush(dns_respcache_t *rc) {
+	REQUIRE(VALID_RESPCACHE(rc));
+
+	struct cds_lfht *ht =
+		cds_lfht_new(RESPCACHE_INIT_SIZE, RESPCACHE_MIN_SIZE, 0,
+			     CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	INSIST(ht != NULL);
+
+	/* First swap the hashtables */
+	rcu_read_lock();
+	ht = rcu_xchg_pointer(&rc->ht, ht);
+	rcu_read_unlock();
+
+	/* Make sure nobody is using the old hash table */
+	synchronize_rcu();
+
+	/* Flush the old hash table */
+	rcentry_flush(rc, ht);
+}
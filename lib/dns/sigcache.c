@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/buffer.h>
+#include <isc/magic.h>
+#include <isc/md.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/serial.h>
+#include <isc/stdtime.h>
+#include <isc/util.h>
+
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdataset.h>
+#include <dns/sigcache.h>
+
+#define SIGCACHE_MAGIC	  ISC_MAGIC('S', 'i', 'g', 'C')
+#define VALID_SIGCACHE(m) ISC_MAGIC_VALID(m, SIGCACHE_MAGIC)
+
+/*
+ * The slots are protected by a fixed set of locks, so that lookups
+ * from different offload threads rarely wait for each other.
+ */
+#define SIGCACHE_LOCKS 64
+
+typedef struct sigentry {
+	unsigned char digest[DNS_SIGCACHE_DIGESTLEN];
+	isc_stdtime_t inception;
+	isc_stdtime_t expire;
+	bool used;
+} sigentry_t;
+
+struct dns_sigcache {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	unsigned int size; /* a power of two */
+	sigentry_t *entries;
+	isc_mutex_t locks[SIGCACHE_LOCKS];
+};
+
+dns_sigcache_t *
+dns_sigcache_new(isc_mem_t *mctx, unsigned int size) {
+	dns_sigcache_t *sc = NULL;
+	unsigned int slots = SIGCACHE_LOCKS;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(size > 0);
+
+	while (slots < size) {
+		slots <<= 1;
+	}
+
+	sc = isc_mem_get(mctx, sizeof(*sc));
+	*sc = (dns_sigcache_t){
+		.size = slots,
+	};
+	sc->entries = isc_mem_cget(mctx, slots, sizeof(sc->entries[0]));
+	for (size_t i = 0; i < SIGCACHE_LOCKS; i++) {
+		isc_mutex_init(&sc->locks[i]);
+	}
+	isc_mem_attach(mctx, &sc->mctx);
+	sc->magic = SIGCACHE_MAGIC;
+
+	return (sc);
+}
+
+void
+dns_sigcache_destroy(dns_sigcache_t **scp) {
+	dns_sigcache_t *sc = NULL;
+
+	REQUIRE(scp != NULL && VALID_SIGCACHE(*scp));
+
+	sc = *scp;
+	*scp = NULL;
+
+	sc->magic = 0;
+	for (size_t i = 0; i < SIGCACHE_LOCKS; i++) {
+		isc_mutex_destroy(&sc->locks[i]);
+	}
+	isc_mem_cput(sc->mctx, sc->entries, sc->size, sizeof(sc->entries[0]));
+	isc_mem_putanddetach(&sc->mctx, sc, sizeof(*sc));
+}
+
+/*
+ * Make qsort happy.
+ */
+static int
+rdata_compare_wrapper(const void *rdata1, const void *rdata2) {
+	return (dns_rdata_compare((const dns_rdata_t *)rdata1,
+				  (const dns_rdata_t *)rdata2));
+}
+
+static void
+digest_region(isc_md_t *md, const unsigned char *base, unsigned int length) {
+	unsigned char len[2] = { (length >> 8) & 0xff, length & 0xff };
+
+	RUNTIME_CHECK(isc_md_update(md, len, sizeof(len)) == ISC_R_SUCCESS);
+	RUNTIME_CHECK(isc_md_update(md, base, length) == ISC_R_SUCCESS);
+}
+
+isc_result_t
+dns_sigcache_digest(const dns_name_t *name, dns_rdataset_t *rdataset,
+		    dst_key_t *key, const dns_rdata_t *sigrdata,
+		    isc_mem_t *mctx, unsigned char *digest) {
+	isc_result_t result;
+	unsigned char keydata[DST_KEY_MAXSIZE];
+	unsigned char header[4];
+	unsigned int digestlen = 0;
+	isc_buffer_t keybuf;
+	isc_region_t r;
+	dns_rdataset_t set;
+	dns_rdata_t *data = NULL;
+	unsigned int i = 0, n;
+	isc_md_t *md = NULL;
+
+	REQUIRE(name != NULL);
+	REQUIRE(DNS_RDATASET_VALID(rdataset));
+	REQUIRE(key != NULL);
+	REQUIRE(sigrdata != NULL);
+	REQUIRE(digest != NULL);
+
+	isc_buffer_init(&keybuf, keydata, sizeof(keydata));
+	result = dst_key_todns(key, &keybuf);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	/*
+	 * The RRset goes in in canonical order, so that the same records
+	 * arriving in a different order produce the same digest.
+	 */
+	n = dns_rdataset_count(rdataset);
+	if (n == 0) {
+		return (ISC_R_NOMORE);
+	}
+	data = isc_mem_cget(mctx, n, sizeof(data[0]));
+
+	dns_rdataset_init(&set);
+	dns_rdataset_clone(rdataset, &set);
+	for (result = dns_rdataset_first(&set); result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(&set))
+	{
+		INSIST(i < n);
+		dns_rdata_init(&data[i]);
+		dns_rdataset_current(&set, &data[i++]);
+	}
+	dns_rdataset_disassociate(&set);
+	INSIST(i == n);
+	qsort(data, n, sizeof(data[0]), rdata_compare_wrapper);
+
+	md = isc_md_new();
+	RUNTIME_CHECK(isc_md_init(md, ISC_MD_SHA256) == ISC_R_SUCCESS);
+
+	dns_name_toregion(name, &r);
+	digest_region(md, r.base, r.length);
+
+	header[0] = (rdataset->type >> 8) & 0xff;
+	header[1] = rdataset->type & 0xff;
+	header[2] = (rdataset->rdclass >> 8) & 0xff;
+	header[3] = rdataset->rdclass & 0xff;
+	RUNTIME_CHECK(isc_md_update(md, header, sizeof(header)) ==
+		      ISC_R_SUCCESS);
+
+	isc_buffer_usedregion(&keybuf, &r);
+	digest_region(md, r.base, r.length);
+	digest_region(md, sigrdata->data, sigrdata->length);
+	for (i = 0; i < n; i++) {
+		digest_region(md, data[i].data, data[i].length);
+	}
+
+	RUNTIME_CHECK(isc_md_final(md, digest, &digestlen) == ISC_R_SUCCESS);
+	INSIST(digestlen == DNS_SIGCACHE_DIGESTLEN);
+
+	isc_md_free(md);
+	isc_mem_cput(mctx, data, n, sizeof(data[0]));
+
+	return (ISC_R_SUCCESS);
+}
+
+static unsigned int
+slot(dns_sigcache_t *sc, const unsigned char *digest) {
+	uint32_t hash;
+
+	/* The digest is already uniformly distributed */
+	memmove(&hash, digest, sizeof(hash));
+	return (hash & (sc->size - 1));
+}
+
+isc_result_t
+dns_sigcache_find(dns_sigcache_t *sc, const unsigned char *digest,
+		  isc_stdtime_t now) {
+	isc_result_t result = ISC_R_NOTFOUND;
+	unsigned int i;
+	sigentry_t *entry = NULL;
+
+	REQUIRE(VALID_SIGCACHE(sc));
+	REQUIRE(digest != NULL);
+
+	i = slot(sc, digest);
+	entry = &sc->entries[i];
+
+	LOCK(&sc->locks[i % SIGCACHE_LOCKS]);
+	if (entry->used &&
+	    memcmp(entry->digest, digest, DNS_SIGCACHE_DIGESTLEN) == 0 &&
+	    !isc_serial_lt(now, entry->inception) &&
+	    !isc_serial_lt(entry->expire, now))
+	{
+		result = ISC_R_SUCCESS;
+	}
+	UNLOCK(&sc->locks[i % SIGCACHE_LOCKS]);
+
+	return (result);
+}
+
+void
+dns_sigcache_add(dns_sigcache_t *sc, const unsigned char *digest,
+		 isc_stdtime_t inception, isc_stdtime_t expire) {
+	unsigned int i;
+	sigentry_t *entry = NULL;
+
+	REQUIRE(VALID_SIGCACHE(sc));
+	REQUIRE(digest != NULL);
+
+	i = slot(sc, digest);
+	entry = &sc->entries[i];
+
+	LOCK(&sc->locks[i % SIGCACHE_LOCKS]);
+	memmove(entry->digest, digest, DNS_SIGCACHE_DIGESTLEN);
+	entry->inception = inception;
+	entry->expire = expire;
+	entry->used = true;
+	UNLOCK(&sc->locks[i % SIGCACHE_LOCKS]);
+}
+
+void
+dns_sigcache_flush(dns_sigcache_t *sc) {
+	REQUIRE(VALID_SIGCACHE(sc));
+
+	for (unsigned int i = 0; i < sc->size; i++) {
+		LOCK(&sc->locks[i % SIGCACHE_LOCKS]);
+		sc->entries[i].used = false;
+		UNLOCK(&sc->locks[i % SIGCACHE_LOCKS]);
+	}
+}
@@ -16,6 +16,7 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/histo.h>
 #include <isc/magic.h>
 #include <isc/mem.h>
 #include <isc/refcount.h>
@@ -39,7 +40,8 @@ typedef enum {
 	dns_statstype_rdataset = 2,
 	dns_statstype_opcode = 3,
 	dns_statstype_rcode = 4,
-	dns_statstype_dnssec = 5
+	dns_statstype_dnssec = 5,
+	dns_statstype_latency = 6
 } dns_statstype_t;
 
 /*%
@@ -108,11 +110,28 @@ typedef enum {
 static int dnssecsign_num_keys = 4;
 static int dnssecsign_block_size = 3;
 
+/*
+ * Query types with a latency histogram of their own; all other types
+ * share the one after them.  The histograms by transport and recursion
+ * status come first.
+ */
+static const dns_rdatatype_t latency_qtypes[] = {
+	dns_rdatatype_a,      dns_rdatatype_aaaa, dns_rdatatype_ptr,
+	dns_rdatatype_mx,     dns_rdatatype_txt,  dns_rdatatype_srv,
+	dns_rdatatype_ns,     dns_rdatatype_soa,  dns_rdatatype_ds,
+	dns_rdatatype_dnskey, dns_rdatatype_svcb, dns_rdatatype_https,
+};
+
+#define LATENCY_QTYPES	  ARRAY_SIZE(latency_qtypes)
+#define LATENCY_QTYPEBASE (dns_latency_max * 2)
+#define LATENCY_HISTOS	  (LATENCY_QTYPEBASE + LATENCY_QTYPES + 1)
+
 struct dns_stats {
 	unsigned int magic;
 	dns_statstype_t type;
 	isc_mem_t *mctx;
 	isc_stats_t *counters;
+	isc_histomulti_t **histos; /* dns_statstype_latency */
 	isc_refcount_t references;
 };
 
@@ -156,7 +175,16 @@ dns_stats_detach(dns_stats_t **statsp) {
 
 	if (isc_refcount_decrement(&stats->references) == 1) {
 		isc_refcount_destroy(&stats->references);
-		isc_stats_detach(&stats->counters);
+		if (stats->histos != NULL) {
+			for (size_t i = 0; i < LATENCY_HISTOS; i++) {
+				isc_histomulti_destroy(&stats->histos[i]);
+			}
+			isc_mem_cput(stats->mctx, stats->histos, LATENCY_HISTOS,
+				     sizeof(stats->histos[0]));
+		}
+		if (stats->counters != NULL) {
+			isc_stats_detach(&stats->counters);
+		}
 		isc_mem_putanddetach(&stats->mctx, stats, sizeof(*stats));
 	}
 }
@@ -170,6 +198,7 @@ create_stats(isc_mem_t *mctx, dns_statstype_t type, int ncounters,
 	dns_stats_t *stats = isc_mem_get(mctx, sizeof(*stats));
 
 	stats->counters = NULL;
+	stats->histos = NULL;
 	isc_refcount_init(&stats->references, 1);
 
 	isc_stats_create(mctx, &stats->counters, ncounters);
@@ -235,6 +264,30 @@ dns_dnssecsignstats_create(isc_mem_t *mctx, dns_stats_t **statsp) {
 		     dnssecsign_num_keys * dnssecsign_block_size, statsp);
 }
 
+void
+dns_latencystats_create(isc_mem_t *mctx, dns_stats_t **statsp) {
+	dns_stats_t *stats = NULL;
+
+	REQUIRE(statsp != NULL && *statsp == NULL);
+
+	stats = isc_mem_get(mctx, sizeof(*stats));
+	*stats = (dns_stats_t){
+		.type = dns_statstype_latency,
+	};
+	isc_refcount_init(&stats->references, 1);
+
+	stats->histos = isc_mem_cget(mctx, LATENCY_HISTOS,
+				     sizeof(stats->histos[0]));
+	for (size_t i = 0; i < LATENCY_HISTOS; i++) {
+		isc_histomulti_create(mctx, DNS_LATENCYHISTO_SIGBITS,
+				      &stats->histos[i]);
+	}
+
+	isc_mem_attach(mctx, &stats->mctx);
+	stats->magic = DNS_STATS_MAGIC;
+	*statsp = stats;
+}
+
 /*%
  * Increment/Decrement methods
  */
@@ -347,6 +400,25 @@ dns_rcodestats_increment(dns_stats_t *stats, dns_rcode_t code) {
 	}
 }
 
+void
+dns_latencystats_add(dns_stats_t *stats, dns_latencytransport_t transport,
+		     bool recursed, dns_rdatatype_t qtype, uint64_t usecs) {
+	size_t i;
+
+	REQUIRE(DNS_STATS_VALID(stats) && stats->type == dns_statstype_latency);
+	REQUIRE(transport < dns_latency_max);
+
+	isc_histomulti_inc(stats->histos[transport * 2 + (recursed ? 1 : 0)],
+			   usecs);
+
+	for (i = 0; i < LATENCY_QTYPES; i++) {
+		if (latency_qtypes[i] == qtype) {
+			break;
+		}
+	}
+	isc_histomulti_inc(stats->histos[LATENCY_QTYPEBASE + i], usecs);
+}
+
 void
 dns_dnssecsignstats_increment(dns_stats_t *stats, dns_keytag_t id, uint8_t alg,
 			      dnssecsignstats_type_t operation) {
@@ -606,3 +678,24 @@ dns_rcodestats_dump(dns_stats_t *stats, dns_rcodestats_dumper_t dump_fn,
 	arg.arg = arg0;
 	isc_stats_dump(stats->counters, rcode_dumpcb, &arg, options);
 }
+
+const isc_histomulti_t *
+dns_latencystats_get(dns_stats_t *stats, dns_latencytransport_t transport,
+		     bool recursed) {
+	REQUIRE(DNS_STATS_VALID(stats) && stats->type == dns_statstype_latency);
+	REQUIRE(transport < dns_latency_max);
+
+	return (stats->histos[transport * 2 + (recursed ? 1 : 0)]);
+}
+
+void
+dns_latencystats_dump(dns_stats_t *stats, dns_latencystats_dumper_t dump_fn,
+		      void *arg) {
+	REQUIRE(DNS_STATS_VALID(stats) && stats->type == dns_statstype_latency);
+
+	for (size_t i = 0; i < LATENCY_QTYPES; i++) {
+		dump_fn(latency_qtypes[i], stats->histos[LATENCY_QTYPEBASE + i],
+			arg);
+	}
+	dump_fn(0, stats->histos[LATENCY_QTYPEBASE + LATENCY_QTYPES], arg);
+}
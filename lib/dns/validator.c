@@ -41,6 +41,7 @@
 #include <dns/rdataset.h>
 #include <dns/rdatatype.h>
 #include <dns/resolver.h>
+#include <dns/sigcache.h>
 #include <dns/validator.h>
 #include <dns/view.h>
 
@@ -353,6 +354,16 @@ trynsec3:
 	return (found);
 }
 
+/*%
+ * Hand a signature verification step to the offload threads.  The
+ * resolver batches these with the other validators running on this loop.
+ */
+static void
+validate_offload(dns_validator_t *val, isc_work_cb work_cb,
+		 isc_after_work_cb after_work_cb) {
+	dns_resolver_verify(val->view->resolver, work_cb, after_work_cb, val);
+}
+
 static void
 resume_answer_with_key(void *arg) {
 	dns_validator_t *val = arg;
@@ -420,8 +431,8 @@ fetch_callback_dnskey(void *arg) {
 		if (eresult == ISC_R_SUCCESS &&
 		    rdataset->trust >= dns_trust_secure)
 		{
-			isc_work_enqueue(val->loop, resume_answer_with_key,
-					 resume_answer, val);
+			validate_offload(val, resume_answer_with_key,
+					 resume_answer);
 			result = DNS_R_WAIT;
 		} else {
 			result = validate_async_run(val, resume_answer);
@@ -596,8 +607,8 @@ validator_callback_dnskey(void *arg) {
 		 * Only extract the dst key if the keyset is secure.
 		 */
 		if (val->frdataset.trust >= dns_trust_secure) {
-			isc_work_enqueue(val->loop, resume_answer_with_key,
-					 resume_answer_with_key_done, val);
+			validate_offload(val, resume_answer_with_key,
+					 resume_answer_with_key_done);
 			result = DNS_R_WAIT;
 		} else {
 			result = validate_async_run(val, resume_answer);
@@ -1181,8 +1192,8 @@ seek_dnskey(dns_validator_t *val) {
 				dns_rdataset_disassociate(&val->fsigrdataset);
 			}
 
-			isc_work_enqueue(val->loop, resume_answer_with_key,
-					 resume_answer_with_key_done, val);
+			validate_offload(val, resume_answer_with_key,
+					 resume_answer_with_key_done);
 			return (DNS_R_WAIT);
 		}
 		break;
@@ -1416,9 +1427,30 @@ verify(dns_validator_t *val, dst_key_t *key, dns_rdata_t *rdata,
 	dns_fixedname_t fixed;
 	bool ignore = false;
 	dns_name_t *wild;
+	unsigned char digest[DNS_SIGCACHE_DIGESTLEN];
+	bool cacheable = false;
 
 	val->attributes |= VALATTR_TRIEDVERIFY;
 	wild = dns_fixedname_initname(&fixed);
+
+	/*
+	 * If this very signature has already been verified with this key
+	 * over this RRset, there is no need to do it again.
+	 */
+	result = dns_sigcache_digest(val->name, val->rdataset, key, rdata,
+				     val->view->mctx, digest);
+	if (result == ISC_R_SUCCESS) {
+		cacheable = true;
+		result = dns_resolver_getsigcache(val->view->resolver, digest,
+						  isc_stdtime_now());
+		if (result == ISC_R_SUCCESS) {
+			validator_log(val, ISC_LOG_DEBUG(3),
+				      "verify rdataset (keyid=%u): "
+				      "previously verified", keyid);
+			return (ISC_R_SUCCESS);
+		}
+	}
+
 	if (over_max_validations(val)) {
 		return (ISC_R_QUOTA);
 	}
@@ -1433,6 +1465,15 @@ again:
 		goto again;
 	}
 
+	if (cacheable && !ignore && result == ISC_R_SUCCESS) {
+		dns_rdata_rrsig_t sig;
+
+		RUNTIME_CHECK(dns_rdata_tostruct(rdata, &sig, NULL) ==
+			      ISC_R_SUCCESS);
+		dns_resolver_addsigcache(val->view->resolver, digest,
+					 sig.timesigned, sig.timeexpire);
+	}
+
 	if (ignore && (result == ISC_R_SUCCESS || result == DNS_R_FROMWILDCARD))
 	{
 		validator_log(val, ISC_LOG_INFO,
@@ -1606,8 +1647,8 @@ validate_answer_signing_key_done(void *arg) {
 		val->result = ISC_R_CANCELED;
 	} else if (val->key != NULL) {
 		/* Process with next key if we selected one */
-		isc_work_enqueue(val->loop, validate_answer_signing_key,
-				 validate_answer_signing_key_done, val);
+		validate_offload(val, validate_answer_signing_key,
+				 validate_answer_signing_key_done);
 		return;
 	}
 
@@ -1669,8 +1710,8 @@ validate_answer_process(void *arg) {
 		goto next_key;
 	}
 
-	isc_work_enqueue(val->loop, validate_answer_signing_key,
-			 validate_answer_signing_key_done, val);
+	validate_offload(val, validate_answer_signing_key,
+			 validate_answer_signing_key_done);
 	return;
 
 next_key:
@@ -2061,8 +2102,8 @@ validate_dnskey_dsset_next_done(void *arg) {
 		break;
 	default:
 		/* Continue validation until we have success or no more data */
-		isc_work_enqueue(val->loop, validate_dnskey_dsset_next,
-				 validate_dnskey_dsset_next_done, val);
+		validate_offload(val, validate_dnskey_dsset_next,
+				 validate_dnskey_dsset_next_done);
 		return;
 	}
 
@@ -2084,8 +2125,8 @@ validate_dnskey_dsset_first(dns_validator_t *val) {
 		/* continue async run */
 		result = validate_dnskey_dsset(val);
 		if (result != ISC_R_SUCCESS) {
-			isc_work_enqueue(val->loop, validate_dnskey_dsset_next,
-					 validate_dnskey_dsset_next_done, val);
+			validate_offload(val, validate_dnskey_dsset_next,
+					 validate_dnskey_dsset_next_done);
 			return;
 		}
 	}
@@ -55,6 +55,7 @@
 #include <dns/rdataset.h>
 #include <dns/request.h>
 #include <dns/resolver.h>
+#include <dns/respcache.h>
 #include <dns/rpz.h>
 #include <dns/rrl.h>
 #include <dns/stats.h>
@@ -379,6 +380,9 @@ destroy(dns_view_t *view) {
 	if (view->dtenv != NULL) {
 		dns_dt_detach(&view->dtenv);
 	}
+	if (view->dtfilter != NULL) {
+		dns_dtfilter_detach(&view->dtfilter);
+	}
 #endif /* HAVE_DNSTAP */
 	dns_view_setnewzones(view, false, NULL, NULL, 0ULL);
 	if (view->new_zone_file != NULL) {
@@ -404,6 +408,12 @@ destroy(dns_view_t *view) {
 	if (view->failcache != NULL) {
 		dns_badcache_destroy(&view->failcache);
 	}
+	if (view->respcache != NULL) {
+		dns_respcache_destroy(&view->respcache);
+	}
+	if (view->latencystats != NULL) {
+		dns_stats_detach(&view->latencystats);
+	}
 	isc_mutex_destroy(&view->new_zone_lock);
 	isc_mutex_destroy(&view->lock);
 	isc_refcount_destroy(&view->references);
@@ -704,6 +714,27 @@ dns_view_getdynamickeyring(dns_view_t *view, dns_tsigkeyring_t **ringp) {
 	}
 }
 
+void
+dns_view_setlatencystats(dns_view_t *view, dns_stats_t *stats) {
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(stats != NULL);
+
+	if (view->latencystats != NULL) {
+		dns_stats_detach(&view->latencystats);
+	}
+	dns_stats_attach(stats, &view->latencystats);
+}
+
+void
+dns_view_getlatencystats(dns_view_t *view, dns_stats_t **statsp) {
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(statsp != NULL && *statsp == NULL);
+
+	if (view->latencystats != NULL) {
+		dns_stats_attach(view->latencystats, statsp);
+	}
+}
+
 void
 dns_view_restorekeyring(dns_view_t *view) {
 	FILE *fp;
@@ -1460,6 +1491,7 @@ dns_view_flushcache(dns_view_t *view, bool fixuponly) {
 	dns_cache_attachdb(view->cache, &view->cachedb);
 	if (view->resolver != NULL) {
 		dns_resolver_flushbadcache(view->resolver, NULL);
+		dns_resolver_flushsigcache(view->resolver);
 	}
 	if (view->failcache != NULL) {
 		dns_badcache_flush(view->failcache);
@@ -61,6 +61,22 @@
 		}                              \
 	}
 
+/*%
+ * AXFR data is handed to the database loader in batches of about
+ * XFRIN_BATCHSIZE bytes, and reading from the primary pauses while
+ * more than XFRIN_MAXQUEUED bytes are still waiting to be loaded.
+ */
+#define XFRIN_BATCHSIZE (4 * 1024 * 1024)
+#define XFRIN_MAXQUEUED (2 * XFRIN_BATCHSIZE)
+
+/*%
+ * IXFR transactions that are waiting to be applied are merged into one
+ * database update while their combined size stays below
+ * XFRIN_COALESCE_MAX bytes.  They are still written to the journal one
+ * by one.
+ */
+#define XFRIN_COALESCE_MAX (64 * 1024)
+
 /*%
  * The states of the *XFR state machine.  We handle both IXFR and AXFR
  * with a single integrated state machine because they cannot be distinguished
@@ -129,9 +145,11 @@ struct dns_xfrin {
 	dns_db_t *db;
 	dns_dbversion_t *ver;
 	dns_diff_t diff; /*%< Pending database changes */
+	size_t diffsize; /*%< Bytes held in 'diff' */
 
 	/* Diff queue */
 	bool diff_running;
+	bool stalled; /*%< Waiting for the queue to drain */
 	struct __cds_wfcq_head diff_head;
 	struct cds_wfcq_tail diff_tail;
 
@@ -151,6 +169,12 @@ struct dns_xfrin {
 	atomic_uint nmsg;	     /*%< Number of messages recvd */
 	atomic_uint nrecs;	     /*%< Number of records recvd */
 	atomic_uint_fast64_t nbytes; /*%< Number of bytes received */
+	atomic_uint_fast64_t queued; /*%< Bytes queued for loading */
+	atomic_uint_fast64_t peak;   /*%< Most bytes held at once */
+	atomic_uint ntrans;	     /*%< IXFR transactions applied */
+	atomic_uint nupdates;	     /*%< Database updates for them */
+	atomic_uint_fast64_t applyus; /*%< Time spent applying them */
+	atomic_uint_fast64_t maxus;   /*%< Slowest single update */
 	_Atomic(isc_time_t) start;   /*%< Start time of the transfer */
 	_Atomic(dns_transport_type_t) soa_transport_type;
 	atomic_uint_fast32_t end_serial;
@@ -202,6 +226,17 @@ typedef struct xfrin_work {
 	isc_result_t result;
 } xfrin_work_t;
 
+typedef struct xfrin_apply_data xfrin_apply_data_t;
+struct xfrin_apply_data {
+	dns_diff_t diff;     /*%< Pending database changes */
+	size_t size;	     /*%< Memory used by the tuples in 'diff' */
+	unsigned int ntrans; /*%< IXFR transactions merged into 'diff' */
+	ISC_LINK(xfrin_apply_data_t) link; /*%< In a batch of IXFR
+					    *   transactions */
+	struct cds_wfcq_node wfcq_node;
+};
+typedef ISC_LIST(xfrin_apply_data_t) xfrin_apply_list_t;
+
 /**************************************************************************/
 /*
  * Forward declarations.
@@ -239,6 +274,8 @@ xfr_rr(dns_xfrin_t *xfr, dns_name_t *name, uint32_t ttl, dns_rdata_t *rdata);
 
 static isc_result_t
 xfrin_start(dns_xfrin_t *xfr);
+static void
+xfrin_readnext(dns_xfrin_t *xfr);
 
 static void
 xfrin_connect_done(isc_result_t result, isc_region_t *region, void *arg);
@@ -299,53 +336,126 @@ static isc_result_t
 axfr_putdata(dns_xfrin_t *xfr, dns_diffop_t op, dns_name_t *name, dns_ttl_t ttl,
 	     dns_rdata_t *rdata) {
 	isc_result_t result;
-
 	dns_difftuple_t *tuple = NULL;
+	uint64_t used;
 
 	if (rdata->rdclass != xfr->rdclass) {
 		return (DNS_R_BADCLASS);
 	}
 
 	CHECK(dns_zone_checknames(xfr->zone, name, rdata));
+
+	/*
+	 * Once enough data has been received, pass it on to the loader,
+	 * but only at a change of owner name: the loader builds each
+	 * RRset in one go when all of its records arrive together.
+	 */
+	tuple = ISC_LIST_TAIL(xfr->diff.tuples);
+	if (xfr->diffsize >= XFRIN_BATCHSIZE && tuple != NULL &&
+	    !dns_name_equal(&tuple->name, name))
+	{
+		axfr_commit(xfr);
+	}
+
+	tuple = NULL;
 	CHECK(dns_difftuple_create(xfr->diff.mctx, op, name, ttl, rdata,
 				   &tuple));
 	dns_diff_append(&xfr->diff, &tuple);
+
+	xfr->diffsize += sizeof(*tuple) + name->length + rdata->length;
+	used = xfr->diffsize + atomic_load_relaxed(&xfr->queued);
+	if (used > atomic_load_relaxed(&xfr->peak)) {
+		atomic_store_relaxed(&xfr->peak, used);
+	}
+
+	result = ISC_R_SUCCESS;
+failure:
+	return (result);
+}
+
+static isc_result_t
+axfr_apply_one(dns_xfrin_t *xfr, xfrin_apply_data_t *data) {
+	isc_result_t result;
+	uint64_t records;
+
+	CHECK(dns_diff_load(&data->diff, &xfr->axfr));
+	if (xfr->maxrecords != 0U) {
+		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
+		if (result == ISC_R_SUCCESS && records > xfr->maxrecords) {
+			result = DNS_R_TOOMANYRECORDS;
+			goto failure;
+		}
+	}
 	result = ISC_R_SUCCESS;
+
 failure:
 	return (result);
 }
 
 /*
- * Store a set of AXFR RRs in the database.
+ * Store the queued batches of AXFR RRs in the database.
  */
 static void
 axfr_apply(void *arg) {
 	xfrin_work_t *work = arg;
 	dns_xfrin_t *xfr = work->xfr;
 	isc_result_t result = ISC_R_SUCCESS;
-	uint64_t records;
 
 	REQUIRE(VALID_XFRIN(xfr));
 
-	if (atomic_load(&xfr->shuttingdown)) {
-		result = ISC_R_SHUTTINGDOWN;
-		goto failure;
-	}
+	struct __cds_wfcq_head diff_head;
+	struct cds_wfcq_tail diff_tail;
 
-	CHECK(dns_diff_load(&xfr->diff, &xfr->axfr));
-	if (xfr->maxrecords != 0U) {
-		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
-		if (result == ISC_R_SUCCESS && records > xfr->maxrecords) {
-			result = DNS_R_TOOMANYRECORDS;
-			goto failure;
+	/* Initialize local wfcqueue */
+	__cds_wfcq_init(&diff_head, &diff_tail);
+
+	enum cds_wfcq_ret ret = __cds_wfcq_splice_blocking(
+		&diff_head, &diff_tail, &xfr->diff_head, &xfr->diff_tail);
+	INSIST(ret == CDS_WFCQ_RET_DEST_EMPTY);
+
+	struct cds_wfcq_node *node, *next;
+	__cds_wfcq_for_each_blocking_safe(&diff_head, &diff_tail, node, next) {
+		xfrin_apply_data_t *data =
+			caa_container_of(node, xfrin_apply_data_t, wfcq_node);
+
+		if (atomic_load(&xfr->shuttingdown)) {
+			result = ISC_R_SHUTTINGDOWN;
 		}
+
+		/* Apply only until first failure */
+		if (result == ISC_R_SUCCESS) {
+			result = axfr_apply_one(xfr, data);
+		}
+
+		atomic_fetch_sub_relaxed(&xfr->queued, data->size);
+		dns_diff_clear(&data->diff);
+		isc_mem_put(xfr->mctx, data, sizeof(*data));
 	}
 
-failure:
-	dns_diff_clear(&xfr->diff);
 	work->result = result;
 }
 
+/*
+ * Start reading from the primary again if it was paused to let the
+ * loader catch up, or drop the reference kept for the next read if
+ * the transfer is being torn down.
+ */
+static void
+axfr_resume(dns_xfrin_t *xfr) {
+	if (!xfr->stalled) {
+		return;
+	}
+
+	if (atomic_load(&xfr->shuttingdown)) {
+		xfr->stalled = false;
+		dns_xfrin_unref(xfr);
+	} else if (atomic_load_relaxed(&xfr->queued) < XFRIN_MAXQUEUED) {
+		xfrin_log(xfr, ISC_LOG_DEBUG(3), "resuming transfer");
+		xfr->stalled = false;
+		xfrin_readnext(xfr);
+	}
+}
+
 static void
 axfr_apply_done(void *arg) {
 	xfrin_work_t *work = arg;
@@ -358,12 +468,22 @@ axfr_apply_done(void *arg) {
 		result = ISC_R_SHUTTINGDOWN;
 	}
 
-	if (result == ISC_R_SUCCESS) {
+	if (result != ISC_R_SUCCESS) {
+		(void)dns_db_endload(xfr->db, &xfr->axfr);
+		goto failure;
+	}
+
+	/* Reschedule */
+	if (!cds_wfcq_empty(&xfr->diff_head, &xfr->diff_tail)) {
+		isc_work_enqueue(xfr->loop, axfr_apply, axfr_apply_done, work);
+		axfr_resume(xfr);
+		return;
+	}
+
+	if (atomic_load(&xfr->state) == XFRST_AXFR_END) {
 		CHECK(dns_db_endload(xfr->db, &xfr->axfr));
 		CHECK(dns_zone_verifydb(xfr->zone, xfr->db, NULL));
 		CHECK(axfr_finalize(xfr));
-	} else {
-		(void)dns_db_endload(xfr->db, &xfr->axfr);
 	}
 
 failure:
@@ -379,20 +499,39 @@ failure:
 		xfrin_fail(xfr, result, "failed while processing responses");
 	}
 
+	axfr_resume(xfr);
+
 	dns_xfrin_detach(&xfr);
 }
 
+/*
+ * Queue the AXFR RRs received so far for loading into the database.
+ */
 static void
 axfr_commit(dns_xfrin_t *xfr) {
-	REQUIRE(!xfr->diff_running);
+	xfrin_apply_data_t *data = isc_mem_get(xfr->mctx, sizeof(*data));
 
-	xfrin_work_t *work = isc_mem_get(xfr->mctx, sizeof(*work));
-	*work = (xfrin_work_t){
-		.xfr = dns_xfrin_ref(xfr),
-		.result = ISC_R_UNSET,
-	};
-	xfr->diff_running = true;
-	isc_work_enqueue(xfr->loop, axfr_apply, axfr_apply_done, work);
+	*data = (xfrin_apply_data_t){ .size = xfr->diffsize };
+	ISC_LINK_INIT(data, link);
+	cds_wfcq_node_init(&data->wfcq_node);
+
+	dns_diff_init(xfr->mctx, &data->diff);
+	ISC_LIST_MOVE(data->diff.tuples, xfr->diff.tuples);
+	xfr->diffsize = 0;
+
+	atomic_fetch_add_relaxed(&xfr->queued, data->size);
+	(void)cds_wfcq_enqueue(&xfr->diff_head, &xfr->diff_tail,
+			       &data->wfcq_node);
+
+	if (!xfr->diff_running) {
+		xfrin_work_t *work = isc_mem_get(xfr->mctx, sizeof(*work));
+		*work = (xfrin_work_t){
+			.xfr = dns_xfrin_ref(xfr),
+			.result = ISC_R_UNSET,
+		};
+		xfr->diff_running = true;
+		isc_work_enqueue(xfr->loop, axfr_apply, axfr_apply_done, work);
+	}
 }
 
 static isc_result_t
@@ -411,11 +550,6 @@ axfr_finalize(dns_xfrin_t *xfr) {
  * IXFR handling
  */
 
-typedef struct ixfr_apply_data {
-	dns_diff_t diff; /*%< Pending database changes */
-	struct cds_wfcq_node wfcq_node;
-} ixfr_apply_data_t;
-
 static isc_result_t
 ixfr_init(dns_xfrin_t *xfr) {
 	isc_result_t result;
@@ -457,43 +591,195 @@ ixfr_putdata(dns_xfrin_t *xfr, dns_diffop_t op, dns_name_t *name, dns_ttl_t ttl,
 	CHECK(dns_difftuple_create(xfr->diff.mctx, op, name, ttl, rdata,
 				   &tuple));
 	dns_diff_append(&xfr->diff, &tuple);
+	xfr->diffsize += sizeof(*tuple) + name->length + rdata->length;
 	result = ISC_R_SUCCESS;
 failure:
 	return (result);
 }
 
-static isc_result_t
-ixfr_begin_transaction(dns_xfrin_t *xfr) {
-	isc_result_t result = ISC_R_SUCCESS;
+static dns_difftuple_t *
+ixfr_findsoa(dns_diff_t *diff, dns_diffop_t op) {
+	for (dns_difftuple_t *t = ISC_LIST_HEAD(diff->tuples); t != NULL;
+	     t = ISC_LIST_NEXT(t, link))
+	{
+		if (t->op == op && t->rdata.type == dns_rdatatype_soa) {
+			return (t);
+		}
+	}
 
-	if (xfr->ixfr.journal != NULL) {
-		CHECK(dns_journal_begin_transaction(xfr->ixfr.journal));
+	return (NULL);
+}
+
+/*
+ * Find the tuple in 'diff' that adds or deletes the same record as
+ * 't', ignoring the TTL.  '*countp' is set to the number of them.
+ */
+static dns_difftuple_t *
+ixfr_findrr(dns_diff_t *diff, dns_difftuple_t *t, unsigned int *countp) {
+	dns_difftuple_t *found = NULL;
+	unsigned int count = 0;
+
+	for (dns_difftuple_t *o = ISC_LIST_HEAD(diff->tuples); o != NULL;
+	     o = ISC_LIST_NEXT(o, link))
+	{
+		if (o->rdata.type == t->rdata.type &&
+		    dns_name_equal(&o->name, &t->name) &&
+		    dns_rdata_compare(&o->rdata, &t->rdata) == 0)
+		{
+			if (found == NULL) {
+				found = o;
+			}
+			count++;
+		}
 	}
-failure:
-	return (result);
+
+	SET_IF_NOT_NULL(countp, count);
+	return (found);
 }
 
-static isc_result_t
-ixfr_end_transaction(dns_xfrin_t *xfr) {
-	isc_result_t result = ISC_R_SUCCESS;
+/*
+ * Make a copy of the changes in 'src' that can be merged with others.
+ */
+static xfrin_apply_data_t *
+ixfr_copydata(isc_mem_t *mctx, xfrin_apply_data_t *src) {
+	xfrin_apply_data_t *data = isc_mem_get(mctx, sizeof(*data));
 
-	CHECK(dns_zone_verifydb(xfr->zone, xfr->db, xfr->ver));
-	/* XXX enter ready-to-commit state here */
-	if (xfr->ixfr.journal != NULL) {
-		CHECK(dns_journal_commit(xfr->ixfr.journal));
+	*data = (xfrin_apply_data_t){
+		.size = src->size,
+		.ntrans = src->ntrans,
+	};
+	ISC_LINK_INIT(data, link);
+	cds_wfcq_node_init(&data->wfcq_node);
+	dns_diff_init(mctx, &data->diff);
+
+	for (dns_difftuple_t *t = ISC_LIST_HEAD(src->diff.tuples); t != NULL;
+	     t = ISC_LIST_NEXT(t, link))
+	{
+		dns_difftuple_t *copy = NULL;
+
+		RUNTIME_CHECK(dns_difftuple_copy(t, &copy) == ISC_R_SUCCESS);
+		ISC_LIST_APPEND(data->diff.tuples, copy, link);
 	}
-failure:
-	return (result);
+
+	return (data);
+}
+
+static void
+ixfr_freedata(isc_mem_t *mctx, xfrin_apply_data_t **datap) {
+	xfrin_apply_data_t *data = *datap;
+
+	*datap = NULL;
+	dns_diff_clear(&data->diff);
+	isc_mem_put(mctx, data, sizeof(*data));
+}
+
+/*
+ * Merge the IXFR transaction in 'src' into the one in 'dst' if it
+ * starts at the serial 'dst' ends at.  A record added by one and
+ * deleted by the other cancels out; if a record would change the
+ * same way twice, or the result would be too large, nothing is done
+ * and false is returned.  On success 'src' is left empty.
+ */
+static bool
+ixfr_coalesce(xfrin_apply_data_t *dst, xfrin_apply_data_t *src) {
+	dns_difftuple_t *dstsoa = NULL, *srcsoa = NULL;
+	dns_difftuple_t *t = NULL, *o = NULL;
+	dns_difftuplelist_t adds = ISC_LIST_INITIALIZER;
+	unsigned int count;
+
+	if (dst->size + src->size > XFRIN_COALESCE_MAX) {
+		return (false);
+	}
+
+	dstsoa = ixfr_findsoa(&dst->diff, DNS_DIFFOP_ADD);
+	srcsoa = ixfr_findsoa(&src->diff, DNS_DIFFOP_DEL);
+	if (dstsoa == NULL || srcsoa == NULL ||
+	    dns_soa_getserial(&dstsoa->rdata) !=
+		    dns_soa_getserial(&srcsoa->rdata))
+	{
+		return (false);
+	}
+
+	for (t = ISC_LIST_HEAD(src->diff.tuples); t != NULL;
+	     t = ISC_LIST_NEXT(t, link))
+	{
+		if (t->rdata.type == dns_rdatatype_soa) {
+			continue;
+		}
+		o = ixfr_findrr(&dst->diff, t, &count);
+		if (count > 1 || (o != NULL && o->op == t->op)) {
+			return (false);
+		}
+	}
+
+	/* The intermediate serial disappears */
+	ISC_LIST_UNLINK(dst->diff.tuples, dstsoa, link);
+	dns_difftuple_free(&dstsoa);
+	ISC_LIST_UNLINK(src->diff.tuples, srcsoa, link);
+	dns_difftuple_free(&srcsoa);
+
+	while ((t = ISC_LIST_HEAD(src->diff.tuples)) != NULL) {
+		ISC_LIST_UNLINK(src->diff.tuples, t, link);
+		o = NULL;
+		if (t->rdata.type != dns_rdatatype_soa) {
+			o = ixfr_findrr(&dst->diff, t, NULL);
+		}
+
+		/*
+		 * An add followed by a delete cancels out, and so does a
+		 * delete followed by an add, unless the TTL changed.
+		 */
+		if (o != NULL && o->op != t->op &&
+		    (o->op == DNS_DIFFOP_ADD || o->ttl == t->ttl))
+		{
+			ISC_LIST_UNLINK(dst->diff.tuples, o, link);
+			dns_difftuple_free(&o);
+			dns_difftuple_free(&t);
+			continue;
+		}
+		ISC_LIST_APPEND(dst->diff.tuples, t, link);
+	}
+
+	/*
+	 * Put the result back into the order of a single transaction:
+	 * the old SOA and the deletions, then the new SOA and additions.
+	 */
+	for (t = ISC_LIST_HEAD(dst->diff.tuples); t != NULL; t = o) {
+		o = ISC_LIST_NEXT(t, link);
+		if (t->op != DNS_DIFFOP_ADD) {
+			continue;
+		}
+		ISC_LIST_UNLINK(dst->diff.tuples, t, link);
+		if (t->rdata.type == dns_rdatatype_soa) {
+			ISC_LIST_PREPEND(adds, t, link);
+		} else {
+			ISC_LIST_APPEND(adds, t, link);
+		}
+	}
+	ISC_LIST_APPENDLIST(dst->diff.tuples, adds, link);
+
+	dst->size += src->size;
+	dst->ntrans += src->ntrans;
+
+	return (true);
 }
 
+/*
+ * Apply a batch of consecutive IXFR transactions to the database, as
+ * merged into 'merged' if there is more than one, and then write each
+ * of them to the journal, so that the journal keeps every serial that
+ * downstream servers may ask for.
+ */
 static isc_result_t
-ixfr_apply_one(dns_xfrin_t *xfr, ixfr_apply_data_t *data) {
+ixfr_apply_one(dns_xfrin_t *xfr, xfrin_apply_list_t *batch,
+	       xfrin_apply_data_t *merged) {
 	isc_result_t result = ISC_R_SUCCESS;
 	uint64_t records;
+	dns_diff_t *diff = NULL;
 
-	CHECK(ixfr_begin_transaction(xfr));
+	diff = merged != NULL ? &merged->diff : &ISC_LIST_HEAD(*batch)->diff;
 
-	CHECK(dns_diff_apply(&data->diff, xfr->db, xfr->ver));
+	CHECK(dns_diff_apply(diff, xfr->db, xfr->ver));
 	if (xfr->maxrecords != 0U) {
 		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
 		if (result == ISC_R_SUCCESS && records > xfr->maxrecords) {
@@ -501,25 +787,74 @@ ixfr_apply_one(dns_xfrin_t *xfr, ixfr_apply_data_t *data) {
 			goto failure;
 		}
 	}
+	CHECK(dns_zone_verifydb(xfr->zone, xfr->db, xfr->ver));
+
 	if (xfr->ixfr.journal != NULL) {
-		CHECK(dns_journal_writediff(xfr->ixfr.journal, &data->diff));
+		for (xfrin_apply_data_t *data = ISC_LIST_HEAD(*batch);
+		     data != NULL; data = ISC_LIST_NEXT(data, link))
+		{
+			CHECK(dns_journal_begin_transaction(xfr->ixfr.journal));
+			CHECK(dns_journal_writediff(xfr->ixfr.journal,
+						    &data->diff));
+			CHECK(dns_journal_commit(xfr->ixfr.journal));
+		}
 	}
 
-	result = ixfr_end_transaction(xfr);
-
-	return (result);
 failure:
-	/* We need to end the transaction, but keep the previous error */
-	(void)ixfr_end_transaction(xfr);
+	return (result);
+}
+
+/*
+ * Apply a batch, timing how long it takes.
+ */
+static isc_result_t
+ixfr_apply_timed(dns_xfrin_t *xfr, xfrin_apply_list_t *batch,
+		 xfrin_apply_data_t *merged) {
+	isc_result_t result;
+	isc_time_t start = isc_time_now_hires();
+	isc_time_t stop;
+	uint64_t usecs;
+	unsigned int ntrans = merged != NULL ? merged->ntrans : 1;
+
+	result = ixfr_apply_one(xfr, batch, merged);
+
+	stop = isc_time_now_hires();
+	usecs = isc_time_microdiff(&stop, &start);
+	atomic_fetch_add_relaxed(&xfr->ntrans, ntrans);
+	atomic_fetch_add_relaxed(&xfr->nupdates, 1);
+	atomic_fetch_add_relaxed(&xfr->applyus, usecs);
+	if (usecs > atomic_load_relaxed(&xfr->maxus)) {
+		atomic_store_relaxed(&xfr->maxus, usecs);
+	}
+
+	xfrin_log(xfr, ISC_LOG_DEBUG(3),
+		  "applied %u transaction%s in %" PRIu64 " us: %s", ntrans,
+		  ntrans == 1 ? "" : "s", usecs, isc_result_totext(result));
 
 	return (result);
 }
 
+static void
+ixfr_freebatch(dns_xfrin_t *xfr, xfrin_apply_list_t *batch,
+	       xfrin_apply_data_t **mergedp) {
+	xfrin_apply_data_t *data = NULL;
+
+	while ((data = ISC_LIST_HEAD(*batch)) != NULL) {
+		ISC_LIST_UNLINK(*batch, data, link);
+		ixfr_freedata(xfr->mctx, &data);
+	}
+	if (*mergedp != NULL) {
+		ixfr_freedata(xfr->mctx, mergedp);
+	}
+}
+
 static void
 ixfr_apply(void *arg) {
 	xfrin_work_t *work = arg;
 	dns_xfrin_t *xfr = work->xfr;
 	isc_result_t result = ISC_R_SUCCESS;
+	xfrin_apply_list_t batch = ISC_LIST_INITIALIZER;
+	xfrin_apply_data_t *merged = NULL;
 
 	REQUIRE(VALID_XFRIN(xfr));
 
@@ -533,25 +868,57 @@ ixfr_apply(void *arg) {
 		&diff_head, &diff_tail, &xfr->diff_head, &xfr->diff_tail);
 	INSIST(ret == CDS_WFCQ_RET_DEST_EMPTY);
 
+	/*
+	 * The transactions received while the previous ones were being
+	 * applied are merged as far as possible and applied together.
+	 * The merge works on copies, since the transactions themselves
+	 * still have to be written to the journal.
+	 */
 	struct cds_wfcq_node *node, *next;
 	__cds_wfcq_for_each_blocking_safe(&diff_head, &diff_tail, node, next) {
-		ixfr_apply_data_t *data =
-			caa_container_of(node, ixfr_apply_data_t, wfcq_node);
+		xfrin_apply_data_t *data =
+			caa_container_of(node, xfrin_apply_data_t, wfcq_node);
+		xfrin_apply_data_t *first = ISC_LIST_HEAD(batch);
 
 		if (atomic_load(&xfr->shuttingdown)) {
 			result = ISC_R_SHUTTINGDOWN;
 		}
 
+		if (result == ISC_R_SUCCESS && first != NULL &&
+		    (merged != NULL ? merged->size : first->size) +
+				    data->size <=
+			    XFRIN_COALESCE_MAX)
+		{
+			xfrin_apply_data_t *copy = NULL;
+			bool coalesced;
+
+			if (merged == NULL) {
+				merged = ixfr_copydata(xfr->mctx, first);
+			}
+			copy = ixfr_copydata(xfr->mctx, data);
+			coalesced = ixfr_coalesce(merged, copy);
+			ixfr_freedata(xfr->mctx, &copy);
+			if (coalesced) {
+				ISC_LIST_APPEND(batch, data, link);
+				continue;
+			}
+		}
+
 		/* Apply only until first failure */
-		if (result == ISC_R_SUCCESS) {
+		if (result == ISC_R_SUCCESS && first != NULL) {
 			/* This also checks for shuttingdown condition */
-			result = ixfr_apply_one(xfr, data);
+			result = ixfr_apply_timed(xfr, &batch, merged);
 		}
 
 		/* We need to clear and free all data chunks */
-		dns_diff_clear(&data->diff);
-		isc_mem_put(xfr->mctx, data, sizeof(*data));
+		ixfr_freebatch(xfr, &batch, &merged);
+		ISC_LIST_APPEND(batch, data, link);
+	}
+
+	if (result == ISC_R_SUCCESS && !ISC_LIST_EMPTY(batch)) {
+		result = ixfr_apply_timed(xfr, &batch, merged);
 	}
+	ixfr_freebatch(xfr, &batch, &merged);
 
 	work->result = result;
 }
@@ -605,9 +972,13 @@ failure:
 static isc_result_t
 ixfr_commit(dns_xfrin_t *xfr) {
 	isc_result_t result = ISC_R_SUCCESS;
-	ixfr_apply_data_t *data = isc_mem_get(xfr->mctx, sizeof(*data));
+	xfrin_apply_data_t *data = isc_mem_get(xfr->mctx, sizeof(*data));
 
-	*data = (ixfr_apply_data_t){ 0 };
+	*data = (xfrin_apply_data_t){
+		.size = xfr->diffsize,
+		.ntrans = 1,
+	};
+	ISC_LINK_INIT(data, link);
 	cds_wfcq_node_init(&data->wfcq_node);
 
 	if (xfr->ver == NULL) {
@@ -617,6 +988,7 @@ ixfr_commit(dns_xfrin_t *xfr) {
 	dns_diff_init(xfr->mctx, &data->diff);
 	/* FIXME: Should we add dns_diff_move() */
 	ISC_LIST_MOVE(data->diff.tuples, xfr->diff.tuples);
+	xfr->diffsize = 0;
 
 	(void)cds_wfcq_enqueue(&xfr->diff_head, &xfr->diff_tail,
 			       &data->wfcq_node);
@@ -996,13 +1368,23 @@ dns_xfrin_getendserial(dns_xfrin_t *xfr) {
 
 void
 dns_xfrin_getstats(dns_xfrin_t *xfr, unsigned int *nmsgp, unsigned int *nrecsp,
-		   uint64_t *nbytesp) {
+		   uint64_t *nbytesp, uint64_t *ratep, uint64_t *peakp) {
+	uint64_t nbytes, msecs;
+	isc_time_t now = isc_time_now();
+	isc_time_t start;
+
 	REQUIRE(VALID_XFRIN(xfr));
 	REQUIRE(nmsgp != NULL && nrecsp != NULL && nbytesp != NULL);
 
+	nbytes = atomic_load_relaxed(&xfr->nbytes);
+	start = atomic_load_relaxed(&xfr->start);
+	msecs = isc_time_microdiff(&now, &start) / 1000;
+
 	SET_IF_NOT_NULL(nmsgp, atomic_load_relaxed(&xfr->nmsg));
 	SET_IF_NOT_NULL(nrecsp, atomic_load_relaxed(&xfr->nrecs));
-	SET_IF_NOT_NULL(nbytesp, atomic_load_relaxed(&xfr->nbytes));
+	SET_IF_NOT_NULL(nbytesp, nbytes);
+	SET_IF_NOT_NULL(ratep, nbytes * 1000 / ISC_MAX(msecs, 1));
+	SET_IF_NOT_NULL(peakp, atomic_load_relaxed(&xfr->peak));
 }
 
 const isc_sockaddr_t *
@@ -1082,6 +1464,7 @@ xfrin_reset(dns_xfrin_t *xfr) {
 	}
 
 	dns_diff_clear(&xfr->diff);
+	xfr->diffsize = 0;
 
 	if (xfr->ixfr.journal != NULL) {
 		dns_journal_destroy(&xfr->ixfr.journal);
@@ -1938,18 +2321,26 @@ xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg) {
 		xfrin_cancelio(xfr);
 		break;
 	default:
-		/*
-		 * Read the next message.
-		 */
 		dns_message_detach(&msg);
-		dns_dispatch_getnext(xfr->dispentry);
 
-		isc_interval_t interval;
-		isc_interval_set(&interval, dns_zone_getidlein(xfr->zone), 0);
-		isc_timer_start(xfr->max_idle_timer, isc_timertype_once,
-				&interval);
+		/*
+		 * If the loader has fallen behind, keep the reference for
+		 * the next read and let axfr_apply_done() resume reading
+		 * once it has caught up.
+		 */
+		if (xfr->diff_running &&
+		    atomic_load_relaxed(&xfr->queued) >= XFRIN_MAXQUEUED)
+		{
+			xfrin_log(xfr, ISC_LOG_DEBUG(3),
+				  "pausing transfer while loading");
+			xfr->stalled = true;
+			return;
+		}
 
-		LIBDNS_XFRIN_READ(xfr, xfr->info, result);
+		/*
+		 * Read the next message.
+		 */
+		xfrin_readnext(xfr);
 		return;
 	}
 
@@ -1965,6 +2356,18 @@ failure:
 	LIBDNS_XFRIN_RECV_DONE(xfr, xfr->info, result);
 }
 
+static void
+xfrin_readnext(dns_xfrin_t *xfr) {
+	isc_interval_t interval;
+
+	dns_dispatch_getnext(xfr->dispentry);
+
+	isc_interval_set(&interval, dns_zone_getidlein(xfr->zone), 0);
+	isc_timer_start(xfr->max_idle_timer, isc_timertype_once, &interval);
+
+	LIBDNS_XFRIN_READ(xfr, xfr->info, ISC_R_SUCCESS);
+}
+
 static void
 xfrin_destroy(dns_xfrin_t *xfr) {
 	uint64_t msecs, persec;
@@ -2004,19 +2407,33 @@ xfrin_destroy(dns_xfrin_t *xfr) {
 		  atomic_load_relaxed(&xfr->nbytes),
 		  (unsigned int)(msecs / 1000), (unsigned int)(msecs % 1000),
 		  (unsigned int)persec, atomic_load_relaxed(&xfr->end_serial));
-
-	/* Cleanup unprocessed IXFR data */
+	if (atomic_load_relaxed(&xfr->nupdates) != 0) {
+		unsigned int nupdates = atomic_load_relaxed(&xfr->nupdates);
+		xfrin_log(xfr, ISC_LOG_INFO,
+			  "applied %u transactions in %u updates, "
+			  "%" PRIu64 " us average, %" PRIu64 " us max",
+			  atomic_load_relaxed(&xfr->ntrans), nupdates,
+			  atomic_load_relaxed(&xfr->applyus) / nupdates,
+			  atomic_load_relaxed(&xfr->maxus));
+	}
+	if (atomic_load_relaxed(&xfr->peak) != 0) {
+		xfrin_log(xfr, ISC_LOG_DEBUG(1),
+			  "at most %" PRIu64 " bytes were waiting to be loaded",
+			  atomic_load_relaxed(&xfr->peak));
+	}
+
+	/* Cleanup unprocessed AXFR and IXFR data */
 	struct cds_wfcq_node *node, *next;
 	__cds_wfcq_for_each_blocking_safe(&xfr->diff_head, &xfr->diff_tail,
 					  node, next) {
-		ixfr_apply_data_t *data =
-			caa_container_of(node, ixfr_apply_data_t, wfcq_node);
+		xfrin_apply_data_t *data =
+			caa_container_of(node, xfrin_apply_data_t, wfcq_node);
 		/* We need to clear and free all data chunks */
 		dns_diff_clear(&data->diff);
 		isc_mem_put(xfr->mctx, data, sizeof(*data));
 	}
 
-	/* Cleanup unprocessed AXFR data */
+	/* Cleanup data not yet queued */
 	dns_diff_clear(&xfr->diff);
 
 	xfrin_cancelio(xfr);
@@ -22,6 +22,7 @@
 #include <isc/file.h>
 #include <isc/hash.h>
 #include <isc/hashmap.h>
+#include <isc/heap.h>
 #include <isc/hex.h>
 #include <isc/loop.h>
 #include <isc/md.h>
@@ -42,6 +43,7 @@
 #include <isc/timer.h>
 #include <isc/tls.h>
 #include <isc/util.h>
+#include <isc/work.h>
 
 #include <dns/acl.h>
 #include <dns/adb.h>
@@ -179,6 +181,7 @@ typedef ISC_LIST(dns_nsec3chain_t) dns_nsec3chainlist_t;
 typedef struct dns_nsfetch dns_nsfetch_t;
 typedef struct dns_keyfetch dns_keyfetch_t;
 typedef struct dns_asyncload dns_asyncload_t;
+typedef struct dns_journalpunch dns_journalpunch_t;
 typedef struct dns_include dns_include_t;
 
 #define DNS_ZONE_CHECKLOCK
@@ -265,6 +268,15 @@ struct dns_zone {
 	isc_rwlock_t dblock;
 	dns_db_t *db; /* Locked by dblock */
 
+	/*%
+	 * Bumped whenever the zone database is replaced or a new version
+	 * of it is committed; 'dbnotify' is false if the current database
+	 * can change without telling us.  Starts at a random value so that
+	 * a zone reusing the memory of a freed one won't match its state.
+	 */
+	atomic_uint_fast32_t generation;
+	atomic_bool dbnotify;
+
 	unsigned int tid;
 
 	/* Locked */
@@ -293,6 +305,10 @@ struct dns_zone {
 	isc_time_t refreshtime;
 	isc_time_t dumptime;
 	isc_time_t loadtime;
+	isc_time_t loadstart;
+	uint64_t loadusecs;
+	off_t loadsize;
+	dns_zonemgr_t *loadzmgr;
 	isc_time_t notifytime;
 	isc_time_t resigntime;
 	isc_time_t keywarntime;
@@ -557,6 +573,10 @@ typedef enum {
 						      * just being loaded for
 						      * the first time. */
 	DNS_ZONEFLG_FIRSTREFRESH = 0x100000000U, /*%< First refresh pending */
+	DNS_ZONEFLG_COMPACTING = 0x200000000U,	 /*%< journal space is being
+						  * released */
+	DNS_ZONEFLG_NOPUNCH = 0x400000000U,	 /*%< journal space cannot be
+						  * released in place */
 	DNS_ZONEFLG___MAX = UINT64_MAX, /* trick to make the ENUM 64-bit wide */
 } dns_zoneflg_t;
 
@@ -624,6 +644,21 @@ struct dns_zonemgr {
 	unsigned int serialqueryrate;
 	unsigned int startupserialqueryrate;
 
+	/* Zone load scheduler, locked by loadlock. */
+	isc_mutex_t loadlock;
+	isc_heap_t *loadqueue;
+	unsigned int loadconcurrency;
+	unsigned int loadsqueued;
+	unsigned int loadsactive;
+	uint64_t loadsdone;
+	uint64_t loadsfailed;
+	uint64_t loadbytes;
+	uint64_t loadusecs;
+	uint64_t compactbytes;
+	uint64_t compactusecs;
+	bool loadshutdown;
+	isc_stats_t *stats;
+
 	/* Locked by urlock. */
 	/* LRU cache */
 	struct dns_unreachable unreachable[UNREACH_CACHE_SIZE];
@@ -797,9 +832,27 @@ struct dns_nsfetch {
  */
 struct dns_asyncload {
 	dns_zone_t *zone;
+	dns_zonemgr_t *zmgr;
 	unsigned int flags;
 	dns_zt_callback_t *loaded;
 	void *loaded_arg;
+	/* Scheduling priority, see asyncload_higher() */
+	bool reload;
+	uint64_t usecs;
+	off_t size;
+	unsigned int heap_index;
+};
+
+/*%
+ * Releasing the space of transactions dropped from a journal.
+ */
+struct dns_journalpunch {
+	dns_zone_t *zone;
+	char *journal;
+	uint32_t offset;
+	uint32_t freed;
+	isc_time_t start;
+	isc_result_t result;
 };
 
 /*%
@@ -868,6 +921,8 @@ static void
 zone_attachdb(dns_zone_t *zone, dns_db_t *db);
 static void
 zone_detachdb(dns_zone_t *zone);
+static isc_result_t
+zone_dbupdated(dns_db_t *db, void *fn_arg);
 static void
 zone_catz_enable(dns_zone_t *zone, dns_catz_zones_t *catzs);
 static void
@@ -888,6 +943,14 @@ zone_loaddone(void *arg, isc_result_t result);
 static isc_result_t
 zone_startload(dns_db_t *db, dns_zone_t *zone, isc_time_t loadtime);
 static void
+zone_loadslot_release(dns_zone_t *zone, isc_result_t result);
+static void
+zonemgr_loadqueue(dns_zonemgr_t *zmgr, dns_asyncload_t *asl);
+static void
+zonemgr_loadnext(dns_zonemgr_t *zmgr);
+static void
+zonemgr_loadstats(dns_zonemgr_t *zmgr);
+static void
 zone_namerd_tostr(dns_zone_t *zone, char *buf, size_t length);
 static void
 zone_name_tostr(dns_zone_t *zone, char *buf, size_t length);
@@ -1156,6 +1219,8 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx, unsigned int tid) {
 
 	isc_refcount_init(&zone->references, 1);
 	isc_refcount_init(&zone->irefs, 0);
+	atomic_init(&zone->generation, isc_random32());
+	atomic_init(&zone->dbnotify, false);
 	dns_name_init(&zone->origin, NULL);
 	isc_sockaddr_any(&zone->notifysrc4);
 	isc_sockaddr_any6(&zone->notifysrc6);
@@ -2350,14 +2415,40 @@ static void
 zone_asyncload(void *arg) {
 	dns_asyncload_t *asl = arg;
 	dns_zone_t *zone = asl->zone;
+	dns_zone_t *loading = zone;
 	isc_result_t result;
 
 	REQUIRE(DNS_ZONE_VALID(zone));
 
 	LOCK_ZONE(zone);
+	zone->loadstart = isc_time_now();
+	zone->loadsize = asl->size;
 	result = zone_load(zone, asl->flags, true);
 	if (result != DNS_R_CONTINUE) {
 		DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_LOADPENDING);
+		zone->loadzmgr = asl->zmgr;
+		asl->zmgr = NULL;
+		zone_loadslot_release(zone, result);
+	} else {
+		/*
+		 * The load finishes in zone_loaddone(), which hands the
+		 * slot back.  For an inline-signed zone whose raw zone is
+		 * being reloaded, that is the raw zone's load.
+		 */
+		if (inline_secure(zone) &&
+		    !DNS_ZONE_FLAG(zone, DNS_ZONEFLG_LOADING))
+		{
+			loading = zone->raw;
+			LOCK_ZONE(loading);
+			loading->loadstart = zone->loadstart;
+			loading->loadsize = zone->loadsize;
+		}
+		INSIST(loading->loadzmgr == NULL);
+		loading->loadzmgr = asl->zmgr;
+		asl->zmgr = NULL;
+		if (loading != zone) {
+			UNLOCK_ZONE(loading);
+		}
 	}
 	UNLOCK_ZONE(zone);
 
@@ -2389,15 +2480,21 @@ dns_zone_asyncload(dns_zone_t *zone, bool newonly, dns_zt_callback_t *done,
 	}
 
 	asl = isc_mem_get(zone->mctx, sizeof(*asl));
-
-	asl->zone = NULL;
-	asl->flags = newonly ? DNS_ZONELOADFLAG_NOSTAT : 0;
-	asl->loaded = done;
-	asl->loaded_arg = arg;
+	*asl = (dns_asyncload_t){
+		.flags = newonly ? DNS_ZONELOADFLAG_NOSTAT : 0,
+		.loaded = done,
+		.loaded_arg = arg,
+		.reload = DNS_ZONE_FLAG(zone, DNS_ZONEFLG_LOADED),
+		.usecs = zone->loadusecs,
+	};
+	if (zone->masterfile != NULL) {
+		(void)isc_file_getsize(zone->masterfile, &asl->size);
+	}
 
 	zone_iattach(zone, &asl->zone);
+	dns_zonemgr_attach(zone->zmgr, &asl->zmgr);
 	DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_LOADPENDING);
-	isc_async_run(zone->loop, zone_asyncload, asl);
+	zonemgr_loadqueue(asl->zmgr, asl);
 	UNLOCK_ZONE(zone);
 
 	return (ISC_R_SUCCESS);
@@ -11457,6 +11554,76 @@ zone_journal_rollforward(dns_zone_t *zone, dns_db_t *db, bool *needdump,
 	}
 }
 
+static void
+zone_compactstats(dns_zone_t *zone, uint64_t bytes, const isc_time_t *start) {
+	dns_zonemgr_t *zmgr = zone->zmgr;
+	isc_time_t now;
+
+	if (zmgr == NULL) {
+		return;
+	}
+
+	now = isc_time_now();
+	LOCK(&zmgr->loadlock);
+	zmgr->compactbytes += bytes;
+	zmgr->compactusecs += isc_time_microdiff(&now, start);
+	zonemgr_loadstats(zmgr);
+	UNLOCK(&zmgr->loadlock);
+}
+
+static void
+zone_journal_punch(void *arg) {
+	dns_journalpunch_t *punch = arg;
+
+	punch->result = dns_journal_punch(punch->journal, punch->offset);
+}
+
+static void
+zone_journal_punched(void *arg) {
+	dns_journalpunch_t *punch = arg;
+	dns_zone_t *zone = punch->zone;
+
+	LOCK_ZONE(zone);
+	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_COMPACTING);
+	switch (punch->result) {
+	case ISC_R_SUCCESS:
+		zone_compactstats(zone, punch->freed, &punch->start);
+		break;
+	case ISC_R_NOTIMPLEMENTED:
+		/*
+		 * The journal is copied from now on, which also gets rid
+		 * of what was dropped from it this time.
+		 */
+		dns_zone_log(zone, ISC_LOG_INFO,
+			     "journal space cannot be released in place, "
+			     "journal will be rewritten instead");
+		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_NOPUNCH);
+		break;
+	default:
+		dns_zone_log(zone, ISC_LOG_ERROR, "dns_journal_punch failed: %s",
+			     isc_result_totext(punch->result));
+		break;
+	}
+	UNLOCK_ZONE(zone);
+
+	isc_mem_free(zone->mctx, punch->journal);
+	isc_mem_put(zone->mctx, punch, sizeof(*punch));
+	dns_zone_idetach(&zone);
+}
+
+/*
+ * Drop the transactions before 'serial' from the journal, if it is
+ * larger than the configured size.
+ *
+ * A journal is compacted by moving its beginning forward, which only
+ * takes a header write; flushing it to disk and releasing the space of
+ * the dropped transactions happens on a worker thread, so the zone's
+ * loop does not wait for the disk.  The transactions that outgoing
+ * transfers are still reading are left for a later compaction.  A
+ * journal is copied into a new file instead when it has to be repaired
+ * or converted, when what is kept is small, or when the file system
+ * cannot release the space.
+ */
 static void
 zone_journal_compact(dns_zone_t *zone, dns_db_t *db, uint32_t serial) {
 	isc_result_t result;
@@ -11464,6 +11631,10 @@ zone_journal_compact(dns_zone_t *zone, dns_db_t *db, uint32_t serial) {
 	dns_dbversion_t *ver = NULL;
 	uint64_t dbsize;
 	uint32_t options = 0;
+	uint32_t begin = 0, freed = 0;
+	off_t before = 0, after = 0;
+	isc_time_t start;
+	const char *what = NULL;
 
 	INSIST(LOCKED_ZONE(zone));
 	if (inline_raw(zone)) {
@@ -11493,18 +11664,64 @@ zone_journal_compact(dns_zone_t *zone, dns_db_t *db, uint32_t serial) {
 		zone_debuglog(zone, __func__, 1, "target journal size %d",
 			      journalsize);
 	}
+
+	if (options == 0 && zone->loop != NULL &&
+	    !DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NOPUNCH))
+	{
+		if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_COMPACTING)) {
+			zone_debuglog(zone, __func__, 1,
+				      "journal space is still being released");
+			return;
+		}
+
+		what = "dns_journal_truncate";
+		start = isc_time_now();
+		result = dns_journal_truncate(zone->mctx, zone->journal,
+					      serial, journalsize, &begin,
+					      &freed);
+		if (result == ISC_R_SUCCESS && freed != 0) {
+			dns_journalpunch_t *punch = NULL;
+
+			punch = isc_mem_get(zone->mctx, sizeof(*punch));
+			*punch = (dns_journalpunch_t){
+				.journal = isc_mem_strdup(zone->mctx,
+							  zone->journal),
+				.offset = begin,
+				.freed = freed,
+				.start = start,
+			};
+			zone_iattach(zone, &punch->zone);
+			DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_COMPACTING);
+			isc_work_enqueue(zone->loop, zone_journal_punch,
+					 zone_journal_punched, punch);
+		}
+		if (result != ISC_R_NOTIMPLEMENTED) {
+			goto done;
+		}
+	}
+
+	what = "dns_journal_compact";
+	start = isc_time_now();
+	(void)isc_file_getsize(zone->journal, &before);
 	result = dns_journal_compact(zone->mctx, zone->journal, serial, options,
 				     journalsize);
+	if (result == ISC_R_SUCCESS &&
+	    isc_file_getsize(zone->journal, &after) == ISC_R_SUCCESS &&
+	    after < before)
+	{
+		zone_compactstats(zone, before - after, &start);
+	}
+
+done:
 	switch (result) {
 	case ISC_R_SUCCESS:
 	case ISC_R_NOSPACE:
 	case ISC_R_NOTFOUND:
-		dns_zone_log(zone, ISC_LOG_DEBUG(3), "dns_journal_compact: %s",
+		dns_zone_log(zone, ISC_LOG_DEBUG(3), "%s: %s", what,
 			     isc_result_totext(result));
 		break;
 	default:
-		dns_zone_log(zone, ISC_LOG_ERROR,
-			     "dns_journal_compact failed: %s",
+		dns_zone_log(zone, ISC_LOG_ERROR, "%s failed: %s", what,
 			     isc_result_totext(result));
 		break;
 	}
@@ -17556,6 +17773,16 @@ zone_attachdb(dns_zone_t *zone, dns_db_t *db) {
 	REQUIRE(zone->db == NULL && db != NULL);
 
 	dns_db_attach(db, &zone->db);
+
+	/*
+	 * Only the zone databases keep a list of update listeners;
+	 * anything else (e.g. dyndb backends) may change under us.
+	 */
+	if (db->update_listeners != NULL) {
+		dns_db_updatenotify_register(db, zone_dbupdated, zone);
+		atomic_store_release(&zone->dbnotify, true);
+	}
+	atomic_fetch_add_release(&zone->generation, 1);
 }
 
 /* The caller must hold the dblock as a writer. */
@@ -17565,9 +17792,24 @@ zone_detachdb(dns_zone_t *zone) {
 
 	dns_zone_rpz_disable_db(zone, zone->db);
 	dns_zone_catz_disable_db(zone, zone->db);
+	if (atomic_exchange_acq_rel(&zone->dbnotify, false)) {
+		dns_db_updatenotify_unregister(zone->db, zone_dbupdated, zone);
+	}
+	atomic_fetch_add_release(&zone->generation, 1);
 	dns_db_detach(&zone->db);
 }
 
+static isc_result_t
+zone_dbupdated(dns_db_t *db, void *fn_arg) {
+	dns_zone_t *zone = (dns_zone_t *)fn_arg;
+
+	UNUSED(db);
+
+	atomic_fetch_add_release(&zone->generation, 1);
+
+	return (ISC_R_SUCCESS);
+}
+
 static void
 zone_xfrdone(dns_zone_t *zone, uint32_t *expireopt, isc_result_t result) {
 	isc_time_t now, expiretime;
@@ -17878,6 +18120,48 @@ again:
 	}
 }
 
+/*
+ * Hand the load slot held by 'zone' back to its zone manager, if it
+ * holds one, and remember how long the load took so that the next
+ * reload can be scheduled accordingly.  Zone must be locked.
+ */
+static void
+zone_loadslot_release(dns_zone_t *zone, isc_result_t result) {
+	dns_zonemgr_t *zmgr = zone->loadzmgr;
+	bool loaded = (result == ISC_R_SUCCESS ||
+		       result == DNS_R_SEENINCLUDE);
+	isc_time_t now;
+	uint64_t usecs;
+
+	REQUIRE(LOCKED_ZONE(zone));
+
+	if (zmgr == NULL) {
+		return;
+	}
+	zone->loadzmgr = NULL;
+
+	now = isc_time_now();
+	usecs = isc_time_microdiff(&now, &zone->loadstart);
+	if (loaded) {
+		zone->loadusecs = ISC_MAX(usecs, 1);
+	}
+
+	LOCK(&zmgr->loadlock);
+	INSIST(zmgr->loadsactive > 0);
+	zmgr->loadsactive--;
+	if (loaded) {
+		zmgr->loadsdone++;
+		zmgr->loadbytes += zone->loadsize;
+		zmgr->loadusecs += usecs;
+	} else if (result != DNS_R_UPTODATE && result != DNS_R_DYNAMIC) {
+		zmgr->loadsfailed++;
+	}
+	zonemgr_loadnext(zmgr);
+	UNLOCK(&zmgr->loadlock);
+
+	dns_zonemgr_detach(&zmgr);
+}
+
 static void
 zone_loaddone(void *arg, isc_result_t result) {
 	dns_load_t *load = arg;
@@ -17925,6 +18209,7 @@ again:
 	}
 	(void)zone_postload(zone, load->db, load->loadtime, result);
 	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_LOADING);
+	zone_loadslot_release(zone, result);
 	zone_idetach(&load->callbacks.zone);
 	/*
 	 * Leave the zone frozen if the reload fails.
@@ -18794,6 +19079,105 @@ zonemgr_keymgmt_delete(dns_zonemgr_t *zmgr, dns_keyfileio_t **deleted) {
 	RWUNLOCK(&mgmt->lock, isc_rwlocktype_write);
 }
 
+/*
+ * Zone load scheduling.  Loads requested with dns_zone_asyncload() are
+ * queued in the zone manager and started on the zones' own loops, at
+ * most 'loadconcurrency' at a time.  Zones that have never been loaded
+ * go first, smallest file first, so that as many zones as possible are
+ * answering as early as possible.  Reloads follow, fastest previous
+ * load first.
+ */
+static bool
+asyncload_higher(void *v1, void *v2) {
+	dns_asyncload_t *asl1 = v1;
+	dns_asyncload_t *asl2 = v2;
+
+	if (asl1->reload != asl2->reload) {
+		return (!asl1->reload);
+	}
+	if (asl1->reload && asl1->usecs != asl2->usecs) {
+		if (asl1->usecs == 0 || asl2->usecs == 0) {
+			return (asl1->usecs != 0);
+		}
+		return (asl1->usecs < asl2->usecs);
+	}
+	return (asl1->size < asl2->size);
+}
+
+static void
+asyncload_index(void *what, unsigned int idx) {
+	dns_asyncload_t *asl = what;
+
+	asl->heap_index = idx;
+}
+
+/*
+ * Publish the load scheduler and journal compaction counters.
+ * loadlock must be held.
+ */
+static void
+zonemgr_loadstats(dns_zonemgr_t *zmgr) {
+	if (zmgr->stats == NULL) {
+		return;
+	}
+
+	isc_stats_set(zmgr->stats, zmgr->loadsqueued,
+		      dns_zonestatscounter_loadqueued);
+	isc_stats_set(zmgr->stats, zmgr->loadsactive,
+		      dns_zonestatscounter_loadactive);
+	isc_stats_set(zmgr->stats, zmgr->loadsdone,
+		      dns_zonestatscounter_loadsuccess);
+	isc_stats_set(zmgr->stats, zmgr->loadsfailed,
+		      dns_zonestatscounter_loadfail);
+	isc_stats_set(zmgr->stats, zmgr->loadbytes,
+		      dns_zonestatscounter_loadbytes);
+	isc_stats_set(zmgr->stats, zmgr->loadusecs,
+		      dns_zonestatscounter_loadusecs);
+	isc_stats_set(zmgr->stats, zmgr->compactbytes,
+		      dns_zonestatscounter_compactbytes);
+	isc_stats_set(zmgr->stats, zmgr->compactusecs,
+		      dns_zonestatscounter_compactusecs);
+}
+
+/*
+ * Start as many queued loads as the concurrency limit allows; once the
+ * zone manager is shutting down, start them all.  loadlock must be held.
+ */
+static void
+zonemgr_loadnext(dns_zonemgr_t *zmgr) {
+	dns_asyncload_t *asl = NULL;
+
+	while (zmgr->loadshutdown ||
+	       zmgr->loadsactive < zmgr->loadconcurrency)
+	{
+		asl = isc_heap_element(zmgr->loadqueue, 1);
+		if (asl == NULL) {
+			break;
+		}
+		isc_heap_delete(zmgr->loadqueue, 1);
+		zmgr->loadsqueued--;
+		zmgr->loadsactive++;
+
+		/*
+		 * The zone may have been released from the zone manager
+		 * while it was queued, so don't rely on zone->loop.
+		 */
+		isc_async_run(isc_loop_get(zmgr->loopmgr, asl->zone->tid),
+			      zone_asyncload, asl);
+	}
+
+	zonemgr_loadstats(zmgr);
+}
+
+static void
+zonemgr_loadqueue(dns_zonemgr_t *zmgr, dns_asyncload_t *asl) {
+	LOCK(&zmgr->loadlock);
+	isc_heap_insert(zmgr->loadqueue, asl);
+	zmgr->loadsqueued++;
+	zonemgr_loadnext(zmgr);
+	UNLOCK(&zmgr->loadlock);
+}
+
 void
 dns_zonemgr_create(isc_mem_t *mctx, isc_nm_t *netmgr, dns_zonemgr_t **zmgrp) {
 	dns_zonemgr_t *zmgr = NULL;
@@ -18812,6 +19196,7 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_nm_t *netmgr, dns_zonemgr_t **zmgrp) {
 		.workers = isc_loopmgr_nloops(loopmgr),
 		.transfersin = 10,
 		.transfersperns = 2,
+		.loadconcurrency = isc_loopmgr_nloops(loopmgr),
 	};
 
 	isc_refcount_init(&zmgr->refs, 1);
@@ -18829,6 +19214,11 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_nm_t *netmgr, dns_zonemgr_t **zmgrp) {
 	/* Unreachable lock. */
 	isc_rwlock_init(&zmgr->urlock);
 
+	/* Zone load scheduler. */
+	isc_mutex_init(&zmgr->loadlock);
+	isc_heap_create(zmgr->mctx, asyncload_higher, asyncload_index, 0,
+			&zmgr->loadqueue);
+
 	isc_ratelimiter_create(loop, &zmgr->checkdsrl);
 	isc_ratelimiter_create(loop, &zmgr->notifyrl);
 	isc_ratelimiter_create(loop, &zmgr->refreshrl);
@@ -19021,6 +19411,12 @@ dns_zonemgr_shutdown(dns_zonemgr_t *zmgr) {
 	isc_ratelimiter_shutdown(zmgr->startupnotifyrl);
 	isc_ratelimiter_shutdown(zmgr->startuprefreshrl);
 
+	/* Don't hold back any queued loads, they must run to completion. */
+	LOCK(&zmgr->loadlock);
+	zmgr->loadshutdown = true;
+	zonemgr_loadnext(zmgr);
+	UNLOCK(&zmgr->loadlock);
+
 	for (size_t i = 0; i < zmgr->workers; i++) {
 		isc_mem_detach(&zmgr->mctxpool[i]);
 	}
@@ -19052,6 +19448,13 @@ zonemgr_free(dns_zonemgr_t *zmgr) {
 	isc_mem_cput(zmgr->mctx, zmgr->mctxpool, zmgr->workers,
 		     sizeof(zmgr->mctxpool[0]));
 
+	INSIST(zmgr->loadsqueued == 0);
+	isc_heap_destroy(&zmgr->loadqueue);
+	isc_mutex_destroy(&zmgr->loadlock);
+	if (zmgr->stats != NULL) {
+		isc_stats_detach(&zmgr->stats);
+	}
+
 	isc_rwlock_destroy(&zmgr->urlock);
 	isc_rwlock_destroy(&zmgr->rwlock);
 	isc_rwlock_destroy(&zmgr->tlsctx_cache_rwlock);
@@ -19078,6 +19481,41 @@ dns_zonemgr_gettransfersin(dns_zonemgr_t *zmgr) {
 	return (zmgr->transfersin);
 }
 
+void
+dns_zonemgr_setloadconcurrency(dns_zonemgr_t *zmgr, unsigned int value) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	LOCK(&zmgr->loadlock);
+	zmgr->loadconcurrency = (value == 0) ? zmgr->workers : value;
+	zonemgr_loadnext(zmgr);
+	UNLOCK(&zmgr->loadlock);
+}
+
+unsigned int
+dns_zonemgr_getloadconcurrency(dns_zonemgr_t *zmgr) {
+	unsigned int value;
+
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	LOCK(&zmgr->loadlock);
+	value = zmgr->loadconcurrency;
+	UNLOCK(&zmgr->loadlock);
+
+	return (value);
+}
+
+void
+dns_zonemgr_setstats(dns_zonemgr_t *zmgr, isc_stats_t *stats) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+	REQUIRE(stats != NULL);
+
+	LOCK(&zmgr->loadlock);
+	REQUIRE(zmgr->stats == NULL);
+	isc_stats_attach(stats, &zmgr->stats);
+	zonemgr_loadstats(zmgr);
+	UNLOCK(&zmgr->loadlock);
+}
+
 void
 dns_zonemgr_settransfersperns(dns_zonemgr_t *zmgr, uint32_t value) {
 	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
@@ -24041,6 +24479,20 @@ dns_zone_getgluecachestats(dns_zone_t *zone) {
 	return (zone->gluecachestats);
 }
 
+uint32_t
+dns_zone_getgeneration(dns_zone_t *zone) {
+	uint32_t generation;
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	generation = atomic_load_acquire(&zone->generation);
+	if (!atomic_load_acquire(&zone->dbnotify)) {
+		return (0);
+	}
+
+	return (generation);
+}
+
 bool
 dns_zone_isloaded(dns_zone_t *zone) {
 	REQUIRE(DNS_ZONE_VALID(zone));
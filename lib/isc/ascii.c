@@ -11,10 +11,14 @@
  * information regarding copyright ownership.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
 #include <isc/ascii.h>
+#include <isc/util.h>
+
+#include "ascii_p.h"
 
 const uint8_t isc__ascii_tolower[256] = {
 	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
@@ -65,3 +69,221 @@ const uint8_t isc__ascii_toupper[256] = {
 	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb,
 	0xfc, 0xfd, 0xfe, 0xff
 };
+
+typedef bool
+lowerequal_fn(const uint8_t *a, const uint8_t *b, unsigned int len);
+typedef int
+lowercmp_fn(const uint8_t *a, const uint8_t *b, unsigned int len);
+
+static bool
+lowerequal_swar(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	return (isc_ascii_lowerequal(a, b, len));
+}
+
+static int
+lowercmp_swar(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	return (isc_ascii_lowercmp(a, b, len));
+}
+
+#if HAVE_X86_SIMD_TARGET
+
+#include <immintrin.h>
+
+/*
+ * Strings shorter than a vector are left to the SWAR code. Longer ones
+ * are processed a vector at a time, and the last vector overlaps the
+ * previous one instead of running over the end of the strings; that is
+ * harmless for ordering too, because the overlapping bytes are known
+ * to be equal.
+ */
+
+__attribute__((target("sse4.2"))) static __m128i
+tolower_sse(__m128i bytes) {
+	/* signed comparisons, so non-ASCII bytes are not upper case */
+	__m128i ge_A = _mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1));
+	__m128i gt_Z = _mm_cmpgt_epi8(bytes, _mm_set1_epi8('Z'));
+	__m128i upper = _mm_andnot_si128(gt_Z, ge_A);
+	return (_mm_add_epi8(bytes,
+			     _mm_and_si128(upper, _mm_set1_epi8('a' - 'A'))));
+}
+
+/*
+ * Return a bit mask of the bytes that differ in the 16 bytes at `a`
+ * and `b`, ignoring case.
+ */
+__attribute__((target("sse4.2"))) static unsigned int
+lowerdiff_sse(const uint8_t *a, const uint8_t *b) {
+	__m128i x = tolower_sse(_mm_loadu_si128((const __m128i *)a));
+	__m128i y = tolower_sse(_mm_loadu_si128((const __m128i *)b));
+	return (~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff);
+}
+
+__attribute__((target("sse4.2"))) static bool
+lowerequal_sse(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	if (len < 16) {
+		return (isc_ascii_lowerequal(a, b, len));
+	}
+	for (unsigned int i = 0; i < len; i += 16) {
+		unsigned int off = ISC_MIN(i, len - 16);
+		if (lowerdiff_sse(a + off, b + off) != 0) {
+			return (false);
+		}
+	}
+	return (true);
+}
+
+static int
+lowercmp_at(const uint8_t *a, const uint8_t *b, unsigned int n) {
+	return (isc_ascii_tolower(a[n]) < isc_ascii_tolower(b[n]) ? -1 : +1);
+}
+
+__attribute__((target("sse4.2"))) static int
+lowercmp_sse(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	if (len < 16) {
+		return (isc_ascii_lowercmp(a, b, len));
+	}
+	for (unsigned int i = 0; i < len; i += 16) {
+		unsigned int off = ISC_MIN(i, len - 16);
+		unsigned int diff = lowerdiff_sse(a + off, b + off);
+		if (diff != 0) {
+			return (lowercmp_at(a, b, off + __builtin_ctz(diff)));
+		}
+	}
+	return (0);
+}
+
+__attribute__((target("avx2"))) static __m256i
+tolower_avx2(__m256i bytes) {
+	__m256i ge_A = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('A' - 1));
+	__m256i gt_Z = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('Z'));
+	__m256i upper = _mm256_andnot_si256(gt_Z, ge_A);
+	return (_mm256_add_epi8(
+		bytes, _mm256_and_si256(upper, _mm256_set1_epi8('a' - 'A'))));
+}
+
+__attribute__((target("avx2"))) static uint32_t
+lowerdiff_avx2(const uint8_t *a, const uint8_t *b) {
+	__m256i x = tolower_avx2(_mm256_loadu_si256((const __m256i *)a));
+	__m256i y = tolower_avx2(_mm256_loadu_si256((const __m256i *)b));
+	return (~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+}
+
+__attribute__((target("avx2,sse4.2"))) static bool
+lowerequal_avx2(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	if (len < 32) {
+		return (lowerequal_sse(a, b, len));
+	}
+	for (unsigned int i = 0; i < len; i += 32) {
+		unsigned int off = ISC_MIN(i, len - 32);
+		if (lowerdiff_avx2(a + off, b + off) != 0) {
+			return (false);
+		}
+	}
+	return (true);
+}
+
+__attribute__((target("avx2,sse4.2"))) static int
+lowercmp_avx2(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	if (len < 32) {
+		return (lowercmp_sse(a, b, len));
+	}
+	for (unsigned int i = 0; i < len; i += 32) {
+		unsigned int off = ISC_MIN(i, len - 32);
+		uint32_t diff = lowerdiff_avx2(a + off, b + off);
+		if (diff != 0) {
+			return (lowercmp_at(a, b, off + __builtin_ctz(diff)));
+		}
+	}
+	return (0);
+}
+
+#endif /* HAVE_X86_SIMD_TARGET */
+
+static struct {
+	const char *name;
+	lowerequal_fn *lowerequal;
+	lowercmp_fn *lowercmp;
+} impls[ISC__ASCII_IMPLS] = {
+	[ISC__ASCII_SWAR] = { "swar", lowerequal_swar, lowercmp_swar },
+#if HAVE_X86_SIMD_TARGET
+	[ISC__ASCII_SSE42] = { "sse4.2", lowerequal_sse, lowercmp_sse },
+	[ISC__ASCII_AVX2] = { "avx2", lowerequal_avx2, lowercmp_avx2 },
+#else
+	[ISC__ASCII_SSE42] = { "sse4.2", NULL, NULL },
+	[ISC__ASCII_AVX2] = { "avx2", NULL, NULL },
+#endif /* HAVE_X86_SIMD_TARGET */
+};
+
+static isc__ascii_impl_t impl = ISC__ASCII_SWAR;
+static lowerequal_fn *lowerequal = lowerequal_swar;
+static lowercmp_fn *lowercmp = lowercmp_swar;
+
+static bool
+impl_supported(isc__ascii_impl_t i) {
+	switch (i) {
+	case ISC__ASCII_SWAR:
+		return (true);
+#if HAVE_X86_SIMD_TARGET
+	case ISC__ASCII_SSE42:
+		return (__builtin_cpu_supports("sse4.2"));
+	case ISC__ASCII_AVX2:
+		return (__builtin_cpu_supports("sse4.2") &&
+			__builtin_cpu_supports("avx2"));
+#endif /* HAVE_X86_SIMD_TARGET */
+	default:
+		return (false);
+	}
+}
+
+static void
+impl_set(isc__ascii_impl_t i) {
+	impl = i;
+	lowerequal = impls[i].lowerequal;
+	lowercmp = impls[i].lowercmp;
+}
+
+void
+isc__ascii_initialize(void) {
+#if HAVE_X86_SIMD_TARGET
+	__builtin_cpu_init();
+#endif /* HAVE_X86_SIMD_TARGET */
+	for (isc__ascii_impl_t i = ISC__ASCII_IMPLS; i-- > 0;) {
+		if (impl_supported(i)) {
+			impl_set(i);
+			break;
+		}
+	}
+}
+
+bool
+isc__ascii_setimpl(isc__ascii_impl_t i) {
+	REQUIRE(i < ISC__ASCII_IMPLS);
+
+	if (!impl_supported(i)) {
+		return (false);
+	}
+	impl_set(i);
+	return (true);
+}
+
+isc__ascii_impl_t
+isc__ascii_getimpl(void) {
+	return (impl);
+}
+
+const char *
+isc__ascii_impltext(isc__ascii_impl_t i) {
+	REQUIRE(i < ISC__ASCII_IMPLS);
+	return (impls[i].name);
+}
+
+bool
+isc_ascii_lowerequal_wide(const uint8_t *a, const uint8_t *b,
+			  unsigned int len) {
+	return (lowerequal(a, b, len));
+}
+
+int
+isc_ascii_lowercmp_wide(const uint8_t *a, const uint8_t *b, unsigned int len) {
+	return (lowercmp(a, b, len));
+}
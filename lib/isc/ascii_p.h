@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include <isc/lang.h>
+
+/*! \file */
+
+/*%
+ *     Types and functions below not be used outside this module and its
+ *     associated unit tests and benchmarks.
+ */
+
+ISC_LANG_BEGINDECLS
+
+/*%
+ * The implementations of isc_ascii_lowerequal_wide() and
+ * isc_ascii_lowercmp_wide(). The fastest one supported by the CPU is
+ * selected by isc__ascii_initialize() when the library is loaded.
+ */
+typedef enum {
+	ISC__ASCII_SWAR = 0,
+	ISC__ASCII_SSE42,
+	ISC__ASCII_AVX2,
+	ISC__ASCII_IMPLS, /* number of implementations */
+} isc__ascii_impl_t;
+
+void
+isc__ascii_initialize(void);
+
+bool
+isc__ascii_setimpl(isc__ascii_impl_t impl);
+/*%<
+ * Switch to implementation 'impl'. Must not be called while another
+ * thread is using the wide functions.
+ *
+ * Returns false (and keeps the current implementation) if 'impl' is not
+ * supported by this build or this CPU.
+ */
+
+isc__ascii_impl_t
+isc__ascii_getimpl(void);
+/*%<
+ * Return the implementation currently in use.
+ */
+
+const char *
+isc__ascii_impltext(isc__ascii_impl_t impl);
+/*%<
+ * Return the name of implementation 'impl'.
+ */
+
+ISC_LANG_ENDDECLS
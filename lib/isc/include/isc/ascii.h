@@ -186,3 +186,17 @@ ret:
 	}
 	return (0);
 }
+
+/*
+ * Case-insensitive equality and order of `len` bytes at `a` and `b`,
+ * like isc_ascii_lowerequal() and isc_ascii_lowercmp(), for strings
+ * that are often longer than a word, such as whole DNS names. These use
+ * SSE4.2 or AVX2 vectors when the CPU supports them.
+ */
+#define ISC_ASCII_WIDE 16 /* shorter strings are not worth it */
+
+bool
+isc_ascii_lowerequal_wide(const uint8_t *a, const uint8_t *b,
+			  unsigned int len);
+int
+isc_ascii_lowercmp_wide(const uint8_t *a, const uint8_t *b, unsigned int len);
@@ -37,6 +37,15 @@ static inline isc_loop_t *
 isc_loop(void) {
 	return (isc__loop_local);
 }
+extern bool isc_loopmgr_affinity;
+/*%<
+ * If set to true before isc_loopmgr_create() is called, each loop thread
+ * is pinned to its own CPU.  The CPUs are chosen among those the process
+ * is allowed to run on, grouped by NUMA node and spread evenly across
+ * the nodes, and each loop thread allocates its memory from an arena
+ * shared only with the other loops on the same node.
+ */
+
 void
 isc_loopmgr_create(isc_mem_t *mctx, uint32_t nloops, isc_loopmgr_t **loopmgrp);
 /*%<
@@ -252,6 +252,20 @@ isc_mem_arena_set_dirty_decay_ms(isc_mem_t *mctx, const ssize_t decay_ms);
  */
 /*@}*/
 
+void
+isc_mem_setthreadnode(unsigned int node);
+/*!<
+ * \brief Route the allocations made by the current thread to a jemalloc
+ * arena shared only with the other threads that were assigned to the
+ * same NUMA node.  As long as those threads are pinned to CPUs on
+ * 'node', the pages the arena hands out are first touched, and hence
+ * placed, on that node.  When jemalloc is not available, this is a
+ * no-op.
+ *
+ * Requires:
+ * node < ISC_OS_MAXNODES
+ */
+
 void
 isc_mem_attach(isc_mem_t *, isc_mem_t **);
 
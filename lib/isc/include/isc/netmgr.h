@@ -31,6 +31,19 @@
 #define HAVE_SO_REUSEPORT_LB 1
 #endif
 
+#if HAVE_SENDMMSG
+#define HAVE_UDP_SEND_BATCHING 1
+#endif
+
+#if HAVE_DECL_TPACKET_V3
+#define HAVE_RAW_UDP_LISTENER 1
+#endif
+
+#if HAVE_DECL_BPF_MAP_TYPE_REUSEPORT_SOCKARRAY && \
+	defined(SO_ATTACH_REUSEPORT_EBPF) && defined(SO_MEMINFO)
+#define HAVE_REUSEPORT_STEERING 1
+#endif
+
 /*
  * Convenience macros to specify on how many threads should socket listen
  */
@@ -326,6 +339,47 @@ isc_nm_routeconnect(isc_nm_t *mgr, isc_nm_cb_t cb, void *cbarg);
  * are not supported.
  */
 
+isc_result_t
+isc_nm_listenrawudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
+		    const char *ifname, isc_nm_recv_cb_t cb, void *cbarg,
+		    isc_nmsocket_t **sockp);
+/*%<
+ * The same as `isc_nm_listenudp()`, but the datagrams are received
+ * from an AF_PACKET ring buffer attached to the network interface
+ * 'ifname' (or to all interfaces when 'ifname' is NULL or unknown)
+ * instead of the kernel UDP socket, which is only used for sending
+ * the responses.  The packets that the kernel would have delivered to
+ * the UDP socket are discarded there.
+ *
+ * Requires:
+ * \li	'iface' is not a wildcard address.
+ *
+ * Returns:
+ * \li	#ISC_R_SUCCESS on success
+ * \li	#ISC_R_NOTIMPLEMENTED on systems without AF_PACKET ring support
+ *	or when 'iface' is a wildcard address
+ * \li	#ISC_R_NOPERM when the process is not allowed to open packet
+ *	sockets
+ * \li	any error returned by isc_nm_listenudp()
+ */
+
+isc_result_t
+isc_nm_listensteeredudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
+			isc_nm_recv_cb_t cb, void *cbarg, isc_nmsocket_t **sockp);
+/*%<
+ * The same as `isc_nm_listenudp()`, but each datagram is handed to the
+ * loop running on the CPU that received it (see isc_loopmgr_affinity),
+ * rather than to one picked by hashing the addresses and ports, unless
+ * that loop is falling behind.  This needs load balanced sockets and a
+ * reuseport BPF program, so it is only available on Linux.
+ *
+ * Returns:
+ * \li	#ISC_R_SUCCESS
+ * \li	#ISC_R_NOTIMPLEMENTED if steering is not supported
+ * \li	any error returned by isc_nm_listenudp(), or by the kernel when
+ *	setting up the BPF program
+ */
+
 isc_result_t
 isc_nm_listenproxyudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
 		      isc_nm_recv_cb_t cb, void *cbarg, isc_nmsocket_t **sockp);
@@ -569,6 +623,20 @@ isc_nm_setloadbalancesockets(isc_nm_t *mgr, bool enabled);
  * \li	'mgr' is a valid netmgr.
  */
 
+bool
+isc_nm_getudpsendbatching(isc_nm_t *mgr);
+void
+isc_nm_setudpsendbatching(isc_nm_t *mgr, bool enabled);
+/*%<
+ * Get and set whether UDP responses sent from listening sockets are
+ * queued until the end of the current loop iteration and then sent
+ * together with sendmmsg(2) (and UDP GSO, where the kernel supports it).
+ * Has no effect on systems without sendmmsg(2).
+ *
+ * Requires:
+ * \li	'mgr' is a valid netmgr.
+ */
+
 void
 isc_nm_gettimeouts(isc_nm_t *mgr, uint32_t *initial, uint32_t *idle,
 		   uint32_t *keepalive, uint32_t *advertised);
@@ -28,6 +28,13 @@ ISC_LANG_BEGINDECLS
  */
 #define ISC_OS_CACHELINE_SIZE 64
 
+/*%<
+ * Limits on the CPU and NUMA node numbers the topology functions know
+ * about; anything beyond them is treated as belonging to node 0.
+ */
+#define ISC_OS_MAXCPUS	1024
+#define ISC_OS_MAXNODES 64
+
 unsigned int
 isc_os_ncpus(void);
 /*%<
@@ -43,6 +50,20 @@ isc_os_cacheline(void);
  * instead of constant. Is common on ppc64le architecture.
  */
 
+unsigned int
+isc_os_numanodes(void);
+/*%<
+ * Return the number of NUMA nodes on the system (strictly, one more than
+ * the highest node number), or 1 if the topology cannot be determined.
+ */
+
+unsigned int
+isc_os_cpunode(unsigned int cpu);
+/*%<
+ * Return the NUMA node that CPU number 'cpu' belongs to, or 0 if this
+ * cannot be determined.
+ */
+
 mode_t
 isc_os_umask(void);
 /*%<
@@ -103,6 +103,11 @@ typedef struct isc_radix_node {
 #define RADIX_TREE_MAGIC    ISC_MAGIC('R', 'd', 'x', 'T')
 #define RADIX_TREE_VALID(a) ISC_MAGIC_VALID(a, RADIX_TREE_MAGIC)
 
+/*
+ * The compiled, read-only form of a radix tree; see isc_radix_compile().
+ */
+typedef struct isc_radix_trie isc_radix_trie_t;
+
 typedef struct isc_radix_tree {
 	unsigned int	  magic;
 	isc_mem_t	 *mctx;
@@ -110,6 +115,7 @@ typedef struct isc_radix_tree {
 	uint32_t	  maxbits;	   /* for IP, 32 bit addresses */
 	int		  num_active_node; /* for debugging purposes */
 	int		  num_added_node;  /* total number of nodes */
+	isc_radix_trie_t *trie[RADIX_FAMILIES]; /* compiled form, or NULL */
 } isc_radix_tree_t;
 
 isc_result_t
@@ -119,6 +125,10 @@ isc_radix_search(isc_radix_tree_t *radix, isc_radix_node_t **target,
  * Search 'radix' for the best match to 'prefix'.
  * Return the node found in '*target'.
  *
+ * If the tree has been compiled with isc_radix_compile() and 'prefix'
+ * is a host address (32 bits for IPv4, 128 bits for IPv6), the compiled
+ * form is used to find the same node in a few memory accesses.
+ *
  * Requires:
  * \li	'radix' to be valid.
  * \li	'target' is not NULL and "*target" is NULL.
@@ -134,7 +144,8 @@ isc_radix_insert(isc_radix_tree_t *radix, isc_radix_node_t **target,
 		 isc_radix_node_t *source, isc_prefix_t *prefix);
 /*%<
  * Insert 'source' or 'prefix' into the radix tree 'radix'.
- * Return the node added in 'target'.
+ * Return the node added in 'target'.  Any compiled form of the tree
+ * is discarded.
  *
  * Requires:
  * \li	'radix' to be valid.
@@ -150,7 +161,8 @@ isc_radix_insert(isc_radix_tree_t *radix, isc_radix_node_t **target,
 void
 isc_radix_remove(isc_radix_tree_t *radix, isc_radix_node_t *node);
 /*%<
- * Remove the node 'node' from the radix tree 'radix'.
+ * Remove the node 'node' from the radix tree 'radix'.  Any compiled
+ * form of the tree is discarded.
  *
  * Requires:
  * \li	'radix' to be valid.
@@ -172,6 +184,26 @@ isc_radix_create(isc_mem_t *mctx, isc_radix_tree_t **target, int maxbits);
  * \li	ISC_R_SUCCESS
  */
 
+void
+isc_radix_compile(isc_radix_tree_t *radix);
+/*%<
+ * Build a compiled form of 'radix' to speed up isc_radix_search() for
+ * host addresses.  This is meant to be called once the tree has been
+ * fully populated, e.g. when an ACL has been configured; it can be
+ * called again to rebuild it.
+ *
+ * The compiled form is a multibit trie with a stride of 6 bits, in which
+ * each node stores its children and its leaves compactly behind a pair
+ * of 64-bit bitmaps (as in "Poptrie", Asai and Ohara, SIGCOMM 2015).
+ * The first-match result for every address range is computed in
+ * advance, so a lookup is a walk of at most 6 (IPv4) or 22 (IPv6) nodes
+ * with no backtracking.
+ *
+ * Requires:
+ * \li	'radix' to be valid, and not searched by other threads while
+ *	this runs.
+ */
+
 void
 isc_radix_destroy(isc_radix_tree_t *radix, isc_radix_destroyfunc_t func);
 /*%<
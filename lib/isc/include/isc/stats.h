@@ -80,6 +80,15 @@ enum {
 	isc_sockstatscounter_tcp4clients,
 	isc_sockstatscounter_tcp6clients,
 
+	isc_sockstatscounter_udp4sendbatch,
+	isc_sockstatscounter_udp6sendbatch,
+
+	isc_sockstatscounter_udp4sendbatchmsg,
+	isc_sockstatscounter_udp6sendbatchmsg,
+
+	isc_sockstatscounter_udp4sendgso,
+	isc_sockstatscounter_udp6sendgso,
+
 	isc_sockstatscounter_max,
 };
 
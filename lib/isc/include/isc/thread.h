@@ -54,6 +54,35 @@ isc_thread_yield(void);
 void
 isc_thread_setname(isc_thread_t thread, const char *name);
 
+unsigned int
+isc_thread_getaffinity(unsigned int *cpus, unsigned int size);
+/*%<
+ * Store the numbers of the CPUs the current thread is allowed to run on
+ * in 'cpus' (at most 'size' of them) in ascending order, and return how
+ * many were stored. Returns 0 if CPU affinity is not supported.
+ */
+
+isc_result_t
+isc_thread_setaffinity(unsigned int cpu);
+/*%<
+ * Pin the current thread to CPU number 'cpu'.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_FAILURE		the thread could not be pinned
+ *\li	#ISC_R_NOTIMPLEMENTED	CPU affinity is not supported
+ */
+
+void
+isc_thread_resetaffinity(void);
+/*%<
+ * Let the current thread run on all of the CPUs the process was started
+ * on again, undoing isc_thread_setaffinity().  Threads created with
+ * isc_thread_create() start this way, and so do the threads that run
+ * isc_work callbacks, rather than sharing the CPU of the loop thread
+ * that happened to start them.
+ */
+
 #define isc_thread_self (uintptr_t) pthread_self
 
 ISC_LANG_ENDDECLS
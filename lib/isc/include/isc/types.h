@@ -86,11 +86,12 @@ typedef struct isc_nm_http_endpoints isc_nm_http_endpoints_t;
 /*%< HTTP endpoints set */
 #endif /* HAVE_LIBNGHTTP2 */
 
-/*% Statistics formats (text file or XML) */
+/*% Statistics formats (text file, XML, JSON or OpenMetrics) */
 typedef enum {
 	isc_statsformat_file,
 	isc_statsformat_xml,
-	isc_statsformat_json
+	isc_statsformat_json,
+	isc_statsformat_metrics
 } isc_statsformat_t;
 
 typedef enum isc_nmsocket_type {
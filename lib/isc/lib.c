@@ -13,6 +13,7 @@
 
 /*! \file */
 
+#include <isc/ascii.h>
 #include <isc/hash.h>
 #include <isc/iterated_hash.h>
 #include <isc/md.h>
@@ -24,10 +25,12 @@
 #include <isc/uv.h>
 #include <isc/xml.h>
 
+#include "ascii_p.h"
 #include "config.h"
 #include "mem_p.h"
 #include "mutex_p.h"
 #include "os_p.h"
+#include "thread_p.h"
 
 #ifndef ISC_CONSTRUCTOR
 #error Either __attribute__((constructor|destructor))__ or DllMain support needed to compile BIND 9.
@@ -45,7 +48,9 @@ isc__shutdown(void) ISC_DESTRUCTOR;
 void
 isc__initialize(void) {
 	isc__os_initialize();
+	isc__ascii_initialize();
 	isc__mutex_initialize();
+	isc__thread_initialize();
 	isc__mem_initialize();
 	isc__tls_initialize();
 	isc__uv_initialize();
@@ -26,6 +26,7 @@
 #include <isc/magic.h>
 #include <isc/mem.h>
 #include <isc/mutex.h>
+#include <isc/os.h>
 #include <isc/refcount.h>
 #include <isc/result.h>
 #include <isc/signal.h>
@@ -48,6 +49,8 @@
 
 thread_local isc_loop_t *isc__loop_local = NULL;
 
+bool isc_loopmgr_affinity = false;
+
 static void
 ignore_signal(int sig, void (*handler)(int)) {
 	struct sigaction sa = { .sa_handler = handler };
@@ -189,6 +192,7 @@ static void
 loop_init(isc_loop_t *loop, isc_loopmgr_t *loopmgr, uint32_t tid) {
 	*loop = (isc_loop_t){
 		.tid = tid,
+		.cpu = -1,
 		.loopmgr = loopmgr,
 		.run_jobs = ISC_LIST_INITIALIZER,
 	};
@@ -272,6 +276,12 @@ loop_thread(void *arg) {
 
 	isc__tid_init(loop->tid);
 
+	if (loop->cpu >= 0 &&
+	    isc_thread_setaffinity(loop->cpu) == ISC_R_SUCCESS)
+	{
+		isc_mem_setthreadnode(loop->node);
+	}
+
 	int r = uv_prepare_start(&loop->quiescent, quiescent_cb);
 	UV_RUNTIME_CHECK(uv_prepare_start, r);
 
@@ -313,6 +323,45 @@ threadpool_initialize(uint32_t workers) {
 	}
 }
 
+static int
+cpu_compare(const void *a, const void *b) {
+	unsigned int cpu_a = *(const unsigned int *)a;
+	unsigned int cpu_b = *(const unsigned int *)b;
+	unsigned int node_a = isc_os_cpunode(cpu_a);
+	unsigned int node_b = isc_os_cpunode(cpu_b);
+
+	if (node_a != node_b) {
+		return (node_a < node_b ? -1 : 1);
+	}
+	return (cpu_a < cpu_b ? -1 : (cpu_a > cpu_b ? 1 : 0));
+}
+
+/*
+ * Pick a CPU for every loop.  Sorting the allowed CPUs by node and then
+ * taking evenly spaced ones keeps neighbouring loops on the same node,
+ * and gives every node its share of the loops when there are fewer
+ * loops than CPUs.
+ */
+static void
+loopmgr_placement(isc_loopmgr_t *loopmgr) {
+	unsigned int cpus[ISC_OS_MAXCPUS];
+	unsigned int ncpus = isc_thread_getaffinity(cpus, ARRAY_SIZE(cpus));
+
+	if (ncpus == 0) {
+		return;
+	}
+
+	qsort(cpus, ncpus, sizeof(cpus[0]), cpu_compare);
+
+	for (size_t i = 0; i < loopmgr->nloops; i++) {
+		isc_loop_t *loop = &loopmgr->loops[i];
+		unsigned int cpu = cpus[i * ncpus / loopmgr->nloops];
+
+		loop->cpu = cpu;
+		loop->node = isc_os_cpunode(cpu);
+	}
+}
+
 static void
 loop_destroy(isc_loop_t *loop) {
 	int r = uv_async_send(&loop->destroy_trigger);
@@ -354,6 +403,10 @@ isc_loopmgr_create(isc_mem_t *mctx, uint32_t nloops, isc_loopmgr_t **loopmgrp) {
 		loop_init(loop, loopmgr, i);
 	}
 
+	if (isc_loopmgr_affinity) {
+		loopmgr_placement(loopmgr);
+	}
+
 	loopmgr->sigint = isc_signal_new(loopmgr, isc__loopmgr_signal, loopmgr,
 					 SIGINT);
 	loopmgr->sigterm = isc_signal_new(loopmgr, isc__loopmgr_signal, loopmgr,
@@ -49,6 +49,10 @@ struct isc_loop {
 	uv_loop_t loop;
 	uint32_t tid;
 
+	/* CPU placement, cpu is -1 unless pinned */
+	int cpu;
+	unsigned int node;
+
 	isc_mem_t *mctx;
 
 	/* states */
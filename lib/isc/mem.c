@@ -117,6 +117,12 @@ static isc_once_t init_once = ISC_ONCE_INIT;
 static isc_once_t shut_once = ISC_ONCE_INIT;
 static isc_mutex_t contextslock;
 
+/*
+ * Arenas shared by the threads running on each NUMA node, offset by one
+ * so that zero means "not created yet"; protected by contextslock.
+ */
+static unsigned int node_arenas[ISC_OS_MAXNODES];
+
 struct isc_mem {
 	unsigned int magic;
 	unsigned int flags;
@@ -1616,6 +1622,36 @@ isc_mem_arena_set_dirty_decay_ms(isc_mem_t *mctx, const ssize_t decay_ms) {
 	return (mem_set_arena_ssize_value(mctx, "dirty_decay_ms", decay_ms));
 }
 
+void
+isc_mem_setthreadnode(unsigned int node) {
+	REQUIRE(node < ISC_OS_MAXNODES);
+
+#ifdef JEMALLOC_API_SUPPORTED
+	unsigned int arenano = 0;
+
+	LOCK(&contextslock);
+	if (node_arenas[node] == 0 && mem_jemalloc_arena_create(&arenano)) {
+		node_arenas[node] = arenano + 1;
+	}
+	arenano = node_arenas[node];
+	UNLOCK(&contextslock);
+
+	if (arenano == 0) {
+		return;
+	}
+
+	/*
+	 * Unlike isc_mem_create_arena(), this keeps the thread cache: the
+	 * arena is the one the thread's allocations fall back to, so
+	 * every memory context used on this thread benefits.
+	 */
+	arenano--;
+	(void)mallctl("thread.arena", NULL, NULL, &arenano, sizeof(arenano));
+#else
+	UNUSED(node);
+#endif /* JEMALLOC_API_SUPPORTED */
+}
+
 void
 isc__mem_printactive(isc_mem_t *ctx, FILE *file) {
 #if ISC_MEM_TRACKLINES
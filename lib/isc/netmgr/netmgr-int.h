@@ -61,6 +61,12 @@
 #define ISC_NETMGR_UDP_RECVBUF_SIZE UINT16_MAX
 #endif
 
+/*
+ * Maximum number of datagrams handed to the kernel in a single sendmmsg(2)
+ * call when flushing the batched UDP send queue.
+ */
+#define ISC_NETMGR_UDP_SENDMMSG_MAX 64
+
 /*
  * The TCP send and receive buffers can fit one maximum sized DNS message plus
  * its size, the receive buffer here affects TCP, DoT and DoH.
@@ -245,6 +251,8 @@ isc__nm_dump_active_manager(isc_nm_t *netmgr);
 typedef void (*isc__nm_closecb)(isc_nmhandle_t *);
 typedef struct isc_nm_http_session isc_nm_http_session_t;
 
+typedef struct isc__nm_steer isc__nm_steer_t;
+
 struct isc_nmhandle {
 	int magic;
 	isc_refcount_t references;
@@ -346,6 +354,11 @@ struct isc_nm {
 	 */
 	atomic_bool shuttingdown;
 
+	/*
+	 * Coalesce UDP responses and send them with sendmmsg(2).
+	 */
+	bool udp_send_batching;
+
 	/*
 	 * Timeout values for TCP connections, corresponding to
 	 * tcp-intiial-timeout, tcp-idle-timeout, tcp-keepalive-timeout,
@@ -390,7 +403,10 @@ typedef enum {
 	STATID_RECVFAIL = 9,
 	STATID_ACTIVE = 10,
 	STATID_CLIENTS = 11,
-	STATID_MAX = 12,
+	STATID_SENDBATCH = 12,
+	STATID_SENDBATCHMSG = 13,
+	STATID_SENDGSO = 14,
+	STATID_MAX = 15,
 } isc__nm_statid_t;
 
 typedef struct isc_nmsocket_tls_send_req {
@@ -562,6 +578,46 @@ struct isc_nmsocket {
 		size_t udp_server_socks_num;
 	} proxy;
 
+	/*%
+	 * UDP responses queued during the current loop iteration; they are
+	 * flushed together with sendmmsg(2) from a job that runs before the
+	 * loop polls for more I/O.  'gso' is set when the kernel accepts
+	 * UDP_SEGMENT on the socket, so that consecutive datagrams to the
+	 * same peer can be coalesced into a single segmented send.
+	 */
+	struct {
+		ISC_LIST(isc__nm_uvreq_t) pending;
+		bool scheduled;
+		bool gso;
+		isc_job_t job;
+	} udpsend;
+
+	/*%
+	 * AF_PACKET receive ring used instead of the kernel UDP receive
+	 * path.  The listener keeps the interface index and the fanout
+	 * group shared by its children; each child has its own packet
+	 * socket, the mmap()ed TPACKET_V3 ring and the poll handle.
+	 */
+	struct {
+		bool enabled;
+		unsigned int ifindex;
+		uint16_t fanout;
+		uv_os_sock_t fd;
+		uint8_t *ring;
+		size_t ringsize;
+		unsigned int block;
+		uv_poll_t poll;
+	} packet;
+
+	/*%
+	 * Reuseport steering by receiving CPU.  The listener owns the BPF
+	 * program and its maps; each child counts the datagrams it has
+	 * received and remembers whether it has marked itself overloaded.
+	 */
+	isc__nm_steer_t *steer;
+	unsigned int steer_received;
+	bool steer_overloaded;
+
 	/*%
 	 * pquota is a non-attached pointer to the TCP client quota, stored in
 	 * listening sockets.
@@ -884,6 +940,50 @@ isc__nm_udp_settimeout(isc_nmhandle_t *handle, uint32_t timeout);
  * Set or clear the recv timeout for the UDP socket associated with 'handle'.
  */
 
+isc_result_t
+isc__nm_packet_start(isc_nmsocket_t *sock);
+/*%<
+ * Open the AF_PACKET socket and the receive ring for the UDP listener
+ * child 'sock' and start polling it; the datagrams received on the
+ * ring are passed to the socket's read callback.
+ */
+
+void
+isc__nm_packet_close(isc_nmsocket_t *sock);
+/*%<
+ * Stop polling and close the AF_PACKET receive ring of 'sock', if any.
+ */
+
+isc_result_t
+isc__nm_steer_create(isc_nm_t *mgr, uint32_t nchildren,
+		     isc__nm_steer_t **steerp);
+/*%<
+ * Create the BPF maps and load the program that steer the datagrams for
+ * a UDP listener with 'nchildren' children to them by receiving CPU.
+ * This has to be done before the children start reading.
+ */
+
+isc_result_t
+isc__nm_steer_attach(isc_nmsocket_t *sock);
+/*%<
+ * Put the bound sockets of the children of the UDP listener 'sock' into
+ * the socket map and attach the steering program to their group.
+ */
+
+void
+isc__nm_steer_check(isc_nmsocket_t *sock);
+/*%<
+ * Called by the steered UDP listener child 'sock' after every batch of
+ * datagrams: check its receive queue from time to time and tell the
+ * steering program whether the child is overloaded.
+ */
+
+void
+isc__nm_steer_cleanup(isc_nmsocket_t *sock);
+/*%<
+ * Free the steering program and maps of 'sock', if any.
+ */
+
 void
 isc__nm_tcp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 		 isc_nm_cb_t cb, void *cbarg);
@@ -1337,6 +1437,14 @@ isc__nm_socket_incoming_cpu(uv_os_sock_t fd);
  * Set the SO_INCOMING_CPU socket option on the fd if available
  */
 
+isc_result_t
+isc__nm_socket_steer_cpu(uv_os_sock_t fd, int cpu);
+/*%<
+ * Set the SO_INCOMING_CPU socket option on the fd to 'cpu' if available,
+ * so that the kernel prefers this socket in its SO_REUSEPORT group for
+ * packets received on that CPU.
+ */
+
 isc_result_t
 isc__nm_socket_disable_pmtud(uv_os_sock_t fd, sa_family_t sa_family);
 /*%<
@@ -1350,6 +1458,19 @@ isc__nm_socket_v6only(uv_os_sock_t fd, sa_family_t sa_family);
  * Restrict the socket to sending and receiving IPv6 packets only
  */
 
+isc_result_t
+isc__nm_socket_udp_gso(uv_os_sock_t fd);
+/*%<
+ * Check whether UDP Generic Segmentation Offload (UDP_SEGMENT) can be
+ * used on the fd
+ */
+
+isc_result_t
+isc__nm_socket_drop_input(uv_os_sock_t fd);
+/*%<
+ * Attach a socket filter that discards every incoming datagram on the fd
+ */
+
 isc_result_t
 isc__nm_socket_connectiontimeout(uv_os_sock_t fd, int timeout_ms);
 /*%<
@@ -65,6 +65,9 @@ static const isc_statscounter_t udp4statsindex[] = {
 	isc_sockstatscounter_udp4recvfail,
 	isc_sockstatscounter_udp4active,
 	-1,
+	isc_sockstatscounter_udp4sendbatch,
+	isc_sockstatscounter_udp4sendbatchmsg,
+	isc_sockstatscounter_udp4sendgso,
 };
 
 static const isc_statscounter_t udp6statsindex[] = {
@@ -80,6 +83,9 @@ static const isc_statscounter_t udp6statsindex[] = {
 	isc_sockstatscounter_udp6recvfail,
 	isc_sockstatscounter_udp6active,
 	-1,
+	isc_sockstatscounter_udp6sendbatch,
+	isc_sockstatscounter_udp6sendbatchmsg,
+	isc_sockstatscounter_udp6sendgso,
 };
 
 static const isc_statscounter_t tcp4statsindex[] = {
@@ -89,6 +95,9 @@ static const isc_statscounter_t tcp4statsindex[] = {
 	isc_sockstatscounter_tcp4acceptfail,  isc_sockstatscounter_tcp4accept,
 	isc_sockstatscounter_tcp4sendfail,    isc_sockstatscounter_tcp4recvfail,
 	isc_sockstatscounter_tcp4active,      isc_sockstatscounter_tcp4clients,
+	-1,
+	-1,
+	-1,
 };
 
 static const isc_statscounter_t tcp6statsindex[] = {
@@ -98,6 +107,9 @@ static const isc_statscounter_t tcp6statsindex[] = {
 	isc_sockstatscounter_tcp6acceptfail,  isc_sockstatscounter_tcp6accept,
 	isc_sockstatscounter_tcp6sendfail,    isc_sockstatscounter_tcp6recvfail,
 	isc_sockstatscounter_tcp6active,      isc_sockstatscounter_tcp6clients,
+	-1,
+	-1,
+	-1,
 };
 
 static void
@@ -375,6 +387,22 @@ isc_nm_setloadbalancesockets(isc_nm_t *mgr, ISC_ATTR_UNUSED bool enabled) {
 #endif
 }
 
+bool
+isc_nm_getudpsendbatching(isc_nm_t *mgr) {
+	REQUIRE(VALID_NM(mgr));
+
+	return (mgr->udp_send_batching);
+}
+
+void
+isc_nm_setudpsendbatching(isc_nm_t *mgr, ISC_ATTR_UNUSED bool enabled) {
+	REQUIRE(VALID_NM(mgr));
+
+#if HAVE_UDP_SEND_BATCHING
+	mgr->udp_send_batching = enabled;
+#endif
+}
+
 void
 isc_nm_gettimeouts(isc_nm_t *mgr, uint32_t *initial, uint32_t *idle,
 		   uint32_t *keepalive, uint32_t *advertised) {
@@ -483,6 +511,7 @@ nmsocket_cleanup(void *arg) {
 	isc__nm_streamdns_cleanup_data(sock);
 	isc__nm_proxystream_cleanup_data(sock);
 	isc__nm_proxyudp_cleanup_data(sock);
+	isc__nm_steer_cleanup(sock);
 
 	if (sock->barriers_initialised) {
 		isc_barrier_destroy(&sock->listen_barrier);
@@ -690,6 +719,8 @@ isc___nmsocket_init(isc_nmsocket_t *sock, isc__networker_t *worker,
 		.active_handles = ISC_LIST_INITIALIZER,
 		.active_handles_max = ISC_NETMGR_MAX_STREAM_CLIENTS_PER_CONN,
 		.active_link = ISC_LINK_INITIALIZER,
+		.udpsend.pending = ISC_LIST_INITIALIZER,
+		.packet.fd = -1,
 		.active = true,
 	};
 
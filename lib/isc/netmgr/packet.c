@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * AF_PACKET receive path for the UDP listeners.
+ *
+ * Every listener child opens a packet socket bound to the listening
+ * interface, maps a TPACKET_V3 receive ring into memory and polls it from
+ * its loop.  A classic BPF filter lets only the UDP datagrams addressed to
+ * the listening address and port into the ring, and the children of one
+ * listener form a fanout group, so each flow is always handled by the same
+ * loop.  The datagrams are then validated and passed to the read callback
+ * straight from the ring, exactly like the datagrams received on the UDP
+ * socket in isc__nm_udp_read_cb().
+ *
+ * The UDP socket bound to the listening address is still used for sending
+ * the responses, but a filter attached to it discards every datagram that
+ * the kernel would otherwise queue there.
+ */
+
+#include <unistd.h>
+
+#include <isc/atomic.h>
+#include <isc/endian.h>
+#include <isc/errno.h>
+#include <isc/netmgr.h>
+#include <isc/result.h>
+#include <isc/sockaddr.h>
+#include <isc/util.h>
+#include <isc/uv.h>
+
+#include "netmgr-int.h"
+
+#if HAVE_DECL_TPACKET_V3
+
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <sys/mman.h>
+
+#ifndef PACKET_FANOUT_FLAG_UNIQUEID
+#define PACKET_FANOUT_FLAG_UNIQUEID 0x2000
+#endif /* PACKET_FANOUT_FLAG_UNIQUEID */
+
+#ifndef TP_STATUS_CSUM_VALID
+#define TP_STATUS_CSUM_VALID (1 << 7)
+#endif /* TP_STATUS_CSUM_VALID */
+
+/*
+ * The ring is made of PACKET_RING_BLOCKS blocks; a block is handed over to
+ * us when it's full or when PACKET_RING_TIMEOUT milliseconds have passed
+ * since the first datagram was stored in it.  With TPACKET_V3 the frames
+ * have variable size, so the frame size only needs to be valid, and a
+ * datagram can be as large as the block.
+ */
+#define PACKET_RING_BLOCKSIZE (1 << 18)
+#define PACKET_RING_BLOCKS    8
+#define PACKET_RING_FRAMESIZE 2048
+#define PACKET_RING_TIMEOUT   1
+
+#define IPV4_HDRLEN 20
+#define IPV6_HDRLEN 40
+#define UDP_HDRLEN  8
+
+static void
+packet_close_cb(uv_handle_t *handle) {
+	isc_nmsocket_t *sock = uv_handle_get_data(handle);
+
+	REQUIRE(VALID_NMSOCK(sock));
+
+	if (sock->packet.ring != NULL) {
+		(void)munmap(sock->packet.ring, sock->packet.ringsize);
+		sock->packet.ring = NULL;
+	}
+	isc__nm_closesocket(sock->packet.fd);
+	sock->packet.fd = -1;
+}
+
+static uint32_t
+csum_add(uint32_t sum, const uint8_t *data, size_t len) {
+	while (len > 1) {
+		sum += (data[0] << 8) | data[1];
+		data += 2;
+		len -= 2;
+	}
+	if (len > 0) {
+		sum += data[0] << 8;
+	}
+	return (sum);
+}
+
+static uint16_t
+csum_fold(uint32_t sum) {
+	while ((sum >> 16) != 0) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	return ((uint16_t)~sum);
+}
+
+static bool
+udp_checksum_ok(const uint8_t *src, const uint8_t *dst, size_t addrlen,
+		const uint8_t *udp, size_t ulen) {
+	uint32_t sum = 0;
+
+	sum = csum_add(sum, src, addrlen);
+	sum = csum_add(sum, dst, addrlen);
+	sum += IPPROTO_UDP + (uint32_t)ulen;
+	sum = csum_add(sum, udp, ulen);
+
+	return (csum_fold(sum) == 0);
+}
+
+/*
+ * Validate the IPv4/IPv6 and UDP headers the same way the kernel UDP stack
+ * would, and extract the peer address and the payload.  The checksums are
+ * not verified when the kernel has already done that (or when it was never
+ * computed, e.g. for locally generated datagrams on the loopback).
+ */
+static bool
+packet_parse(isc_nmsocket_t *sock, const uint8_t *data, size_t len,
+	     uint32_t status, unsigned int ifindex, isc_sockaddr_t *peer,
+	     isc_region_t *payload) {
+	const isc_sockaddr_t *iface = &sock->parent->iface;
+	const uint8_t *udp = NULL;
+	size_t ulen;
+	bool csum = true;
+
+	if ((status & (TP_STATUS_CSUM_VALID | TP_STATUS_CSUMNOTREADY)) != 0) {
+		csum = false;
+	}
+
+	switch (iface->type.sa.sa_family) {
+	case AF_INET: {
+		struct in_addr src;
+		size_t hlen, tlen;
+
+		if (len < IPV4_HDRLEN || (data[0] >> 4) != 4) {
+			return (false);
+		}
+		hlen = (data[0] & 0x0f) * 4;
+		tlen = (data[2] << 8) | data[3];
+		if (hlen < IPV4_HDRLEN || tlen > len ||
+		    tlen < hlen + UDP_HDRLEN)
+		{
+			return (false);
+		}
+		/* Fragments are reassembled before they reach the ring */
+		if ((((data[6] << 8) | data[7]) & 0x3fff) != 0 ||
+		    data[9] != IPPROTO_UDP ||
+		    memcmp(data + 16, &iface->type.sin.sin_addr, 4) != 0 ||
+		    csum_fold(csum_add(0, data, hlen)) != 0)
+		{
+			return (false);
+		}
+
+		udp = data + hlen;
+		ulen = (udp[4] << 8) | udp[5];
+		if (ulen < UDP_HDRLEN || ulen > tlen - hlen) {
+			return (false);
+		}
+		if (csum && (udp[6] != 0 || udp[7] != 0) &&
+		    !udp_checksum_ok(data + 12, data + 16, 4, udp, ulen))
+		{
+			return (false);
+		}
+
+		memmove(&src, data + 12, sizeof(src));
+		isc_sockaddr_fromin(peer, &src, (udp[0] << 8) | udp[1]);
+		break;
+	}
+	case AF_INET6: {
+		struct in6_addr src;
+		size_t plen;
+
+		if (len < IPV6_HDRLEN || (data[0] >> 4) != 6) {
+			return (false);
+		}
+		plen = (data[4] << 8) | data[5];
+		if (IPV6_HDRLEN + plen > len || plen < UDP_HDRLEN ||
+		    data[6] != IPPROTO_UDP ||
+		    memcmp(data + 24, &iface->type.sin6.sin6_addr, 16) != 0)
+		{
+			return (false);
+		}
+
+		udp = data + IPV6_HDRLEN;
+		ulen = (udp[4] << 8) | udp[5];
+		if (ulen < UDP_HDRLEN || ulen > plen) {
+			return (false);
+		}
+		/* The UDP checksum is mandatory with IPv6 */
+		if (udp[6] == 0 && udp[7] == 0) {
+			return (false);
+		}
+		if (csum &&
+		    !udp_checksum_ok(data + 8, data + 24, 16, udp, ulen))
+		{
+			return (false);
+		}
+
+		memmove(&src, data + 8, sizeof(src));
+		isc_sockaddr_fromin6(peer, &src, (udp[0] << 8) | udp[1]);
+		if (IN6_IS_ADDR_LINKLOCAL(&src)) {
+			peer->type.sin6.sin6_scope_id = ifindex;
+		}
+		break;
+	}
+	default:
+		UNREACHABLE();
+	}
+
+	if (((udp[2] << 8) | udp[3]) != isc_sockaddr_getport(iface) ||
+	    isc_sockaddr_getport(peer) == 0)
+	{
+		return (false);
+	}
+
+	payload->base = UNCONST(udp + UDP_HDRLEN);
+	payload->length = ulen - UDP_HDRLEN;
+
+	return (true);
+}
+
+static void
+packet_recv(isc_nmsocket_t *sock, isc_sockaddr_t *peer, isc_region_t *payload) {
+	isc__nm_uvreq_t *req = NULL;
+	uint32_t maxudp;
+
+	/*
+	 * The same reasons to drop the datagram without processing as
+	 * in isc__nm_udp_read_cb().
+	 */
+	maxudp = atomic_load_relaxed(&sock->worker->netmgr->maxudp);
+	if (maxudp != 0 && payload->length > maxudp) {
+		return;
+	}
+
+	if (isc__nm_closing(sock->worker) || !isc__nmsocket_active(sock)) {
+		return;
+	}
+
+	req = isc__nm_get_read_req(sock, peer);
+
+	/*
+	 * The callback will be called synchronously, so we can pass the
+	 * frame in the ring directly.
+	 */
+	req->uvbuf.base = (char *)payload->base;
+	req->uvbuf.len = payload->length;
+
+	REQUIRE(!sock->processing);
+	sock->processing = true;
+	isc__nm_readcb(sock, req, ISC_R_SUCCESS, false);
+	sock->processing = false;
+}
+
+static void
+packet_read_block(isc_nmsocket_t *sock, struct tpacket_block_desc *bd) {
+	struct tpacket3_hdr *hdr =
+		(struct tpacket3_hdr *)((uint8_t *)bd +
+					bd->hdr.bh1.offset_to_first_pkt);
+
+	for (uint32_t i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+		struct sockaddr_ll *sll =
+			(struct sockaddr_ll *)((uint8_t *)hdr +
+					       TPACKET_ALIGN(sizeof(*hdr)));
+		isc_sockaddr_t peer;
+		isc_region_t payload;
+
+		/* Skip our own responses and truncated datagrams */
+		if (sll->sll_pkttype != PACKET_OUTGOING &&
+		    hdr->tp_snaplen == hdr->tp_len &&
+		    packet_parse(sock, (uint8_t *)hdr + hdr->tp_net,
+				 hdr->tp_snaplen, hdr->tp_status,
+				 sll->sll_ifindex, &peer, &payload))
+		{
+			packet_recv(sock, &peer, &payload);
+		}
+
+		hdr = (struct tpacket3_hdr *)((uint8_t *)hdr +
+					      hdr->tp_next_offset);
+	}
+}
+
+static void
+packet_poll_cb(uv_poll_t *handle, int status, int events) {
+	isc_nmsocket_t *sock = uv_handle_get_data((uv_handle_t *)handle);
+
+	UNUSED(events);
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->tid == isc_tid());
+
+	if (status < 0) {
+		isc__nm_incstats(sock, STATID_RECVFAIL);
+		return;
+	}
+
+	/*
+	 * Process all the blocks the kernel has handed over to us, and
+	 * return each one to the kernel as soon as we are done with it.
+	 */
+	for (;;) {
+		uint8_t *base = sock->packet.ring +
+				sock->packet.block * PACKET_RING_BLOCKSIZE;
+		struct tpacket_block_desc *bd = (void *)base;
+
+		if ((bd->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+			break;
+		}
+		atomic_thread_fence(memory_order_acquire);
+
+		packet_read_block(sock, bd);
+
+		atomic_thread_fence(memory_order_release);
+		bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+
+		sock->packet.block = (sock->packet.block + 1) %
+				     PACKET_RING_BLOCKS;
+
+		if (!uv_is_active((uv_handle_t *)handle)) {
+			/* The socket was closed from the read callback */
+			break;
+		}
+	}
+}
+
+/*
+ * Accept only the UDP datagrams addressed to the listening address and
+ * port; the offsets are relative to the network header as the packet
+ * socket is SOCK_DGRAM.
+ */
+static isc_result_t
+packet_filter(uv_os_sock_t fd, const isc_sockaddr_t *iface) {
+	uint32_t port = isc_sockaddr_getport(iface);
+	struct sock_fprog prog = { 0 };
+
+	if (iface->type.sa.sa_family == AF_INET) {
+		uint32_t addr = ntohl(iface->type.sin.sin_addr.s_addr);
+		struct sock_filter code[] = {
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 6),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, addr, 0, 4),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, UINT32_MAX),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		};
+
+		prog.len = ARRAY_SIZE(code);
+		prog.filter = code;
+		if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+			       sizeof(prog)) == -1)
+		{
+			return (isc_errno_toresult(errno));
+		}
+	} else {
+		const uint8_t *a = iface->type.sin6.sin6_addr.s6_addr;
+		uint32_t addr[4] = {
+			ISC_U8TO32_BE(a),
+			ISC_U8TO32_BE(a + 4),
+			ISC_U8TO32_BE(a + 8),
+			ISC_U8TO32_BE(a + 12),
+		};
+		struct sock_filter code[] = {
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 6),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 11),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 24),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, addr[0], 0, 9),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 28),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, addr[1], 0, 7),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 32),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, addr[2], 0, 5),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 36),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, addr[3], 0, 3),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, IPV6_HDRLEN + 2),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, UINT32_MAX),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		};
+
+		prog.len = ARRAY_SIZE(code);
+		prog.filter = code;
+		if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+			       sizeof(prog)) == -1)
+		{
+			return (isc_errno_toresult(errno));
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * The first child creates a new fanout group with an identifier that is
+ * unique in the network namespace, the other children join it.
+ */
+static isc_result_t
+packet_fanout(isc_nmsocket_t *sock) {
+	isc_nmsocket_t *parent = sock->parent;
+	int type = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+	int val;
+	socklen_t len = sizeof(val);
+
+	if (sock->tid == 0) {
+		val = (type | PACKET_FANOUT_FLAG_UNIQUEID) << 16;
+		if (setsockopt(sock->packet.fd, SOL_PACKET, PACKET_FANOUT, &val,
+			       sizeof(val)) == -1 ||
+		    getsockopt(sock->packet.fd, SOL_PACKET, PACKET_FANOUT, &val,
+			       &len) == -1)
+		{
+			return (isc_errno_toresult(errno));
+		}
+		parent->packet.fanout = val & 0xffff;
+		return (ISC_R_SUCCESS);
+	}
+
+	val = parent->packet.fanout | (type << 16);
+	if (setsockopt(sock->packet.fd, SOL_PACKET, PACKET_FANOUT, &val,
+		       sizeof(val)) == -1)
+	{
+		return (isc_errno_toresult(errno));
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+isc_result_t
+isc__nm_packet_start(isc_nmsocket_t *sock) {
+	isc_result_t result;
+	isc_nmsocket_t *parent = NULL;
+	sa_family_t sa_family;
+	uv_os_sock_t fd;
+	void *ring = NULL;
+	int r;
+	struct tpacket_req3 req = {
+		.tp_block_size = PACKET_RING_BLOCKSIZE,
+		.tp_block_nr = PACKET_RING_BLOCKS,
+		.tp_frame_size = PACKET_RING_FRAMESIZE,
+		.tp_frame_nr = PACKET_RING_BLOCKSIZE / PACKET_RING_FRAMESIZE *
+			       PACKET_RING_BLOCKS,
+		.tp_retire_blk_tov = PACKET_RING_TIMEOUT,
+	};
+	struct sockaddr_ll sll = { .sll_family = AF_PACKET };
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->type == isc_nm_udpsocket);
+	REQUIRE(sock->tid == isc_tid());
+	REQUIRE(VALID_NMSOCK(sock->parent));
+	REQUIRE(sock->parent->packet.enabled);
+
+	parent = sock->parent;
+	sa_family = parent->iface.type.sa.sa_family;
+
+	/*
+	 * Nothing is going to be received on the UDP socket itself.
+	 */
+	result = isc__nm_socket_drop_input(sock->fd);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	/*
+	 * The packet socket doesn't receive anything until it's bound to
+	 * the protocol below, so the filter is in place before the first
+	 * datagram arrives.
+	 */
+	fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		return (isc_errno_toresult(errno));
+	}
+
+	result = packet_filter(fd, &parent->iface);
+	if (result != ISC_R_SUCCESS) {
+		goto failure;
+	}
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &(int){ TPACKET_V3 },
+		       sizeof(int)) == -1 ||
+	    setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1)
+	{
+		result = isc_errno_toresult(errno);
+		goto failure;
+	}
+
+#ifdef PACKET_IGNORE_OUTGOING
+	(void)setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &(int){ 1 },
+			 sizeof(int));
+#endif /* PACKET_IGNORE_OUTGOING */
+
+	ring = mmap(NULL, (size_t)req.tp_block_size * req.tp_block_nr,
+		    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED) {
+		ring = NULL;
+		result = isc_errno_toresult(errno);
+		goto failure;
+	}
+
+	sll.sll_protocol = htons((sa_family == AF_INET) ? ETH_P_IP
+							: ETH_P_IPV6);
+	sll.sll_ifindex = parent->packet.ifindex;
+	if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) == -1) {
+		result = isc_errno_toresult(errno);
+		goto failure;
+	}
+
+	sock->packet.fd = fd;
+	sock->packet.ring = ring;
+	sock->packet.ringsize = (size_t)req.tp_block_size * req.tp_block_nr;
+	sock->packet.block = 0;
+
+	result = packet_fanout(sock);
+	if (result != ISC_R_SUCCESS) {
+		goto failure;
+	}
+
+	r = uv_poll_init_socket(&sock->worker->loop->loop, &sock->packet.poll,
+				fd);
+	if (r != 0) {
+		result = isc_uverr2result(r);
+		goto failure;
+	}
+	uv_handle_set_data((uv_handle_t *)&sock->packet.poll, sock);
+
+	/*
+	 * From now on, the ring is released by isc__nm_packet_close().
+	 */
+	r = uv_poll_start(&sock->packet.poll, UV_READABLE, packet_poll_cb);
+	return (isc_uverr2result(r));
+
+failure:
+	if (ring != NULL) {
+		(void)munmap(ring, (size_t)req.tp_block_size * req.tp_block_nr);
+	}
+	isc__nm_closesocket(fd);
+	sock->packet.fd = -1;
+	sock->packet.ring = NULL;
+	return (result);
+}
+
+void
+isc__nm_packet_close(isc_nmsocket_t *sock) {
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->tid == isc_tid());
+
+	if (sock->packet.fd == -1) {
+		return;
+	}
+
+	uv_poll_stop(&sock->packet.poll);
+	uv_close((uv_handle_t *)&sock->packet.poll, packet_close_cb);
+}
+
+#else /* HAVE_DECL_TPACKET_V3 */
+
+isc_result_t
+isc__nm_packet_start(isc_nmsocket_t *sock) {
+	UNUSED(sock);
+
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
+void
+isc__nm_packet_close(isc_nmsocket_t *sock) {
+	UNUSED(sock);
+}
+
+#endif /* HAVE_DECL_TPACKET_V3 */
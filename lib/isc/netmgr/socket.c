@@ -11,6 +11,14 @@
  * information regarding copyright ownership.
  */
 
+#if HAVE_DECL_UDP_SEGMENT
+#include <netinet/udp.h>
+#endif /* HAVE_DECL_UDP_SEGMENT */
+
+#if HAVE_DECL_TPACKET_V3
+#include <linux/filter.h>
+#endif /* HAVE_DECL_TPACKET_V3 */
+
 #include <isc/errno.h>
 #include <isc/uv.h>
 
@@ -232,6 +240,23 @@ isc__nm_socket_incoming_cpu(uv_os_sock_t fd) {
 	return (ISC_R_NOTIMPLEMENTED);
 }
 
+isc_result_t
+isc__nm_socket_steer_cpu(uv_os_sock_t fd, int cpu) {
+#ifdef SO_INCOMING_CPU
+	if (setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) ==
+	    -1)
+	{
+		return (ISC_R_FAILURE);
+	} else {
+		return (ISC_R_SUCCESS);
+	}
+#else
+	UNUSED(fd);
+	UNUSED(cpu);
+#endif
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
 isc_result_t
 isc__nm_socket_disable_pmtud(uv_os_sock_t fd, sa_family_t sa_family) {
 	/*
@@ -299,6 +324,42 @@ isc__nm_socket_v6only(uv_os_sock_t fd, sa_family_t sa_family) {
 	return (ISC_R_NOTIMPLEMENTED);
 }
 
+isc_result_t
+isc__nm_socket_udp_gso(uv_os_sock_t fd) {
+	/*
+	 * Setting the default segment size to zero leaves the socket
+	 * behaviour unchanged, but fails on kernels without UDP GSO.
+	 */
+#if HAVE_DECL_UDP_SEGMENT
+	if (setsockopt_off(fd, SOL_UDP, UDP_SEGMENT) == -1) {
+		return (ISC_R_FAILURE);
+	} else {
+		return (ISC_R_SUCCESS);
+	}
+#else
+	UNUSED(fd);
+#endif
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
+isc_result_t
+isc__nm_socket_drop_input(uv_os_sock_t fd) {
+#if HAVE_DECL_TPACKET_V3
+	struct sock_filter code[] = { BPF_STMT(BPF_RET | BPF_K, 0) };
+	struct sock_fprog prog = { .len = ARRAY_SIZE(code), .filter = code };
+
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+		       sizeof(prog)) == -1)
+	{
+		return (ISC_R_FAILURE);
+	}
+	return (ISC_R_SUCCESS);
+#else
+	UNUSED(fd);
+#endif
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
 isc_result_t
 isc__nm_socket_connectiontimeout(uv_os_sock_t fd, int timeout_ms) {
 #if defined(TIMEOUT_OPTNAME)
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Reuseport steering by receiving CPU for the UDP listeners.
+ *
+ * With load balanced sockets, every loop has its own UDP socket bound to
+ * the listening address, and by default the kernel picks one of them by
+ * hashing the 4-tuple of each datagram.  A steered listener attaches an
+ * SK_REUSEPORT BPF program to its socket group instead, which hands each
+ * datagram to the socket of the loop running on the CPU that received it
+ * (or, when the loops are not pinned to CPUs, to a socket picked by the
+ * CPU number), so the RX queue, the softirq and the loop can share one
+ * core.
+ *
+ * Every child keeps an eye on its own receive queue; while it is more
+ * than half full, the child marks itself overloaded in a map read by the
+ * program, and the datagrams that would go to it are spread over the
+ * whole group by the usual hash until it has caught up.
+ *
+ * The program is small enough to be assembled here, so there is no need
+ * for libbpf or a BPF compiler.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <isc/errno.h>
+#include <isc/loop.h>
+#include <isc/netmgr.h>
+#include <isc/os.h>
+#include <isc/result.h>
+#include <isc/util.h>
+
+#include "../loop_p.h"
+#include "netmgr-int.h"
+
+#if HAVE_REUSEPORT_STEERING
+
+#include <linux/bpf.h>
+#include <linux/sock_diag.h>
+#include <sys/syscall.h>
+
+/*
+ * Check the receive queue after this many datagrams.
+ */
+#define STEER_CHECK_INTERVAL 256
+
+/*
+ * A child is overloaded when its receive queue takes more than
+ * 1/STEER_HIGH of the receive buffer, and stops being overloaded when the
+ * queue drops below 1/STEER_LOW of it.
+ */
+#define STEER_HIGH 2
+#define STEER_LOW  8
+
+struct isc__nm_steer {
+	isc_mem_t *mctx;
+	int sockmap; /* child index -> socket */
+	int cpumap;  /* CPU -> child index */
+	int loadmap; /* child index -> overloaded */
+	int prog;
+};
+
+/*
+ * Instruction encoding, after the macros in the kernel's filter.h.
+ */
+#define INSN(c, d, s, o, i)                                           \
+	((struct bpf_insn){ .code = (c),                              \
+			    .dst_reg = (d),                           \
+			    .src_reg = (s),                           \
+			    .off = (o),                               \
+			    .imm = (i) })
+#define MOV64_REG(d, s)	 INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define MOV64_IMM(d, i)	 INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define ADD64_IMM(d, i)	 INSN(BPF_ALU64 | BPF_ADD | BPF_K, d, 0, 0, i)
+#define LDX_W(d, s, o)	 INSN(BPF_LDX | BPF_MEM | BPF_W, d, s, o, 0)
+#define STX_W(d, s, o)	 INSN(BPF_STX | BPF_MEM | BPF_W, d, s, o, 0)
+#define JEQ_IMM(d, i, o) INSN(BPF_JMP | BPF_JEQ | BPF_K, d, 0, o, i)
+#define JNE_IMM(d, i, o) INSN(BPF_JMP | BPF_JNE | BPF_K, d, 0, o, i)
+#define CALL(f)		 INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define EXIT()		 INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+#define LD_MAP_FD(d, fd)                                                \
+	INSN(BPF_LD | BPF_DW | BPF_IMM, d, BPF_PSEUDO_MAP_FD, 0, fd), \
+		INSN(0, 0, 0, 0, 0)
+
+static int
+bpf(enum bpf_cmd cmd, union bpf_attr *attr) {
+	return (syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+}
+
+static int
+map_create(enum bpf_map_type type, uint32_t value_size,
+	   uint32_t max_entries) {
+	union bpf_attr attr = {
+		.map_type = type,
+		.key_size = sizeof(uint32_t),
+		.value_size = value_size,
+		.max_entries = max_entries,
+	};
+
+	return (bpf(BPF_MAP_CREATE, &attr));
+}
+
+static int
+map_update(int map, uint32_t key, const void *value) {
+	union bpf_attr attr = {
+		.map_fd = map,
+		.key = (uintptr_t)&key,
+		.value = (uintptr_t)value,
+		.flags = BPF_ANY,
+	};
+
+	return (bpf(BPF_MAP_UPDATE_ELEM, &attr));
+}
+
+static int
+prog_load(isc__nm_steer_t *steer) {
+	/*
+	 * The jump offsets count the instructions between the jump and
+	 * the "pass" label; LD_MAP_FD takes two of them.
+	 */
+	struct bpf_insn insns[] = {
+		MOV64_REG(BPF_REG_6, BPF_REG_1),
+		/* key = cpumap[smp_processor_id()] */
+		CALL(BPF_FUNC_get_smp_processor_id),
+		STX_W(BPF_REG_10, BPF_REG_0, -4),
+		MOV64_REG(BPF_REG_2, BPF_REG_10),
+		ADD64_IMM(BPF_REG_2, -4),
+		LD_MAP_FD(BPF_REG_1, steer->cpumap),
+		CALL(BPF_FUNC_map_lookup_elem),
+		JEQ_IMM(BPF_REG_0, 0, 17),
+		LDX_W(BPF_REG_1, BPF_REG_0, 0),
+		STX_W(BPF_REG_10, BPF_REG_1, -8),
+		/* if (loadmap[key] != 0) goto pass */
+		MOV64_REG(BPF_REG_2, BPF_REG_10),
+		ADD64_IMM(BPF_REG_2, -8),
+		LD_MAP_FD(BPF_REG_1, steer->loadmap),
+		CALL(BPF_FUNC_map_lookup_elem),
+		JEQ_IMM(BPF_REG_0, 0, 9),
+		LDX_W(BPF_REG_1, BPF_REG_0, 0),
+		JNE_IMM(BPF_REG_1, 0, 7),
+		/* sk_select_reuseport(ctx, sockmap, &key, 0) */
+		MOV64_REG(BPF_REG_1, BPF_REG_6),
+		LD_MAP_FD(BPF_REG_2, steer->sockmap),
+		MOV64_REG(BPF_REG_3, BPF_REG_10),
+		ADD64_IMM(BPF_REG_3, -8),
+		MOV64_IMM(BPF_REG_4, 0),
+		CALL(BPF_FUNC_sk_select_reuseport),
+		/*
+		 * pass: if no socket was selected, the kernel falls back
+		 * to the hash.
+		 */
+		MOV64_IMM(BPF_REG_0, SK_PASS),
+		EXIT(),
+	};
+	union bpf_attr attr = {
+		.prog_type = BPF_PROG_TYPE_SK_REUSEPORT,
+		.insn_cnt = ARRAY_SIZE(insns),
+		.insns = (uintptr_t)insns,
+		.license = (uintptr_t)"MPL-2.0",
+	};
+
+	return (bpf(BPF_PROG_LOAD, &attr));
+}
+
+/*
+ * Pick the child for the datagrams received on 'cpu': the one whose loop
+ * is pinned to it if there is one, else one of the loops on the same
+ * NUMA node, else any.  Child 'i' of a listener runs on loop 'i'.
+ */
+static uint32_t
+cpu_child(isc_nm_t *mgr, uint32_t nchildren, unsigned int cpu) {
+	unsigned int node = isc_os_cpunode(cpu);
+	uint32_t nlocal = 0;
+
+	for (uint32_t i = 0; i < nchildren; i++) {
+		isc_loop_t *loop = mgr->workers[i].loop;
+
+		if (loop->cpu == (int)cpu) {
+			return (i);
+		}
+		if (loop->cpu >= 0 && loop->node == node) {
+			nlocal++;
+		}
+	}
+
+	if (nlocal == 0) {
+		return (cpu % nchildren);
+	}
+
+	nlocal = cpu % nlocal;
+	for (uint32_t i = 0; i < nchildren; i++) {
+		isc_loop_t *loop = mgr->workers[i].loop;
+
+		if (loop->cpu >= 0 && loop->node == node && nlocal-- == 0) {
+			return (i);
+		}
+	}
+
+	UNREACHABLE();
+}
+
+static void
+steer_free(isc__nm_steer_t **steerp) {
+	isc__nm_steer_t *steer = *steerp;
+
+	*steerp = NULL;
+
+	if (steer->prog != -1) {
+		close(steer->prog);
+	}
+	if (steer->loadmap != -1) {
+		close(steer->loadmap);
+	}
+	if (steer->cpumap != -1) {
+		close(steer->cpumap);
+	}
+	if (steer->sockmap != -1) {
+		close(steer->sockmap);
+	}
+
+	isc_mem_putanddetach(&steer->mctx, steer, sizeof(*steer));
+}
+
+isc_result_t
+isc__nm_steer_create(isc_nm_t *mgr, uint32_t nchildren,
+		     isc__nm_steer_t **steerp) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc__nm_steer_t *steer = NULL;
+
+	REQUIRE(VALID_NM(mgr));
+	REQUIRE(nchildren > 0 && nchildren <= mgr->nloops);
+	REQUIRE(steerp != NULL && *steerp == NULL);
+
+	steer = isc_mem_get(mgr->mctx, sizeof(*steer));
+	*steer = (isc__nm_steer_t){
+		.sockmap = -1,
+		.cpumap = -1,
+		.loadmap = -1,
+		.prog = -1,
+	};
+	isc_mem_attach(mgr->mctx, &steer->mctx);
+
+	steer->sockmap = map_create(BPF_MAP_TYPE_REUSEPORT_SOCKARRAY,
+				    sizeof(uint64_t), nchildren);
+	steer->cpumap = map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t),
+				   ISC_OS_MAXCPUS);
+	steer->loadmap = map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t),
+				    nchildren);
+	if (steer->sockmap == -1 || steer->cpumap == -1 ||
+	    steer->loadmap == -1)
+	{
+		result = isc_errno_toresult(errno);
+		goto cleanup;
+	}
+
+	for (unsigned int cpu = 0; cpu < ISC_OS_MAXCPUS; cpu++) {
+		uint32_t child = cpu_child(mgr, nchildren, cpu);
+
+		if (map_update(steer->cpumap, cpu, &child) == -1) {
+			result = isc_errno_toresult(errno);
+			goto cleanup;
+		}
+	}
+
+	steer->prog = prog_load(steer);
+	if (steer->prog == -1) {
+		result = isc_errno_toresult(errno);
+		goto cleanup;
+	}
+
+	*steerp = steer;
+
+	return (ISC_R_SUCCESS);
+
+cleanup:
+	steer_free(&steer);
+	return (result);
+}
+
+isc_result_t
+isc__nm_steer_attach(isc_nmsocket_t *sock) {
+	isc__nm_steer_t *steer = NULL;
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->type == isc_nm_udplistener);
+	REQUIRE(sock->steer != NULL);
+
+	steer = sock->steer;
+
+	/*
+	 * The sockets have to be bound before they can be put in the map;
+	 * the program then applies to the whole reuseport group.
+	 */
+	for (uint32_t i = 0; i < sock->nchildren; i++) {
+		uint64_t fd = sock->children[i].fd;
+
+		if (map_update(steer->sockmap, i, &fd) == -1) {
+			return (isc_errno_toresult(errno));
+		}
+	}
+
+	if (setsockopt(sock->children[0].fd, SOL_SOCKET,
+		       SO_ATTACH_REUSEPORT_EBPF, &steer->prog,
+		       sizeof(steer->prog)) == -1)
+	{
+		return (isc_errno_toresult(errno));
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+void
+isc__nm_steer_check(isc_nmsocket_t *sock) {
+	isc__nm_steer_t *steer = NULL;
+	uint32_t meminfo[SK_MEMINFO_VARS];
+	socklen_t len = sizeof(meminfo);
+	uint32_t overloaded, queued, limit;
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->tid == isc_tid());
+
+	if (sock->parent == NULL || sock->parent->steer == NULL) {
+		return;
+	}
+
+	if (!sock->steer_overloaded &&
+	    sock->steer_received < STEER_CHECK_INTERVAL)
+	{
+		return;
+	}
+	sock->steer_received = 0;
+
+	steer = sock->parent->steer;
+
+	if (getsockopt(sock->fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) == -1)
+	{
+		return;
+	}
+
+	queued = meminfo[SK_MEMINFO_RMEM_ALLOC];
+	limit = meminfo[SK_MEMINFO_RCVBUF];
+	if (sock->steer_overloaded) {
+		overloaded = (queued > limit / STEER_LOW);
+	} else {
+		overloaded = (queued > limit / STEER_HIGH);
+	}
+
+	if ((overloaded != 0) == sock->steer_overloaded) {
+		return;
+	}
+
+	if (map_update(steer->loadmap, sock->tid, &overloaded) == 0) {
+		sock->steer_overloaded = (overloaded != 0);
+	}
+}
+
+void
+isc__nm_steer_cleanup(isc_nmsocket_t *sock) {
+	REQUIRE(VALID_NMSOCK(sock));
+
+	if (sock->steer != NULL) {
+		steer_free(&sock->steer);
+	}
+}
+
+#else /* HAVE_REUSEPORT_STEERING */
+
+isc_result_t
+isc__nm_steer_create(isc_nm_t *mgr, uint32_t nchildren,
+		     isc__nm_steer_t **steerp) {
+	UNUSED(mgr);
+	UNUSED(nchildren);
+	UNUSED(steerp);
+
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
+isc_result_t
+isc__nm_steer_attach(isc_nmsocket_t *sock) {
+	UNUSED(sock);
+
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
+void
+isc__nm_steer_check(isc_nmsocket_t *sock) {
+	UNUSED(sock);
+}
+
+void
+isc__nm_steer_cleanup(isc_nmsocket_t *sock) {
+	UNUSED(sock);
+}
+
+#endif /* HAVE_REUSEPORT_STEERING */
@@ -429,6 +429,10 @@ start_tcp_child(isc_nm_t *mgr, isc_sockaddr_t *iface, isc_nmsocket_t *sock,
 		UNUSED(fd);
 		csock->fd = isc__nm_tcp_lb_socket(mgr,
 						  iface->type.sa.sa_family);
+		if (worker->loop->cpu >= 0) {
+			(void)isc__nm_socket_steer_cpu(csock->fd,
+						       worker->loop->cpu);
+		}
 	} else {
 		csock->fd = dup(fd);
 	}
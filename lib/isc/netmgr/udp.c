@@ -11,8 +11,13 @@
  * information regarding copyright ownership.
  */
 
+#include <net/if.h>
 #include <unistd.h>
 
+#if HAVE_DECL_UDP_SEGMENT
+#include <netinet/udp.h>
+#endif /* HAVE_DECL_UDP_SEGMENT */
+
 #include <isc/async.h>
 #include <isc/atomic.h>
 #include <isc/barrier.h>
@@ -60,6 +65,16 @@
 #endif /* if defined(HAVE_LINUX_NETLINK_H) && defined(HAVE_LINUX_RTNETLINK_H) \
 	*/
 
+/*
+ * The UDP GSO limits: the kernel refuses to segment a datagram into more
+ * than 64 segments, the whole payload must fit into a single IP packet
+ * before segmentation, and each segment must fit into the path MTU, so we
+ * only coalesce responses that don't exceed the default EDNS buffer size.
+ */
+#define UDP_GSO_MAX_SEGMENTS 64
+#define UDP_GSO_MAX_PAYLOAD  (UINT16_MAX - 48)
+#define UDP_GSO_MAX_SEGSIZE  1232
+
 static void
 udp_send_cb(uv_udp_send_t *req, int status);
 
@@ -131,6 +146,10 @@ start_udp_child_job(void *arg) {
 	}
 	isc__nm_incstats(sock, STATID_OPEN);
 
+#if HAVE_UDP_SEND_BATCHING
+	sock->udpsend.gso = (isc__nm_socket_udp_gso(sock->fd) == ISC_R_SUCCESS);
+#endif /* HAVE_UDP_SEND_BATCHING */
+
 	if (sa_family == AF_INET6) {
 		uv_bind_flags |= UV_UDP_IPV6ONLY;
 	}
@@ -160,6 +179,14 @@ start_udp_child_job(void *arg) {
 
 	isc__nm_set_network_buffers(mgr, &sock->uv_handle.handle);
 
+	if (sock->parent->packet.enabled) {
+		result = isc__nm_packet_start(sock);
+		if (result != ISC_R_SUCCESS) {
+			isc__nm_incstats(sock, STATID_BINDFAIL);
+		}
+		goto done;
+	}
+
 	r = uv_udp_recv_start(&sock->uv_handle.udp, isc__nm_alloc_cb,
 			      isc__nm_udp_read_cb);
 	if (r != 0) {
@@ -168,7 +195,9 @@ start_udp_child_job(void *arg) {
 	}
 
 done:
-	result = isc_uverr2result(r);
+	if (result == ISC_R_UNSET) {
+		result = isc_uverr2result(r);
+	}
 
 	sock->result = result;
 
@@ -193,6 +222,10 @@ start_udp_child(isc_nm_t *mgr, isc_sockaddr_t *iface, isc_nmsocket_t *sock,
 	if (mgr->load_balance_sockets) {
 		csock->fd = isc__nm_udp_lb_socket(mgr,
 						  iface->type.sa.sa_family);
+		if (worker->loop->cpu >= 0) {
+			(void)isc__nm_socket_steer_cpu(csock->fd,
+						       worker->loop->cpu);
+		}
 	} else {
 		csock->fd = dup(fd);
 	}
@@ -205,13 +238,15 @@ start_udp_child(isc_nm_t *mgr, isc_sockaddr_t *iface, isc_nmsocket_t *sock,
 	}
 }
 
-isc_result_t
-isc_nm_listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
-		 isc_nm_recv_cb_t cb, void *cbarg, isc_nmsocket_t **sockp) {
+static isc_result_t
+listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
+	  bool packet, unsigned int ifindex, bool steer, isc_nm_recv_cb_t cb,
+	  void *cbarg, isc_nmsocket_t **sockp) {
 	isc_result_t result = ISC_R_UNSET;
 	isc_nmsocket_t *sock = NULL;
 	uv_os_sock_t fd = -1;
 	isc__networker_t *worker = NULL;
+	isc__nm_steer_t *steering = NULL;
 
 	REQUIRE(VALID_NM(mgr));
 	REQUIRE(isc_tid() == 0);
@@ -227,6 +262,20 @@ isc_nm_listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
 	}
 	REQUIRE(workers <= mgr->nloops);
 
+	/*
+	 * The steering program has to be in place before the children
+	 * start reading.
+	 */
+	if (steer) {
+		if (!mgr->load_balance_sockets) {
+			return (ISC_R_NOTIMPLEMENTED);
+		}
+		result = isc__nm_steer_create(mgr, workers, &steering);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+
 	sock = isc_mempool_get(worker->nmsocket_pool);
 	isc__nmsocket_init(sock, worker, isc_nm_udplistener, iface, NULL);
 
@@ -239,6 +288,9 @@ isc_nm_listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
 
 	sock->recv_cb = cb;
 	sock->recv_cbarg = cbarg;
+	sock->packet.enabled = packet;
+	sock->packet.ifindex = ifindex;
+	sock->steer = steering;
 
 	if (!mgr->load_balance_sockets) {
 		fd = isc__nm_udp_lb_socket(mgr, iface->type.sa.sa_family);
@@ -270,6 +322,10 @@ isc_nm_listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
 		}
 	}
 
+	if (result == ISC_R_SUCCESS && steer) {
+		result = isc__nm_steer_attach(sock);
+	}
+
 	if (result != ISC_R_SUCCESS) {
 		sock->active = false;
 		isc__nm_udp_stoplistening(sock);
@@ -284,6 +340,78 @@ isc_nm_listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
 	return (ISC_R_SUCCESS);
 }
 
+isc_result_t
+isc_nm_listenudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
+		 isc_nm_recv_cb_t cb, void *cbarg, isc_nmsocket_t **sockp) {
+	return (listenudp(mgr, workers, iface, false, 0, false, cb, cbarg,
+			  sockp));
+}
+
+isc_result_t
+isc_nm_listenrawudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
+		    const char *ifname, isc_nm_recv_cb_t cb, void *cbarg,
+		    isc_nmsocket_t **sockp) {
+#if HAVE_RAW_UDP_LISTENER
+	unsigned int ifindex = 0;
+
+	REQUIRE(VALID_NM(mgr));
+	REQUIRE(iface != NULL);
+
+	/*
+	 * The datagrams are matched against the listening address.
+	 */
+	switch (iface->type.sa.sa_family) {
+	case AF_INET:
+		if (iface->type.sin.sin_addr.s_addr == INADDR_ANY) {
+			return (ISC_R_NOTIMPLEMENTED);
+		}
+		break;
+	case AF_INET6:
+		if (IN6_IS_ADDR_UNSPECIFIED(&iface->type.sin6.sin6_addr)) {
+			return (ISC_R_NOTIMPLEMENTED);
+		}
+		break;
+	default:
+		return (ISC_R_NOTIMPLEMENTED);
+	}
+
+	if (ifname != NULL) {
+		ifindex = if_nametoindex(ifname);
+	}
+
+	return (listenudp(mgr, workers, iface, true, ifindex, false, cb, cbarg,
+			  sockp));
+#else  /* HAVE_RAW_UDP_LISTENER */
+	UNUSED(mgr);
+	UNUSED(workers);
+	UNUSED(iface);
+	UNUSED(ifname);
+	UNUSED(cb);
+	UNUSED(cbarg);
+	UNUSED(sockp);
+
+	return (ISC_R_NOTIMPLEMENTED);
+#endif /* HAVE_RAW_UDP_LISTENER */
+}
+
+isc_result_t
+isc_nm_listensteeredudp(isc_nm_t *mgr, uint32_t workers, isc_sockaddr_t *iface,
+			isc_nm_recv_cb_t cb, void *cbarg, isc_nmsocket_t **sockp) {
+#if HAVE_REUSEPORT_STEERING
+	return (listenudp(mgr, workers, iface, false, 0, true, cb, cbarg,
+			  sockp));
+#else  /* HAVE_REUSEPORT_STEERING */
+	UNUSED(mgr);
+	UNUSED(workers);
+	UNUSED(iface);
+	UNUSED(cb);
+	UNUSED(cbarg);
+	UNUSED(sockp);
+
+	return (ISC_R_NOTIMPLEMENTED);
+#endif /* HAVE_REUSEPORT_STEERING */
+}
+
 #ifdef USE_ROUTE_SOCKET
 static isc_result_t
 route_socket(uv_os_sock_t *fdp) {
@@ -547,6 +675,7 @@ isc__nm_udp_read_cb(uv_udp_t *handle, ssize_t nrecv, const uv_buf_t *buf,
 	 */
 	if (nrecv == 0 && addr == NULL) {
 		INSIST(flags == 0);
+		isc__nm_steer_check(sock);
 		goto free;
 	}
 
@@ -562,6 +691,8 @@ isc__nm_udp_read_cb(uv_udp_t *handle, ssize_t nrecv, const uv_buf_t *buf,
 		sa = &sockaddr;
 	}
 
+	sock->steer_received++;
+
 	req = isc__nm_get_read_req(sock, sa);
 
 	/*
@@ -641,6 +772,283 @@ udp_send_cb(uv_udp_send_t *req, int status) {
 	isc__nm_sendcb(sock, uvreq, result, false);
 }
 
+static isc_result_t
+udp_send_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *req) {
+	const struct sockaddr *sa = sock->connected ? NULL
+						    : &req->peer.type.sa;
+	int r;
+
+	r = uv_udp_send(&req->uv_req.udp_send, &sock->uv_handle.udp,
+			&req->uvbuf, 1, sa, udp_send_cb);
+	if (r < 0) {
+		isc__nm_incstats(sock, STATID_SENDFAIL);
+		return (isc_uverr2result(r));
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+#if HAVE_UDP_SEND_BATCHING
+static void
+udp_send_cancel(isc_nmsocket_t *sock, isc_result_t result) {
+	isc__nm_uvreq_t *req = NULL;
+
+	while ((req = ISC_LIST_HEAD(sock->udpsend.pending)) != NULL) {
+		ISC_LIST_UNLINK(sock->udpsend.pending, req, link);
+		isc__nm_failed_send_cb(sock, req, result, true);
+	}
+}
+
+/*
+ * Hand the datagrams from a message that sendmmsg(2) couldn't send right
+ * now over to libuv, which queues them until the socket becomes writable.
+ */
+static void
+udp_send_fallback(isc_nmsocket_t *sock, isc__nm_uvreq_t **reqs, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		isc_result_t result = udp_send_direct(sock, reqs[i]);
+		if (result != ISC_R_SUCCESS) {
+			isc__nm_failed_send_cb(sock, reqs[i], result, false);
+		}
+	}
+}
+
+static bool
+udp_send_coalesce(isc_nmsocket_t *sock, isc__nm_uvreq_t **reqs,
+		  struct msghdr *msg, isc__nm_uvreq_t *req) {
+	isc__nm_uvreq_t *first = reqs[0];
+	isc__nm_uvreq_t *last = reqs[msg->msg_iovlen - 1];
+	size_t segsize = first->uvbuf.len;
+	size_t total = 0;
+
+	if (!sock->udpsend.gso || segsize > UDP_GSO_MAX_SEGSIZE ||
+	    msg->msg_iovlen >= UDP_GSO_MAX_SEGMENTS)
+	{
+		return (false);
+	}
+
+	/*
+	 * Only the last segment may be shorter than the others.
+	 */
+	if (last->uvbuf.len != segsize || req->uvbuf.len > segsize ||
+	    req->uvbuf.len == 0)
+	{
+		return (false);
+	}
+
+	for (size_t i = 0; i < msg->msg_iovlen; i++) {
+		total += msg->msg_iov[i].iov_len;
+	}
+	if (total + req->uvbuf.len > UDP_GSO_MAX_PAYLOAD) {
+		return (false);
+	}
+
+	return (isc_sockaddr_equal(&first->peer, &req->peer));
+}
+
+/*
+ * Send the datagrams queued on the socket since the last flush, using as
+ * few sendmmsg(2) calls as possible.  Consecutive datagrams for the same
+ * peer are merged into a single message segmented by the kernel when UDP
+ * GSO is available.
+ */
+static void
+udp_send_flush(isc_nmsocket_t *sock) {
+	isc__nm_uvreq_t *reqs[ISC_NETMGR_UDP_SENDMMSG_MAX];
+	struct iovec iovs[ISC_NETMGR_UDP_SENDMMSG_MAX];
+	struct mmsghdr msgs[ISC_NETMGR_UDP_SENDMMSG_MAX];
+	size_t firstreq[ISC_NETMGR_UDP_SENDMMSG_MAX];
+#if HAVE_DECL_UDP_SEGMENT
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} control[ISC_NETMGR_UDP_SENDMMSG_MAX];
+#endif /* HAVE_DECL_UDP_SEGMENT */
+	uv_os_fd_t fd;
+	int r;
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->tid == isc_tid());
+
+	if (isc__nm_closing(sock->worker)) {
+		udp_send_cancel(sock, ISC_R_SHUTTINGDOWN);
+		return;
+	}
+
+	if (isc__nmsocket_closing(sock)) {
+		udp_send_cancel(sock, ISC_R_CANCELED);
+		return;
+	}
+
+	r = uv_fileno(&sock->uv_handle.handle, &fd);
+	if (r < 0) {
+		udp_send_cancel(sock, isc_uverr2result(r));
+		return;
+	}
+
+	while (!ISC_LIST_EMPTY(sock->udpsend.pending)) {
+		isc__nm_uvreq_t *req = NULL;
+		size_t nreqs = 0, nmsgs = 0, sent = 0;
+
+		while (nreqs < ISC_NETMGR_UDP_SENDMMSG_MAX &&
+		       (req = ISC_LIST_HEAD(sock->udpsend.pending)) != NULL)
+		{
+			ISC_LIST_UNLINK(sock->udpsend.pending, req, link);
+
+			reqs[nreqs] = req;
+			iovs[nreqs] = (struct iovec){
+				.iov_base = req->uvbuf.base,
+				.iov_len = req->uvbuf.len,
+			};
+
+			if (nmsgs > 0 &&
+			    udp_send_coalesce(sock, &reqs[firstreq[nmsgs - 1]],
+					      &msgs[nmsgs - 1].msg_hdr, req))
+			{
+				msgs[nmsgs - 1].msg_hdr.msg_iovlen++;
+			} else {
+				firstreq[nmsgs] = nreqs;
+				msgs[nmsgs++] = (struct mmsghdr){
+					.msg_hdr = {
+						.msg_name = &req->peer.type.sa,
+						.msg_namelen = req->peer.length,
+						.msg_iov = &iovs[nreqs],
+						.msg_iovlen = 1,
+					},
+				};
+			}
+			nreqs++;
+		}
+
+#if HAVE_DECL_UDP_SEGMENT
+		for (size_t i = 0; i < nmsgs; i++) {
+			struct msghdr *msg = &msgs[i].msg_hdr;
+			struct cmsghdr *cmsg = NULL;
+
+			if (msg->msg_iovlen == 1) {
+				continue;
+			}
+
+			msg->msg_control = control[i].buf;
+			msg->msg_controllen = sizeof(control[i].buf);
+
+			cmsg = CMSG_FIRSTHDR(msg);
+			cmsg->cmsg_level = SOL_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			*(uint16_t *)(void *)CMSG_DATA(cmsg) =
+				msg->msg_iov[0].iov_len;
+		}
+#endif /* HAVE_DECL_UDP_SEGMENT */
+
+		while (sent < nmsgs) {
+			size_t first = firstreq[sent];
+			size_t count = msgs[sent].msg_hdr.msg_iovlen;
+			int n = sendmmsg(fd, &msgs[sent], nmsgs - sent, 0);
+
+			if (n < 0) {
+				switch (errno) {
+				case EINTR:
+					continue;
+				case EAGAIN:
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+				case EWOULDBLOCK:
+#endif
+				case ENOBUFS:
+					/*
+					 * The socket buffer is full; let libuv
+					 * wait for the socket to drain.
+					 */
+					udp_send_fallback(sock, &reqs[first],
+							  nreqs - first);
+					sent = nmsgs;
+					continue;
+				case EIO:
+				case EINVAL:
+					if (count > 1) {
+						/*
+						 * The kernel or the NIC
+						 * refused to segment the
+						 * datagram; stop using GSO.
+						 */
+						sock->udpsend.gso = false;
+						udp_send_fallback(sock,
+								  &reqs[first],
+								  count);
+						sent++;
+						continue;
+					}
+					FALLTHROUGH;
+				default:
+					break;
+				}
+
+				/*
+				 * The first message can't be sent at all,
+				 * report the error and carry on with the rest.
+				 */
+				isc_result_t result = isc_errno_toresult(errno);
+				for (size_t i = first; i < first + count; i++) {
+					isc__nm_incstats(sock, STATID_SENDFAIL);
+					isc__nm_failed_send_cb(sock, reqs[i],
+							       result, false);
+				}
+				sent++;
+				continue;
+			}
+
+			isc__nm_incstats(sock, STATID_SENDBATCH);
+			for (size_t i = sent; i < sent + (size_t)n; i++) {
+				struct msghdr *msg = &msgs[i].msg_hdr;
+				for (size_t j = firstreq[i];
+				     j < firstreq[i] + msg->msg_iovlen; j++)
+				{
+					isc__nm_incstats(sock,
+							 STATID_SENDBATCHMSG);
+					if (msg->msg_iovlen > 1) {
+						isc__nm_incstats(
+							sock, STATID_SENDGSO);
+					}
+					isc__nm_sendcb(sock, reqs[j],
+						       ISC_R_SUCCESS, false);
+				}
+			}
+			sent += n;
+		}
+	}
+}
+
+static void
+udp_send_flush_job(void *arg) {
+	isc_nmsocket_t *sock = arg;
+
+	REQUIRE(VALID_NMSOCK(sock));
+
+	sock->udpsend.scheduled = false;
+	udp_send_flush(sock);
+
+	isc__nmsocket_detach(&sock);
+}
+
+/*
+ * Queue the datagram on the socket and make sure the queue gets flushed
+ * once the loop is done with the current iteration, so that all the
+ * responses generated while processing a batch of received datagrams are
+ * sent together.
+ */
+static void
+udp_send_enqueue(isc_nmsocket_t *sock, isc__nm_uvreq_t *req) {
+	ISC_LIST_APPEND(sock->udpsend.pending, req, link);
+
+	if (!sock->udpsend.scheduled) {
+		sock->udpsend.scheduled = true;
+		isc__nmsocket_attach(sock, &(isc_nmsocket_t *){ NULL });
+		isc_job_run(sock->worker->loop, &sock->udpsend.job,
+			    udp_send_flush_job, sock);
+	}
+}
+#endif /* HAVE_UDP_SEND_BATCHING */
+
 /*
  * Send the data in 'region' to a peer via a UDP socket. We try to find
  * a proper sibling/child socket so that we won't have to jump to
@@ -651,11 +1059,9 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 		 isc_nm_cb_t cb, void *cbarg) {
 	isc_nmsocket_t *sock = handle->sock;
 	const isc_sockaddr_t *peer = &handle->peer;
-	const struct sockaddr *sa = NULL;
 	isc__nm_uvreq_t *uvreq = NULL;
 	isc__networker_t *worker = NULL;
 	uint32_t maxudp;
-	int r;
 	isc_result_t result;
 
 	REQUIRE(VALID_NMSOCK(sock));
@@ -664,7 +1070,6 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 
 	worker = sock->worker;
 	maxudp = atomic_load(&worker->netmgr->maxudp);
-	sa = sock->connected ? NULL : &peer->type.sa;
 
 	/*
 	 * We're simulating a firewall blocking UDP packets bigger than
@@ -682,6 +1087,7 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 	uvreq = isc__nm_uvreq_get(sock);
 	uvreq->uvbuf.base = (char *)region->base;
 	uvreq->uvbuf.len = region->length;
+	uvreq->peer = *peer;
 
 	isc_nmhandle_attach(handle, &uvreq->handle);
 
@@ -698,11 +1104,20 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 		goto fail;
 	}
 
-	r = uv_udp_send(&uvreq->uv_req.udp_send, &sock->uv_handle.udp,
-			&uvreq->uvbuf, 1, sa, udp_send_cb);
-	if (r < 0) {
-		isc__nm_incstats(sock, STATID_SENDFAIL);
-		result = isc_uverr2result(r);
+#if HAVE_UDP_SEND_BATCHING
+	/*
+	 * Responses from the listening sockets are batched.
+	 */
+	if (worker->netmgr->udp_send_batching && sock->parent != NULL &&
+	    !sock->connected)
+	{
+		udp_send_enqueue(sock, uvreq);
+		return;
+	}
+#endif /* HAVE_UDP_SEND_BATCHING */
+
+	result = udp_send_direct(sock, uvreq);
+	if (result != ISC_R_SUCCESS) {
 		goto fail;
 	}
 	return;
@@ -961,17 +1376,24 @@ isc__nm_udp_close(isc_nmsocket_t *sock) {
 	isc__nmsocket_timer_stop(sock);
 	isc__nm_stop_reading(sock);
 
+#if HAVE_UDP_SEND_BATCHING
+	udp_send_cancel(sock, ISC_R_CANCELED);
+#endif /* HAVE_UDP_SEND_BATCHING */
+
 	/*
 	 * The order of the close operation is important here, the uv_close()
 	 * gets scheduled in the reverse order, so we need to close the timer
 	 * last, so its gone by the time we destroy the socket
 	 */
 
-	/* 2. close the listening socket */
+	/* 3. close the listening socket */
 	isc__nmsocket_clearcb(sock);
 	isc__nm_stop_reading(sock);
 	uv_close(&sock->uv_handle.handle, udp_close_cb);
 
+	/* 2. close the AF_PACKET receive ring */
+	isc__nm_packet_close(sock);
+
 	/* 1. close the read timer */
 	isc__nmsocket_timer_stop(sock);
 	uv_close((uv_handle_t *)&sock->read_timer, NULL);
@@ -12,6 +12,9 @@
  */
 
 #include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #include <isc/os.h>
@@ -23,6 +26,8 @@
 static unsigned int isc__os_ncpus = 0;
 static unsigned long isc__os_cacheline = ISC_OS_CACHELINE_SIZE;
 static mode_t isc__os_umask = 0;
+static unsigned int isc__os_numanodes = 1;
+static uint8_t isc__os_cpunode[ISC_OS_MAXCPUS];
 
 #ifdef HAVE_SYSCONF
 
@@ -74,6 +79,99 @@ ncpus_initialize(void) {
 	}
 }
 
+#if defined(__linux__)
+#include <ctype.h>
+#include <dirent.h>
+
+#define NODE_DIR "/sys/devices/system/node"
+
+/*
+ * Parse a kernel CPU list such as "0-3,8-11" and assign the CPUs in it
+ * to 'node'.
+ */
+static void
+cpulist_parse(char *list, unsigned int node) {
+	char *token = NULL, *saveptr = NULL;
+
+	for (token = strtok_r(list, ",\n", &saveptr); token != NULL;
+	     token = strtok_r(NULL, ",\n", &saveptr))
+	{
+		char *end = NULL;
+		unsigned long first, last;
+
+		first = strtoul(token, &end, 10);
+		if (end == token) {
+			continue;
+		}
+		last = first;
+		if (*end == '-') {
+			last = strtoul(end + 1, NULL, 10);
+		}
+
+		for (unsigned long cpu = first;
+		     cpu <= last && cpu < ISC_OS_MAXCPUS; cpu++)
+		{
+			isc__os_cpunode[cpu] = node;
+		}
+	}
+}
+
+static void
+numa_initialize(void) {
+	DIR *dir = NULL;
+	struct dirent *dp = NULL;
+	unsigned int nodes = 0;
+
+	dir = opendir(NODE_DIR);
+	if (dir == NULL) {
+		return;
+	}
+
+	while ((dp = readdir(dir)) != NULL) {
+		char path[256], list[4096];
+		char *end = NULL;
+		unsigned long node;
+		FILE *fp = NULL;
+
+		if (strncmp(dp->d_name, "node", 4) != 0 ||
+		    !isdigit((unsigned char)dp->d_name[4]))
+		{
+			continue;
+		}
+		node = strtoul(dp->d_name + 4, &end, 10);
+		if (*end != '\0' || node >= ISC_OS_MAXNODES) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), NODE_DIR "/%s/cpulist",
+			 dp->d_name);
+		fp = fopen(path, "r");
+		if (fp == NULL) {
+			continue;
+		}
+		if (fgets(list, sizeof(list), fp) != NULL) {
+			cpulist_parse(list, node);
+		}
+		fclose(fp);
+
+		if (node >= nodes) {
+			nodes = node + 1;
+		}
+	}
+
+	closedir(dir);
+
+	if (nodes > 0) {
+		isc__os_numanodes = nodes;
+	}
+}
+#else  /* if defined(__linux__) */
+static void
+numa_initialize(void) {
+	/* Everything stays on node 0 */
+}
+#endif /* if defined(__linux__) */
+
 static void
 umask_initialize(void) {
 	isc__os_umask = umask(0);
@@ -90,6 +188,19 @@ isc_os_cacheline(void) {
 	return (isc__os_cacheline);
 }
 
+unsigned int
+isc_os_numanodes(void) {
+	return (isc__os_numanodes);
+}
+
+unsigned int
+isc_os_cpunode(unsigned int cpu) {
+	if (cpu >= ISC_OS_MAXCPUS) {
+		return (0);
+	}
+	return (isc__os_cpunode[cpu]);
+}
+
 mode_t
 isc_os_umask(void) {
 	return (isc__os_umask);
@@ -99,6 +210,7 @@ void
 isc__os_initialize(void) {
 	umask_initialize();
 	ncpus_initialize();
+	numa_initialize();
 #if defined(HAVE_SYSCONF) && defined(_SC_LEVEL1_DCACHE_LINESIZE)
 	long s = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
 	if (s > 0 && (unsigned long)s > isc__os_cacheline) {
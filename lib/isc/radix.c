@@ -26,6 +26,45 @@
 
 #define BIT_TEST(f, b) (((f) & (b)) != 0)
 
+/*
+ * Compiled trie: each node covers RADIX_STRIDE bits of the address, so
+ * it has 1 << RADIX_STRIDE slots, and every slot either leads to a child
+ * node or ends the lookup with a leaf.  The children of a node are kept
+ * next to each other in 'nodes', the leaves in 'leaves', and both are
+ * found by counting bits:
+ *
+ *   - bit N of 'vector' is set if slot N has a child node;
+ *   - bit N of 'leafvec' is set if slot N starts a run of slots with
+ *     the same leaf, so runs of equal leaves are only stored once.
+ */
+#define RADIX_STRIDE 6
+#define RADIX_SLOTS  (1 << RADIX_STRIDE)
+
+typedef struct radix_pnode {
+	uint64_t vector;
+	uint64_t leafvec;
+	uint32_t base0; /* first leaf */
+	uint32_t base1; /* first child */
+} radix_pnode_t;
+
+struct isc_radix_trie {
+	unsigned int nbytes; /* address length */
+	radix_pnode_t *nodes;
+	uint32_t nnodes, nodes_alloc;
+	isc_radix_node_t **leaves;
+	uint32_t nleaves, leaves_alloc;
+};
+
+/*
+ * A prefix to be compiled, with its address masked to its length.
+ */
+typedef struct radix_entry {
+	unsigned char addr[16];
+	uint32_t bitlen;
+	int num;
+	isc_radix_node_t *node;
+} radix_entry_t;
+
 static isc_result_t
 _new_prefix(isc_mem_t *mctx, isc_prefix_t **target, int family, void *dest,
 	    int bitlen);
@@ -193,9 +232,28 @@ _clear_radix(isc_radix_tree_t *radix, isc_radix_destroyfunc_t func) {
 	RUNTIME_CHECK(radix->num_active_node == 0);
 }
 
+static void
+_clear_trie(isc_radix_tree_t *radix) {
+	for (size_t i = 0; i < RADIX_FAMILIES; i++) {
+		isc_radix_trie_t *trie = radix->trie[i];
+
+		if (trie == NULL) {
+			continue;
+		}
+		radix->trie[i] = NULL;
+
+		isc_mem_cput(radix->mctx, trie->nodes, trie->nodes_alloc,
+			     sizeof(trie->nodes[0]));
+		isc_mem_cput(radix->mctx, trie->leaves, trie->leaves_alloc,
+			     sizeof(trie->leaves[0]));
+		isc_mem_put(radix->mctx, trie, sizeof(*trie));
+	}
+}
+
 void
 isc_radix_destroy(isc_radix_tree_t *radix, isc_radix_destroyfunc_t func) {
 	REQUIRE(radix != NULL);
+	_clear_trie(radix);
 	_clear_radix(radix, func);
 	isc_mem_putanddetach(&radix->mctx, radix, sizeof(*radix));
 }
@@ -213,6 +271,281 @@ isc_radix_process(isc_radix_tree_t *radix, isc_radix_processfunc_t func) {
 	RADIX_WALK_END;
 }
 
+/*
+ * Return the RADIX_STRIDE bits of 'addr' starting at bit 'depth',
+ * padding with zeros past the end of the address.
+ */
+static unsigned int
+_stride_bits(const unsigned char *addr, unsigned int nbytes,
+	     unsigned int depth) {
+	unsigned int byte = depth / 8;
+	unsigned int bits = addr[byte] << 8;
+
+	if (byte + 1 < nbytes) {
+		bits |= addr[byte + 1];
+	}
+
+	return ((bits >> (16 - RADIX_STRIDE - depth % 8)) & (RADIX_SLOTS - 1));
+}
+
+/*
+ * Count the bits set in 'bitmap' up to and including 'slot'.
+ */
+static unsigned int
+_rank(uint64_t bitmap, unsigned int slot) {
+	return (__builtin_popcountll(bitmap & ((UINT64_C(2) << slot) - 1)));
+}
+
+static uint32_t
+_trie_addnodes(isc_mem_t *mctx, isc_radix_trie_t *trie, uint32_t count) {
+	uint32_t base = trie->nnodes;
+
+	if (trie->nnodes + count > trie->nodes_alloc) {
+		uint32_t alloc = ISC_MAX(trie->nodes_alloc * 2,
+					 trie->nnodes + count);
+		trie->nodes = isc_mem_creget(mctx, trie->nodes,
+					     trie->nodes_alloc, alloc,
+					     sizeof(trie->nodes[0]));
+		trie->nodes_alloc = alloc;
+	}
+	trie->nnodes += count;
+
+	return (base);
+}
+
+static uint32_t
+_trie_addleaves(isc_mem_t *mctx, isc_radix_trie_t *trie, uint32_t count) {
+	uint32_t base = trie->nleaves;
+
+	if (trie->nleaves + count > trie->leaves_alloc) {
+		uint32_t alloc = ISC_MAX(trie->leaves_alloc * 2,
+					 trie->nleaves + count);
+		trie->leaves = isc_mem_creget(mctx, trie->leaves,
+					      trie->leaves_alloc, alloc,
+					      sizeof(trie->leaves[0]));
+		trie->leaves_alloc = alloc;
+	}
+	trie->nleaves += count;
+
+	return (base);
+}
+
+/*
+ * Fill in node 'index' for the prefixes in 'entries', which are all
+ * longer than 'depth' bits and share their first 'depth' bits, and
+ * then its children.  'inherited' is the first-match prefix among those
+ * that cover the whole node.
+ */
+static void
+_trie_build(isc_mem_t *mctx, isc_radix_trie_t *trie, uint32_t index,
+	    radix_entry_t **entries, size_t count, unsigned int depth,
+	    radix_entry_t *inherited) {
+	radix_entry_t *best[RADIX_SLOTS];
+	size_t children[RADIX_SLOTS + 1] = { 0 };
+	radix_entry_t **sorted = NULL;
+	size_t nlong = 0;
+	uint64_t vector = 0, leafvec = 0;
+	uint32_t base0, base1, nleaves = 0;
+	isc_radix_node_t *leaf = NULL;
+	unsigned int slot, i;
+
+	for (slot = 0; slot < RADIX_SLOTS; slot++) {
+		best[slot] = inherited;
+	}
+
+	/*
+	 * Prefixes that end within this node cover a range of slots,
+	 * where the one that was added first wins; longer ones go to the
+	 * child of their slot.
+	 */
+	for (i = 0; i < count; i++) {
+		radix_entry_t *e = entries[i];
+
+		slot = _stride_bits(e->addr, trie->nbytes, depth);
+		if (e->bitlen <= depth + RADIX_STRIDE) {
+			unsigned int span = 1 << (depth + RADIX_STRIDE -
+						  e->bitlen);
+			for (unsigned int s = slot; s < slot + span; s++) {
+				if (best[s] == NULL || e->num < best[s]->num) {
+					best[s] = e;
+				}
+			}
+		} else {
+			children[slot + 1]++;
+			vector |= UINT64_C(1) << slot;
+			nlong++;
+		}
+	}
+
+	/*
+	 * A slot with a child node never ends a lookup, so its leaf is
+	 * just a continuation of the previous run.
+	 */
+	for (slot = 0; slot < RADIX_SLOTS; slot++) {
+		isc_radix_node_t *this = NULL;
+
+		if ((vector & (UINT64_C(1) << slot)) != 0 && slot > 0) {
+			continue;
+		}
+		if (best[slot] != NULL) {
+			this = best[slot]->node;
+		}
+		if (slot == 0 || this != leaf) {
+			leafvec |= UINT64_C(1) << slot;
+			leaf = this;
+			nleaves++;
+		}
+	}
+
+	base1 = _trie_addnodes(mctx, trie, __builtin_popcountll(vector));
+	base0 = _trie_addleaves(mctx, trie, nleaves);
+
+	leaf = NULL;
+	for (slot = 0, i = 0; slot < RADIX_SLOTS; slot++) {
+		if ((leafvec & (UINT64_C(1) << slot)) != 0) {
+			trie->leaves[base0 + i++] = (best[slot] != NULL)
+							    ? best[slot]->node
+							    : NULL;
+		}
+	}
+	INSIST(i == nleaves);
+
+	trie->nodes[index] = (radix_pnode_t){
+		.vector = vector,
+		.leafvec = leafvec,
+		.base0 = base0,
+		.base1 = base1,
+	};
+
+	if (nlong == 0) {
+		return;
+	}
+
+	/*
+	 * Sort the longer prefixes by slot, and build each child from
+	 * its own share.
+	 */
+	for (slot = 0; slot < RADIX_SLOTS; slot++) {
+		children[slot + 1] += children[slot];
+	}
+	sorted = isc_mem_cget(mctx, nlong, sizeof(sorted[0]));
+	for (i = 0; i < count; i++) {
+		radix_entry_t *e = entries[i];
+
+		if (e->bitlen > depth + RADIX_STRIDE) {
+			slot = _stride_bits(e->addr, trie->nbytes, depth);
+			sorted[children[slot]++] = e;
+		}
+	}
+
+	for (slot = 0, i = 0; slot < RADIX_SLOTS; slot++) {
+		size_t start;
+
+		if ((vector & (UINT64_C(1) << slot)) == 0) {
+			continue;
+		}
+
+		start = (slot == 0) ? 0 : children[slot - 1];
+		_trie_build(mctx, trie, base1 + i++, sorted + start,
+			    children[slot] - start, depth + RADIX_STRIDE,
+			    best[slot]);
+	}
+
+	isc_mem_cput(mctx, sorted, nlong, sizeof(sorted[0]));
+}
+
+static isc_radix_trie_t *
+_trie_compile(isc_radix_tree_t *radix, int fam) {
+	isc_radix_trie_t *trie = NULL;
+	isc_radix_node_t *node = NULL;
+	radix_entry_t *entries = NULL, **ptrs = NULL;
+	radix_entry_t *inherited = NULL;
+	size_t count = 0, n = 0, nlong = 0;
+
+	RADIX_WALK(radix->head, node) {
+		if (node->node_num[fam] != -1) {
+			count++;
+		}
+	}
+	RADIX_WALK_END;
+
+	if (count > 0) {
+		entries = isc_mem_cget(radix->mctx, count, sizeof(entries[0]));
+		ptrs = isc_mem_cget(radix->mctx, count, sizeof(ptrs[0]));
+	}
+
+	RADIX_WALK(radix->head, node) {
+		if (node->node_num[fam] != -1) {
+			radix_entry_t *e = &entries[n++];
+			uint32_t bitlen = node->prefix->bitlen;
+
+			*e = (radix_entry_t){
+				.bitlen = bitlen,
+				.num = node->node_num[fam],
+				.node = node,
+			};
+			memmove(e->addr, isc_prefix_touchar(node->prefix),
+				(bitlen + 7) / 8);
+			if (bitlen % 8 != 0) {
+				e->addr[bitlen / 8] &= 0xff << (8 - bitlen % 8);
+			}
+
+			/* A zero-length prefix covers the whole root node */
+			if (bitlen == 0) {
+				if (inherited == NULL ||
+				    e->num < inherited->num)
+				{
+					inherited = e;
+				}
+			} else {
+				ptrs[nlong++] = e;
+			}
+		}
+	}
+	RADIX_WALK_END;
+	INSIST(n == count);
+
+	trie = isc_mem_get(radix->mctx, sizeof(*trie));
+	*trie = (isc_radix_trie_t){
+		.nbytes = (fam == RADIX_V6) ? 16 : 4,
+	};
+
+	(void)_trie_addnodes(radix->mctx, trie, 1);
+	_trie_build(radix->mctx, trie, 0, ptrs, nlong, 0, inherited);
+
+	if (count > 0) {
+		isc_mem_cput(radix->mctx, ptrs, count, sizeof(ptrs[0]));
+		isc_mem_cput(radix->mctx, entries, count, sizeof(entries[0]));
+	}
+
+	return (trie);
+}
+
+void
+isc_radix_compile(isc_radix_tree_t *radix) {
+	REQUIRE(RADIX_TREE_VALID(radix));
+
+	_clear_trie(radix);
+
+	radix->trie[RADIX_V4] = _trie_compile(radix, RADIX_V4);
+	radix->trie[RADIX_V6] = _trie_compile(radix, RADIX_V6);
+}
+
+static isc_radix_node_t *
+_trie_search(const isc_radix_trie_t *trie, const unsigned char *addr) {
+	const radix_pnode_t *node = &trie->nodes[0];
+	unsigned int depth = 0;
+	unsigned int slot = _stride_bits(addr, trie->nbytes, depth);
+
+	while ((node->vector & (UINT64_C(1) << slot)) != 0) {
+		node = &trie->nodes[node->base1 + _rank(node->vector, slot) - 1];
+		depth += RADIX_STRIDE;
+		slot = _stride_bits(addr, trie->nbytes, depth);
+	}
+
+	return (trie->leaves[node->base0 + _rank(node->leafvec, slot) - 1]);
+}
+
 isc_result_t
 isc_radix_search(isc_radix_tree_t *radix, isc_radix_node_t **target,
 		 isc_prefix_t *prefix) {
@@ -229,6 +562,16 @@ isc_radix_search(isc_radix_tree_t *radix, isc_radix_node_t **target,
 
 	*target = NULL;
 
+	tfam = ISC_RADIX_FAMILY(prefix);
+	if (radix->trie[tfam] != NULL &&
+	    prefix->bitlen == radix->trie[tfam]->nbytes * 8)
+	{
+		*target = _trie_search(radix->trie[tfam],
+				       isc_prefix_touchar(prefix));
+		return ((*target != NULL) ? ISC_R_SUCCESS : ISC_R_NOTFOUND);
+	}
+	tfam = -1;
+
 	node = radix->head;
 
 	if (node == NULL) {
@@ -304,6 +647,8 @@ isc_radix_insert(isc_radix_tree_t *radix, isc_radix_node_t **target,
 
 	INSIST(prefix != NULL);
 
+	_clear_trie(radix);
+
 	bitlen = prefix->bitlen;
 	fam = prefix->family;
 
@@ -609,6 +954,8 @@ isc_radix_remove(isc_radix_tree_t *radix, isc_radix_node_t *node) {
 	REQUIRE(radix != NULL);
 	REQUIRE(node != NULL);
 
+	_clear_trie(radix);
+
 	if (node->r && node->l) {
 		/*
 		 * This might be a placeholder node -- have to check and
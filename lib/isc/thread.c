@@ -28,6 +28,7 @@
 #include <sys/types.h>
 #endif /* if defined(HAVE_SYS_PROCSET_H) */
 
+#include <stdbool.h>
 #include <stdlib.h>
 
 #include <isc/atomic.h>
@@ -38,6 +39,21 @@
 #include <isc/urcu.h>
 #include <isc/util.h>
 
+#include "thread_p.h"
+
+#if defined(HAVE_PTHREAD_GETAFFINITY_NP) && \
+	defined(HAVE_PTHREAD_SETAFFINITY_NP) && defined(CPU_SETSIZE)
+#define HAVE_CPU_AFFINITY 1
+#endif
+
+#if defined(HAVE_CPU_AFFINITY)
+/*
+ * The CPUs the process was started on.
+ */
+static cpu_set_t initial_cpus;
+static bool initial_cpus_valid = false;
+#endif /* if defined(HAVE_CPU_AFFINITY) */
+
 #ifndef THREAD_MINSTACKSIZE
 #define THREAD_MINSTACKSIZE (1024U * 1024)
 #endif /* ifndef THREAD_MINSTACKSIZE */
@@ -89,6 +105,12 @@ thread_body(struct thread_wrap *wrap) {
 
 static void *
 thread_run(void *wrap) {
+	/*
+	 * Don't inherit the CPU of a loop thread that created this one;
+	 * loop threads pin themselves again.
+	 */
+	isc_thread_resetaffinity();
+
 	/*
 	 * Get a thread-local digest context only in new threads.
 	 * The main thread is handled by isc__initialize().
@@ -169,6 +191,76 @@ isc_thread_setname(isc_thread_t thread, const char *name) {
 #endif /* if defined(HAVE_PTHREAD_SETNAME_NP) && !defined(__APPLE__) */
 }
 
+unsigned int
+isc_thread_getaffinity(unsigned int *cpus, unsigned int size) {
+	REQUIRE(cpus != NULL || size == 0);
+
+#if defined(HAVE_CPU_AFFINITY)
+	cpu_set_t set;
+	unsigned int n = 0;
+
+	CPU_ZERO(&set);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		return (0);
+	}
+
+	for (unsigned int cpu = 0; cpu < CPU_SETSIZE && n < size; cpu++) {
+		if (CPU_ISSET(cpu, &set)) {
+			cpus[n++] = cpu;
+		}
+	}
+
+	return (n);
+#else  /* if defined(HAVE_CPU_AFFINITY) */
+	UNUSED(cpus);
+	UNUSED(size);
+	return (0);
+#endif /* if defined(HAVE_CPU_AFFINITY) */
+}
+
+isc_result_t
+isc_thread_setaffinity(unsigned int cpu) {
+#if defined(HAVE_CPU_AFFINITY)
+	cpu_set_t set;
+
+	if (cpu >= CPU_SETSIZE) {
+		return (ISC_R_FAILURE);
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		return (ISC_R_FAILURE);
+	}
+
+	return (ISC_R_SUCCESS);
+#else  /* if defined(HAVE_CPU_AFFINITY) */
+	UNUSED(cpu);
+	return (ISC_R_NOTIMPLEMENTED);
+#endif /* if defined(HAVE_CPU_AFFINITY) */
+}
+
+void
+isc_thread_resetaffinity(void) {
+#if defined(HAVE_CPU_AFFINITY)
+	if (initial_cpus_valid) {
+		(void)pthread_setaffinity_np(pthread_self(),
+					     sizeof(initial_cpus),
+					     &initial_cpus);
+	}
+#endif /* if defined(HAVE_CPU_AFFINITY) */
+}
+
+void
+isc__thread_initialize(void) {
+#if defined(HAVE_CPU_AFFINITY)
+	CPU_ZERO(&initial_cpus);
+	initial_cpus_valid = (pthread_getaffinity_np(pthread_self(),
+						     sizeof(initial_cpus),
+						     &initial_cpus) == 0);
+#endif /* if defined(HAVE_CPU_AFFINITY) */
+}
+
 void
 isc_thread_yield(void) {
 #if defined(HAVE_SCHED_YIELD)
@@ -11,20 +11,33 @@
  * information regarding copyright ownership.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 
 #include <isc/job.h>
 #include <isc/loop.h>
+#include <isc/thread.h>
 #include <isc/urcu.h>
 #include <isc/uv.h>
 #include <isc/work.h>
 
 #include "loop_p.h"
 
+/*
+ * The libuv threadpool is started by the first loop thread that queues
+ * work, and its threads inherit that loop's CPU.
+ */
+static thread_local bool affinity_reset = false;
+
 static void
 isc__work_cb(uv_work_t *req) {
 	isc_work_t *work = uv_req_get_data((uv_req_t *)req);
 
+	if (!affinity_reset) {
+		isc_thread_resetaffinity();
+		affinity_reset = true;
+	}
+
 	rcu_register_thread();
 
 	work->work_cb(work->cbarg);
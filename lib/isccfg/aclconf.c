@@ -634,6 +634,7 @@ cfg_acl_fromconfig(const cfg_obj_t *acl_data, const cfg_obj_t *cctx,
 	const cfg_obj_t *obj_acl_tuple = NULL;
 	const cfg_obj_t *obj_port = NULL, *obj_transport = NULL;
 	bool is_tuple = false;
+	bool toplevel;
 
 	if (nest_level != 0) {
 		new_nest_level = nest_level - 1;
@@ -644,6 +645,8 @@ cfg_acl_fromconfig(const cfg_obj_t *acl_data, const cfg_obj_t *cctx,
 	REQUIRE(*target == NULL || DNS_ACL_VALID(*target));
 
 	REQUIRE(acl_data != NULL);
+
+	toplevel = (*target == NULL);
 	if (cfg_obj_islist(acl_data)) {
 		caml = acl_data;
 	} else {
@@ -971,6 +974,14 @@ cfg_acl_fromconfig(const cfg_obj_t *acl_data, const cfg_obj_t *cctx,
 		INSIST(dacl->length <= dacl->alloc);
 	}
 
+	/*
+	 * The ACL is complete unless it is being absorbed into a parent,
+	 * so build the fast lookup structure for the IP table now.
+	 */
+	if (toplevel) {
+		dns_iptable_compile(dacl->iptable);
+	}
+
 	dns_acl_attach(dacl, target);
 	result = ISC_R_SUCCESS;
 
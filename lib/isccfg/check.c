@@ -51,6 +51,7 @@
 #include <dns/keyvalues.h>
 #include <dns/peer.h>
 #include <dns/rbt.h>
+#include <dns/rcode.h>
 #include <dns/rdataclass.h>
 #include <dns/rdatatype.h>
 #include <dns/rpz.h>
@@ -878,6 +879,104 @@ check_ratelimit(cfg_aclconfctx_t *actx, const cfg_obj_t *voptions,
 	return (result);
 }
 
+static isc_result_t
+check_dnstapfilter(cfg_aclconfctx_t *actx, const cfg_obj_t *voptions,
+		   const cfg_obj_t *config, isc_log_t *logctx,
+		   isc_mem_t *mctx) {
+	isc_result_t result = ISC_R_SUCCESS;
+	const cfg_obj_t *map = NULL;
+	const cfg_obj_t *options = NULL;
+	const cfg_obj_t *obj = NULL;
+	const cfg_listelt_t *element = NULL;
+
+	if (voptions != NULL) {
+		cfg_map_get(voptions, "dnstap-filter", &map);
+	}
+	if (config != NULL && map == NULL) {
+		cfg_map_get(config, "options", &options);
+		if (options != NULL) {
+			cfg_map_get(options, "dnstap-filter", &map);
+		}
+	}
+	if (map == NULL) {
+		return (ISC_R_SUCCESS);
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(map, "sample", &obj);
+	if (obj != NULL && cfg_obj_asuint32(obj) == 0) {
+		cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
+			    "dnstap-filter sample must be greater than 0");
+		result = ISC_R_RANGE;
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(map, "qnames", &obj);
+	for (element = cfg_list_first(obj); element != NULL;
+	     element = cfg_list_next(element))
+	{
+		const cfg_obj_t *nameobj = cfg_listelt_value(element);
+		const char *str = cfg_obj_asstring(nameobj);
+		dns_fixedname_t fixed;
+		isc_result_t tresult;
+
+		tresult = dns_name_fromstring(dns_fixedname_initname(&fixed),
+					      str, dns_rootname, 0, NULL);
+		if (tresult != ISC_R_SUCCESS) {
+			cfg_obj_log(nameobj, logctx, ISC_LOG_ERROR,
+				    "dnstap-filter qnames: '%s' is not a "
+				    "valid name",
+				    str);
+			if (result == ISC_R_SUCCESS) {
+				result = tresult;
+			}
+		}
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(map, "rcodes", &obj);
+	for (element = cfg_list_first(obj); element != NULL;
+	     element = cfg_list_next(element))
+	{
+		const cfg_obj_t *rcodeobj = cfg_listelt_value(element);
+		const char *str = cfg_obj_asstring(rcodeobj);
+		isc_textregion_t r;
+		dns_rcode_t rcode;
+
+		r.base = UNCONST(str);
+		r.length = strlen(str);
+		if (dns_rcode_fromtext(&rcode, &r) != ISC_R_SUCCESS ||
+		    rcode > 15)
+		{
+			cfg_obj_log(rcodeobj, logctx, ISC_LOG_ERROR,
+				    "dnstap-filter rcodes: '%s' is not a "
+				    "valid header response code",
+				    str);
+			if (result == ISC_R_SUCCESS) {
+				result = ISC_R_FAILURE;
+			}
+		}
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(map, "clients", &obj);
+	if (obj != NULL) {
+		dns_acl_t *acl = NULL;
+		isc_result_t tresult;
+
+		tresult = cfg_acl_fromconfig(obj, config, logctx, actx, mctx, 0,
+					     &acl);
+		if (acl != NULL) {
+			dns_acl_detach(&acl);
+		}
+		if (result == ISC_R_SUCCESS) {
+			result = tresult;
+		}
+	}
+
+	return (result);
+}
+
 static isc_result_t
 check_fetchlimit(const cfg_obj_t *voptions, const cfg_obj_t *config,
 		 isc_log_t *logctx) {
@@ -1100,6 +1199,8 @@ check_listener(const cfg_obj_t *listener, const cfg_obj_t *config,
 	const cfg_obj_t *portobj = NULL;
 	const cfg_obj_t *http_server = NULL;
 	const cfg_obj_t *proxyobj = NULL;
+	const cfg_obj_t *rawobj = NULL;
+	const cfg_obj_t *steerobj = NULL;
 	bool do_tls = false, no_tls = false;
 	dns_acl_t *acl = NULL;
 
@@ -1194,6 +1295,40 @@ check_listener(const cfg_obj_t *listener, const cfg_obj_t *config,
 		}
 	}
 
+	rawobj = cfg_tuple_get(ltup, "raw-udp");
+	if (rawobj != NULL && cfg_obj_isboolean(rawobj) &&
+	    cfg_obj_asboolean(rawobj) &&
+	    ((tlsobj != NULL && cfg_obj_isstring(tlsobj)) ||
+	     (httpobj != NULL && cfg_obj_isstring(httpobj)) ||
+	     (proxyobj != NULL && cfg_obj_isstring(proxyobj))))
+	{
+		cfg_obj_log(rawobj, logctx, ISC_LOG_ERROR,
+			    "'raw-udp' cannot be used together with 'tls', "
+			    "'http' or 'proxy'");
+
+		if (result == ISC_R_SUCCESS) {
+			result = ISC_R_FAILURE;
+		}
+	}
+
+	steerobj = cfg_tuple_get(ltup, "steering");
+	if (steerobj != NULL && cfg_obj_isstring(steerobj) &&
+	    strcasecmp(cfg_obj_asstring(steerobj), "cpu") == 0 &&
+	    ((rawobj != NULL && cfg_obj_isboolean(rawobj) &&
+	      cfg_obj_asboolean(rawobj)) ||
+	     (tlsobj != NULL && cfg_obj_isstring(tlsobj)) ||
+	     (httpobj != NULL && cfg_obj_isstring(httpobj)) ||
+	     (proxyobj != NULL && cfg_obj_isstring(proxyobj))))
+	{
+		cfg_obj_log(steerobj, logctx, ISC_LOG_ERROR,
+			    "'steering cpu' cannot be used together with "
+			    "'raw-udp', 'tls', 'http' or 'proxy'");
+
+		if (result == ISC_R_SUCCESS) {
+			result = ISC_R_FAILURE;
+		}
+	}
+
 	tresult = cfg_acl_fromconfig(cfg_tuple_get(listener, "acl"), config,
 				     logctx, actx, mctx, 0, &acl);
 	if (result == ISC_R_SUCCESS) {
@@ -1936,6 +2071,17 @@ check_options(const cfg_obj_t *options, const cfg_obj_t *config,
 					result = ISC_R_FAILURE;
 				}
 			}
+
+			obj2 = NULL;
+			(void)cfg_map_get(options, "dnstap-ring-size", &obj2);
+			if (obj2 != NULL && dmode == dns_dtmode_unix) {
+				cfg_obj_log(obj2, logctx, ISC_LOG_ERROR,
+					    "dnstap-ring-size "
+					    "cannot be set with mode unix");
+				if (result == ISC_R_SUCCESS) {
+					result = ISC_R_FAILURE;
+				}
+			}
 		}
 	}
 #endif /* ifdef HAVE_DNSTAP */
@@ -5821,6 +5967,11 @@ check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 		result = tresult;
 	}
 
+	tresult = check_dnstapfilter(actx, voptions, config, logctx, mctx);
+	if (tresult != ISC_R_SUCCESS) {
+		result = tresult;
+	}
+
 	/*
 	 * Load plugins.
 	 */
@@ -149,12 +149,20 @@ static cfg_type_t cfg_type_zone;
 
 /*% listen-on */
 
+static const char *steering_enums[] = { "cpu", "hash", NULL };
+static cfg_type_t cfg_type_steering = {
+	"steering",   cfg_parse_enum,  cfg_print_ustring,
+	cfg_doc_enum, &cfg_rep_string, &steering_enums
+};
+
 static cfg_tuplefielddef_t listenon_tuple_fields[] = {
 	{ "port", &cfg_type_optional_port, 0 },
 	/*
 	 * Let's follow the protocols encapsulation order (lower->upper), at
 	 * least roughly.
 	 */
+	{ "raw-udp", &cfg_type_boolean, 0 },
+	{ "steering", &cfg_type_steering, 0 },
 	{ "proxy", &cfg_type_astring, CFG_CLAUSEFLAG_EXPERIMENTAL },
 	{ "tls", &cfg_type_astring, 0 },
 #if HAVE_LIBNGHTTP2
@@ -1269,11 +1277,13 @@ static cfg_clausedef_t options_clauses[] = {
 #ifdef HAVE_DNSTAP
 	{ "dnstap-output", &cfg_type_dnstapoutput, 0 },
 	{ "dnstap-identity", &cfg_type_serverid, 0 },
+	{ "dnstap-ring-size", &cfg_type_sizeval, 0 },
 	{ "dnstap-version", &cfg_type_qstringornone, 0 },
 #else  /* ifdef HAVE_DNSTAP */
 	{ "dnstap-output", &cfg_type_dnstapoutput,
 	  CFG_CLAUSEFLAG_NOTCONFIGURED },
 	{ "dnstap-identity", &cfg_type_serverid, CFG_CLAUSEFLAG_NOTCONFIGURED },
+	{ "dnstap-ring-size", &cfg_type_sizeval, CFG_CLAUSEFLAG_NOTCONFIGURED },
 	{ "dnstap-version", &cfg_type_qstringornone,
 	  CFG_CLAUSEFLAG_NOTCONFIGURED },
 #endif /* ifdef HAVE_DNSTAP */
@@ -1381,12 +1391,14 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "tkey-domain", &cfg_type_qstring, 0 },
 	{ "tkey-gssapi-credential", &cfg_type_qstring, 0 },
 	{ "tkey-gssapi-keytab", &cfg_type_qstring, 0 },
+	{ "transfer-cache-size", &cfg_type_sizeval, 0 },
 	{ "transfer-message-size", &cfg_type_uint32, 0 },
 	{ "transfers-in", &cfg_type_uint32, 0 },
 	{ "transfers-out", &cfg_type_uint32, 0 },
 	{ "transfers-per-ns", &cfg_type_uint32, 0 },
 	{ "treat-cr-as-space", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "udp-receive-buffer", &cfg_type_uint32, 0 },
+	{ "udp-send-batching", &cfg_type_boolean, 0 },
 	{ "udp-send-buffer", &cfg_type_uint32, 0 },
 	{ "update-quota", &cfg_type_uint32, 0 },
 	{ "use-id-pool", NULL, CFG_CLAUSEFLAG_ANCIENT },
@@ -1396,6 +1408,7 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "use-v6-udp-ports", &cfg_type_bracketed_portlist,
 	  CFG_CLAUSEFLAG_DEPRECATED },
 	{ "version", &cfg_type_qstringornone, 0 },
+	{ "zone-load-concurrency", &cfg_type_uint32, 0 },
 	{ NULL, NULL, 0 }
 };
 
@@ -1489,7 +1502,7 @@ static cfg_type_t cfg_type_mustbesecure = {
 	cfg_doc_tuple,	&cfg_rep_tuple,	 mustbesecure_fields
 };
 
-static const char *masterformat_enums[] = { "raw", "text", NULL };
+static const char *masterformat_enums[] = { "image", "raw", "text", NULL };
 static cfg_type_t cfg_type_masterformat = {
 	"masterformat", cfg_parse_enum,	 cfg_print_ustring,
 	cfg_doc_enum,	&cfg_rep_string, &masterformat_enums
@@ -1559,6 +1572,26 @@ static cfg_type_t cfg_type_dnstap = { "dnstap",
 				      &cfg_rep_list,
 				      &cfg_type_dnstap_entry };
 
+/*%
+ * dnstap-filter
+ */
+static cfg_clausedef_t dnstapfilter_clauses[] = {
+	{ "clients", &cfg_type_bracketed_aml, 0 },
+	{ "latency", &cfg_type_uint32, 0 },
+	{ "qnames", &cfg_type_namelist, 0 },
+	{ "rcodes", &cfg_type_namelist, 0 },
+	{ "sample", &cfg_type_uint32, 0 },
+	{ NULL, NULL, 0 }
+};
+
+static cfg_clausedef_t *dnstapfilter_clausesets[] = { dnstapfilter_clauses,
+						       NULL };
+
+static cfg_type_t cfg_type_dnstapfilter = {
+	"dnstap-filter", cfg_parse_map, cfg_print_map,
+	cfg_doc_map,	 &cfg_rep_map,	dnstapfilter_clausesets
+};
+
 /*%
  * dnstap-output
  */
@@ -2120,8 +2153,11 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "dnssec-validation", &cfg_type_boolorauto, 0 },
 #ifdef HAVE_DNSTAP
 	{ "dnstap", &cfg_type_dnstap, 0 },
+	{ "dnstap-filter", &cfg_type_dnstapfilter, 0 },
 #else  /* ifdef HAVE_DNSTAP */
 	{ "dnstap", &cfg_type_dnstap, CFG_CLAUSEFLAG_NOTCONFIGURED },
+	{ "dnstap-filter", &cfg_type_dnstapfilter,
+	  CFG_CLAUSEFLAG_NOTCONFIGURED },
 #endif /* HAVE_DNSTAP */
 	{ "dual-stack-servers", &cfg_type_nameportiplist, 0 },
 	{ "edns-udp-size", &cfg_type_uint32, 0 },
@@ -2146,6 +2182,7 @@ static cfg_clausedef_t view_clauses[] = {
 #else  /* ifdef HAVE_LMDB */
 	{ "lmdb-mapsize", &cfg_type_sizeval, CFG_CLAUSEFLAG_NOTCONFIGURED },
 #endif /* ifdef HAVE_LMDB */
+	{ "loop-cache-size", &cfg_type_uint32, 0 },
 	{ "max-acache-size", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "max-cache-size", &cfg_type_sizeorpercent, 0 },
 	{ "max-cache-ttl", &cfg_type_duration, 0 },
@@ -2193,6 +2230,7 @@ static cfg_clausedef_t view_clauses[] = {
 	  CFG_CLAUSEFLAG_ANCIENT },
 	{ "resolver-query-timeout", &cfg_type_uint32, 0 },
 	{ "resolver-retry-interval", &cfg_type_uint32, CFG_CLAUSEFLAG_ANCIENT },
+	{ "response-cache-size", &cfg_type_sizeval, 0 },
 	{ "response-padding", &cfg_type_resppadding, 0 },
 	{ "response-policy", &cfg_type_rpz, 0 },
 	{ "rfc2308-type1", NULL, CFG_CLAUSEFLAG_ANCIENT },
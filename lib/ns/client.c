@@ -35,6 +35,7 @@
 #include <isc/timer.h>
 #include <isc/util.h>
 
+#include <dns/acl.h>
 #include <dns/adb.h>
 #include <dns/badcache.h>
 #include <dns/cache.h>
@@ -50,11 +51,13 @@
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/resolver.h>
+#include <dns/respcache.h>
 #include <dns/result.h>
 #include <dns/stats.h>
 #include <dns/tsig.h>
 #include <dns/view.h>
 #include <dns/zone.h>
+#include <dns/zt.h>
 
 #include <ns/client.h>
 #include <ns/interfacemgr.h>
@@ -106,6 +109,17 @@
 #define WANTPAD(x)	(((x)->attributes & NS_CLIENTATTR_WANTPAD) != 0)
 #define USEKEEPALIVE(x) (((x)->attributes & NS_CLIENTATTR_USEKEEPALIVE) != 0)
 
+/*%
+ * Requests with any of these attributes get a response that is specific
+ * to the client and are never answered from the response cache.
+ */
+#define RESPCACHE_NOATTRS                                                 \
+	(NS_CLIENTATTR_MULTICAST | NS_CLIENTATTR_WANTNSID |               \
+	 NS_CLIENTATTR_BADCOOKIE | NS_CLIENTATTR_WANTCOOKIE |             \
+	 NS_CLIENTATTR_HAVECOOKIE | NS_CLIENTATTR_WANTEXPIRE |            \
+	 NS_CLIENTATTR_HAVEEXPIRE | NS_CLIENTATTR_HAVEECS |               \
+	 NS_CLIENTATTR_WANTPAD)
+
 #define MANAGER_MAGIC	 ISC_MAGIC('N', 'S', 'C', 'm')
 #define VALID_MANAGER(m) ISC_MAGIC_VALID(m, MANAGER_MAGIC)
 
@@ -352,6 +366,49 @@ ns_client_drop(ns_client_t *client, isc_result_t result) {
 	}
 }
 
+/*
+ * Record the time from the receipt of a query to the completion of the
+ * send of its response in the view's latency statistics.
+ */
+static void
+client_latency(ns_client_t *client) {
+	dns_stats_t *stats = NULL;
+	dns_latencytransport_t transport;
+	uint64_t usecs;
+	bool recursed;
+
+	if (client->view == NULL || client->view->latencystats == NULL ||
+	    client->message == NULL ||
+	    client->message->opcode != dns_opcode_query)
+	{
+		return;
+	}
+
+	switch (ns_client_transport_type(client)) {
+	case DNS_TRANSPORT_UDP:
+		transport = dns_latency_udp;
+		break;
+	case DNS_TRANSPORT_TCP:
+		transport = dns_latency_tcp;
+		break;
+	case DNS_TRANSPORT_TLS:
+		transport = dns_latency_tls;
+		break;
+	case DNS_TRANSPORT_HTTP:
+		transport = dns_latency_https;
+		break;
+	default:
+		return;
+	}
+
+	stats = client->view->latencystats;
+	usecs = (isc_time_monotonic() - client->recvtime) / NS_PER_US;
+	recursed = (client->query.attributes & NS_QUERYATTR_RECURSED) != 0;
+
+	dns_latencystats_add(stats, transport, recursed, client->query.qtype,
+			     usecs);
+}
+
 static void
 client_senddone(isc_nmhandle_t *handle, isc_result_t result, void *cbarg) {
 	ns_client_t *client = cbarg;
@@ -384,6 +441,8 @@ client_senddone(isc_nmhandle_t *handle, isc_result_t result, void *cbarg) {
 				      isc_result_totext(result));
 			isc_nm_bad_request(handle);
 		}
+	} else {
+		client_latency(client);
 	}
 
 	isc_nmhandle_detach(&handle);
@@ -582,6 +641,237 @@ done:
 	ns_client_drop(client, result);
 }
 
+/*
+ * Check whether the response to the current request can be taken from,
+ * or stored in, the view's response cache, and compute the flags it is
+ * cached under.  Anything that could make the response depend on the
+ * client rather than on the question rules this out.
+ */
+static bool
+client_respcache_ok(ns_client_t *client, unsigned int *flagsp) {
+	dns_view_t *view = client->view;
+	dns_message_t *message = client->message;
+	dns_rdatatype_t qtype = client->query.qtype;
+	unsigned int flags = 0;
+
+	if (view == NULL || view->respcache == NULL || TCP_CLIENT(client) ||
+	    client->sendcb != NULL)
+	{
+		return (false);
+	}
+
+	if (view->recursion || view->rrl != NULL || view->rpzs != NULL ||
+	    view->dns64cnt != 0 || view->sortlist != NULL ||
+	    view->nocasecompress != NULL || view->hooktable != NULL ||
+	    !ISC_LIST_EMPTY(view->dlz_searched))
+	{
+		return (false);
+	}
+
+	if (message->opcode != dns_opcode_query || message->tsigkey != NULL ||
+	    message->sig0key != NULL ||
+	    (client->attributes & RESPCACHE_NOATTRS) != 0 ||
+	    dns_rdatatype_ismeta(qtype) || dns_rdatatype_atparent(qtype))
+	{
+		return (false);
+	}
+
+	if ((client->attributes & NS_CLIENTATTR_WANTOPT) != 0) {
+		flags |= DNS_RESPCACHE_EDNS;
+	}
+	if ((client->attributes & NS_CLIENTATTR_WANTDNSSEC) != 0) {
+		flags |= DNS_RESPCACHE_DO;
+	}
+	if ((client->attributes & NS_CLIENTATTR_WANTAD) != 0) {
+		flags |= DNS_RESPCACHE_AD;
+	}
+	if ((message->flags & DNS_MESSAGEFLAG_RD) != 0) {
+		flags |= DNS_RESPCACHE_RD;
+	}
+	if ((message->flags & DNS_MESSAGEFLAG_CD) != 0) {
+		flags |= DNS_RESPCACHE_CD;
+	}
+	if (isc_sockaddr_pf(&client->peeraddr) == AF_INET6) {
+		flags |= DNS_RESPCACHE_INET6;
+	}
+
+	*flagsp = flags;
+	return (true);
+}
+
+/*
+ * Only data from ordinary zones that anyone may query is cached.
+ */
+static bool
+client_respcache_zoneok(ns_client_t *client, dns_zone_t *zone) {
+	dns_acl_t *acl = NULL;
+
+	switch (dns_zone_gettype(zone)) {
+	case dns_zone_primary:
+	case dns_zone_secondary:
+		break;
+	default:
+		return (false);
+	}
+
+	acl = dns_zone_getqueryacl(zone);
+	if (acl == NULL) {
+		acl = client->view->queryacl;
+	}
+	if (acl != NULL && !dns_acl_isany(acl)) {
+		return (false);
+	}
+
+	acl = dns_zone_getqueryonacl(zone);
+	if (acl == NULL) {
+		acl = client->view->queryonacl;
+	}
+	if (acl != NULL && !dns_acl_isany(acl)) {
+		return (false);
+	}
+
+	return (true);
+}
+
+static void
+client_respcache_add(ns_client_t *client, isc_buffer_t *buffer,
+		     bool complete) {
+	dns_message_t *message = client->message;
+	dns_zone_t *zone = client->query.authzone;
+	unsigned int flags = 0;
+	isc_region_t r;
+
+	if (!client_respcache_ok(client, &flags) || client->ede != NULL ||
+	    zone == NULL || zone != client->query.respcache.zone ||
+	    client->query.respcache.generation == 0 ||
+	    (client->query.attributes & NS_QUERYATTR_REDIRECT) != 0)
+	{
+		return;
+	}
+
+	if ((message->flags & DNS_MESSAGEFLAG_AA) == 0 ||
+	    (message->flags & DNS_MESSAGEFLAG_TC) != 0 ||
+	    (message->rcode != dns_rcode_noerror &&
+	     message->rcode != dns_rcode_nxdomain))
+	{
+		return;
+	}
+
+	if (!client_respcache_zoneok(client, zone)) {
+		return;
+	}
+
+	isc_buffer_usedregion(buffer, &r);
+	dns_respcache_add(client->view->respcache, zone,
+			  client->query.respcache.generation,
+			  client->query.origqname, client->query.qtype,
+			  message->rdclass, flags, isc_buffer_length(buffer),
+			  complete, &r);
+}
+
+isc_result_t
+ns_client_sendcached(ns_client_t *client, unsigned int *ancountp) {
+	dns_view_t *view = NULL;
+	dns_message_t *message = NULL;
+	dns_zone_t *zone = NULL;
+	unsigned char *data = NULL;
+	isc_buffer_t buffer;
+	unsigned int flags = 0;
+	uint32_t generation;
+	isc_result_t result;
+	size_t respsize;
+#ifdef HAVE_DNSTAP
+	dns_transport_type_t transport_type;
+	dns_dtmsgtype_t dtmsgtype;
+	isc_region_t zr;
+#endif /* HAVE_DNSTAP */
+
+	REQUIRE(NS_CLIENT_VALID(client));
+	REQUIRE(ancountp != NULL);
+
+	view = client->view;
+	message = client->message;
+
+	if (!client_respcache_ok(client, &flags)) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	result = dns_view_findzone(view, client->query.qname,
+				   DNS_ZTFIND_MIRROR, &zone);
+	if (result != ISC_R_SUCCESS && result != DNS_R_PARTIALMATCH) {
+		return (ISC_R_NOTFOUND);
+	}
+
+	generation = dns_zone_getgeneration(zone);
+	if (generation == 0 || !client_respcache_zoneok(client, zone)) {
+		dns_zone_detach(&zone);
+		return (ISC_R_NOTFOUND);
+	}
+
+	client_allocsendbuf(client, &buffer, &data);
+	result = dns_respcache_find(view->respcache, zone, generation,
+				    client->query.qname, client->query.qtype,
+				    message->rdclass, flags, message->id,
+				    &buffer);
+	if (result != ISC_R_SUCCESS) {
+		dns_zone_detach(&zone);
+		ns_stats_increment(client->manager->sctx->nsstats,
+				   ns_statscounter_respcachemiss);
+		return (ISC_R_NOTFOUND);
+	}
+
+	CTRACE("sendcached");
+
+	message->rcode = data[3] & 0x0f;
+	*ancountp = (data[6] << 8) | data[7];
+
+#ifdef HAVE_DNSTAP
+	dns_name_toregion(dns_zone_getorigin(zone), &zr);
+	if ((flags & DNS_RESPCACHE_RD) != 0) {
+		dtmsgtype = DNS_DTTYPE_CR;
+	} else {
+		dtmsgtype = DNS_DTTYPE_AR;
+	}
+	transport_type = ns_client_transport_type(client);
+	dns_dt_send(view, dtmsgtype, &client->peeraddr, &client->destsockaddr,
+		    transport_type, &zr, &client->requesttime, NULL, &buffer);
+#endif /* HAVE_DNSTAP */
+
+	dns_zone_detach(&zone);
+
+	respsize = isc_buffer_usedlength(&buffer);
+
+	client_sendpkg(client, &buffer);
+
+	switch (isc_sockaddr_pf(&client->peeraddr)) {
+	case AF_INET:
+		isc_histomulti_inc(client->manager->sctx->udpoutstats4,
+				   DNS_SIZEHISTO_BUCKETOUT(respsize));
+		break;
+	case AF_INET6:
+		isc_histomulti_inc(client->manager->sctx->udpoutstats6,
+				   DNS_SIZEHISTO_BUCKETOUT(respsize));
+		break;
+	default:
+		UNREACHABLE();
+	}
+
+	ns_stats_increment(client->manager->sctx->nsstats,
+			   ns_statscounter_respcachehit);
+	ns_stats_increment(client->manager->sctx->nsstats,
+			   ns_statscounter_response);
+	dns_rcodestats_increment(client->manager->sctx->rcodestats,
+				 message->rcode);
+	if ((flags & DNS_RESPCACHE_EDNS) != 0) {
+		ns_stats_increment(client->manager->sctx->nsstats,
+				   ns_statscounter_edns0out);
+	}
+
+	client->query.attributes |= NS_QUERYATTR_ANSWERED;
+
+	return (ISC_R_SUCCESS);
+}
+
 void
 ns_client_send(ns_client_t *client) {
 	isc_result_t result;
@@ -594,6 +884,7 @@ ns_client_send(ns_client_t *client) {
 	unsigned int render_opts;
 	unsigned int preferred_glue;
 	bool opt_included = false;
+	bool complete = true;
 	size_t respsize;
 	dns_aclenv_t *env = NULL;
 #ifdef HAVE_DNSTAP
@@ -733,7 +1024,9 @@ ns_client_send(ns_client_t *client) {
 	result = dns_message_rendersection(client->message,
 					   DNS_SECTION_ADDITIONAL,
 					   preferred_glue | render_opts);
-	if (result != ISC_R_SUCCESS && result != ISC_R_NOSPACE) {
+	if (result == ISC_R_NOSPACE) {
+		complete = false;
+	} else if (result != ISC_R_SUCCESS) {
 		goto cleanup;
 	}
 renderend:
@@ -742,6 +1035,10 @@ renderend:
 		goto cleanup;
 	}
 
+	if (client->view != NULL && client->view->respcache != NULL) {
+		client_respcache_add(client, &buffer, complete);
+	}
+
 #ifdef HAVE_DNSTAP
 	memset(&zr, 0, sizeof(zr));
 	if (((client->message->flags & DNS_MESSAGEFLAG_AA) != 0) &&
@@ -1876,6 +2173,7 @@ ns_client_request(isc_nmhandle_t *handle, isc_result_t eresult,
 	client->state = NS_CLIENTSTATE_WORKING;
 
 	client->requesttime = isc_time_now();
+	client->recvtime = isc_time_monotonic();
 	client->tnow = client->requesttime;
 	client->now = isc_time_seconds(&client->tnow);
 
@@ -202,6 +202,7 @@ struct ns_client {
 	bool	       peeraddr_valid;
 	isc_netaddr_t  destaddr;
 	isc_sockaddr_t destsockaddr;
+	isc_nanosecs_t recvtime; /*%< monotonic, for latency stats */
 
 	dns_ecs_t ecs; /*%< EDNS client subnet sent by client */
 
@@ -295,6 +296,20 @@ ns_client_sendraw(ns_client_t *client, dns_message_t *msg);
  * send msg as a response using client->message->id for the id.
  */
 
+isc_result_t
+ns_client_sendcached(ns_client_t *client, unsigned int *ancountp);
+/*%<
+ * Finish processing the current client request by sending a response
+ * from the view's response cache, if the request qualifies and a
+ * matching response is found.  On success, client->message->rcode is
+ * set to the RCODE of the response and '*ancountp' to the number of
+ * records in its answer section.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS		a cached response was sent
+ *\li	#ISC_R_NOTFOUND		the request must be processed normally
+ */
+
 void
 ns_client_error(ns_client_t *client, isc_result_t result);
 /*%<
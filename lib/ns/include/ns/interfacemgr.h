@@ -90,6 +90,8 @@ struct ns_interface {
 					   *   connected) */
 	ns_clientmgr_t	   *clientmgr;	  /*%< Client manager. */
 	isc_nm_proxy_type_t proxy_type;
+	bool		    raw_udp; /*%< Receive UDP from AF_PACKET ring */
+	bool		    steer_cpu; /*%< Steer UDP by receiving CPU */
 	ISC_LINK(ns_interface_t) link;
 };
 
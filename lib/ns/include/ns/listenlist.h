@@ -53,6 +53,8 @@ struct ns_listenelt {
 	uint32_t	    http_max_clients;
 	uint32_t	    max_concurrent_streams;
 	isc_nm_proxy_type_t proxy;
+	bool		    raw_udp;
+	bool		    steer_cpu;
 	ISC_LINK(ns_listenelt_t) link;
 };
 
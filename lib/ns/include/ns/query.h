@@ -144,6 +144,15 @@ struct ns_query {
 	dns_keytag_t root_key_sentinel_keyid;
 	bool	     root_key_sentinel_is_ta;
 	bool	     root_key_sentinel_not_ta;
+
+	/*%
+	 * Zone generation observed before the first zone lookup, for
+	 * the response cache.  The zone is not attached.
+	 */
+	struct {
+		dns_zone_t *zone;
+		uint32_t    generation;
+	} respcache;
 };
 
 #define NS_QUERYATTR_RECURSIONOK     0x000001
@@ -165,6 +174,7 @@ struct ns_query {
 #define NS_QUERYATTR_REDIRECT	     0x020000
 #define NS_QUERYATTR_ANSWERED	     0x040000
 #define NS_QUERYATTR_STALEOK	     0x080000
+#define NS_QUERYATTR_RECURSED	     0x100000
 
 typedef struct query_ctx query_ctx_t;
 
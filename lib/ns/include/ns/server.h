@@ -104,6 +104,9 @@ struct ns_server {
 	bool	       interface_auto;
 	dns_tkeyctx_t *tkeyctx;
 
+	/*% Rendered outgoing transfers */
+	ns_xfrcache_t *xfrcache;
+
 	/*% Server id for NSID */
 	char *server_id;
 	bool  usehostname;
@@ -114,7 +114,10 @@ enum {
 
 	ns_statscounter_recurshighwater = 68,
 
-	ns_statscounter_max = 69,
+	ns_statscounter_respcachehit = 69,
+	ns_statscounter_respcachemiss = 70,
+
+	ns_statscounter_max = 71,
 };
 
 void
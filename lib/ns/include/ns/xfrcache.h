@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file
+ * \brief
+ * A cache of rendered outgoing zone transfers.
+ *
+ * Notes:
+ *\li	When many secondaries transfer the same zone, they usually ask
+ *	for exactly the same data: an AXFR of the current version, or an
+ *	IXFR from the previous serial to the current one.  The transfer
+ *	cache keeps the question and answer sections of every TCP message
+ *	of such a transfer, as they were rendered and compressed for the
+ *	first requester, so that later requesters can be sent the same
+ *	bytes.  The header, OPT and TSIG records are not cached; they are
+ *	rendered for each client.
+ *
+ *\li	An entry is keyed on the zone database, the question, the
+ *	serial range and the transfer format.  The database is not
+ *	attached; it is identified by its address together with the time
+ *	the zone was loaded, so that an old entry cannot match a new
+ *	database allocated at the same address.  Looking up or publishing
+ *	an entry removes the entries for the same zone that were made for
+ *	another database or another current serial, since those can no
+ *	longer be requested.
+ *
+ *\li	Only one transfer at a time records an entry for a given key.
+ *	The entries being recorded are charged to the cache as they grow,
+ *	so that the published and recording entries together stay within
+ *	the size of the cache; the least recently used published entries
+ *	are removed to make room.
+ *
+ * MP:
+ *\li	The cache is locked internally.  An entry is only modified by the
+ *	transfer that records it, and is read-only once published.
+ */
+
+/***
+ *** Imports
+ ***/
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/mem.h>
+#include <isc/refcount.h>
+#include <isc/region.h>
+#include <isc/time.h>
+
+#include <dns/types.h>
+
+#include <ns/types.h>
+
+/***
+ *** Types
+ ***/
+
+typedef struct ns_xfrentry ns_xfrentry_t;
+
+/*%
+ * What a cached transfer was made for.  All the fields must match for
+ * an entry to be used.
+ */
+typedef struct ns_xfrkey {
+	const dns_zone_t *zone;	    /*%< only compared, never dereferenced */
+	const dns_db_t	 *db;	    /*%< only compared, never dereferenced */
+	isc_time_t	  loadtime; /*%< dns_zone_getloadtime() */
+	const dns_name_t *qname;    /*%< compared case-sensitively */
+	dns_rdataclass_t  rdclass;
+	dns_rdatatype_t	  qtype;
+	bool		  incremental;	/*%< IXFR rather than AXFR data */
+	uint32_t	  begin_serial; /*%< for incremental transfers */
+	uint32_t	  end_serial;
+	bool		  many_answers;
+	uint16_t	  msgsize; /*%< transfer-message-size */
+} ns_xfrkey_t;
+
+/***
+ *** Functions
+ ***/
+
+void
+ns_xfrcache_create(isc_mem_t *mctx, ns_xfrcache_t **cachep);
+/*%<
+ * Create a transfer cache.  It is disabled (has a maximum size of
+ * zero) until ns_xfrcache_setsize() is called.
+ *
+ * Requires:
+ *\li	'mctx' is valid.
+ *\li	'cachep' is not NULL and '*cachep' is NULL.
+ */
+
+void
+ns_xfrcache_destroy(ns_xfrcache_t **cachep);
+/*%<
+ * Destroy the transfer cache and release its entries.  Entries that
+ * are still being replayed are freed when their last reference is
+ * detached.
+ *
+ * Requires:
+ *\li	'*cachep' is a valid transfer cache.
+ */
+
+void
+ns_xfrcache_setsize(ns_xfrcache_t *cache, size_t size);
+/*%<
+ * Set the maximum total size of the cached transfers to 'size' bytes,
+ * removing entries as needed.  Zero disables the cache and flushes it.
+ *
+ * Requires:
+ *\li	'cache' is a valid transfer cache.
+ */
+
+isc_result_t
+ns_xfrcache_find(ns_xfrcache_t *cache, const ns_xfrkey_t *key,
+		 ns_xfrentry_t **entryp);
+/*%<
+ * Look for a published transfer for 'key', and attach '*entryp' to it.
+ *
+ * Requires:
+ *\li	'cache' is a valid transfer cache.
+ *\li	'key' is not NULL.
+ *\li	'entryp' is not NULL and '*entryp' is NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOTFOUND
+ */
+
+isc_result_t
+ns_xfrcache_begin(ns_xfrcache_t *cache, const ns_xfrkey_t *key,
+		  ns_xfrentry_t **entryp);
+/*%<
+ * Create a new, empty entry for recording a transfer for 'key'.  The
+ * entry is not visible to ns_xfrcache_find() until it is published.
+ * If the entry is detached without being published, another transfer
+ * may record it.  The cache must not be destroyed while an entry is
+ * being recorded.
+ *
+ * Requires:
+ *\li	'cache' is a valid transfer cache.
+ *\li	'key' is not NULL.
+ *\li	'entryp' is not NULL and '*entryp' is NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_DISABLED		the cache has a maximum size of zero
+ *\li	#ISC_R_EXISTS		another transfer is recording 'key'
+ */
+
+isc_result_t
+ns_xfrentry_addmsg(ns_xfrentry_t *entry, const isc_region_t *question,
+		   unsigned int qdcount, const isc_region_t *answer,
+		   unsigned int ancount);
+/*%<
+ * Append a message, made up of the rendered 'question' and 'answer'
+ * sections holding 'qdcount' and 'ancount' records, to an entry that is
+ * being recorded.
+ *
+ * Requires:
+ *\li	'entry' is a valid, unpublished entry.
+ *\li	'question' and 'answer' are not NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOSPACE		the entry would not fit in the cache
+ *				next to the other entries being
+ *				recorded; it can no longer be published.
+ */
+
+void
+ns_xfrcache_publish(ns_xfrcache_t *cache, ns_xfrentry_t *entry);
+/*%<
+ * Make a completely recorded entry available to ns_xfrcache_find(),
+ * replacing any stale entries for the same zone.  If the same transfer
+ * has been published in the meantime, or the entry does not fit, it
+ * is silently dropped.
+ *
+ * Requires:
+ *\li	'cache' is a valid transfer cache.
+ *\li	'entry' is a valid, unpublished entry created from 'cache'.
+ */
+
+unsigned int
+ns_xfrentry_count(ns_xfrentry_t *entry);
+/*%<
+ * Return the number of messages in the entry.
+ *
+ * Requires:
+ *\li	'entry' is valid.
+ */
+
+unsigned int
+ns_xfrentry_maxlength(ns_xfrentry_t *entry);
+/*%<
+ * Return the length of the longest message in the entry, not counting
+ * the message header or the records that are rendered for each client.
+ *
+ * Requires:
+ *\li	'entry' is valid.
+ */
+
+isc_result_t
+ns_xfrentry_getmsg(ns_xfrentry_t *entry, unsigned int n,
+		   isc_region_t *question, unsigned int *qdcountp,
+		   isc_region_t *answer, unsigned int *ancountp);
+/*%<
+ * Get the 'n'th message of the entry, counting from zero.
+ *
+ * Requires:
+ *\li	'entry' is valid.
+ *\li	'question', 'qdcountp', 'answer' and 'ancountp' are not NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMORE		'n' is past the last message
+ */
+
+ISC_REFCOUNT_DECL(ns_xfrentry);
@@ -476,6 +476,42 @@ static isc_result_t
 ns_interface_listenudp(ns_interface_t *ifp, isc_nm_proxy_type_t proxy) {
 	isc_result_t result;
 
+	if (ifp->raw_udp) {
+		INSIST(proxy == ISC_NM_PROXY_NONE);
+		result = isc_nm_listenrawudp(ifp->mgr->nm, ISC_NM_LISTEN_ALL,
+					     &ifp->addr, ifp->name,
+					     ns_client_request, ifp,
+					     &ifp->udplistensocket);
+		if (result == ISC_R_SUCCESS) {
+			return (result);
+		}
+
+		char sabuf[ISC_SOCKADDR_FORMATSIZE];
+		isc_sockaddr_format(&ifp->addr, sabuf, sizeof(sabuf));
+		isc_log_write(IFMGR_COMMON_LOGARGS, ISC_LOG_WARNING,
+			      "creating raw UDP listener on %s: %s, "
+			      "using UDP sockets instead",
+			      sabuf, isc_result_totext(result));
+	}
+
+	if (ifp->steer_cpu) {
+		INSIST(proxy == ISC_NM_PROXY_NONE);
+		result = isc_nm_listensteeredudp(ifp->mgr->nm,
+						 ISC_NM_LISTEN_ALL, &ifp->addr,
+						 ns_client_request, ifp,
+						 &ifp->udplistensocket);
+		if (result == ISC_R_SUCCESS) {
+			return (result);
+		}
+
+		char sabuf[ISC_SOCKADDR_FORMATSIZE];
+		isc_sockaddr_format(&ifp->addr, sabuf, sizeof(sabuf));
+		isc_log_write(IFMGR_COMMON_LOGARGS, ISC_LOG_WARNING,
+			      "creating steered UDP listener on %s: %s, "
+			      "using hash steering instead",
+			      sabuf, isc_result_totext(result));
+	}
+
 	/* Reserve space for an ns_client_t with the netmgr handle */
 	if (proxy == ISC_NM_PROXY_NONE) {
 		result = isc_nm_listenudp(ifp->mgr->nm, ISC_NM_LISTEN_ALL,
@@ -671,6 +707,8 @@ interface_setup(ns_interfacemgr_t *mgr, isc_sockaddr_t *addr, const char *name,
 
 	ifp->flags |= NS_INTERFACEFLAG_LISTENING;
 	ifp->proxy_type = elt->proxy;
+	ifp->raw_udp = elt->raw_udp;
+	ifp->steer_cpu = elt->steer_cpu;
 
 	if (elt->is_http) {
 		result = ns_interface_listenhttp(
@@ -1042,9 +1080,12 @@ same_listener_type(ns_interface_t *ifp, ns_listenelt_t *new_le) {
 
 	/*
 	 * Check if transport type of the listener has not changed. That
-	 * implies that PROXY type has not been changed as well.
+	 * implies that PROXY type, the raw UDP receive path and the UDP
+	 * steering have not been changed as well.
 	 */
-	return (same_transport_type && new_le->proxy == ifp->proxy_type);
+	return (same_transport_type && new_le->proxy == ifp->proxy_type &&
+		new_le->raw_udp == ifp->raw_udp &&
+		new_le->steer_cpu == ifp->steer_cpu);
 }
 
 static bool
@@ -199,6 +199,8 @@ listenelt_create(isc_mem_t *mctx, in_port_t port, dns_acl_t *acl,
 	elt->http_max_clients = 0;
 	elt->max_concurrent_streams = 0;
 	elt->proxy = proxy;
+	elt->raw_udp = false;
+	elt->steer_cpu = false;
 
 	*target = elt;
 	return (ISC_R_SUCCESS);
@@ -598,6 +598,38 @@ query_send(ns_client_t *client) {
 	}
 }
 
+/*
+ * Try to answer the query with a pre-rendered response from the view's
+ * response cache.
+ */
+static bool
+query_respcache(ns_client_t *client) {
+	unsigned int ancount = 0;
+	isc_statscounter_t counter;
+
+	if (client->view->respcache == NULL ||
+	    ns_client_sendcached(client, &ancount) != ISC_R_SUCCESS)
+	{
+		return (false);
+	}
+
+	inc_stats(client, ns_statscounter_authans);
+	if (client->message->rcode == dns_rcode_nxdomain) {
+		counter = ns_statscounter_nxdomain;
+	} else if (ancount == 0) {
+		counter = ns_statscounter_nxrrset;
+	} else {
+		counter = ns_statscounter_success;
+	}
+	inc_stats(client, counter);
+
+	if (!client->nodetach) {
+		isc_nmhandle_detach(&client->reqhandle);
+	}
+
+	return (true);
+}
+
 static void
 query_error(ns_client_t *client, isc_result_t result, int line) {
 	int loglevel = ISC_LOG_DEBUG(3);
@@ -792,6 +824,8 @@ query_reset(ns_client_t *client, bool everything) {
 	client->query.root_key_sentinel_keyid = 0;
 	client->query.root_key_sentinel_is_ta = false;
 	client->query.root_key_sentinel_not_ta = false;
+	client->query.respcache.zone = NULL;
+	client->query.respcache.generation = 0;
 }
 
 static void
@@ -1119,6 +1153,18 @@ query_getzonedb(ns_client_t *client, const dns_name_t *name,
 		partial = true;
 	}
 	if (result == ISC_R_SUCCESS || result == DNS_R_PARTIALMATCH) {
+		if (client->view->respcache != NULL &&
+		    !client->query.authdbset)
+		{
+			/*
+			 * Sample the zone generation before the zone data
+			 * is read, so that a response cached from it can't
+			 * outlive a concurrent update.
+			 */
+			client->query.respcache.zone = zone;
+			client->query.respcache.generation =
+				dns_zone_getgeneration(zone);
+		}
 		result = dns_zone_getdb(zone, &db);
 	}
 
@@ -6280,6 +6326,7 @@ fetch_callback(void *arg) {
 	isc_nmhandle_detach(&HANDLE_RECTYPE_NORMAL(client));
 
 	client->query.attributes &= ~NS_QUERYATTR_RECURSING;
+	client->query.attributes |= NS_QUERYATTR_RECURSED;
 	client->state = NS_CLIENTSTATE_WORKING;
 
 	/*
@@ -11962,6 +12009,10 @@ ns_query_start(ns_client_t *client, isc_nmhandle_t *handle) {
 
 	log_tat(client);
 
+	if (query_respcache(client)) {
+		return;
+	}
+
 	if (dns_rdatatype_ismeta(qtype)) {
 		switch (qtype) {
 		case dns_rdatatype_any:
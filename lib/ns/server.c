@@ -25,6 +25,7 @@
 #include <ns/query.h>
 #include <ns/server.h>
 #include <ns/stats.h>
+#include <ns/xfrcache.h>
 
 #define SCTX_MAGIC    ISC_MAGIC('S', 'c', 't', 'x')
 #define SCTX_VALID(s) ISC_MAGIC_VALID(s, SCTX_MAGIC)
@@ -70,6 +71,8 @@ ns_server_create(isc_mem_t *mctx, ns_matchview_t matchingview,
 	ISC_LIST_INIT(sctx->http_quotas);
 	isc_mutex_init(&sctx->http_quotas_lock);
 
+	ns_xfrcache_create(mctx, &sctx->xfrcache);
+
 	ns_stats_create(mctx, ns_statscounter_max, &sctx->nsstats);
 
 	dns_rdatatypestats_create(mctx, &sctx->rcvquerystats);
@@ -168,6 +171,9 @@ ns_server_detach(ns_server_t **sctxp) {
 		if (sctx->tkeyctx != NULL) {
 			dns_tkeyctx_destroy(&sctx->tkeyctx);
 		}
+		if (sctx->xfrcache != NULL) {
+			ns_xfrcache_destroy(&sctx->xfrcache);
+		}
 
 		if (sctx->nsstats != NULL) {
 			ns_stats_detach(&sctx->nsstats);
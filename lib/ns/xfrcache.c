@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <isc/list.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/refcount.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+
+#include <ns/xfrcache.h>
+
+#define XFRCACHE_MAGIC	  ISC_MAGIC('X', 'f', 'r', 'C')
+#define VALID_XFRCACHE(c) ISC_MAGIC_VALID(c, XFRCACHE_MAGIC)
+
+#define XFRENTRY_MAGIC	  ISC_MAGIC('X', 'f', 'r', 'E')
+#define VALID_XFRENTRY(e) ISC_MAGIC_VALID(e, XFRENTRY_MAGIC)
+
+/*
+ * One TCP message: the question section (empty except in the first
+ * message) followed by the answer section, as they were rendered
+ * right after the message header.
+ */
+typedef struct xfrmsg {
+	unsigned char *base;
+	unsigned int qlength;
+	unsigned int length;
+	unsigned int qdcount;
+	unsigned int ancount;
+} xfrmsg_t;
+
+struct ns_xfrentry {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	ns_xfrcache_t *cache; /* Charged for the entry while recording */
+	ns_xfrkey_t key;
+	dns_fixedname_t fqname;
+	xfrmsg_t *msgs;
+	unsigned int nmsgs;
+	unsigned int nalloc;
+	unsigned int maxlength; /* Longest message */
+	size_t size;		/* Memory used by the entry */
+	bool overflow;
+	bool published;
+	ISC_LINK(ns_xfrentry_t) link;
+};
+
+typedef ISC_LIST(ns_xfrentry_t) xfrentrylist_t;
+
+struct ns_xfrcache {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_mutex_t lock;
+	size_t maxsize;
+	size_t size;		  /* Published and recording entries */
+	xfrentrylist_t entries;	  /* Most recently used first */
+	xfrentrylist_t recording; /* Not published yet */
+};
+
+void
+ns_xfrcache_create(isc_mem_t *mctx, ns_xfrcache_t **cachep) {
+	ns_xfrcache_t *cache = NULL;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(cachep != NULL && *cachep == NULL);
+
+	cache = isc_mem_get(mctx, sizeof(*cache));
+	*cache = (ns_xfrcache_t){
+		.entries = ISC_LIST_INITIALIZER,
+		.recording = ISC_LIST_INITIALIZER,
+	};
+	isc_mutex_init(&cache->lock);
+	isc_mem_attach(mctx, &cache->mctx);
+	cache->magic = XFRCACHE_MAGIC;
+
+	*cachep = cache;
+}
+
+static void
+detach_all(xfrentrylist_t *list) {
+	ns_xfrentry_t *entry = NULL;
+
+	while ((entry = ISC_LIST_HEAD(*list)) != NULL) {
+		ISC_LIST_UNLINK(*list, entry, link);
+		ns_xfrentry_detach(&entry);
+	}
+}
+
+/*
+ * Unlink 'entry' from the cache and move it to 'list', so that it can
+ * be detached once the cache is unlocked.
+ */
+static void
+evict(ns_xfrcache_t *cache, ns_xfrentry_t *entry, xfrentrylist_t *list) {
+	ISC_LIST_UNLINK(cache->entries, entry, link);
+	INSIST(cache->size >= entry->size);
+	cache->size -= entry->size;
+	ISC_LIST_APPEND(*list, entry, link);
+}
+
+static void
+evict_lru(ns_xfrcache_t *cache, size_t needed, xfrentrylist_t *list) {
+	while (cache->size + needed > cache->maxsize &&
+	       !ISC_LIST_EMPTY(cache->entries))
+	{
+		evict(cache, ISC_LIST_TAIL(cache->entries), list);
+	}
+}
+
+void
+ns_xfrcache_destroy(ns_xfrcache_t **cachep) {
+	ns_xfrcache_t *cache = NULL;
+
+	REQUIRE(cachep != NULL && VALID_XFRCACHE(*cachep));
+
+	cache = *cachep;
+	*cachep = NULL;
+
+	INSIST(ISC_LIST_EMPTY(cache->recording));
+
+	cache->magic = 0;
+	detach_all(&cache->entries);
+	isc_mutex_destroy(&cache->lock);
+	isc_mem_putanddetach(&cache->mctx, cache, sizeof(*cache));
+}
+
+void
+ns_xfrcache_setsize(ns_xfrcache_t *cache, size_t size) {
+	xfrentrylist_t evicted = ISC_LIST_INITIALIZER;
+
+	REQUIRE(VALID_XFRCACHE(cache));
+
+	LOCK(&cache->lock);
+	cache->maxsize = size;
+	evict_lru(cache, 0, &evicted);
+	UNLOCK(&cache->lock);
+
+	detach_all(&evicted);
+}
+
+static bool
+key_equal(const ns_xfrkey_t *a, const ns_xfrkey_t *b) {
+	if (a->zone != b->zone || a->db != b->db ||
+	    isc_time_compare(&a->loadtime, &b->loadtime) != 0 ||
+	    a->rdclass != b->rdclass ||
+	    a->qtype != b->qtype || a->incremental != b->incremental ||
+	    a->end_serial != b->end_serial ||
+	    a->many_answers != b->many_answers || a->msgsize != b->msgsize)
+	{
+		return (false);
+	}
+	if (a->incremental && a->begin_serial != b->begin_serial) {
+		return (false);
+	}
+
+	/*
+	 * The cached question section echoes the name with the case
+	 * of the first request.
+	 */
+	return (dns_name_caseequal(a->qname, b->qname));
+}
+
+/*
+ * Entries for an older version of the zone can't be asked for anymore.
+ */
+static bool
+key_stale(const ns_xfrkey_t *old, const ns_xfrkey_t *new) {
+	return (old->zone == new->zone &&
+		(old->db != new->db ||
+		 isc_time_compare(&old->loadtime, &new->loadtime) != 0 ||
+		 old->end_serial != new->end_serial));
+}
+
+/*
+ * Remove the entries made for another version of the zone 'key' is
+ * for.  The database of such an entry may have been freed already.
+ */
+static void
+evict_stale(ns_xfrcache_t *cache, const ns_xfrkey_t *key,
+	    xfrentrylist_t *list) {
+	ns_xfrentry_t *old = NULL, *next = NULL;
+
+	ISC_LIST_FOREACH_SAFE (cache->entries, old, link, next) {
+		if (key_stale(&old->key, key)) {
+			evict(cache, old, list);
+		}
+	}
+}
+
+isc_result_t
+ns_xfrcache_find(ns_xfrcache_t *cache, const ns_xfrkey_t *key,
+		 ns_xfrentry_t **entryp) {
+	xfrentrylist_t evicted = ISC_LIST_INITIALIZER;
+	isc_result_t result = ISC_R_NOTFOUND;
+	ns_xfrentry_t *entry = NULL;
+
+	REQUIRE(VALID_XFRCACHE(cache));
+	REQUIRE(key != NULL);
+	REQUIRE(entryp != NULL && *entryp == NULL);
+
+	LOCK(&cache->lock);
+	evict_stale(cache, key, &evicted);
+	ISC_LIST_FOREACH (cache->entries, entry, link) {
+		if (key_equal(&entry->key, key)) {
+			ISC_LIST_UNLINK(cache->entries, entry, link);
+			ISC_LIST_PREPEND(cache->entries, entry, link);
+			ns_xfrentry_attach(entry, entryp);
+			result = ISC_R_SUCCESS;
+			break;
+		}
+	}
+	UNLOCK(&cache->lock);
+
+	detach_all(&evicted);
+
+	return (result);
+}
+
+isc_result_t
+ns_xfrcache_begin(ns_xfrcache_t *cache, const ns_xfrkey_t *key,
+		  ns_xfrentry_t **entryp) {
+	ns_xfrentry_t *entry = NULL, *other = NULL;
+	isc_result_t result = ISC_R_SUCCESS;
+
+	REQUIRE(VALID_XFRCACHE(cache));
+	REQUIRE(key != NULL);
+	REQUIRE(entryp != NULL && *entryp == NULL);
+
+	entry = isc_mem_get(cache->mctx, sizeof(*entry));
+	*entry = (ns_xfrentry_t){
+		.key = *key,
+		.size = sizeof(*entry),
+		.references = ISC_REFCOUNT_INITIALIZER(1),
+		.link = ISC_LINK_INITIALIZER,
+	};
+	entry->key.qname = dns_fixedname_initname(&entry->fqname);
+	dns_name_copy(key->qname, dns_fixedname_name(&entry->fqname));
+
+	/*
+	 * Only one transfer records each entry; the others that miss the
+	 * cache at the same time are rendered as usual.
+	 */
+	LOCK(&cache->lock);
+	if (cache->maxsize == 0) {
+		result = ISC_R_DISABLED;
+	} else {
+		ISC_LIST_FOREACH (cache->recording, other, link) {
+			if (key_equal(&other->key, &entry->key)) {
+				result = ISC_R_EXISTS;
+				break;
+			}
+		}
+	}
+	if (result == ISC_R_SUCCESS) {
+		ISC_LIST_APPEND(cache->recording, entry, link);
+		cache->size += entry->size;
+		entry->cache = cache;
+	}
+	UNLOCK(&cache->lock);
+
+	if (result != ISC_R_SUCCESS) {
+		isc_mem_put(cache->mctx, entry, sizeof(*entry));
+		return (result);
+	}
+
+	isc_mem_attach(cache->mctx, &entry->mctx);
+	entry->magic = XFRENTRY_MAGIC;
+
+	*entryp = entry;
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Charge 'needed' more bytes for a recording entry to the cache,
+ * making room for them by removing published entries if necessary.
+ */
+static isc_result_t
+charge(ns_xfrentry_t *entry, size_t needed) {
+	xfrentrylist_t evicted = ISC_LIST_INITIALIZER;
+	ns_xfrcache_t *cache = entry->cache;
+	isc_result_t result = ISC_R_NOSPACE;
+
+	LOCK(&cache->lock);
+	if (entry->size + needed <= cache->maxsize) {
+		evict_lru(cache, needed, &evicted);
+		if (cache->size + needed <= cache->maxsize) {
+			cache->size += needed;
+			result = ISC_R_SUCCESS;
+		}
+	}
+	UNLOCK(&cache->lock);
+
+	detach_all(&evicted);
+
+	return (result);
+}
+
+/*
+ * Stop recording 'entry', and give back what it was charged.
+ */
+static void
+uncharge(ns_xfrentry_t *entry) {
+	ns_xfrcache_t *cache = entry->cache;
+
+	ISC_LIST_UNLINK(cache->recording, entry, link);
+	INSIST(cache->size >= entry->size);
+	cache->size -= entry->size;
+	entry->cache = NULL;
+}
+
+isc_result_t
+ns_xfrentry_addmsg(ns_xfrentry_t *entry, const isc_region_t *question,
+		   unsigned int qdcount, const isc_region_t *answer,
+		   unsigned int ancount) {
+	xfrmsg_t *msg = NULL;
+	unsigned int length;
+	size_t grow = 0;
+
+	REQUIRE(VALID_XFRENTRY(entry));
+	REQUIRE(!entry->published);
+	REQUIRE(question != NULL && answer != NULL);
+
+	if (entry->overflow) {
+		return (ISC_R_NOSPACE);
+	}
+
+	length = question->length + answer->length;
+	if (entry->nmsgs == entry->nalloc) {
+		grow = ISC_MAX(entry->nalloc, 16U);
+	}
+	if (charge(entry, length + grow * sizeof(entry->msgs[0])) !=
+	    ISC_R_SUCCESS)
+	{
+		entry->overflow = true;
+		return (ISC_R_NOSPACE);
+	}
+
+	if (grow != 0) {
+		entry->msgs = isc_mem_creget(
+			entry->mctx, entry->msgs, entry->nalloc,
+			entry->nalloc + grow, sizeof(entry->msgs[0]));
+		entry->nalloc += grow;
+		entry->size += grow * sizeof(entry->msgs[0]);
+	}
+
+	msg = &entry->msgs[entry->nmsgs++];
+	*msg = (xfrmsg_t){
+		.base = isc_mem_get(entry->mctx, length),
+		.qlength = question->length,
+		.length = length,
+		.qdcount = qdcount,
+		.ancount = ancount,
+	};
+	if (question->length > 0) {
+		memmove(msg->base, question->base, question->length);
+	}
+	memmove(msg->base + question->length, answer->base, answer->length);
+	entry->size += length;
+	entry->maxlength = ISC_MAX(entry->maxlength, length);
+
+	return (ISC_R_SUCCESS);
+}
+
+void
+ns_xfrcache_publish(ns_xfrcache_t *cache, ns_xfrentry_t *entry) {
+	xfrentrylist_t evicted = ISC_LIST_INITIALIZER;
+	ns_xfrentry_t *old = NULL;
+	bool duplicate = false;
+
+	REQUIRE(VALID_XFRCACHE(cache));
+	REQUIRE(VALID_XFRENTRY(entry));
+	REQUIRE(!entry->published);
+	REQUIRE(entry->cache == cache);
+
+	entry->published = true;
+
+	LOCK(&cache->lock);
+	uncharge(entry);
+	if (entry->overflow || entry->nmsgs == 0 ||
+	    entry->size > cache->maxsize)
+	{
+		UNLOCK(&cache->lock);
+		return;
+	}
+
+	evict_stale(cache, &entry->key, &evicted);
+	ISC_LIST_FOREACH (cache->entries, old, link) {
+		if (key_equal(&old->key, &entry->key)) {
+			duplicate = true;
+			break;
+		}
+	}
+
+	if (!duplicate) {
+		evict_lru(cache, entry->size, &evicted);
+		ISC_LIST_PREPEND(cache->entries, ns_xfrentry_ref(entry), link);
+		cache->size += entry->size;
+	}
+	UNLOCK(&cache->lock);
+
+	detach_all(&evicted);
+}
+
+unsigned int
+ns_xfrentry_count(ns_xfrentry_t *entry) {
+	REQUIRE(VALID_XFRENTRY(entry));
+
+	return (entry->nmsgs);
+}
+
+unsigned int
+ns_xfrentry_maxlength(ns_xfrentry_t *entry) {
+	REQUIRE(VALID_XFRENTRY(entry));
+
+	return (entry->maxlength);
+}
+
+isc_result_t
+ns_xfrentry_getmsg(ns_xfrentry_t *entry, unsigned int n,
+		   isc_region_t *question, unsigned int *qdcountp,
+		   isc_region_t *answer, unsigned int *ancountp) {
+	xfrmsg_t *msg = NULL;
+
+	REQUIRE(VALID_XFRENTRY(entry));
+	REQUIRE(question != NULL && qdcountp != NULL);
+	REQUIRE(answer != NULL && ancountp != NULL);
+
+	if (n >= entry->nmsgs) {
+		return (ISC_R_NOMORE);
+	}
+
+	msg = &entry->msgs[n];
+	question->base = msg->base;
+	question->length = msg->qlength;
+	answer->base = msg->base + msg->qlength;
+	answer->length = msg->length - msg->qlength;
+	*qdcountp = msg->qdcount;
+	*ancountp = msg->ancount;
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+xfrentry_destroy(ns_xfrentry_t *entry) {
+	ns_xfrcache_t *cache = entry->cache;
+
+	entry->magic = 0;
+
+	/*
+	 * A recording that was abandoned lets another transfer record
+	 * the entry.
+	 */
+	if (cache != NULL) {
+		LOCK(&cache->lock);
+		uncharge(entry);
+		UNLOCK(&cache->lock);
+	}
+
+	for (unsigned int i = 0; i < entry->nmsgs; i++) {
+		isc_mem_put(entry->mctx, entry->msgs[i].base,
+			    entry->msgs[i].length);
+	}
+	if (entry->msgs != NULL) {
+		isc_mem_cput(entry->mctx, entry->msgs, entry->nalloc,
+			     sizeof(entry->msgs[0]));
+	}
+	isc_mem_putanddetach(&entry->mctx, entry, sizeof(*entry));
+}
+
+ISC_REFCOUNT_IMPL(ns_xfrentry, xfrentry_destroy);
@@ -44,6 +44,7 @@
 #include <ns/log.h>
 #include <ns/server.h>
 #include <ns/stats.h>
+#include <ns/xfrcache.h>
 #include <ns/xfrout.h>
 
 /*! \file
@@ -669,6 +670,11 @@ typedef struct {
 	uint32_t end_serial;	/* Serial number after XFR is done */
 	struct xfr_stats stats; /*%< Transfer statistics */
 
+	/* Transfer cache */
+	ns_xfrentry_t *cached;	/* Cached messages being replayed */
+	unsigned int cachedmsg; /* Next cached message to send */
+	ns_xfrentry_t *record;	/* Entry recording this transfer */
+
 	/* Timeouts */
 	uint64_t maxtime; /*%< Maximum XFR timeout (in ms) */
 	isc_nm_timer_t *maxtime_timer;
@@ -692,6 +698,9 @@ xfrout_ctx_create(isc_mem_t *mctx, ns_client_t *client, unsigned int id,
 static void
 sendstream(xfrout_ctx_t *xfr);
 
+static void
+sendcached(xfrout_ctx_t *xfr);
+
 static void
 xfrout_senddone(isc_nmhandle_t *handle, isc_result_t result, void *arg);
 
@@ -720,6 +729,54 @@ xfrout_delayed_timeout(void *arg, isc_result_t result);
 
 /**************************************************************************/
 
+/*
+ * Look for a cached transfer for 'key'.  The longest cached message
+ * must still fit next to the OPT and TSIG records rendered for this
+ * client, which may take up more room than they did for the client
+ * the transfer was recorded for.
+ */
+static bool
+findcached(ns_client_t *client, const ns_xfrkey_t *key,
+	   ns_xfrentry_t **cachedp) {
+	ns_xfrcache_t *xfrcache = client->manager->sctx->xfrcache;
+	dns_message_t *msg = NULL;
+	dns_tsigkey_t *tsigkey = NULL;
+	dns_rdataset_t *opt = NULL;
+	unsigned int length;
+	bool fits = false;
+
+	if (ns_xfrcache_find(xfrcache, key, cachedp) != ISC_R_SUCCESS) {
+		return (false);
+	}
+
+	dns_message_create(client->manager->mctx, NULL, NULL,
+			   DNS_MESSAGE_INTENTRENDER, &msg);
+	tsigkey = dns_message_gettsigkey(client->message);
+	if (dns_message_settsigkey(msg, tsigkey) != ISC_R_SUCCESS) {
+		goto done;
+	}
+	if ((client->attributes & NS_CLIENTATTR_WANTOPT) != 0 &&
+	    (ns_client_addopt(client, msg, &opt) != ISC_R_SUCCESS ||
+	     dns_message_setopt(msg, opt) != ISC_R_SUCCESS))
+	{
+		goto done;
+	}
+
+	length = DNS_MESSAGE_HEADERLEN + ns_xfrentry_maxlength(*cachedp);
+	fits = (length + msg->reserved <= NS_CLIENT_TCP_BUFFER_SIZE);
+
+done:
+	dns_message_detach(&msg);
+	if (!fits) {
+		ns_client_log(client, DNS_LOGCATEGORY_XFER_OUT,
+			      NS_LOGMODULE_XFER_OUT, ISC_LOG_DEBUG(1),
+			      "cached transfer does not fit, "
+			      "rendering it again");
+		ns_xfrentry_detach(cachedp);
+	}
+	return (fits);
+}
+
 void
 ns_xfr_start(ns_client_t *client, dns_rdatatype_t reqtype) {
 	isc_result_t result;
@@ -753,6 +810,8 @@ ns_xfr_start(ns_client_t *client, dns_rdatatype_t reqtype) {
 	bool is_ixfr = false;
 	bool useviewacl = false;
 	uint32_t begin_serial = 0, current_serial;
+	ns_xfrkey_t key;
+	ns_xfrentry_t *cached = NULL;
 
 	switch (reqtype) {
 	case dns_rdatatype_axfr:
@@ -970,7 +1029,46 @@ got_soa:
 	CHECK(dns_db_createsoatuple(db, ver, mctx, DNS_DIFFOP_EXISTS,
 				    &current_soa_tuple));
 
+	/*
+	 * The EXPIRE option has to be known before a cached transfer is
+	 * looked for, as it takes up room in the first message.
+	 */
+	if (zone != NULL) {
+		dns_zone_getraw(zone, &raw);
+		mayberaw = (raw != NULL) ? raw : zone;
+		if ((client->attributes & NS_CLIENTATTR_WANTEXPIRE) != 0 &&
+		    (dns_zone_gettype(mayberaw) == dns_zone_secondary ||
+		     dns_zone_gettype(mayberaw) == dns_zone_mirror))
+		{
+			isc_time_t expiretime;
+			uint32_t secs;
+			dns_zone_getexpiretime(zone, &expiretime);
+			secs = isc_time_seconds(&expiretime);
+			if (secs >= client->now && result == ISC_R_SUCCESS) {
+				client->attributes |= NS_CLIENTATTR_HAVEEXPIRE;
+				client->expire = secs - client->now;
+			}
+		}
+		if (raw != NULL) {
+			dns_zone_detach(&raw);
+		}
+	}
+
 	current_serial = dns_soa_getserial(&current_soa_tuple->rdata);
+	key = (ns_xfrkey_t){
+		.zone = zone,
+		.db = db,
+		.qname = question_name,
+		.rdclass = question_class,
+		.qtype = reqtype,
+		.end_serial = current_serial,
+		.many_answers = (format == dns_many_answers),
+		.msgsize = client->manager->sctx->transfer_tcp_message_size,
+	};
+	if (!is_dlz) {
+		RUNTIME_CHECK(dns_zone_getloadtime(zone, &key.loadtime) ==
+			      ISC_R_SUCCESS);
+	}
 	if (reqtype == dns_rdatatype_ixfr) {
 		size_t jsize;
 		uint64_t dbsize;
@@ -1022,6 +1120,18 @@ got_soa:
 			}
 		}
 
+		/*
+		 * A cached copy of this delta was made when the journal
+		 * had it and it passed the size check, so the journal
+		 * does not need to be looked at again.
+		 */
+		key.incremental = true;
+		key.begin_serial = begin_serial;
+		if (!is_dlz && findcached(client, &key, &cached)) {
+			is_ixfr = true;
+			goto have_stream;
+		}
+
 		journalfile = is_dlz ? NULL : dns_zone_getjournal(zone);
 		if (journalfile != NULL) {
 			result = ixfr_rrstream_create(
@@ -1068,6 +1178,11 @@ got_soa:
 		is_ixfr = true;
 	} else {
 	axfr_fallback:
+		key.incremental = false;
+		key.begin_serial = 0;
+		if (!is_dlz && findcached(client, &key, &cached)) {
+			goto have_stream;
+		}
 		CHECK(axfr_rrstream_create(mctx, db, ver, &data_stream));
 	}
 
@@ -1108,7 +1223,21 @@ have_stream:
 	xfr->mnemonic = mnemonic;
 	stream = NULL;
 
-	CHECK(xfr->stream->methods->first(xfr->stream));
+	/*
+	 * Replay a cached copy of the transfer if there is one, or else
+	 * try to record this one for the next requester.  Polls and DLZ
+	 * transfers are never cached.
+	 */
+	if (cached != NULL) {
+		xfr->cached = cached;
+		cached = NULL;
+	} else {
+		if (!is_poll && !is_dlz) {
+			(void)ns_xfrcache_begin(client->manager->sctx->xfrcache,
+						&key, &xfr->record);
+		}
+		CHECK(xfr->stream->methods->first(xfr->stream));
+	}
 
 	if (xfr->tsigkey != NULL) {
 		dns_name_format(xfr->tsigkey->name, keyname, sizeof(keyname));
@@ -1132,26 +1261,9 @@ have_stream:
 			    (xfr->tsigkey != NULL) ? ": TSIG " : "", keyname,
 			    current_serial);
 	}
-
-	if (zone != NULL) {
-		dns_zone_getraw(zone, &raw);
-		mayberaw = (raw != NULL) ? raw : zone;
-		if ((client->attributes & NS_CLIENTATTR_WANTEXPIRE) != 0 &&
-		    (dns_zone_gettype(mayberaw) == dns_zone_secondary ||
-		     dns_zone_gettype(mayberaw) == dns_zone_mirror))
-		{
-			isc_time_t expiretime;
-			uint32_t secs;
-			dns_zone_getexpiretime(zone, &expiretime);
-			secs = isc_time_seconds(&expiretime);
-			if (secs >= client->now && result == ISC_R_SUCCESS) {
-				client->attributes |= NS_CLIENTATTR_HAVEEXPIRE;
-				client->expire = secs - client->now;
-			}
-		}
-		if (raw != NULL) {
-			dns_zone_detach(&raw);
-		}
+	if (xfr->cached != NULL) {
+		xfrout_log(xfr, ISC_LOG_DEBUG(1), "sending %u cached messages",
+			   ns_xfrentry_count(xfr->cached));
 	}
 
 	/* Start the timers */
@@ -1179,6 +1291,9 @@ failure:
 	if (current_soa_tuple != NULL) {
 		dns_difftuple_free(&current_soa_tuple);
 	}
+	if (cached != NULL) {
+		ns_xfrentry_detach(&cached);
+	}
 	if (stream != NULL) {
 		stream->methods->destroy(&stream);
 	}
@@ -1358,6 +1473,146 @@ xfrout_enqueue_send(xfrout_ctx_t *xfr) {
 	isc_nm_timer_start(xfr->delayed_send_timer, timeout);
 }
 
+/*
+ * Create the next TCP message of the transfer, with everything but the
+ * question and answer sections.
+ */
+static isc_result_t
+createmsg(xfrout_ctx_t *xfr, dns_message_t **msgp) {
+	dns_message_t *msg = NULL;
+	isc_result_t result;
+
+	dns_message_create(xfr->mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
+			   &msg);
+
+	msg->id = xfr->id;
+	msg->rcode = dns_rcode_noerror;
+	msg->flags = DNS_MESSAGEFLAG_QR | DNS_MESSAGEFLAG_AA;
+	if ((xfr->client->attributes & NS_CLIENTATTR_RA) != 0) {
+		msg->flags |= DNS_MESSAGEFLAG_RA;
+	}
+	CHECK(dns_message_settsigkey(msg, xfr->tsigkey));
+	dns_message_setquerytsig(msg, xfr->lasttsig);
+	if (xfr->lasttsig != NULL) {
+		isc_buffer_free(&xfr->lasttsig);
+	}
+	msg->verified_sig = xfr->verified_tsig;
+
+	/*
+	 * Add a EDNS option to the message?
+	 */
+	if ((xfr->client->attributes & NS_CLIENTATTR_WANTOPT) != 0) {
+		dns_rdataset_t *opt = NULL;
+
+		CHECK(ns_client_addopt(xfr->client, msg, &opt));
+		CHECK(dns_message_setopt(msg, opt));
+		/*
+		 * Add to first message only.
+		 */
+		xfr->client->attributes &= ~NS_CLIENTATTR_WANTNSID;
+		xfr->client->attributes &= ~NS_CLIENTATTR_HAVEEXPIRE;
+	}
+
+	*msgp = msg;
+	return (ISC_R_SUCCESS);
+
+failure:
+	dns_message_detach(&msg);
+	return (result);
+}
+
+/*
+ * Save the question and answer sections that were just rendered into
+ * xfr->txbuf; 'qend' is where the answer section starts.
+ */
+static void
+recordmsg(xfrout_ctx_t *xfr, dns_message_t *msg, unsigned int qend) {
+	unsigned char *base = isc_buffer_base(&xfr->txbuf);
+	isc_region_t question = {
+		.base = base + DNS_MESSAGE_HEADERLEN,
+		.length = qend - DNS_MESSAGE_HEADERLEN,
+	};
+	isc_region_t answer = {
+		.base = base + qend,
+		.length = isc_buffer_usedlength(&xfr->txbuf) - qend,
+	};
+	isc_result_t result;
+
+	result = ns_xfrentry_addmsg(xfr->record, &question,
+				    msg->counts[DNS_SECTION_QUESTION], &answer,
+				    msg->counts[DNS_SECTION_ANSWER]);
+	if (result != ISC_R_SUCCESS) {
+		xfrout_log(xfr, ISC_LOG_DEBUG(1),
+			   "transfer is too large to be cached");
+		ns_xfrentry_detach(&xfr->record);
+	}
+}
+
+/*
+ * Send the next message of a cached transfer.  Only the header, OPT
+ * and TSIG records are rendered; the rest is copied from the cache.
+ */
+static void
+sendcached(xfrout_ctx_t *xfr) {
+	dns_message_t *msg = NULL;
+	isc_result_t result;
+	dns_compress_t cctx;
+	bool cleanup_cctx = false;
+	isc_region_t question, answer;
+	unsigned int qdcount, ancount;
+
+	isc_buffer_clear(&xfr->txbuf);
+
+	result = ns_xfrentry_getmsg(xfr->cached, xfr->cachedmsg, &question,
+				    &qdcount, &answer, &ancount);
+	INSIST(result == ISC_R_SUCCESS);
+
+	CHECK(createmsg(xfr, &msg));
+	if (xfr->cachedmsg > 0) {
+		msg->tcp_continuation = 1;
+	}
+
+	dns_compress_init(&cctx, xfr->mctx,
+			  DNS_COMPRESS_CASE | DNS_COMPRESS_LARGE);
+	cleanup_cctx = true;
+	CHECK(dns_message_renderbegin(msg, &cctx, &xfr->txbuf));
+	CHECK(dns_message_renderraw(msg, DNS_SECTION_QUESTION, &question,
+				    qdcount));
+	CHECK(dns_message_renderraw(msg, DNS_SECTION_ANSWER, &answer,
+				    ancount));
+	CHECK(dns_message_renderend(msg));
+	dns_compress_invalidate(&cctx);
+	cleanup_cctx = false;
+
+	xfr->stats.nrecs += ancount;
+	if (++xfr->cachedmsg == ns_xfrentry_count(xfr->cached)) {
+		xfr->end_of_stream = true;
+	}
+
+	xfrout_log(xfr, ISC_LOG_DEBUG(8),
+		   "sending cached TCP message of %d bytes",
+		   isc_buffer_usedlength(&xfr->txbuf));
+
+	xfrout_enqueue_send(xfr);
+
+	/* Advance lasttsig to be the last TSIG generated */
+	CHECK(dns_message_getquerytsig(msg, xfr->mctx, &xfr->lasttsig));
+
+failure:
+	if (msg != NULL) {
+		dns_message_detach(&msg);
+	}
+	if (cleanup_cctx) {
+		dns_compress_invalidate(&cctx);
+	}
+
+	if (result == ISC_R_SUCCESS) {
+		return;
+	}
+
+	xfrout_fail(xfr, result, "sending cached zone data");
+}
+
 /*
  * Arrange to send as much as we can of "stream" without blocking.
  *
@@ -1380,6 +1635,12 @@ sendstream(xfrout_ctx_t *xfr) {
 	bool cleanup_cctx = false;
 	bool is_tcp;
 	int n_rrs;
+	unsigned int qend;
+
+	if (xfr->cached != NULL) {
+		sendcached(xfr);
+		return;
+	}
 
 	isc_buffer_clear(&xfr->buf);
 	isc_buffer_clear(&xfr->txbuf);
@@ -1401,38 +1662,9 @@ sendstream(xfrout_ctx_t *xfr) {
 		 * message.
 		 */
 
-		dns_message_create(xfr->mctx, NULL, NULL,
-				   DNS_MESSAGE_INTENTRENDER, &tcpmsg);
+		CHECK(createmsg(xfr, &tcpmsg));
 		msg = tcpmsg;
 
-		msg->id = xfr->id;
-		msg->rcode = dns_rcode_noerror;
-		msg->flags = DNS_MESSAGEFLAG_QR | DNS_MESSAGEFLAG_AA;
-		if ((xfr->client->attributes & NS_CLIENTATTR_RA) != 0) {
-			msg->flags |= DNS_MESSAGEFLAG_RA;
-		}
-		CHECK(dns_message_settsigkey(msg, xfr->tsigkey));
-		dns_message_setquerytsig(msg, xfr->lasttsig);
-		if (xfr->lasttsig != NULL) {
-			isc_buffer_free(&xfr->lasttsig);
-		}
-		msg->verified_sig = xfr->verified_tsig;
-
-		/*
-		 * Add a EDNS option to the message?
-		 */
-		if ((xfr->client->attributes & NS_CLIENTATTR_WANTOPT) != 0) {
-			dns_rdataset_t *opt = NULL;
-
-			CHECK(ns_client_addopt(xfr->client, msg, &opt));
-			CHECK(dns_message_setopt(msg, opt));
-			/*
-			 * Add to first message only.
-			 */
-			xfr->client->attributes &= ~NS_CLIENTATTR_WANTNSID;
-			xfr->client->attributes &= ~NS_CLIENTATTR_HAVEEXPIRE;
-		}
-
 		/*
 		 * Account for reserved space.
 		 */
@@ -1601,7 +1833,11 @@ sendstream(xfrout_ctx_t *xfr) {
 		cleanup_cctx = true;
 		CHECK(dns_message_renderbegin(msg, &cctx, &xfr->txbuf));
 		CHECK(dns_message_rendersection(msg, DNS_SECTION_QUESTION, 0));
+		qend = isc_buffer_usedlength(&xfr->txbuf);
 		CHECK(dns_message_rendersection(msg, DNS_SECTION_ANSWER, 0));
+		if (xfr->record != NULL) {
+			recordmsg(xfr, msg, qend);
+		}
 		CHECK(dns_message_renderend(msg));
 		dns_compress_invalidate(&cctx);
 		cleanup_cctx = false;
@@ -1667,6 +1903,12 @@ xfrout_ctx_destroy(xfrout_ctx_t **xfrp) {
 	if (xfr->lasttsig != NULL) {
 		isc_buffer_free(&xfr->lasttsig);
 	}
+	if (xfr->cached != NULL) {
+		ns_xfrentry_detach(&xfr->cached);
+	}
+	if (xfr->record != NULL) {
+		ns_xfrentry_detach(&xfr->record);
+	}
 
 	isc_quota_release(&xfr->client->manager->sctx->xfroutquota);
 
@@ -1733,6 +1975,13 @@ xfrout_senddone(isc_nmhandle_t *handle, isc_result_t result, void *arg) {
 			   (unsigned int)(msecs % 1000), (unsigned int)persec,
 			   xfr->end_serial);
 
+		if (xfr->record != NULL) {
+			ns_server_t *sctx = xfr->client->manager->sctx;
+
+			ns_xfrcache_publish(sctx->xfrcache, xfr->record);
+			ns_xfrentry_detach(&xfr->record);
+		}
+
 		/*
 		 * We're done, unreference the handle and destroy the xfr
 		 * context.
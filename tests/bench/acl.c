@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/mem.h>
+#include <isc/netaddr.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/acl.h>
+#include <dns/iptable.h>
+
+/*
+ * Measure dns_acl_match() on ACLs of increasing size, such as those
+ * built from threat feeds, before and after the IP table is compiled.
+ * Most prefixes are IPv4 /16 to /32; one in eight is an IPv6 /32 to
+ * /64.  Half of the lookups hit an address that is in the ACL.
+ */
+#define LOOKUPS (1000 * 1000)
+
+static isc_netaddr_t *prefixes = NULL;
+static uint16_t *bitlens = NULL;
+static isc_netaddr_t *addrs = NULL;
+
+static void
+random_prefix(isc_netaddr_t *na, uint16_t *bitlen) {
+	if (isc_random_uniform(8) == 0) {
+		struct in6_addr in6;
+
+		isc_random_buf(&in6, sizeof(in6));
+		isc_netaddr_fromin6(na, &in6);
+		*bitlen = 32 + isc_random_uniform(33);
+	} else {
+		struct in_addr in;
+
+		isc_random_buf(&in, sizeof(in));
+		isc_netaddr_fromin(na, &in);
+		*bitlen = 16 + isc_random_uniform(17);
+	}
+}
+
+static uint64_t
+lookups(dns_acl_t *acl, unsigned int *matched) {
+	isc_time_t start = isc_time_now_hires();
+	isc_time_t finish;
+
+	*matched = 0;
+	for (size_t i = 0; i < LOOKUPS; i++) {
+		int match = 0;
+
+		dns_acl_match(&addrs[i], NULL, acl, NULL, &match, NULL);
+		if (match > 0) {
+			(*matched)++;
+		}
+	}
+
+	finish = isc_time_now_hires();
+	return (isc_time_microdiff(&finish, &start));
+}
+
+int
+main(void) {
+	isc_mem_t *mctx = NULL;
+	size_t max = 1000 * 1000;
+
+	isc_mem_create(&mctx);
+
+	prefixes = isc_mem_cget(mctx, max, sizeof(prefixes[0]));
+	bitlens = isc_mem_cget(mctx, max, sizeof(bitlens[0]));
+	addrs = isc_mem_cget(mctx, LOOKUPS, sizeof(addrs[0]));
+
+	for (size_t i = 0; i < max; i++) {
+		random_prefix(&prefixes[i], &bitlens[i]);
+	}
+
+	for (size_t size = 10; size <= max; size *= 10) {
+		dns_acl_t *acl = NULL;
+		unsigned int tree_matched, trie_matched;
+		uint64_t tree_us, trie_us, compile_us;
+		isc_time_t start, finish;
+
+		dns_acl_create(mctx, 0, &acl);
+		for (size_t i = 0; i < size; i++) {
+			isc_result_t result;
+
+			result = dns_iptable_addprefix(acl->iptable,
+						       &prefixes[i],
+						       bitlens[i], true);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+		}
+
+		/* Every other lookup is for an address in a listed prefix */
+		for (size_t i = 0; i < LOOKUPS; i++) {
+			if (i % 2 == 0) {
+				addrs[i] = prefixes[isc_random_uniform(size)];
+			} else {
+				uint16_t bitlen;
+				random_prefix(&addrs[i], &bitlen);
+			}
+		}
+
+		tree_us = lookups(acl, &tree_matched);
+
+		start = isc_time_now_hires();
+		dns_iptable_compile(acl->iptable);
+		finish = isc_time_now_hires();
+		compile_us = isc_time_microdiff(&finish, &start);
+
+		trie_us = lookups(acl, &trie_matched);
+		INSIST(tree_matched == trie_matched);
+
+		printf("%7zu prefixes: tree %6.1f ns/lookup, "
+		       "compiled %6.1f ns/lookup (%.1fx), compile %.3f ms, "
+		       "%u matched\n",
+		       size, tree_us * 1000.0 / LOOKUPS,
+		       trie_us * 1000.0 / LOOKUPS,
+		       (double)tree_us / ISC_MAX(trie_us, 1),
+		       compile_us / 1000.0, trie_matched);
+
+		dns_acl_detach(&acl);
+	}
+
+	isc_mem_cput(mctx, addrs, LOOKUPS, sizeof(addrs[0]));
+	isc_mem_cput(mctx, bitlens, max, sizeof(bitlens[0]));
+	isc_mem_cput(mctx, prefixes, max, sizeof(prefixes[0]));
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
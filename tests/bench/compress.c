@@ -10,15 +10,19 @@
  * See the COPYRIGHT file distributed with this work for additional
  * information regarding copyright ownership.
  */
+#include <ctype.h>
 #include <err.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <isc/buffer.h>
+#include <isc/commandline.h>
 #include <isc/mem.h>
+#include <isc/random.h>
 #include <isc/result.h>
 #include <isc/time.h>
 #include <isc/util.h>
@@ -27,6 +31,8 @@
 #include <dns/fixedname.h>
 #include <dns/name.h>
 
+#include "compress_p.h"
+
 static void
 CHECKRESULT(isc_result_t result, const char *msg) {
 	if (result != ISC_R_SUCCESS) {
@@ -35,16 +41,237 @@ CHECKRESULT(isc_result_t result, const char *msg) {
 	}
 }
 
+/*
+ * Synthetic message shapes for the -m mode. Each shape is a list of the
+ * names in one message, in the order they are rendered.
+ */
+#define MAXNAMES 65536
+
+static dns_fixedname_t fixedname[MAXNAMES];
+static unsigned int count = 0;
+
+static void
+addname(const char *text) {
+	if (count == ARRAY_SIZE(fixedname)) {
+		errx(1, "too many names");
+	}
+	dns_name_t *name = dns_fixedname_initname(&fixedname[count++]);
+	isc_result_t result = dns_name_fromstring(name, text, dns_rootname, 0,
+						  NULL);
+	CHECKRESULT(result, text);
+}
+
+static void
+randlabel(char *buf, size_t len, const char *alphabet) {
+	size_t n = strlen(alphabet);
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = alphabet[isc_random_uniform(n)];
+	}
+	buf[len] = '\0';
+}
+
+/*
+ * Randomize the case of a name, as resolvers using 0x20 do.
+ */
+static void
+mixcase(char *text) {
+	for (char *p = text; *p != '\0'; p++) {
+		if (isc_random_uniform(2) == 0) {
+			*p = toupper((unsigned char)*p);
+		}
+	}
+}
+
+/* a TLD referral with 13 nameservers and A + AAAA glue */
+static void
+shape_referral(bool randcase) {
+	char text[DNS_NAME_FORMATSIZE];
+
+	snprintf(text, sizeof(text), "www.example.com");
+	if (randcase) {
+		mixcase(text);
+	}
+	addname(text);
+	for (char c = 'a'; c <= 'm'; c++) {
+		addname("com");
+		snprintf(text, sizeof(text), "%c.gtld-servers.net", c);
+		addname(text);
+	}
+	for (int family = 0; family < 2; family++) {
+		for (char c = 'a'; c <= 'm'; c++) {
+			snprintf(text, sizeof(text), "%c.gtld-servers.net", c);
+			addname(text);
+		}
+	}
+}
+
+static void
+shape_referral_0x20(void) {
+	shape_referral(true);
+}
+
+static void
+shape_referral_plain(void) {
+	shape_referral(false);
+}
+
+/* a zone transfer of hosts with CNAMEs to a CDN */
+static void
+shape_axfr(void) {
+	char text[DNS_NAME_FORMATSIZE];
+
+	for (unsigned int i = 0; count + 2 <= 2000; i++) {
+		snprintf(text, sizeof(text), "host%04u.dept%u.example.com", i,
+			 i % 16);
+		addname(text);
+		snprintf(text, sizeof(text), "edge%u.cdn.example.net", i % 64);
+		addname(text);
+	}
+}
+
+/* a zone transfer of an NSEC3 chain */
+static void
+shape_nsec3(void) {
+	char label[33], text[DNS_NAME_FORMATSIZE];
+
+	for (unsigned int i = 0; i < 1000; i++) {
+		randlabel(label, 32, "0123456789abcdefghijklmnopqrstuv");
+		snprintf(text, sizeof(text), "%s.example.com", label);
+		addname(text);
+	}
+}
+
+/* TXT-heavy names with long labels, such as DKIM and ACME records */
+static void
+shape_longlabels(void) {
+	char label1[64], label2[64], text[DNS_NAME_FORMATSIZE];
+
+	for (unsigned int i = 0; i < 200; i++) {
+		randlabel(label1, 63, "abcdefghijklmnopqrstuvwxyz0123456789");
+		randlabel(label2, 40, "abcdefghijklmnopqrstuvwxyz0123456789");
+		snprintf(text, sizeof(text), "%s.%s._domainkey.example.org",
+			 label1, label2);
+		addname(text);
+	}
+}
+
+static struct {
+	const char *name;
+	void (*fill)(void);
+	dns_compress_flags_t flags;
+} shapes[] = {
+	{ "referral", shape_referral_plain, 0 },
+	{ "referral-0x20", shape_referral_0x20, 0 },
+	{ "axfr", shape_axfr, DNS_COMPRESS_LARGE },
+	{ "axfr-nsec3", shape_nsec3, DNS_COMPRESS_LARGE },
+	{ "long-labels", shape_longlabels, DNS_COMPRESS_LARGE },
+};
+
+/*
+ * Render all the names into messages of up to 64 KiB, starting a new
+ * message when one fills up.
+ */
+static void
+render(isc_mem_t *mctx, dns_compress_flags_t flags) {
+	static uint8_t wire[65535];
+	dns_compress_t cctx;
+	isc_buffer_t buf;
+	isc_result_t result;
+
+	isc_buffer_init(&buf, wire, sizeof(wire));
+	dns_compress_init(&cctx, mctx, flags);
+
+	for (unsigned int i = 0; i < count; i++) {
+		dns_name_t *name = dns_fixedname_name(&fixedname[i]);
+		result = dns_name_towire(name, &cctx, &buf, NULL);
+		if (result == ISC_R_NOSPACE) {
+			dns_compress_invalidate(&cctx);
+			dns_compress_init(&cctx, mctx, flags);
+			isc_buffer_init(&buf, wire, sizeof(wire));
+		} else {
+			CHECKRESULT(result, "dns_name_towire");
+		}
+	}
+	dns_compress_invalidate(&cctx);
+}
+
+static void
+messages(isc_mem_t *mctx) {
+	printf("%-16s", "shape");
+	for (dns__compress_impl_t impl = 0; impl < DNS__COMPRESS_IMPLS; impl++)
+	{
+		if (dns__compress_setimpl(impl)) {
+			printf("%12s", dns__compress_impltext(impl));
+		}
+	}
+	printf("%12s\n", "names");
+
+	for (size_t s = 0; s < ARRAY_SIZE(shapes); s++) {
+		count = 0;
+		shapes[s].fill();
+
+		/* about a million names per implementation */
+		unsigned int repeat = 1000000 / count + 1;
+
+		printf("%-16s", shapes[s].name);
+		for (dns__compress_impl_t impl = 0; impl < DNS__COMPRESS_IMPLS;
+		     impl++)
+		{
+			if (!dns__compress_setimpl(impl)) {
+				continue;
+			}
+
+			render(mctx, shapes[s].flags); /* warm up */
+
+			isc_nanosecs_t start = isc_time_monotonic();
+			for (unsigned int n = 0; n < repeat; n++) {
+				render(mctx, shapes[s].flags);
+			}
+			isc_nanosecs_t finish = isc_time_monotonic();
+
+			printf("%9.1f ns",
+			       (double)(finish - start) / repeat / count);
+		}
+		printf("%12u\n", count);
+	}
+}
+
+static void
+usage(void) {
+	fprintf(stderr,
+		"usage: compress [-m] < names\n"
+		"	-m	report ns/name for synthetic messages with\n"
+		"		each available implementation, instead of\n"
+		"		reading names from stdin\n");
+}
+
 int
-main(void) {
+main(int argc, char *argv[]) {
 	isc_result_t result;
 	isc_buffer_t buf;
+	bool shapemode = false;
+	int opt;
+
+	while ((opt = isc_commandline_parse(argc, argv, "m")) != -1) {
+		switch (opt) {
+		case 'm':
+			shapemode = true;
+			continue;
+		default:
+			usage();
+			exit(EXIT_FAILURE);
+			continue;
+		}
+	}
 
 	isc_mem_t *mctx = NULL;
 	isc_mem_create(&mctx);
 
-	static dns_fixedname_t fixedname[65536];
-	unsigned int count = 0;
+	if (shapemode) {
+		messages(mctx);
+		isc_mem_destroy(&mctx);
+		return (0);
+	}
 
 	char *line = NULL;
 	size_t linecap = 0;
@@ -97,6 +324,12 @@ main(void) {
 	printf("time %f / %u\n", (double)microseconds / 1000000.0, repeat);
 
 	printf("names %u\n", count);
+	if (count > 0) {
+		printf("%.1f ns/name\n",
+		       (double)microseconds * 1000.0 / repeat / count);
+	}
+	printf("implementation %s\n",
+	       dns__compress_impltext(dns__compress_getimpl()));
 
 	isc_mem_destroy(&mctx);
 
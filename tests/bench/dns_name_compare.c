@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <ctype.h>
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/ascii.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+
+#include "ascii_p.h"
+
+/*
+ * Compare pairs of names that are equal apart from case (the common case
+ * for cache and zone lookups, which have to look at every byte), and
+ * pairs that differ only in their first byte, which is the last byte
+ * that dns_name_fullcompare() looks at.
+ */
+#define PAIRS  1024
+#define REPEAT 1000
+
+static dns_fixedname_t fixed1[PAIRS], fixed2[PAIRS];
+
+static void
+randlabel(char *buf, size_t len) {
+	static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = alphabet[isc_random_uniform(sizeof(alphabet) - 1)];
+	}
+	buf[len] = '\0';
+}
+
+static void
+makename(dns_fixedname_t *fixed, const char *text) {
+	dns_name_t *name = dns_fixedname_initname(fixed);
+	isc_result_t result = dns_name_fromstring(name, text, dns_rootname, 0,
+						  NULL);
+	if (result != ISC_R_SUCCESS) {
+		errx(1, "%s: %s", text, isc_result_totext(result));
+	}
+}
+
+/*
+ * Fill the pairs with names made of `labels` random labels of `len`
+ * bytes each under `suffix`.
+ */
+static void
+makepairs(unsigned int labels, unsigned int len, const char *suffix,
+	  bool differ) {
+	char label[64], text[DNS_NAME_FORMATSIZE];
+
+	for (unsigned int i = 0; i < PAIRS; i++) {
+		size_t n = 0;
+
+		for (unsigned int l = 0; l < labels; l++) {
+			randlabel(label, len);
+			n += snprintf(text + n, sizeof(text) - n, "%s.", label);
+		}
+		snprintf(text + n, sizeof(text) - n, "%s", suffix);
+		makename(&fixed1[i], text);
+
+		if (differ) {
+			text[0] = (text[0] == 'a') ? 'b' : 'a';
+		} else {
+			for (char *p = text; *p != '\0'; p++) {
+				if (isc_random_uniform(2) == 0) {
+					*p = toupper((unsigned char)*p);
+				}
+			}
+		}
+		makename(&fixed2[i], text);
+	}
+}
+
+static volatile int sink;
+
+static int
+equal(const dns_name_t *name1, const dns_name_t *name2) {
+	return (dns_name_equal(name1, name2));
+}
+
+static double
+bench(int (*cmp)(const dns_name_t *, const dns_name_t *)) {
+	isc_nanosecs_t start = isc_time_monotonic();
+	for (unsigned int r = 0; r < REPEAT; r++) {
+		for (unsigned int i = 0; i < PAIRS; i++) {
+			sink += cmp(dns_fixedname_name(&fixed1[i]),
+				    dns_fixedname_name(&fixed2[i]));
+		}
+	}
+	return ((double)(isc_time_monotonic() - start) / REPEAT / PAIRS);
+}
+
+static struct {
+	const char *name;
+	int (*cmp)(const dns_name_t *, const dns_name_t *);
+} funcs[] = {
+	{ "equal", equal },
+	{ "compare", dns_name_compare },
+	{ "rdatacompare", dns_name_rdatacompare },
+};
+
+static struct {
+	const char *name;
+	unsigned int labels, len;
+	const char *suffix;
+} shapes[] = {
+	{ "short", 1, 3, "example.com" },
+	{ "typical", 2, 6, "example.co.uk" },
+	{ "nsec3", 1, 32, "example.com" },
+	{ "long", 3, 60, "example.org" },
+};
+
+int
+main(void) {
+	printf("%-24s", "ns/op");
+	for (isc__ascii_impl_t impl = 0; impl < ISC__ASCII_IMPLS; impl++) {
+		if (isc__ascii_setimpl(impl)) {
+			printf("%10s", isc__ascii_impltext(impl));
+		}
+	}
+	printf("\n");
+
+	for (size_t s = 0; s < ARRAY_SIZE(shapes); s++) {
+		for (int differ = 0; differ < 2; differ++) {
+			makepairs(shapes[s].labels, shapes[s].len,
+				  shapes[s].suffix, differ);
+
+			for (size_t f = 0; f < ARRAY_SIZE(funcs); f++) {
+				char title[64];
+
+				snprintf(title, sizeof(title), "%s %s %s",
+					 shapes[s].name,
+					 differ ? "differ" : "same",
+					 funcs[f].name);
+				printf("%-24s", title);
+
+				for (isc__ascii_impl_t impl = 0;
+				     impl < ISC__ASCII_IMPLS; impl++)
+				{
+					if (!isc__ascii_setimpl(impl)) {
+						continue;
+					}
+					printf("%10.1f", bench(funcs[f].cmp));
+				}
+				printf("\n");
+			}
+		}
+	}
+
+	return (0);
+}
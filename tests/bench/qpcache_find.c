@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/os.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/stdtime.h>
+#include <isc/tid.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+
+/*
+ * Measure cache lookup throughput when every loop hammers the same small
+ * set of popular names, which is where contention on the node locks
+ * shows up on a busy resolver.  With -w, one loop keeps replacing the
+ * records with new data while the others are reading them.
+ */
+#define HOT_NAMES 16
+#define LOOKUPS	  (1000 * 1000)
+#define REFRESH	  1000 /* lookups between refreshes on the writer loop */
+
+static isc_loopmgr_t *loopmgr = NULL;
+static dns_db_t *db = NULL;
+static dns_fixedname_t fixed[HOT_NAMES];
+static uint32_t nloops;
+static bool writer = false;
+
+static atomic_uint_fast32_t running;
+static atomic_uint_fast64_t elapsed;
+
+static void
+addname(unsigned int i, unsigned int octet, isc_stdtime_t now) {
+	isc_result_t result;
+	dns_dbnode_t *node = NULL;
+	unsigned char data[4] = { 192, 0, 2, (unsigned char)octet };
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+
+	result = dns_db_findnode(db, dns_fixedname_name(&fixed[i]), true,
+				 &node);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	rdata.data = data;
+	rdata.length = sizeof(data);
+	rdata.rdclass = dns_rdataclass_in;
+	rdata.type = dns_rdatatype_a;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.ttl = 3600;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset,
+				    DNS_DBADD_FORCE, NULL);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS || result == DNS_R_UNCHANGED);
+
+	dns_db_detachnode(db, &node);
+}
+
+static void
+finish(void *arg ISC_ATTR_UNUSED) {
+	uint64_t usecs = atomic_load(&elapsed) / nloops;
+
+	printf("%u loops%s: %0.2f lookups/us per loop, %0.2f total\n", nloops,
+	       writer ? " with writer" : "", (double)LOOKUPS / usecs,
+	       (double)LOOKUPS * nloops / usecs);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+lookups(void *arg ISC_ATTR_UNUSED) {
+	isc_stdtime_t now = isc_stdtime_now();
+	bool refresh = writer && isc_tid() == 0;
+	isc_time_t start = isc_time_now_hires();
+
+	for (unsigned int n = 0; n < LOOKUPS; n++) {
+		unsigned int i = isc_random_uniform(HOT_NAMES);
+		dns_fixedname_t ffound;
+		dns_name_t *found = dns_fixedname_initname(&ffound);
+		dns_dbnode_t *node = NULL;
+		dns_rdataset_t rdataset;
+		isc_result_t result;
+
+		if (refresh && n % REFRESH == 0) {
+			addname(i, n / REFRESH, now);
+		}
+
+		dns_rdataset_init(&rdataset);
+		result = dns_db_find(db, dns_fixedname_name(&fixed[i]), NULL,
+				     dns_rdatatype_a, 0, now, &node, found,
+				     &rdataset, NULL);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+		dns_rdataset_disassociate(&rdataset);
+		dns_db_detachnode(db, &node);
+	}
+
+	isc_time_t stop = isc_time_now_hires();
+	atomic_fetch_add(&elapsed, isc_time_microdiff(&stop, &start));
+
+	if (atomic_fetch_sub(&running, 1) == 1) {
+		isc_async_run(isc_loop_main(loopmgr), finish, NULL);
+	}
+}
+
+static void
+startup(void *arg ISC_ATTR_UNUSED) {
+	isc_mem_t *mctx = isc_loop_getmctx(isc_loop());
+	isc_stdtime_t now = isc_stdtime_now();
+	isc_result_t result;
+
+	result = dns_db_create(mctx, "qpcache", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &db);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	for (unsigned int i = 0; i < HOT_NAMES; i++) {
+		char text[DNS_NAME_FORMATSIZE];
+		dns_name_t *name = dns_fixedname_initname(&fixed[i]);
+
+		snprintf(text, sizeof(text), "www.example%u.com.", i);
+		result = dns_name_fromstring(name, text, dns_rootname, 0,
+					     NULL);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+		addname(i, 0, now);
+	}
+
+	atomic_init(&running, nloops);
+	atomic_init(&elapsed, 0);
+	for (uint32_t i = 0; i < nloops; i++) {
+		isc_async_run(isc_loop_get(loopmgr, i), lookups, NULL);
+	}
+}
+
+int
+main(int argc, char *argv[]) {
+	isc_mem_t *mctx = NULL;
+	const char *env_workers = getenv("ISC_TASK_WORKERS");
+
+	if (argc > 1 && strcmp(argv[1], "-w") == 0) {
+		writer = true;
+	}
+
+	if (env_workers != NULL) {
+		nloops = atoi(env_workers);
+	} else {
+		nloops = isc_os_ncpus();
+	}
+	INSIST(nloops > 0);
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_loop_setup(isc_loop_main(loopmgr), startup, NULL);
+	isc_loopmgr_run(loopmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
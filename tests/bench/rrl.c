@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netaddr.h>
+#include <isc/os.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/sockaddr.h>
+#include <isc/stdtime.h>
+#include <isc/tid.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rrl.h>
+#include <dns/view.h>
+
+/*
+ * Measure response rate limiting throughput when every loop is answering
+ * queries from a large pool of clients, as on an authoritative server
+ * under a reflection attack.  With -q, the limits are scaled by the
+ * estimated total query rate as well.  With -v, the queries all come
+ * from one victim's /24 and ask for many names instead, as when an
+ * attack reflects responses off many names towards a single target.
+ */
+#define CLIENTS	  (64 * 1024)
+#define QNAMES	  1024
+#define RESPONSES (1000 * 1000)
+
+static isc_loopmgr_t *loopmgr = NULL;
+static dns_view_t *view = NULL;
+static dns_fixedname_t fqnames[QNAMES];
+static isc_sockaddr_t clients[CLIENTS];
+static uint32_t nloops;
+static bool qps_scale = false;
+static bool victim = false;
+
+static atomic_uint_fast32_t running;
+static atomic_uint_fast64_t elapsed;
+static atomic_uint_fast64_t dropped;
+
+static void
+finish(void *arg ISC_ATTR_UNUSED) {
+	uint64_t usecs = atomic_load(&elapsed) / nloops;
+
+	printf("%u loops%s%s: %0.2f responses/us per loop, %0.2f total, "
+	       "%0.1f%% limited\n",
+	       nloops, qps_scale ? " with qps-scale" : "",
+	       victim ? " to one victim" : "",
+	       (double)RESPONSES / usecs, (double)RESPONSES * nloops / usecs,
+	       100.0 * atomic_load(&dropped) / ((double)RESPONSES * nloops));
+
+	dns_view_detach(&view);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+responses(void *arg ISC_ATTR_UNUSED) {
+	isc_stdtime_t now = isc_stdtime_now();
+	char log_buf[DNS_RRL_LOG_BUF_LEN];
+	uint64_t limited = 0;
+	isc_time_t start = isc_time_now_hires();
+
+	for (unsigned int n = 0; n < RESPONSES; n++) {
+		unsigned int i = isc_random_uniform(CLIENTS);
+		unsigned int q = victim ? isc_random_uniform(QNAMES) : 0;
+		const dns_name_t *qname = dns_fixedname_name(&fqnames[q]);
+		dns_rrl_result_t result;
+
+		result = dns_rrl(view, NULL, &clients[i], false,
+				 dns_rdataclass_in, dns_rdatatype_a, qname,
+				 ISC_R_SUCCESS, now, false, log_buf,
+				 sizeof(log_buf));
+		if (result != DNS_RRL_RESULT_OK) {
+			limited++;
+		}
+	}
+
+	isc_time_t stop = isc_time_now_hires();
+	atomic_fetch_add(&elapsed, isc_time_microdiff(&stop, &start));
+	atomic_fetch_add(&dropped, limited);
+
+	if (atomic_fetch_sub(&running, 1) == 1) {
+		isc_async_run(isc_loop_main(loopmgr), finish, NULL);
+	}
+}
+
+static void
+startup(void *arg ISC_ATTR_UNUSED) {
+	isc_mem_t *mctx = isc_loop_getmctx(isc_loop());
+	dns_rrl_t *rrl = NULL;
+	isc_result_t result;
+
+	for (unsigned int i = 0; i < QNAMES; i++) {
+		char name[sizeof("www0000.example.com.")];
+
+		snprintf(name, sizeof(name), "www%u.example.com.", i);
+		result = dns_name_fromstring(
+			dns_fixedname_initname(&fqnames[i]), name,
+			dns_rootname, 0, NULL);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+
+	/*
+	 * Clients come from a /15 so that they land in many /24 buckets,
+	 * or all from the same /24 when there is a single victim.
+	 */
+	for (unsigned int i = 0; i < CLIENTS; i++) {
+		uint32_t bits = victim ? 8 : 17;
+		struct in_addr in;
+
+		in.s_addr = htonl(0xc6120000 | isc_random_uniform(1 << bits));
+		isc_sockaddr_fromin(&clients[i], &in, 53);
+	}
+
+	result = dns_view_create(mctx, NULL, dns_rdataclass_in, "bench",
+				 &view);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = dns_rrl_init(&rrl, view, 500);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	rrl->max_entries = 100000;
+	rrl->window = 15;
+	rrl->qps_scale = qps_scale ? 250 : 0;
+	rrl->responses_per_second.r = 5;
+	atomic_init(&rrl->responses_per_second.scaled, 5);
+	rrl->slip.r = 2;
+	atomic_init(&rrl->slip.scaled, 2);
+	rrl->ipv4_prefixlen = 24;
+	rrl->ipv4_mask = htonl(0xffffff00);
+	rrl->ipv6_prefixlen = 56;
+	rrl->ipv6_mask[0] = 0xffffffff;
+	rrl->ipv6_mask[1] = htonl(0xffffff00);
+
+	atomic_init(&running, nloops);
+	atomic_init(&elapsed, 0);
+	atomic_init(&dropped, 0);
+	for (uint32_t i = 0; i < nloops; i++) {
+		isc_async_run(isc_loop_get(loopmgr, i), responses, NULL);
+	}
+}
+
+int
+main(int argc, char *argv[]) {
+	isc_mem_t *mctx = NULL;
+	const char *env_workers = getenv("ISC_TASK_WORKERS");
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-q") == 0) {
+			qps_scale = true;
+		} else if (strcmp(argv[i], "-v") == 0) {
+			victim = true;
+		} else {
+			fprintf(stderr, "usage: %s [-q] [-v]\n", argv[0]);
+			return (1);
+		}
+	}
+
+	if (env_workers != NULL) {
+		nloops = atoi(env_workers);
+	} else {
+		nloops = isc_os_ncpus();
+	}
+	INSIST(nloops > 0);
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_loop_setup(isc_loop_main(loopmgr), startup, NULL);
+	isc_loopmgr_run(loopmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -32,7 +32,10 @@
 #include <isc/types.h>
 #include <isc/util.h>
 
+#include <dns/acl.h>
 #include <dns/dnstap.h>
+#include <dns/fixedname.h>
+#include <dns/nametree.h>
 #include <dns/view.h>
 
 #include <tests/dns.h>
@@ -285,6 +288,210 @@ ISC_RUN_TEST_IMPL(dns_dt_send) {
 	}
 }
 
+/* send dnstap messages through the ring buffer output */
+ISC_RUN_TEST_IMPL(dns_dt_createring) {
+	isc_result_t result;
+	dns_dtenv_t *dtenv = NULL;
+	dns_dthandle_t *handle = NULL;
+	dns_view_t *view = NULL;
+	unsigned char qambuffer[4096];
+	isc_buffer_t qamsg;
+	size_t qasize;
+	isc_sockaddr_t qaddr, raddr;
+	struct in_addr in;
+	uint8_t *data = NULL;
+	size_t dsize;
+	int n = 0;
+
+	result = dns_test_makeview("test", false, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_dt_createring(mctx, TAPFILE, 0, NULL, &dtenv);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(isc_file_exists(TAPFILE));
+
+	dns_dt_attach(dtenv, &view->dtenv);
+	view->dttypes = DNS_DTTYPE_ALL;
+
+	result = dns_test_getdata(TESTS_DIR "/testdata/dnstap/query.auth",
+				  qambuffer, sizeof(qambuffer), &qasize);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_buffer_init(&qamsg, qambuffer, qasize);
+	isc_buffer_add(&qamsg, qasize);
+
+	in.s_addr = inet_addr("10.53.0.1");
+	isc_sockaddr_fromin(&qaddr, &in, 2112);
+	in.s_addr = inet_addr("10.53.0.2");
+	isc_sockaddr_fromin(&raddr, &in, 2112);
+
+	for (int i = 0; i < 100; i++) {
+		dns_dt_send(view, DNS_DTTYPE_AQ, &qaddr, &raddr,
+			    DNS_TRANSPORT_UDP, NULL, NULL, NULL, &qamsg);
+	}
+
+	/* Destroying the environment flushes the rings */
+	dns_dt_detach(&view->dtenv);
+	dns_dt_detach(&dtenv);
+	dns_view_detach(&view);
+
+	result = dns_dt_open(TAPFILE, dns_dtmode_file, mctx, &handle);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	while (dns_dt_getframe(handle, &data, &dsize) == ISC_R_SUCCESS) {
+		dns_dtdata_t *dtdata = NULL;
+		isc_region_t r = { .base = data, .length = dsize };
+
+		result = dns_dt_parse(mctx, &r, &dtdata);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(dtdata->type, DNS_DTTYPE_AQ);
+		dns_dtdata_free(&dtdata);
+		n++;
+	}
+	assert_int_equal(n, 100);
+
+	dns_dt_close(&handle);
+}
+
+/* filter dnstap messages before they are logged */
+ISC_RUN_TEST_IMPL(dns_dtfilter) {
+	isc_result_t result;
+	dns_dtenv_t *dtenv = NULL;
+	dns_dthandle_t *handle = NULL;
+	dns_view_t *view = NULL;
+	dns_dtfilter_t *filter = NULL;
+	dns_nametree_t *qnames = NULL;
+	dns_acl_t *none = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	unsigned char qambuffer[4096], rambuffer[4096];
+	isc_buffer_t qamsg, ramsg;
+	size_t qasize, rasize;
+	isc_sockaddr_t qaddr, raddr;
+	struct in_addr in;
+	isc_stdtime_t now = isc_stdtime_now();
+	isc_time_t p, q;
+	uint8_t *data = NULL;
+	size_t dsize;
+	dns_dtmsgtype_t expected[] = { DNS_DTTYPE_AQ, DNS_DTTYPE_AR };
+	size_t n = 0;
+
+	result = dns_test_makeview("test", false, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_dt_createring(mctx, TAPFILE, 0, NULL, &dtenv);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_dt_attach(dtenv, &view->dtenv);
+	view->dttypes = DNS_DTTYPE_ALL;
+
+	result = dns_test_getdata(TESTS_DIR "/testdata/dnstap/query.auth",
+				  qambuffer, sizeof(qambuffer), &qasize);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_buffer_init(&qamsg, qambuffer, qasize);
+	isc_buffer_add(&qamsg, qasize);
+
+	result = dns_test_getdata(TESTS_DIR "/testdata/dnstap/response.auth",
+				  rambuffer, sizeof(rambuffer), &rasize);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_buffer_init(&ramsg, rambuffer, rasize);
+	isc_buffer_add(&ramsg, rasize);
+
+	in.s_addr = inet_addr("10.53.0.1");
+	isc_sockaddr_fromin(&qaddr, &in, 2112);
+	in.s_addr = inet_addr("10.53.0.2");
+	isc_sockaddr_fromin(&raddr, &in, 2112);
+
+	isc_time_set(&p, now - 3600, 0);
+	isc_time_set(&q, now, 0);
+
+	/* The messages are for www.isc.org, which is not listed */
+	dns_dtfilter_create(mctx, &filter);
+	dns_nametree_create(mctx, DNS_NAMETREE_BOOL, "test", &qnames);
+	result = dns_name_fromstring(name, "example.com.", NULL, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_nametree_add(qnames, name, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dtfilter_setqnames(filter, qnames);
+	dns_nametree_detach(&qnames);
+	view->dtfilter = filter;
+	filter = NULL;
+
+	dns_dt_send(view, DNS_DTTYPE_AQ, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, NULL, &qamsg);
+	dns_dt_send(view, DNS_DTTYPE_AR, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, NULL, &ramsg);
+	dns_dtfilter_detach(&view->dtfilter);
+
+	/* The query passes, the NOERROR response does not */
+	dns_dtfilter_create(mctx, &filter);
+	dns_nametree_create(mctx, DNS_NAMETREE_BOOL, "test", &qnames);
+	result = dns_name_fromstring(name, "isc.org.", NULL, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_nametree_add(qnames, name, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dtfilter_setqnames(filter, qnames);
+	dns_nametree_detach(&qnames);
+	dns_dtfilter_addrcode(filter, dns_rcode_servfail);
+	view->dtfilter = filter;
+	filter = NULL;
+
+	dns_dt_send(view, DNS_DTTYPE_AQ, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, NULL, &qamsg);
+	dns_dt_send(view, DNS_DTTYPE_AR, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, NULL, &ramsg);
+	dns_dtfilter_detach(&view->dtfilter);
+
+	/* Only the slow response passes */
+	dns_dtfilter_create(mctx, &filter);
+	dns_dtfilter_setlatency(filter, 1000);
+	view->dtfilter = filter;
+	filter = NULL;
+
+	dns_dt_send(view, DNS_DTTYPE_AR, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, &q, &q, &ramsg);
+	dns_dt_send(view, DNS_DTTYPE_AR, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, &q, &ramsg);
+	dns_dt_send(view, DNS_DTTYPE_AR, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, &p, &q, &ramsg);
+	dns_dtfilter_detach(&view->dtfilter);
+
+	/* Nothing passes */
+	dns_dtfilter_create(mctx, &filter);
+	dns_acl_none(mctx, &none);
+	dns_dtfilter_setclients(filter, none);
+	dns_acl_detach(&none);
+	view->dtfilter = filter;
+	filter = NULL;
+
+	dns_dt_send(view, DNS_DTTYPE_AQ, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, NULL, &qamsg);
+	dns_dt_send(view, DNS_DTTYPE_AR, &qaddr, &raddr, DNS_TRANSPORT_UDP,
+		    NULL, NULL, NULL, &ramsg);
+
+	dns_dt_detach(&view->dtenv);
+	dns_dt_detach(&dtenv);
+	dns_view_detach(&view);
+
+	result = dns_dt_open(TAPFILE, dns_dtmode_file, mctx, &handle);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	while (dns_dt_getframe(handle, &data, &dsize) == ISC_R_SUCCESS) {
+		dns_dtdata_t *dtdata = NULL;
+		isc_region_t r = { .base = data, .length = dsize };
+
+		assert_true(n < ARRAY_SIZE(expected));
+
+		result = dns_dt_parse(mctx, &r, &dtdata);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(dtdata->type, expected[n]);
+		dns_dtdata_free(&dtdata);
+		n++;
+	}
+	assert_int_equal(n, ARRAY_SIZE(expected));
+
+	dns_dt_close(&handle);
+}
+
 /* dnstap message to text */
 ISC_RUN_TEST_IMPL(dns_dt_totext) {
 	isc_result_t result;
@@ -354,6 +561,8 @@ ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY_CUSTOM(dns_dt_create, setup, cleanup)
 ISC_TEST_ENTRY_CUSTOM(dns_dt_send, setup, cleanup)
+ISC_TEST_ENTRY_CUSTOM(dns_dt_createring, setup, cleanup)
+ISC_TEST_ENTRY_CUSTOM(dns_dtfilter, setup, cleanup)
 ISC_TEST_ENTRY_CUSTOM(dns_dt_totext, setup, cleanup)
 
 ISC_TEST_LIST_END
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/file.h>
+#include <isc/util.h>
+
+#include <dns/diff.h>
+#include <dns/journal.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/soa.h>
+
+#include <tests/dns.h>
+
+#define JOURNAL "journal_test.jnl"
+#define BACKUP	"journal_test.jbk"
+
+#define NTRANSACTIONS 300
+
+/* Enough transactions to keep more than a megabyte when truncated */
+#define NLARGE 20000
+
+static int
+setup_test(void **state) {
+	UNUSED(state);
+
+	(void)isc_file_remove(JOURNAL);
+	(void)isc_file_remove(BACKUP);
+	return (0);
+}
+
+static int
+teardown_test(void **state) {
+	UNUSED(state);
+
+	(void)isc_file_remove(JOURNAL);
+	(void)isc_file_remove(BACKUP);
+	return (0);
+}
+
+/* Write transactions changing the serial from 'from' up to 'to' */
+static void
+write_transactions(uint32_t from, uint32_t to) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_CREATE, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (uint32_t serial = from; serial < to; serial++) {
+		char oldsoa[100], newsoa[100], txt[100];
+		zonechange_t changes[] = {
+			{ DNS_DIFFOP_DEL, "example.", 300, "SOA", oldsoa },
+			{ DNS_DIFFOP_ADD, "example.", 300, "SOA", newsoa },
+			{ DNS_DIFFOP_ADD, "example.", 300, "TXT", txt },
+			ZONECHANGE_SENTINEL,
+		};
+		dns_diff_t diff;
+
+		snprintf(oldsoa, sizeof(oldsoa), "ns. hm. %u 3600 600 86400 60",
+			 serial);
+		snprintf(newsoa, sizeof(newsoa), "ns. hm. %u 3600 600 86400 60",
+			 serial + 1);
+		snprintf(txt, sizeof(txt), "\"%u\"", serial + 1);
+
+		result = dns_test_difffromchanges(&diff, changes, false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = dns_journal_write_transaction(j, &diff);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_diff_clear(&diff);
+	}
+
+	dns_journal_destroy(&j);
+}
+
+/* Check the journal format string */
+static void
+check_format(const char *format) {
+	char buf[16] = { 0 };
+	FILE *fp = fopen(JOURNAL, "rb");
+
+	assert_non_null(fp);
+	assert_int_equal(fread(buf, 1, sizeof(buf), fp), sizeof(buf));
+	fclose(fp);
+	assert_string_equal(buf, format);
+}
+
+/*
+ * Check that iterating from 'serial' starts with the transaction that
+ * changes 'serial', and returns 'count' transactions.
+ */
+static void
+check_iter(dns_journal_t *j, uint32_t serial, uint32_t count) {
+	uint32_t end = dns_journal_last_serial(j);
+	uint32_t n = 0;
+	isc_result_t result;
+
+	result = dns_journal_iter_init(j, serial, end, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (result = dns_journal_first_rr(j); result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(j))
+	{
+		dns_name_t *name = NULL;
+		dns_rdata_t *rdata = NULL;
+		uint32_t ttl;
+
+		dns_journal_current_rr(j, &name, &ttl, &rdata);
+		if (rdata->type != dns_rdatatype_soa) {
+			continue;
+		}
+		/* Deleted SOAs have even numbers, added ones odd */
+		if (n % 2 == 0) {
+			assert_int_equal(dns_soa_getserial(rdata),
+					 serial + n / 2);
+		}
+		n++;
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	assert_int_equal(n, count * 2);
+}
+
+/* every serial in a large journal can be found */
+ISC_RUN_TEST_IMPL(journal_find) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	write_transactions(1, NTRANSACTIONS + 1);
+	check_format(";BIND LOG V9.3\n");
+
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(dns_journal_first_serial(j), 1);
+	assert_int_equal(dns_journal_last_serial(j), NTRANSACTIONS + 1);
+
+	for (uint32_t serial = 1; serial <= NTRANSACTIONS; serial++) {
+		check_iter(j, serial, NTRANSACTIONS + 1 - serial);
+	}
+
+	result = dns_journal_iter_init(j, 0, NTRANSACTIONS + 1, NULL);
+	assert_int_equal(result, ISC_R_RANGE);
+	dns_journal_destroy(&j);
+}
+
+/* the journal can be converted between formats and compacted */
+ISC_RUN_TEST_IMPL(journal_compact) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+	uint32_t first;
+
+	UNUSED(state);
+
+	write_transactions(1, NTRANSACTIONS + 1);
+
+	/* Back to the unsorted index, and appending to it */
+	result = dns_journal_compact(mctx, UNCONST(JOURNAL), 0,
+				     DNS_JOURNAL_COMPACTALL |
+					     DNS_JOURNAL_VERSION2,
+				     0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	check_format(";BIND LOG V9.2\n");
+	write_transactions(NTRANSACTIONS + 1, NTRANSACTIONS + 11);
+	check_format(";BIND LOG V9.2\n");
+
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	check_iter(j, 1, NTRANSACTIONS + 10);
+	check_iter(j, 200, NTRANSACTIONS + 11 - 200);
+	dns_journal_destroy(&j);
+
+	/* Upgrading gives every transaction an index entry */
+	result = dns_journal_compact(mctx, UNCONST(JOURNAL), 0,
+				     DNS_JOURNAL_COMPACTALL, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	check_format(";BIND LOG V9.3\n");
+	write_transactions(NTRANSACTIONS + 11, NTRANSACTIONS + 21);
+
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (uint32_t serial = 1; serial <= NTRANSACTIONS + 20; serial++) {
+		check_iter(j, serial, NTRANSACTIONS + 21 - serial);
+	}
+	dns_journal_destroy(&j);
+
+	/* Dropping the oldest transactions */
+	result = dns_journal_compact(mctx, UNCONST(JOURNAL), 250, 0, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	first = dns_journal_first_serial(j);
+	assert_true(first > 1 && first <= 250);
+	assert_int_equal(dns_journal_last_serial(j), NTRANSACTIONS + 21);
+	result = dns_journal_iter_init(j, 1, NTRANSACTIONS + 21, NULL);
+	assert_int_equal(result, ISC_R_RANGE);
+	for (uint32_t serial = first; serial <= NTRANSACTIONS + 20; serial++) {
+		check_iter(j, serial, NTRANSACTIONS + 21 - serial);
+	}
+	dns_journal_destroy(&j);
+}
+
+/* the beginning of a large journal can be moved forward */
+ISC_RUN_TEST_IMPL(journal_truncate) {
+	dns_journal_t *j = NULL, *reader = NULL;
+	isc_result_t result;
+	uint32_t begin, freed, first;
+	off_t size;
+
+	UNUSED(state);
+
+	write_transactions(1, NLARGE + 1);
+	result = isc_file_getsize(JOURNAL, &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_journal_truncate(mctx, JOURNAL, NLARGE + 2, 0, &begin,
+				      &freed);
+	if (result == ISC_R_NOTIMPLEMENTED) {
+		/* Disk space can't be released here */
+		skip();
+	}
+	assert_int_equal(result, ISC_R_RANGE);
+
+	/* A reader that is already open keeps the old beginning */
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &reader);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_journal_truncate(mctx, JOURNAL, NLARGE / 2, 0, &begin,
+				      &freed);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(freed > 0);
+	assert_true(begin > freed && begin < size);
+
+	/* Only the header changed, and new transactions go at the end */
+	write_transactions(NLARGE + 1, NLARGE + 11);
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(dns_journal_first_serial(j), NLARGE / 2);
+	assert_int_equal(dns_journal_last_serial(j), NLARGE + 11);
+	result = dns_journal_iter_init(j, 1, NLARGE + 11, NULL);
+	assert_int_equal(result, ISC_R_RANGE);
+	check_iter(j, NLARGE / 2, NLARGE / 2 + 11);
+	check_iter(j, NLARGE - 7, 18);
+	dns_journal_destroy(&j);
+
+	/* Nothing is given back while the reader is open */
+	result = dns_journal_punch(JOURNAL, begin);
+	if (result == ISC_R_NOTIMPLEMENTED) {
+		/* The file system doesn't support it */
+		dns_journal_destroy(&reader);
+		skip();
+	}
+	assert_int_equal(result, ISC_R_SUCCESS);
+	check_iter(reader, 1, NLARGE);
+	dns_journal_destroy(&reader);
+
+	/* Then the space before the beginning can be given back */
+	result = dns_journal_punch(JOURNAL, begin);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	check_iter(j, NLARGE / 2, NLARGE / 2 + 11);
+	dns_journal_destroy(&j);
+
+	/* Not what is kept, though, whatever is asked for */
+	result = dns_journal_punch(JOURNAL, UINT32_MAX);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	check_iter(j, NLARGE / 2, NLARGE / 2 + 11);
+	dns_journal_destroy(&j);
+
+	/* Little enough is left to be copied */
+	result = dns_journal_truncate(mctx, JOURNAL, NLARGE, 0, &begin,
+				      &freed);
+	assert_int_equal(result, ISC_R_NOTIMPLEMENTED);
+	result = dns_journal_compact(mctx, UNCONST(JOURNAL), NLARGE, 0, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_open(mctx, JOURNAL, DNS_JOURNAL_READ, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	first = dns_journal_first_serial(j);
+	assert_true(first > NLARGE / 2 && first <= NLARGE);
+	check_iter(j, first, NLARGE + 11 - first);
+	dns_journal_destroy(&j);
+
+	/* Older formats are always copied */
+	result = dns_journal_compact(mctx, UNCONST(JOURNAL), 0,
+				     DNS_JOURNAL_COMPACTALL |
+					     DNS_JOURNAL_VERSION2,
+				     0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_truncate(mctx, JOURNAL, NLARGE + 5, 0, &begin,
+				      &freed);
+	assert_int_equal(result, ISC_R_NOTIMPLEMENTED);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(journal_find, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(journal_compact, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(journal_truncate, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/histo.h>
+#include <isc/loop.h>
+#include <isc/util.h>
+
+#include <dns/stats.h>
+
+#include <tests/dns.h>
+
+static double
+population(const isc_histomulti_t *hm) {
+	isc_histo_t *hg = NULL;
+	double pop;
+
+	isc_histomulti_merge(&hg, hm);
+	isc_histo_moments(hg, &pop, NULL, NULL);
+	isc_histo_destroy(&hg);
+
+	return (pop);
+}
+
+/* queries are counted by transport and by whether they recursed */
+ISC_LOOP_TEST_IMPL(transport) {
+	dns_stats_t *stats = NULL;
+	isc_histo_t *hg = NULL;
+	uint64_t value;
+	const double fraction = 0.5;
+
+	dns_latencystats_create(mctx, &stats);
+
+	for (int i = 0; i < 10; i++) {
+		dns_latencystats_add(stats, dns_latency_udp, false,
+				     dns_rdatatype_a, 100);
+	}
+	dns_latencystats_add(stats, dns_latency_udp, true, dns_rdatatype_a,
+			     50000);
+	dns_latencystats_add(stats, dns_latency_https, false,
+			     dns_rdatatype_aaaa, 2000);
+
+	assert_int_equal(
+		population(dns_latencystats_get(stats, dns_latency_udp, false)),
+		10);
+	assert_int_equal(
+		population(dns_latencystats_get(stats, dns_latency_udp, true)),
+		1);
+	assert_int_equal(population(dns_latencystats_get(
+				 stats, dns_latency_https, false)),
+			 1);
+	assert_int_equal(
+		population(dns_latencystats_get(stats, dns_latency_tcp, false)),
+		0);
+
+	/* The median is within the precision of the histogram */
+	isc_histomulti_merge(&hg,
+			     dns_latencystats_get(stats, dns_latency_udp, true));
+	assert_int_equal(isc_histo_quantiles(hg, 1, &fraction, &value),
+			 ISC_R_SUCCESS);
+	assert_in_range(value, 50000 - 50000 / 8, 50000 + 50000 / 8);
+	isc_histo_destroy(&hg);
+
+	dns_stats_detach(&stats);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+count_qtypes(dns_rdatatype_t type, const isc_histomulti_t *hm, void *arg) {
+	double *counts = arg;
+
+	counts[type] += population(hm);
+}
+
+/* uncommon query types share one histogram */
+ISC_LOOP_TEST_IMPL(qtype) {
+	dns_stats_t *stats = NULL;
+	double counts[dns_rdatatype_any + 1] = { 0 };
+
+	dns_latencystats_create(mctx, &stats);
+
+	dns_latencystats_add(stats, dns_latency_tcp, false, dns_rdatatype_a,
+			     10);
+	dns_latencystats_add(stats, dns_latency_tcp, false, dns_rdatatype_a,
+			     20);
+	dns_latencystats_add(stats, dns_latency_tls, true, dns_rdatatype_https,
+			     30);
+	dns_latencystats_add(stats, dns_latency_udp, false, dns_rdatatype_naptr,
+			     40);
+	dns_latencystats_add(stats, dns_latency_udp, false, dns_rdatatype_any,
+			     50);
+
+	dns_latencystats_dump(stats, count_qtypes, counts);
+
+	assert_int_equal(counts[dns_rdatatype_a], 2);
+	assert_int_equal(counts[dns_rdatatype_https], 1);
+	assert_int_equal(counts[dns_rdatatype_naptr], 0);
+	assert_int_equal(counts[dns_rdatatype_any], 0);
+	assert_int_equal(counts[0], 2);
+
+	dns_stats_detach(&stats);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(transport, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(qtype, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
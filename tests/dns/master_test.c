@@ -19,18 +19,21 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define UNIT_TESTING
 #include <cmocka.h>
 
 #include <isc/dir.h>
+#include <isc/file.h>
 #include <isc/string.h>
 #include <isc/util.h>
 
 #include <dns/cache.h>
 #include <dns/callbacks.h>
 #include <dns/db.h>
+#include <dns/fixedname.h>
 #include <dns/master.h>
 #include <dns/masterdump.h>
 #include <dns/name.h>
@@ -520,6 +523,205 @@ ISC_RUN_TEST_IMPL(dumpraw) {
 	dns_db_detach(&db);
 }
 
+static bool
+files_equal(const char *file1, const char *file2) {
+	char buf1[BIGBUFLEN], buf2[BIGBUFLEN];
+	size_t len1, len2;
+	FILE *f1 = fopen(file1, "r");
+	FILE *f2 = fopen(file2, "r");
+
+	assert_non_null(f1);
+	assert_non_null(f2);
+	len1 = fread(buf1, 1, sizeof(buf1), f1);
+	len2 = fread(buf2, 1, sizeof(buf2), f2);
+	fclose(f1);
+	fclose(f2);
+
+	return (len1 == len2 && memcmp(buf1, buf2, len1) == 0);
+}
+
+/*
+ * Image dump test:
+ * dns_master_dump*() functions dump image files that load back into
+ * the same zone
+ */
+ISC_RUN_TEST_IMPL(dumpimage) {
+	isc_result_t result;
+	dns_db_t *db = NULL, *db2 = NULL;
+	dns_dbversion_t *version = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *dnsorigin = dns_fixedname_initname(&fixed);
+	off_t size;
+
+	UNUSED(state);
+
+	result = dns_name_fromstring(dnsorigin, TEST_ORIGIN, dns_rootname, 0,
+				     NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, dnsorigin,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(SRCDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_load(db, TESTS_DIR "/testdata/master/master1.data",
+			     dns_masterformat_text, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(BUILDDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_db_currentversion(db, &version);
+
+	dns_master_initrawheader(&header);
+	header.sourceserial = 12345;
+	header.flags |= DNS_MASTERRAW_SOURCESERIALSET;
+
+	result = dns_master_dump(mctx, db, version, &dns_master_style_default,
+				 "test.image", dns_masterformat_image, &header);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_master_dump(mctx, db, version, &dns_master_style_default,
+				 "test.dump", dns_masterformat_text, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, false);
+
+	result = test_master(NULL, "test.image", dns_masterformat_image,
+			     nullmsg, nullmsg);
+	assert_string_equal(isc_result_totext(result), "success");
+	assert_true(headerset);
+	assert_true((header.flags & DNS_MASTERRAW_SOURCESERIALSET) != 0);
+	assert_int_equal(header.sourceserial, 12345);
+
+	/* The image loads into a database holding exactly the same data */
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, dnsorigin,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_load(db2, "test.image", dns_masterformat_image, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_db_currentversion(db2, &version);
+	result = dns_master_dump(mctx, db2, version, &dns_master_style_default,
+				 "test.dump2", dns_masterformat_text, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db2, &version, false);
+	assert_true(files_equal("test.dump", "test.dump2"));
+
+	/* An image is not a raw file, and vice versa */
+	result = test_master(NULL, "test.image", dns_masterformat_raw, nullmsg,
+			     nullmsg);
+	assert_int_equal(result, ISC_R_NOTIMPLEMENTED);
+	result = test_master(BUILDDIR, "testdata/master/master13.data",
+			     dns_masterformat_image, nullmsg, nullmsg);
+	assert_int_equal(result, ISC_R_NOTIMPLEMENTED);
+
+	/* Truncated images are rejected */
+	result = isc_file_getsize("test.image", &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(truncate("test.image", size - 1), 0);
+	result = test_master(NULL, "test.image", dns_masterformat_image,
+			     nullmsg, nullmsg);
+	assert_int_equal(result, ISC_R_RANGE);
+
+	unlink("test.image");
+	unlink("test.dump");
+	unlink("test.dump2");
+	dns_db_detach(&db2);
+	dns_db_detach(&db);
+}
+
+/* Replace the first occurrence of 'from' in 'file' with 'to' */
+static void
+patch_file(const char *file, const char *from, const char *to, size_t len) {
+	char buf[BIGBUFLEN];
+	size_t buflen, i;
+	FILE *f = fopen(file, "r+");
+
+	assert_non_null(f);
+	buflen = fread(buf, 1, sizeof(buf), f);
+	for (i = 0; i + len <= buflen; i++) {
+		if (memcmp(buf + i, from, len) == 0) {
+			break;
+		}
+	}
+	assert_true(i + len <= buflen);
+
+	assert_int_equal(fseek(f, (long)i, SEEK_SET), 0);
+	assert_int_equal(fwrite(to, 1, len, f), len);
+	fclose(f);
+}
+
+/*
+ * Corrupt image test:
+ * the rdata in an image file are checked like those in a raw file, and
+ * so is their order
+ */
+ISC_RUN_TEST_IMPL(corruptimage) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *dnsorigin = dns_fixedname_initname(&fixed);
+
+	UNUSED(state);
+
+	result = dns_name_fromstring(dnsorigin, TEST_ORIGIN, dns_rootname, 0,
+				     NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, dnsorigin,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(SRCDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_load(db, TESTS_DIR "/testdata/master/master1.data",
+			     dns_masterformat_text, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(BUILDDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_db_currentversion(db, &version);
+	result = dns_master_dump(mctx, db, version, &dns_master_style_default,
+				 "test.image", dns_masterformat_image, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, false);
+
+	/* The same NS record twice: ns, ns2, ns2 */
+	patch_file("test.image", "\003ns3", "\003ns2", 4);
+	result = test_master(NULL, "test.image", dns_masterformat_image,
+			     nullmsg, nullmsg);
+	assert_int_equal(result, DNS_R_FORMERR);
+
+	/* NS records out of order: ns, ns4, ns2 */
+	patch_file("test.image", "\003ns2", "\003ns4", 4);
+	result = test_master(NULL, "test.image", dns_masterformat_image,
+			     nullmsg, nullmsg);
+	assert_int_equal(result, DNS_R_FORMERR);
+
+	/* Back in order, the image loads again: ns, ns2, ns3 */
+	patch_file("test.image", "\003ns2", "\003ns3", 4);
+	patch_file("test.image", "\003ns4", "\003ns2", 4);
+	result = test_master(NULL, "test.image", dns_masterformat_image,
+			     nullmsg, nullmsg);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* A label running past the end of an NS record */
+	patch_file("test.image", "\003ns2", "\077ns2", 4);
+	result = test_master(NULL, "test.image", dns_masterformat_image,
+			     nullmsg, nullmsg);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+
+	unlink("test.image");
+	dns_db_detach(&db);
+}
+
 static const char *warn_expect_value;
 static bool warn_expect_result;
 
@@ -574,6 +776,8 @@ ISC_TEST_ENTRY(leadingzero)
 ISC_TEST_ENTRY(totext)
 ISC_TEST_ENTRY(loadraw)
 ISC_TEST_ENTRY(dumpraw)
+ISC_TEST_ENTRY(dumpimage)
+ISC_TEST_ENTRY(corruptimage)
 ISC_TEST_ENTRY(toobig)
 ISC_TEST_ENTRY(maxrdata)
 ISC_TEST_ENTRY(neworigin)
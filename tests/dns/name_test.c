@@ -35,6 +35,8 @@
 #include <dns/fixedname.h>
 #include <dns/name.h>
 
+#include "compress_p.h"
+
 #include <tests/dns.h>
 
 /* Set to true (or use -v option) for verbose output */
@@ -452,6 +454,94 @@ ISC_RUN_TEST_IMPL(collision) {
 	dns_compress_invalidate(&cctx);
 }
 
+/*
+ * Render names with labels of all lengths and mixed case, returning the
+ * length of the message and a copy of the hash set.
+ */
+static unsigned int
+compress_render(dns_compress_flags_t flags, uint8_t *msgbuf, size_t msglen,
+		dns_compress_slot_t *set, size_t setsize) {
+	isc_result_t result;
+	dns_compress_t cctx;
+	isc_buffer_t message;
+	char text[DNS_NAME_FORMATSIZE];
+	unsigned int used;
+
+	dns_compress_init(&cctx, mctx, flags | DNS_COMPRESS_LARGE);
+	isc_buffer_init(&message, msgbuf, msglen);
+	isc_buffer_putuint16(&message, 0xEAD);
+
+	for (unsigned int len = 1; len < 64; len++) {
+		for (unsigned int i = 0; i < 4; i++) {
+			dns_fixedname_t fixed;
+			dns_name_t *name = dns_fixedname_initname(&fixed);
+			size_t n = 0;
+
+			/* alternate case in different places for each copy */
+			for (unsigned int c = 0; c < len; c++) {
+				text[n++] = ((c + i) % 3 == 0) ? 'A' + c % 26
+							       : 'a' + c % 26;
+			}
+			snprintf(text + n, sizeof(text) - n,
+				 ".%u.Example-%u.NET", len % 7, i % 2);
+
+			result = dns_name_fromstring(name, text, dns_rootname,
+						     0, NULL);
+			assert_int_equal(result, ISC_R_SUCCESS);
+
+			dns_compress_setpermitted(&cctx, true);
+			result = dns_name_towire(name, &cctx, &message, NULL);
+			assert_int_equal(result, ISC_R_SUCCESS);
+		}
+	}
+
+	assert_int_equal(setsize, (cctx.mask + 1) * sizeof(*set));
+	memmove(set, cctx.set, setsize);
+	used = isc_buffer_usedlength(&message);
+	dns_compress_invalidate(&cctx);
+
+	return (used);
+}
+
+/* vectorized and scalar compression must produce identical results */
+ISC_RUN_TEST_IMPL(compression_impls) {
+	static dns_compress_slot_t set0[1 << DNS_COMPRESS_LARGEBITS];
+	static dns_compress_slot_t set1[1 << DNS_COMPRESS_LARGEBITS];
+	static uint8_t msg0[65536], msg1[65536];
+	dns_compress_flags_t flags[] = { 0, DNS_COMPRESS_CASE };
+	dns__compress_impl_t saved = dns__compress_getimpl();
+
+	UNUSED(state);
+
+	for (size_t f = 0; f < ARRAY_SIZE(flags); f++) {
+		unsigned int len0, len1;
+
+		assert_true(dns__compress_setimpl(DNS__COMPRESS_SCALAR));
+		len0 = compress_render(flags[f], msg0, sizeof(msg0), set0,
+				       sizeof(set0));
+
+		for (dns__compress_impl_t impl = 0; impl < DNS__COMPRESS_IMPLS;
+		     impl++)
+		{
+			if (!dns__compress_setimpl(impl)) {
+				continue;
+			}
+			if (verbose) {
+				fprintf(stderr, "# %s\n",
+					dns__compress_impltext(impl));
+			}
+
+			len1 = compress_render(flags[f], msg1, sizeof(msg1),
+					       set1, sizeof(set1));
+			assert_int_equal(len0, len1);
+			assert_memory_equal(msg0, msg1, len0);
+			assert_memory_equal(set0, set1, sizeof(set0));
+		}
+	}
+
+	assert_true(dns__compress_setimpl(saved));
+}
+
 ISC_RUN_TEST_IMPL(fromregion) {
 	dns_name_t name;
 	isc_buffer_t b;
@@ -1006,6 +1096,7 @@ ISC_TEST_LIST_START
 ISC_TEST_ENTRY(fullcompare)
 ISC_TEST_ENTRY(compression)
 ISC_TEST_ENTRY(collision)
+ISC_TEST_ENTRY(compression_impls)
 ISC_TEST_ENTRY(fromregion)
 ISC_TEST_ENTRY(istat)
 ISC_TEST_ENTRY(init)
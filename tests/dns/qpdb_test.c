@@ -211,9 +211,135 @@ ISC_LOOP_TEST_IMPL(overmempurge_longname) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+static isc_result_t
+find_cached(dns_db_t *db, isc_stdtime_t now, int idx, dns_rdatatype_t rtype) {
+	isc_result_t result;
+	dns_fixedname_t fname, ffound;
+	dns_name_t *found = dns_fixedname_initname(&ffound);
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset;
+	char namebuf[DNS_NAME_FORMATSIZE];
+
+	snprintf(namebuf, sizeof(namebuf), "%d.example.com.", idx);
+	dns_test_namefromstring(namebuf, &fname);
+
+	dns_rdataset_init(&rdataset);
+	result = dns_db_find(db, dns_fixedname_name(&fname), NULL, rtype, 0,
+			     now, &node, found, &rdataset, NULL);
+	if (result == ISC_R_SUCCESS) {
+		assert_true(dns_name_equal(found, dns_fixedname_name(&fname)));
+		assert_int_equal(rdataset.type, rtype);
+		dns_rdataset_disassociate(&rdataset);
+	}
+	if (node != NULL) {
+		dns_db_detachnode(db, &node);
+	}
+
+	return (result);
+}
+
+ISC_LOOP_TEST_IMPL(loopcache) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	uint64_t hits, misses;
+
+	result = dns_db_create(mctx, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_db_setloopcache(db, 10);
+	overmempurge_addrdataset(db, now, 1, 50053, 0, false);
+
+	/* The first lookup fills the loop cache, the second one hits it. */
+	assert_int_equal(find_cached(db, now, 1, 50053), ISC_R_SUCCESS);
+	assert_int_equal(find_cached(db, now, 1, 50053), ISC_R_SUCCESS);
+
+	result = dns_db_getloopcachestats(db, isc_tid(), &hits, &misses);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(hits, 1);
+	assert_int_equal(misses, 1);
+
+	/* Replacing the data invalidates the entry. */
+	overmempurge_addrdataset(db, now, 1, 50053, 0, false);
+	assert_int_equal(find_cached(db, now, 1, 50053), ISC_R_SUCCESS);
+	assert_int_equal(find_cached(db, now, 1, 50053), ISC_R_SUCCESS);
+
+	result = dns_db_getloopcachestats(db, isc_tid(), &hits, &misses);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(hits, 2);
+	assert_int_equal(misses, 2);
+
+	/* Expired entries are not served. */
+	assert_int_equal(find_cached(db, now + 7200, 1, 50053), ISC_R_NOTFOUND);
+
+	/* Names that are not cached never make it into the loop cache. */
+	assert_int_equal(find_cached(db, now, 2, 50053), ISC_R_NOTFOUND);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+loopcache_overmem_check(void *arg) {
+	dns_db_t *db = arg;
+	qpcache_t *qpdb = (qpcache_t *)db;
+	qpc_loopcache_t *lc = &qpdb->loopcaches[isc_tid()];
+
+	/* The flush has run, and the table is still there */
+	assert_false(atomic_load(&lc->flushing));
+	assert_int_equal(atomic_load(&lc->used), 0);
+	assert_non_null(lc->entries);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+ISC_LOOP_TEST_IMPL(loopcache_overmem) {
+	size_t maxcache = 2097152U; /* 2MB - same as DNS_CACHE_MINSIZE */
+	size_t hiwater = maxcache - (maxcache >> 3); /* borrowed from cache.c */
+	size_t lowater = maxcache - (maxcache >> 2); /* ditto */
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_mem_t *mctx2 = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	qpc_loopcache_t *lc = NULL;
+	size_t i;
+
+	isc_mem_create(&mctx2);
+
+	result = dns_db_create(mctx2, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	lc = &((qpcache_t *)db)->loopcaches[isc_tid()];
+
+	dns_db_setloopcache(db, 10);
+	overmempurge_addrdataset(db, now, 0, 50053, 0, false);
+	assert_int_equal(find_cached(db, now, 0, 50053), ISC_R_SUCCESS);
+	assert_int_equal(atomic_load(&lc->used), 1);
+
+	isc_mem_setwater(mctx2, hiwater, lowater);
+	for (i = 1; !isc_mem_isovermem(mctx2) && i < (maxcache / 10); i++) {
+		overmempurge_addrdataset(db, now, i, 50053, 0, false);
+	}
+	assert_true(isc_mem_isovermem(mctx2));
+
+	/* Purging asks the loop to let go of the nodes it is holding */
+	overmempurge_addrdataset(db, now, i, 50053, 0, false);
+	assert_true(atomic_load(&lc->flushing));
+
+	/* The database holds on to the memory context until it's freed */
+	isc_mem_detach(&mctx2);
+	isc_async_current(loopcache_overmem_check, db);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(overmempurge_bigrdata, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(overmempurge_longname, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(loopcache, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(loopcache_overmem, setup_managers, teardown_managers)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -216,9 +216,98 @@ ISC_RUN_TEST_IMPL(setownercase) {
 	assert_true(dns_name_caseequal(name1, name2));
 }
 
+/*
+ * Load a zone in two batches, as a zone transfer does, with the
+ * records of one RRset split between them.
+ */
+ISC_LOOP_TEST_IMPL(loadbatches) {
+	const zonechange_t batch1[] = {
+		{ DNS_DIFFOP_ADD, "example.", 300, "SOA",
+		  "ns.example. hostmaster.example. 1 3600 600 86400 300" },
+		{ DNS_DIFFOP_ADD, "example.", 300, "NS", "ns.example." },
+		{ DNS_DIFFOP_ADD, "a.example.", 300, "A", "192.0.2.1" },
+		{ DNS_DIFFOP_ADD, "a.example.", 300, "TXT", "a" },
+		{ DNS_DIFFOP_ADD, "*.w.example.", 300, "TXT", "wild" },
+		{ DNS_DIFFOP_ADD, "*.w.example.", 300, "A", "192.0.2.3" },
+		ZONECHANGE_SENTINEL,
+	};
+	const zonechange_t batch2[] = {
+		{ DNS_DIFFOP_ADD, "a.example.", 300, "A", "192.0.2.2" },
+		{ DNS_DIFFOP_ADD, "ns.example.", 300, "A", "192.0.2.53" },
+		ZONECHANGE_SENTINEL,
+	};
+	const zonechange_t *batches[] = { batch1, batch2 };
+	dns_rdatacallbacks_t callbacks;
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset;
+	dns_fixedname_t forigin, fname;
+	dns_name_t *name = dns_fixedname_initname(&fname);
+	isc_result_t result;
+
+	dns_test_namefromstring("example.", &forigin);
+	result = dns_db_create(mctx, ZONEDB_DEFAULT,
+			       dns_fixedname_name(&forigin), dns_dbtype_zone,
+			       dns_rdataclass_in, 0, NULL, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdatacallbacks_init(&callbacks);
+	result = dns_db_beginload(db, &callbacks);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (size_t i = 0; i < ARRAY_SIZE(batches); i++) {
+		dns_diff_t diff;
+
+		result = dns_test_difffromchanges(&diff, batches[i], false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = dns_diff_load(&diff, &callbacks);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_diff_clear(&diff);
+	}
+
+	result = dns_db_endload(db, &callbacks);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Both halves of the A RRset were kept */
+	dns_test_namefromstring("a.example.", &fname);
+	result = dns_db_findnode(db, name, false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_init(&rdataset);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a, 0, 0,
+				     &rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(dns_rdataset_count(&rdataset), 2);
+	dns_rdataset_disassociate(&rdataset);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_txt, 0, 0,
+				     &rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db, &node);
+
+	/* The wildcard's parent is marked once */
+	dns_test_namefromstring("w.example.", &fname);
+	result = dns_db_findnode(db, name, false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(((qpznode_t *)node)->wild);
+	dns_db_detachnode(db, &node);
+
+	dns_test_namefromstring("*.w.example.", &fname);
+	result = dns_db_findnode(db, name, false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a, 0, 0,
+				     &rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db, &node);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(ownercase)
 ISC_TEST_ENTRY(setownercase)
+ISC_TEST_ENTRY_CUSTOM(loadbatches, setup_managers, teardown_managers)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -22,8 +22,10 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/atomic.h>
 #include <isc/buffer.h>
 #include <isc/net.h>
+#include <isc/stats.h>
 #include <isc/timer.h>
 #include <isc/tls.h>
 #include <isc/util.h>
@@ -31,6 +33,7 @@
 #include <dns/dispatch.h>
 #include <dns/name.h>
 #include <dns/resolver.h>
+#include <dns/stats.h>
 #include <dns/view.h>
 
 #include <tests/dns.h>
@@ -181,6 +184,101 @@ ISC_LOOP_TEST_IMPL(settimeout_overmax) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+/* dns_resolver_setfetchtrace and an empty trace dump */
+ISC_LOOP_TEST_IMPL(fetchtrace) {
+	dns_resolver_t *resolver = NULL;
+	isc_buffer_t *b = NULL;
+	isc_result_t result;
+
+	mkres(&resolver);
+
+	assert_int_equal(dns_resolver_getfetchtrace(resolver), 0);
+	dns_resolver_setfetchtrace(resolver, 100);
+	assert_int_equal(dns_resolver_getfetchtrace(resolver), 100);
+
+	isc_buffer_allocate(mctx, &b, 64);
+	result = dns_resolver_dumpfetchtrace(resolver, &b);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(isc_buffer_usedlength(b), 0);
+	isc_buffer_free(&b);
+
+	dns_resolver_setfetchtrace(resolver, 0);
+	assert_int_equal(dns_resolver_getfetchtrace(resolver), 0);
+
+	destroy_resolver(&resolver);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/* dns_resolver_verify */
+#define VERIFIES 40
+
+static dns_resolver_t *verify_resolver = NULL;
+static isc_stats_t *verify_stats = NULL;
+static atomic_uint_fast32_t verified;
+static unsigned int verify_done;
+
+static void
+verify_work(void *arg) {
+	UNUSED(arg);
+
+	atomic_fetch_add(&verified, 1);
+}
+
+static void
+verify_after(void *arg) {
+	unsigned int size;
+
+	UNUSED(arg);
+
+	if (++verify_done < VERIFIES) {
+		return;
+	}
+
+	assert_int_equal(atomic_load(&verified), VERIFIES);
+
+	/*
+	 * 40 verifications were queued at once: they are spread over one
+	 * batch per loop, but the batches hold no more than 32.
+	 */
+	size = ISC_MIN((VERIFIES + workers - 1) / workers, 32);
+	assert_int_equal(isc_stats_get_counter(
+				 verify_stats, dns_resstatscounter_verifyqueued),
+			 0);
+	assert_int_equal(isc_stats_get_counter(
+				 verify_stats, dns_resstatscounter_verifybatches),
+			 (VERIFIES + size - 1) / size);
+	assert_int_equal(isc_stats_get_counter(
+				 verify_stats, dns_resstatscounter_verifybatched),
+			 VERIFIES);
+	assert_int_equal(isc_stats_get_counter(
+				 verify_stats, dns_resstatscounter_verifybatchmax),
+			 size);
+
+	isc_stats_detach(&verify_stats);
+	destroy_resolver(&verify_resolver);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+ISC_LOOP_TEST_IMPL(verify_batch) {
+	mkres(&verify_resolver);
+
+	isc_stats_create(mctx, &verify_stats, dns_resstatscounter_max);
+	dns_resolver_setstats(verify_resolver, verify_stats);
+
+	atomic_init(&verified, 0);
+	verify_done = 0;
+	for (size_t i = 0; i < VERIFIES; i++) {
+		dns_resolver_verify(verify_resolver, verify_work, verify_after,
+				    NULL);
+	}
+
+	/* Nothing is handed to the offload threads until the loop runs */
+	assert_int_equal(atomic_load(&verified), 0);
+	assert_int_equal(isc_stats_get_counter(
+				 verify_stats, dns_resstatscounter_verifyqueued),
+			 VERIFIES);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(create, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(gettimeout, setup_test, teardown_test)
@@ -188,6 +286,8 @@ ISC_TEST_ENTRY_CUSTOM(settimeout, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_default, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_belowmin, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_overmax, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(fetchtrace, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(verify_batch, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
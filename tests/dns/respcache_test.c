@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/masterdump.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdataclass.h>
+#include <dns/rdatatype.h>
+#include <dns/respcache.h>
+#include <dns/zone.h>
+
+#include <tests/dns.h>
+
+#define FLAGS (DNS_RESPCACHE_EDNS | DNS_RESPCACHE_DO)
+
+/*
+ * Build a fake response to 'qname'/A, 'extra' bytes past the question.
+ */
+static void
+make_response(const char *qname, dns_fixedname_t *fname, unsigned char *wire,
+	      size_t extra, isc_region_t *r) {
+	dns_name_t *name = dns_fixedname_initname(fname);
+	isc_buffer_t b;
+
+	dns_name_fromstring(name, qname, NULL, 0, NULL);
+
+	isc_buffer_init(&b, wire, DNS_MESSAGE_HEADERLEN + DNS_NAME_MAXWIRE +
+					  4 + extra);
+	isc_buffer_putuint16(&b, 0xabcd); /* id */
+	isc_buffer_putuint16(&b, 0x8400); /* QR, AA */
+	isc_buffer_putuint16(&b, 1);	  /* qdcount */
+	isc_buffer_putuint16(&b, 1);	  /* ancount */
+	isc_buffer_putuint16(&b, 0);
+	isc_buffer_putuint16(&b, 0);
+	isc_buffer_putmem(&b, name->ndata, name->length);
+	isc_buffer_putuint16(&b, dns_rdatatype_a);
+	isc_buffer_putuint16(&b, dns_rdataclass_in);
+	for (size_t i = 0; i < extra; i++) {
+		isc_buffer_putuint8(&b, (uint8_t)i);
+	}
+
+	isc_buffer_usedregion(&b, r);
+}
+
+/* a cached response is returned with the ID and question case patched */
+ISC_RUN_TEST_IMPL(basic) {
+	dns_respcache_t *rc = NULL;
+	dns_zone_t *zone = NULL;
+	dns_fixedname_t fname, fqname;
+	dns_name_t *qname = NULL;
+	unsigned char wire[1024], out[1024];
+	isc_buffer_t target;
+	isc_region_t r;
+	isc_result_t result;
+
+	result = dns_test_makezone("example.com", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rc = dns_respcache_new(mctx, 1024 * 1024);
+
+	make_response("www.example.com.", &fname, wire, 32, &r);
+	dns_respcache_add(rc, zone, 1, dns_fixedname_name(&fname),
+			  dns_rdatatype_a, dns_rdataclass_in, FLAGS, 1232,
+			  true, &r);
+
+	qname = dns_fixedname_initname(&fqname);
+	dns_name_fromstring(qname, "WwW.ExAmPlE.cOm.", NULL, 0, NULL);
+
+	isc_buffer_init(&target, out, 1232);
+	result = dns_respcache_find(rc, zone, 1, qname, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 0x1234, &target);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(isc_buffer_usedlength(&target), r.length);
+	assert_int_equal(out[0], 0x12);
+	assert_int_equal(out[1], 0x34);
+	assert_memory_equal(out + 2, wire + 2, DNS_MESSAGE_HEADERLEN - 2);
+	assert_memory_equal(out + DNS_MESSAGE_HEADERLEN, qname->ndata,
+			    qname->length);
+	assert_memory_equal(out + DNS_MESSAGE_HEADERLEN + qname->length,
+			    wire + DNS_MESSAGE_HEADERLEN + qname->length,
+			    r.length - DNS_MESSAGE_HEADERLEN - qname->length);
+
+	/* Anything else about the question must match */
+	isc_buffer_init(&target, out, 1232);
+	result = dns_respcache_find(rc, zone, 1, qname, dns_rdatatype_aaaa,
+				    dns_rdataclass_in, FLAGS, 0x1234, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	result = dns_respcache_find(rc, zone, 1, qname, dns_rdatatype_a,
+				    dns_rdataclass_ch, FLAGS, 0x1234, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	result = dns_respcache_find(rc, zone, 1, qname, dns_rdatatype_a,
+				    dns_rdataclass_in, DNS_RESPCACHE_EDNS,
+				    0x1234, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	assert_int_equal(isc_buffer_usedlength(&target), 0);
+
+	dns_respcache_flush(rc);
+	result = dns_respcache_find(rc, zone, 1, qname, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 0x1234, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_respcache_destroy(&rc);
+	dns_zone_detach(&zone);
+}
+
+/* entries from an older zone generation, or another zone, are ignored */
+ISC_RUN_TEST_IMPL(generation) {
+	dns_respcache_t *rc = NULL;
+	dns_zone_t *zone = NULL, *other = NULL;
+	dns_fixedname_t fname;
+	dns_name_t *name = NULL;
+	unsigned char wire[1024], out[1024];
+	isc_buffer_t target;
+	isc_region_t r;
+	isc_result_t result;
+
+	result = dns_test_makezone("example.com", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_test_makezone("www.example.com", &other, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rc = dns_respcache_new(mctx, 1024 * 1024);
+
+	make_response("www.example.com.", &fname, wire, 32, &r);
+	name = dns_fixedname_name(&fname);
+	dns_respcache_add(rc, zone, 1, name, dns_rdatatype_a,
+			  dns_rdataclass_in, FLAGS, 1232, true, &r);
+
+	isc_buffer_init(&target, out, sizeof(out));
+	result = dns_respcache_find(rc, other, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* The mismatch evicted the entry */
+	result = dns_respcache_find(rc, zone, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_respcache_add(rc, zone, 1, name, dns_rdatatype_a,
+			  dns_rdataclass_in, FLAGS, 1232, true, &r);
+	result = dns_respcache_find(rc, zone, 2, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	result = dns_respcache_find(rc, zone, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_respcache_add(rc, zone, 2, name, dns_rdatatype_a,
+			  dns_rdataclass_in, FLAGS, 1232, true, &r);
+	result = dns_respcache_find(rc, zone, 2, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_respcache_destroy(&rc);
+	dns_zone_detach(&other);
+	dns_zone_detach(&zone);
+}
+
+/* responses are only reused for buffers they are known to be right for */
+ISC_RUN_TEST_IMPL(bufsize) {
+	dns_respcache_t *rc = NULL;
+	dns_zone_t *zone = NULL;
+	dns_fixedname_t fname;
+	dns_name_t *name = NULL;
+	unsigned char wire[1024], out[4096];
+	isc_buffer_t target;
+	isc_region_t r;
+	isc_result_t result;
+
+	result = dns_test_makezone("example.com", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rc = dns_respcache_new(mctx, 1024 * 1024);
+
+	make_response("www.example.com.", &fname, wire, 400, &r);
+	name = dns_fixedname_name(&fname);
+
+	/* Something was left out, so only good for the same buffer size */
+	dns_respcache_add(rc, zone, 1, name, dns_rdatatype_a,
+			  dns_rdataclass_in, FLAGS, 512, false, &r);
+
+	isc_buffer_init(&target, out, 4096);
+	result = dns_respcache_find(rc, zone, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	isc_buffer_init(&target, out, 512);
+	result = dns_respcache_find(rc, zone, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* A complete response is good for any buffer it fits into */
+	dns_respcache_add(rc, zone, 1, name, dns_rdatatype_a,
+			  dns_rdataclass_in, FLAGS, 1232, true, &r);
+
+	isc_buffer_init(&target, out, 4096);
+	result = dns_respcache_find(rc, zone, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_buffer_init(&target, out, r.length - 1);
+	result = dns_respcache_find(rc, zone, 1, name, dns_rdatatype_a,
+				    dns_rdataclass_in, FLAGS, 1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_respcache_destroy(&rc);
+	dns_zone_detach(&zone);
+}
+
+/* the cache doesn't grow past its size limit */
+ISC_RUN_TEST_IMPL(maxsize) {
+	dns_respcache_t *rc = NULL;
+	dns_zone_t *zone = NULL;
+	dns_fixedname_t fname;
+	unsigned char wire[1024], out[1024];
+	isc_buffer_t target;
+	isc_region_t r;
+	isc_result_t result;
+	char namebuf[DNS_NAME_FORMATSIZE];
+	unsigned int found = 0;
+
+	result = dns_test_makezone("example.com", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Room for a few responses only */
+	rc = dns_respcache_new(mctx, 4 * 1024);
+
+	for (size_t i = 0; i < 100; i++) {
+		snprintf(namebuf, sizeof(namebuf), "n%zu.example.com.", i);
+		make_response(namebuf, &fname, wire, 500, &r);
+		dns_respcache_add(rc, zone, 1, dns_fixedname_name(&fname),
+				  dns_rdatatype_a, dns_rdataclass_in, FLAGS,
+				  1232, true, &r);
+	}
+
+	for (size_t i = 0; i < 100; i++) {
+		snprintf(namebuf, sizeof(namebuf), "n%zu.example.com.", i);
+		make_response(namebuf, &fname, wire, 500, &r);
+		isc_buffer_init(&target, out, sizeof(out));
+		result = dns_respcache_find(
+			rc, zone, 1, dns_fixedname_name(&fname),
+			dns_rdatatype_a, dns_rdataclass_in, FLAGS, 1, &target);
+		if (result == ISC_R_SUCCESS) {
+			found++;
+		}
+	}
+
+	assert_in_range(found, 1, 4 * 1024 / 500);
+
+	dns_respcache_destroy(&rc);
+
+	/* Responses larger than the whole cache are never stored */
+	rc = dns_respcache_new(mctx, 256);
+	make_response("www.example.com.", &fname, wire, 500, &r);
+	dns_respcache_add(rc, zone, 1, dns_fixedname_name(&fname),
+			  dns_rdatatype_a, dns_rdataclass_in, FLAGS, 1232, true,
+			  &r);
+	isc_buffer_init(&target, out, sizeof(out));
+	result = dns_respcache_find(rc, zone, 1, dns_fixedname_name(&fname),
+				    dns_rdatatype_a, dns_rdataclass_in, FLAGS,
+				    1, &target);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_respcache_destroy(&rc);
+	dns_zone_detach(&zone);
+}
+
+/* the zone generation moves on when the zone changes */
+ISC_RUN_TEST_IMPL(zonegeneration) {
+	dns_zone_t *zone = NULL;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL;
+	uint32_t generation;
+	isc_result_t result;
+
+	result = dns_test_makezone("nsec3", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Nothing loaded yet */
+	assert_int_equal(dns_zone_getgeneration(zone), 0);
+
+	result = dns_zone_setfile(
+		zone, TESTS_DIR "/testdata/nsec3param/nsec3.db.signed",
+		dns_masterformat_text, &dns_master_style_default);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_zone_load(zone, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	generation = dns_zone_getgeneration(zone);
+	assert_int_not_equal(generation, 0);
+
+	result = dns_zone_getdb(zone, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Merely reading the zone doesn't change anything */
+	dns_db_currentversion(db, &version);
+	dns_db_closeversion(db, &version, false);
+	assert_int_equal(dns_zone_getgeneration(zone), generation);
+
+	result = dns_db_newversion(db, &version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, true);
+	assert_int_not_equal(dns_zone_getgeneration(zone), generation);
+
+	dns_db_detach(&db);
+	dns_zone_detach(&zone);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(basic)
+ISC_TEST_ENTRY(generation)
+ISC_TEST_ENTRY(bufsize)
+ISC_TEST_ENTRY(maxsize)
+ISC_TEST_ENTRY(zonegeneration)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
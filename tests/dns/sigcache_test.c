@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/mem.h>
+#include <isc/stdtime.h>
+#include <isc/util.h>
+
+#include <dns/dnssec.h>
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+#include <dns/sigcache.h>
+
+#include <dst/dst.h>
+
+#include <tests/dns.h>
+
+static int
+setup_test(void **state) {
+	UNUSED(state);
+
+	if (dst_lib_init(mctx, NULL) != ISC_R_SUCCESS) {
+		return (1);
+	}
+
+	return (0);
+}
+
+static int
+teardown_test(void **state) {
+	UNUSED(state);
+
+	dst_lib_destroy();
+
+	return (0);
+}
+
+static void
+fakedigest(unsigned char *digest, unsigned char fill) {
+	memset(digest, fill, DNS_SIGCACHE_DIGESTLEN);
+}
+
+/* an added signature is found until it expires */
+ISC_RUN_TEST_IMPL(basic) {
+	dns_sigcache_t *sc = NULL;
+	unsigned char digest[DNS_SIGCACHE_DIGESTLEN];
+	unsigned char other[DNS_SIGCACHE_DIGESTLEN];
+	isc_stdtime_t now = isc_stdtime_now();
+	isc_result_t result;
+
+	sc = dns_sigcache_new(mctx, 1024);
+
+	fakedigest(digest, 1);
+	fakedigest(other, 2);
+
+	result = dns_sigcache_find(sc, digest, now);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_sigcache_add(sc, digest, now - 60, now + 60);
+
+	result = dns_sigcache_find(sc, digest, now);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_sigcache_find(sc, other, now);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* Not yet valid, and expired */
+	result = dns_sigcache_find(sc, digest, now - 61);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	result = dns_sigcache_find(sc, digest, now + 61);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_sigcache_flush(sc);
+	result = dns_sigcache_find(sc, digest, now);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_sigcache_destroy(&sc);
+	assert_null(sc);
+}
+
+/* a newer entry replaces the one in the same slot */
+ISC_RUN_TEST_IMPL(replace) {
+	dns_sigcache_t *sc = NULL;
+	unsigned char digest[DNS_SIGCACHE_DIGESTLEN];
+	unsigned char other[DNS_SIGCACHE_DIGESTLEN];
+	isc_stdtime_t now = isc_stdtime_now();
+
+	sc = dns_sigcache_new(mctx, 1);
+
+	/* Same leading bytes, so the same slot */
+	fakedigest(digest, 1);
+	fakedigest(other, 1);
+	other[DNS_SIGCACHE_DIGESTLEN - 1] = 2;
+
+	dns_sigcache_add(sc, digest, now - 60, now + 60);
+	dns_sigcache_add(sc, other, now - 60, now + 60);
+
+	assert_int_equal(dns_sigcache_find(sc, digest, now), ISC_R_NOTFOUND);
+	assert_int_equal(dns_sigcache_find(sc, other, now), ISC_R_SUCCESS);
+
+	dns_sigcache_destroy(&sc);
+}
+
+static void
+makerdata(dns_rdata_t *rdata, dns_rdatatype_t type, unsigned char *buf,
+	  size_t size, const char *text) {
+	isc_result_t result;
+
+	dns_rdata_init(rdata);
+	result = dns_test_rdatafromstring(rdata, dns_rdataclass_in, type, buf,
+					  size, text, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static void
+makerdataset(dns_rdatalist_t *rdatalist, dns_rdataset_t *rdataset,
+	     dns_rdata_t *first, dns_rdata_t *second) {
+	dns_rdatalist_init(rdatalist);
+	rdatalist->rdclass = dns_rdataclass_in;
+	rdatalist->type = dns_rdatatype_a;
+	rdatalist->ttl = 300;
+	ISC_LIST_APPEND(rdatalist->rdata, first, link);
+	ISC_LIST_APPEND(rdatalist->rdata, second, link);
+
+	dns_rdataset_init(rdataset);
+	dns_rdatalist_tordataset(rdatalist, rdataset);
+}
+
+/* the digest does not depend on the order of the records */
+ISC_RUN_TEST_IMPL(digest) {
+	isc_result_t result;
+	dns_fixedname_t fname;
+	dns_name_t *name = dns_fixedname_initname(&fname);
+	unsigned char keybuf[1024], sigbuf[1024];
+	unsigned char abuf[3][4];
+	dns_rdata_t keyrdata, sigrdata;
+	dns_rdata_t a[3], b[2], c[2];
+	dns_rdatalist_t la, lb, lc;
+	dns_rdataset_t sa, sb, sc;
+	unsigned char da[DNS_SIGCACHE_DIGESTLEN];
+	unsigned char db[DNS_SIGCACHE_DIGESTLEN];
+	unsigned char dc[DNS_SIGCACHE_DIGESTLEN];
+	dst_key_t *key = NULL;
+
+	result = dns_name_fromstring(name, "rsa.", NULL, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	makerdata(&keyrdata, dns_rdatatype_dnskey, keybuf, sizeof(keybuf),
+		  "256 3 8 AwEAAdLT1R3qiqCqll3Xzh2qFMvehQ9FODsPftw5U4UjB3QwnJ/3"
+		  "+dph9kZBBeaJagUBVYzoArk6XNydpp3HhSCFDcIiepL6r8XAifW3SqI1"
+		  "KCneOD38kSCl/Qm9P0+3CFWokGVubsSQ+3dpQZxqx5bzOXthbuzAr6X+"
+		  "gDUELAyHtCQNmJ+4ktdCoj3DNYW0z/xLvrcB2Lns7H+/qWnGPL4f3hr7"
+		  "VbakOeay+4J4KGdY2LFxJUVts6QrgAA8gz4mV9YIJFP+C4B3b/Z7qgqZ"
+		  "RxmT0pic+fJC5+sq0l8KwavPn0n+HqVuJNvppVKMdTbsmmuk69RFGMjb"
+		  "FkP7tnCiqC9Zi6s=");
+	result = dns_dnssec_keyfromrdata(name, &keyrdata, mctx, &key);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	makerdata(&sigrdata, dns_rdatatype_rrsig, sigbuf, sizeof(sigbuf),
+		  "A 8 1 300 20300101000000 20200101000000 29238 rsa. "
+		  "AAECAwQFBgcICQoLDA0ODw==");
+
+	makerdata(&a[0], dns_rdatatype_a, abuf[0], sizeof(abuf[0]),
+		  "192.0.2.1");
+	makerdata(&a[1], dns_rdatatype_a, abuf[1], sizeof(abuf[1]),
+		  "192.0.2.2");
+	makerdata(&a[2], dns_rdatatype_a, abuf[2], sizeof(abuf[2]),
+		  "192.0.2.3");
+
+	b[0] = a[1];
+	b[1] = a[0];
+	c[0] = a[0];
+	c[1] = a[2];
+
+	makerdataset(&la, &sa, &a[0], &a[1]);
+	makerdataset(&lb, &sb, &b[0], &b[1]);
+	makerdataset(&lc, &sc, &c[0], &c[1]);
+
+	result = dns_sigcache_digest(name, &sa, key, &sigrdata, mctx, da);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_sigcache_digest(name, &sb, key, &sigrdata, mctx, db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_sigcache_digest(name, &sc, key, &sigrdata, mctx, dc);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	assert_memory_equal(da, db, DNS_SIGCACHE_DIGESTLEN);
+	assert_memory_not_equal(da, dc, DNS_SIGCACHE_DIGESTLEN);
+
+	dns_rdataset_disassociate(&sa);
+	dns_rdataset_disassociate(&sb);
+	dns_rdataset_disassociate(&sc);
+	dst_key_free(&key);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(basic)
+ISC_TEST_ENTRY(replace)
+ISC_TEST_ENTRY_CUSTOM(digest, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
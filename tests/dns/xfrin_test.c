@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/util.h>
+
+/*
+ * Include xfrin.c so that the static functions merging queued IXFR
+ * transactions can be tested.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "xfrin.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+/* Make a queued IXFR transaction from 'changes' */
+static xfrin_apply_data_t *
+makedata(const zonechange_t *changes) {
+	xfrin_apply_data_t *data = isc_mem_get(mctx, sizeof(*data));
+	isc_result_t result;
+
+	*data = (xfrin_apply_data_t){
+		.size = 100,
+		.ntrans = 1,
+	};
+	ISC_LINK_INIT(data, link);
+	cds_wfcq_node_init(&data->wfcq_node);
+
+	result = dns_test_difffromchanges(&data->diff, changes, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (data);
+}
+
+/* Count the tuples in 'data' and check the position of the SOAs */
+static unsigned int
+checkdata(xfrin_apply_data_t *data, uint32_t from, uint32_t to) {
+	dns_difftuple_t *t = ISC_LIST_HEAD(data->diff.tuples);
+	unsigned int n = 0;
+	bool adding = false;
+
+	assert_non_null(t);
+	assert_int_equal(t->op, DNS_DIFFOP_DEL);
+	assert_int_equal(t->rdata.type, dns_rdatatype_soa);
+	assert_int_equal(dns_soa_getserial(&t->rdata), from);
+
+	for (; t != NULL; t = ISC_LIST_NEXT(t, link)) {
+		if (t->op == DNS_DIFFOP_ADD && !adding) {
+			assert_int_equal(t->rdata.type, dns_rdatatype_soa);
+			assert_int_equal(dns_soa_getserial(&t->rdata), to);
+			adding = true;
+		} else if (t->op == DNS_DIFFOP_DEL) {
+			assert_false(adding);
+		}
+		if (t != ISC_LIST_HEAD(data->diff.tuples)) {
+			assert_false(t->op == DNS_DIFFOP_DEL &&
+				     t->rdata.type == dns_rdatatype_soa);
+		}
+		n++;
+	}
+	assert_true(adding);
+
+	return (n);
+}
+
+#define SOA(serial) "ns.example. hm.example. " serial " 3600 600 86400 60"
+
+static zonechange_t one_two[] = {
+	{ DNS_DIFFOP_DEL, "example.", 300, "SOA", SOA("1") },
+	{ DNS_DIFFOP_DEL, "old.example.", 300, "A", "10.0.0.1" },
+	{ DNS_DIFFOP_ADD, "example.", 300, "SOA", SOA("2") },
+	{ DNS_DIFFOP_ADD, "a.example.", 300, "A", "10.0.0.2" },
+	ZONECHANGE_SENTINEL,
+};
+
+static zonechange_t two_three[] = {
+	{ DNS_DIFFOP_DEL, "example.", 300, "SOA", SOA("2") },
+	{ DNS_DIFFOP_ADD, "example.", 300, "SOA", SOA("3") },
+	{ DNS_DIFFOP_ADD, "b.example.", 300, "A", "10.0.0.3" },
+	ZONECHANGE_SENTINEL,
+};
+
+static zonechange_t three_four[] = {
+	{ DNS_DIFFOP_DEL, "example.", 300, "SOA", SOA("3") },
+	{ DNS_DIFFOP_ADD, "example.", 300, "SOA", SOA("4") },
+	{ DNS_DIFFOP_ADD, "b.example.", 300, "A", "10.0.0.3" },
+	ZONECHANGE_SENTINEL,
+};
+
+static zonechange_t five_six[] = {
+	{ DNS_DIFFOP_DEL, "example.", 300, "SOA", SOA("5") },
+	{ DNS_DIFFOP_ADD, "example.", 300, "SOA", SOA("6") },
+	{ DNS_DIFFOP_ADD, "c.example.", 300, "A", "10.0.0.4" },
+	ZONECHANGE_SENTINEL,
+};
+
+static zonechange_t undo_two_three[] = {
+	{ DNS_DIFFOP_DEL, "example.", 300, "SOA", SOA("3") },
+	{ DNS_DIFFOP_DEL, "b.example.", 300, "A", "10.0.0.3" },
+	{ DNS_DIFFOP_ADD, "example.", 300, "SOA", SOA("4") },
+	ZONECHANGE_SENTINEL,
+};
+
+/* consecutive transactions are merged into one */
+ISC_RUN_TEST_IMPL(ixfr_coalesce_contiguous) {
+	xfrin_apply_data_t *dst = makedata(one_two);
+	xfrin_apply_data_t *src = makedata(two_three);
+	dns_difftuple_t *t = NULL;
+	unsigned int count;
+
+	UNUSED(state);
+
+	assert_true(ixfr_coalesce(dst, src));
+	assert_true(ISC_LIST_EMPTY(src->diff.tuples));
+	assert_int_equal(dst->ntrans, 2);
+	assert_int_equal(dst->size, 200);
+
+	/* SOA 1, old, SOA 3, a, b */
+	assert_int_equal(checkdata(dst, 1, 3), 5);
+
+	t = ISC_LIST_TAIL(dst->diff.tuples);
+	assert_non_null(ixfr_findrr(&dst->diff, t, &count));
+	assert_int_equal(count, 1);
+
+	ixfr_freedata(mctx, &dst);
+	ixfr_freedata(mctx, &src);
+}
+
+/* transactions that do not follow each other are left alone */
+ISC_RUN_TEST_IMPL(ixfr_coalesce_gap) {
+	xfrin_apply_data_t *dst = makedata(one_two);
+	xfrin_apply_data_t *src = makedata(five_six);
+	xfrin_apply_data_t *big = makedata(two_three);
+
+	UNUSED(state);
+
+	assert_false(ixfr_coalesce(dst, src));
+	assert_int_equal(dst->ntrans, 1);
+	assert_int_equal(checkdata(dst, 1, 2), 4);
+	assert_int_equal(checkdata(src, 5, 6), 3);
+
+	/* Nor are they merged beyond the size limit */
+	big->size = XFRIN_COALESCE_MAX;
+	assert_false(ixfr_coalesce(dst, big));
+	assert_int_equal(checkdata(big, 2, 3), 3);
+
+	ixfr_freedata(mctx, &dst);
+	ixfr_freedata(mctx, &src);
+	ixfr_freedata(mctx, &big);
+}
+
+/* a record added and then deleted again cancels out */
+ISC_RUN_TEST_IMPL(ixfr_coalesce_cancel) {
+	xfrin_apply_data_t *dst = makedata(two_three);
+	xfrin_apply_data_t *src = makedata(undo_two_three);
+	xfrin_apply_data_t *again = makedata(three_four);
+	xfrin_apply_data_t *other = makedata(two_three);
+	dns_difftuple_t *t = NULL;
+	unsigned int count;
+
+	UNUSED(state);
+
+	assert_true(ixfr_coalesce(dst, src));
+	assert_int_equal(dst->ntrans, 2);
+
+	/* Only the SOAs are left */
+	assert_int_equal(checkdata(dst, 2, 4), 2);
+
+	/* Adding the same record twice cannot be merged */
+	assert_false(ixfr_coalesce(other, again));
+	assert_int_equal(other->ntrans, 1);
+	t = ISC_LIST_TAIL(again->diff.tuples);
+	assert_non_null(ixfr_findrr(&other->diff, t, &count));
+	assert_int_equal(count, 1);
+	assert_null(ixfr_findrr(&dst->diff, t, &count));
+	assert_int_equal(count, 0);
+
+	ixfr_freedata(mctx, &dst);
+	ixfr_freedata(mctx, &src);
+	ixfr_freedata(mctx, &again);
+	ixfr_freedata(mctx, &other);
+}
+
+/* merging works on copies, leaving the original transactions intact */
+ISC_RUN_TEST_IMPL(ixfr_copydata) {
+	xfrin_apply_data_t *first = makedata(one_two);
+	xfrin_apply_data_t *second = makedata(two_three);
+	xfrin_apply_data_t *merged = ixfr_copydata(mctx, first);
+	xfrin_apply_data_t *copy = ixfr_copydata(mctx, second);
+
+	UNUSED(state);
+
+	assert_true(ixfr_coalesce(merged, copy));
+	assert_int_equal(checkdata(merged, 1, 3), 5);
+	assert_int_equal(checkdata(first, 1, 2), 4);
+	assert_int_equal(checkdata(second, 2, 3), 3);
+
+	ixfr_freedata(mctx, &first);
+	ixfr_freedata(mctx, &second);
+	ixfr_freedata(mctx, &merged);
+	ixfr_freedata(mctx, &copy);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(ixfr_coalesce_contiguous)
+ISC_TEST_ENTRY(ixfr_coalesce_gap)
+ISC_TEST_ENTRY(ixfr_coalesce_cancel)
+ISC_TEST_ENTRY(ixfr_copydata)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -24,10 +24,12 @@
 #include <cmocka.h>
 
 #include <isc/buffer.h>
+#include <isc/stats.h>
 #include <isc/timer.h>
 #include <isc/util.h>
 
 #include <dns/name.h>
+#include <dns/stats.h>
 #include <dns/view.h>
 #include <dns/zone.h>
 
@@ -123,6 +125,39 @@ ISC_LOOP_TEST_IMPL(zonemgr_createzone) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+/* set the zone load concurrency */
+ISC_LOOP_TEST_IMPL(zonemgr_loadconcurrency) {
+	dns_zonemgr_t *myzonemgr = NULL;
+	isc_stats_t *stats = NULL;
+	unsigned int nloops = isc_loopmgr_nloops(loopmgr);
+
+	UNUSED(arg);
+
+	dns_zonemgr_create(mctx, netmgr, &myzonemgr);
+
+	assert_int_equal(dns_zonemgr_getloadconcurrency(myzonemgr), nloops);
+	dns_zonemgr_setloadconcurrency(myzonemgr, 5);
+	assert_int_equal(dns_zonemgr_getloadconcurrency(myzonemgr), 5);
+	dns_zonemgr_setloadconcurrency(myzonemgr, 0);
+	assert_int_equal(dns_zonemgr_getloadconcurrency(myzonemgr), nloops);
+
+	isc_stats_create(mctx, &stats, dns_zonestatscounter_max);
+	dns_zonemgr_setstats(myzonemgr, stats);
+	assert_int_equal(isc_stats_get_counter(
+				 stats, dns_zonestatscounter_loadqueued),
+			 0);
+	assert_int_equal(isc_stats_get_counter(
+				 stats, dns_zonestatscounter_loadactive),
+			 0);
+
+	dns_zonemgr_shutdown(myzonemgr);
+	dns_zonemgr_detach(&myzonemgr);
+	assert_null(myzonemgr);
+	isc_stats_detach(&stats);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 /* manage and release a zone */
 ISC_LOOP_TEST_IMPL(zonemgr_unreachable) {
 	dns_zonemgr_t *myzonemgr = NULL;
@@ -191,6 +226,7 @@ ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(zonemgr_create, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(zonemgr_managezone, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(zonemgr_createzone, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(zonemgr_loadconcurrency, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(zonemgr_unreachable, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
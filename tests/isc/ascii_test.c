@@ -22,6 +22,9 @@
 #include <cmocka.h>
 
 #include <isc/ascii.h>
+#include <isc/random.h>
+
+#include "ascii_p.h"
 
 #include <tests/isc.h>
 
@@ -169,11 +172,52 @@ ISC_RUN_TEST_IMPL(exhaustive) {
 	}
 }
 
+/* every implementation of the wide functions matches the SWAR code */
+ISC_RUN_TEST_IMPL(wide) {
+	static uint8_t a[300], b[300];
+	isc__ascii_impl_t saved = isc__ascii_getimpl();
+
+	UNUSED(state);
+
+	for (isc__ascii_impl_t impl = 0; impl < ISC__ASCII_IMPLS; impl++) {
+		if (!isc__ascii_setimpl(impl)) {
+			continue;
+		}
+		for (unsigned int len = 0; len <= sizeof(a); len++) {
+			for (unsigned int n = 0; n < 64; n++) {
+				isc_random_buf(a, len);
+				for (unsigned int i = 0; i < len; i++) {
+					b[i] = (i + n) % 2 == 0
+						       ? isc_ascii_toupper(a[i])
+						       : isc_ascii_tolower(a[i]);
+				}
+				/* make a difference somewhere, sometimes */
+				if (len > 0 && n % 2 == 1) {
+					b[isc_random_uniform(len)] ^= n;
+				}
+
+				assert_int_equal(
+					isc_ascii_lowerequal_wide(a, b, len),
+					isc_ascii_lowerequal(a, b, len));
+				assert_int_equal(
+					isc_ascii_lowercmp_wide(a, b, len),
+					isc_ascii_lowercmp(a, b, len));
+				assert_int_equal(
+					isc_ascii_lowercmp_wide(b, a, len),
+					isc_ascii_lowercmp(b, a, len));
+			}
+		}
+	}
+
+	assert_true(isc__ascii_setimpl(saved));
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(upperlower)
 ISC_TEST_ENTRY(lowerequal)
 ISC_TEST_ENTRY(lowercmp)
 ISC_TEST_ENTRY(exhaustive)
+ISC_TEST_ENTRY(wide)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -28,6 +28,7 @@
 #include <isc/loop.h>
 #include <isc/os.h>
 #include <isc/result.h>
+#include <isc/thread.h>
 #include <isc/util.h>
 
 #include "loop.c"
@@ -130,12 +131,85 @@ ISC_RUN_TEST_IMPL(isc_loopmgr_sigterm) {
 	isc_loopmgr_run(loopmgr);
 }
 
+static unsigned int initial_ncpus = 0;
+
+static void *
+helper_affinity(void *arg) {
+	unsigned int cpus[ISC_OS_MAXCPUS];
+
+	UNUSED(arg);
+
+	assert_int_equal(isc_thread_getaffinity(cpus, ARRAY_SIZE(cpus)),
+			 initial_ncpus);
+
+	return (NULL);
+}
+
+static void
+check_affinity(void *arg) {
+	isc_loop_t *loop = isc_loop();
+	unsigned int cpus[ISC_OS_MAXCPUS];
+
+	if (loop->cpu >= 0) {
+		isc_thread_t thread;
+
+		assert_int_equal(isc_thread_getaffinity(cpus, ARRAY_SIZE(cpus)),
+				 1);
+		assert_int_equal(cpus[0], loop->cpu);
+		assert_int_equal(loop->node, isc_os_cpunode(loop->cpu));
+
+		/* Threads started from here are not stuck on its CPU */
+		isc_thread_create(helper_affinity, NULL, &thread);
+		isc_thread_join(thread, NULL);
+	}
+
+	count(arg);
+	if (isc_tid() == 0) {
+		isc_async_current(shutdown_loopmgr, loopmgr);
+	}
+}
+
+static int
+setup_affinity(void **state) {
+	isc_loopmgr_affinity = true;
+	return (setup_loopmgr(state));
+}
+
+static int
+teardown_affinity(void **state) {
+	isc_loopmgr_affinity = false;
+	return (teardown_loopmgr(state));
+}
+
+/* every loop thread runs pinned to the CPU that was picked for it */
+ISC_RUN_TEST_IMPL(isc_loopmgr_affinity) {
+	unsigned int cpus[ISC_OS_MAXCPUS];
+
+	initial_ncpus = isc_thread_getaffinity(cpus, ARRAY_SIZE(cpus));
+	if (initial_ncpus == 0) {
+		skip();
+		return;
+	}
+
+	atomic_store(&scheduled, 0);
+
+	for (size_t i = 0; i < loopmgr->nloops; i++) {
+		assert_true(loopmgr->loops[i].cpu >= 0);
+	}
+
+	isc_loopmgr_setup(loopmgr, check_affinity, loopmgr);
+	isc_loopmgr_run(loopmgr);
+
+	assert_int_equal(atomic_load(&scheduled), loopmgr->nloops);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_pause, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_runjob, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_sigint, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_sigterm, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_affinity, setup_affinity, teardown_affinity)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -111,6 +111,8 @@ bool stream = false;
 in_port_t stream_port = 0;
 
 bool udp_use_PROXY = false;
+bool udp_use_raw = false;
+bool udp_use_steering = false;
 
 isc_nm_recv_cb_t connect_readcb = NULL;
 
@@ -1356,6 +1358,14 @@ udp_start_listening(uint32_t nworkers, isc_nm_recv_cb_t cb) {
 		result = isc_nm_listenproxyudp(netmgr, nworkers,
 					       &udp_listen_addr, cb, NULL,
 					       &listen_sock);
+	} else if (udp_use_raw) {
+		result = isc_nm_listenrawudp(netmgr, nworkers,
+					     &udp_listen_addr, "lo", cb, NULL,
+					     &listen_sock);
+	} else if (udp_use_steering) {
+		result = isc_nm_listensteeredudp(netmgr, nworkers,
+						 &udp_listen_addr, cb, NULL,
+						 &listen_sock);
 	} else {
 		result = isc_nm_listenudp(netmgr, nworkers, &udp_listen_addr,
 					  cb, NULL, &listen_sock);
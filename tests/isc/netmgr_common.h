@@ -140,6 +140,8 @@ extern bool stream;
 extern in_port_t stream_port;
 
 extern bool udp_use_PROXY;
+extern bool udp_use_raw;
+extern bool udp_use_steering;
 
 extern isc_nm_recv_cb_t connect_readcb;
 
@@ -125,10 +125,113 @@ ISC_RUN_TEST_IMPL(isc_radix_search) {
 	isc_radix_destroy(radix, NULL);
 }
 
+static isc_radix_node_t *
+insert(isc_radix_tree_t *radix, const char *text, int family,
+       unsigned int bitlen) {
+	isc_radix_node_t *node = NULL;
+	isc_prefix_t prefix;
+	isc_netaddr_t netaddr;
+	isc_result_t result;
+	struct in6_addr in6;
+	struct in_addr in;
+
+	if (family == AF_INET6) {
+		assert_int_equal(inet_pton(AF_INET6, text, &in6), 1);
+		isc_netaddr_fromin6(&netaddr, &in6);
+	} else {
+		assert_int_equal(inet_pton(AF_INET, text, &in), 1);
+		isc_netaddr_fromin(&netaddr, &in);
+	}
+	NETADDR_TO_PREFIX_T(&netaddr, prefix, bitlen);
+	if (family == AF_UNSPEC) {
+		prefix.family = AF_UNSPEC;
+	}
+
+	result = isc_radix_insert(radix, &node, NULL, &prefix);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_refcount_destroy(&prefix.refcount);
+
+	return (node);
+}
+
+static isc_radix_node_t *
+search(isc_radix_tree_t *radix, const char *text) {
+	isc_radix_node_t *node = NULL;
+	isc_prefix_t prefix;
+	isc_netaddr_t netaddr;
+	struct in6_addr in6;
+	struct in_addr in;
+
+	if (strchr(text, ':') != NULL) {
+		assert_int_equal(inet_pton(AF_INET6, text, &in6), 1);
+		isc_netaddr_fromin6(&netaddr, &in6);
+		NETADDR_TO_PREFIX_T(&netaddr, prefix, 128);
+	} else {
+		assert_int_equal(inet_pton(AF_INET, text, &in), 1);
+		isc_netaddr_fromin(&netaddr, &in);
+		NETADDR_TO_PREFIX_T(&netaddr, prefix, 32);
+	}
+
+	(void)isc_radix_search(radix, &node, &prefix);
+	isc_refcount_destroy(&prefix.refcount);
+
+	return (node);
+}
+
+/* test searching a compiled radix tree */
+ISC_RUN_TEST_IMPL(isc_radix_compile) {
+	isc_radix_tree_t *radix = NULL;
+	isc_radix_node_t *host, *net8, *net6, *any, *late;
+	const char *addrs[] = { "10.1.2.3",    "10.1.2.4",    "10.200.0.1",
+				"192.0.2.1",   "2001:db8::1", "2001:db9::1",
+				"::ffff:10.1.2.3" };
+	isc_radix_node_t *before[ARRAY_SIZE(addrs)];
+
+	UNUSED(state);
+
+	isc_radix_create(mctx, &radix, RADIX_MAXBITS);
+
+	/* The first matching prefix wins, not the longest one */
+	host = insert(radix, "10.1.2.3", AF_INET, 32);
+	net8 = insert(radix, "10.0.0.0", AF_INET, 8);
+	late = insert(radix, "10.1.0.0", AF_INET, 16);
+	net6 = insert(radix, "2001:db8::", AF_INET6, 32);
+	any = insert(radix, "0.0.0.0", AF_UNSPEC, 0);
+
+	for (size_t i = 0; i < ARRAY_SIZE(addrs); i++) {
+		before[i] = search(radix, addrs[i]);
+	}
+
+	isc_radix_compile(radix);
+	assert_non_null(radix->trie[RADIX_V4]);
+	assert_non_null(radix->trie[RADIX_V6]);
+
+	for (size_t i = 0; i < ARRAY_SIZE(addrs); i++) {
+		assert_ptr_equal(search(radix, addrs[i]), before[i]);
+	}
+
+	assert_ptr_equal(search(radix, "10.1.2.3"), host);
+	assert_ptr_equal(search(radix, "10.1.2.4"), net8);
+	assert_ptr_equal(search(radix, "10.200.0.1"), net8);
+	assert_ptr_equal(search(radix, "192.0.2.1"), any);
+	assert_ptr_equal(search(radix, "2001:db8::1"), net6);
+	assert_ptr_equal(search(radix, "2001:db9::1"), any);
+	assert_ptr_not_equal(search(radix, "10.1.2.4"), late);
+
+	/* Changing the tree discards the compiled form */
+	insert(radix, "192.0.2.0", AF_INET, 24);
+	assert_null(radix->trie[RADIX_V4]);
+	assert_null(radix->trie[RADIX_V6]);
+	assert_ptr_equal(search(radix, "192.0.2.1"), any);
+
+	isc_radix_destroy(radix, NULL);
+}
+
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY(isc_radix_remove)
 ISC_TEST_ENTRY(isc_radix_search)
+ISC_TEST_ENTRY(isc_radix_compile)
 
 ISC_TEST_LIST_END
 ISC_TEST_MAIN
@@ -36,6 +36,7 @@
 #include <isc/quota.h>
 #include <isc/refcount.h>
 #include <isc/sockaddr.h>
+#include <isc/stats.h>
 #include <isc/thread.h>
 #include <isc/util.h>
 
@@ -49,6 +50,11 @@
 
 #include <tests/isc.h>
 
+#if HAVE_REUSEPORT_STEERING
+#include <linux/bpf.h>
+#include <sys/syscall.h>
+#endif /* HAVE_REUSEPORT_STEERING */
+
 /* Callbacks */
 
 static void
@@ -194,6 +200,141 @@ ISC_LOOP_TEST_IMPL(udp_recv_send) { udp_recv_send(arg); }
 
 ISC_LOOP_TEST_IMPL(udp_double_read) { udp_double_read(arg); }
 
+#if HAVE_UDP_SEND_BATCHING
+static isc_stats_t *udp_batched_stats = NULL;
+
+static int
+udp_recv_send_batched_setup(void **state) {
+	int r = udp_recv_send_setup(state);
+
+	isc_nm_setudpsendbatching(netmgr, true);
+	assert_true(isc_nm_getudpsendbatching(netmgr));
+
+	isc_stats_create(mctx, &udp_batched_stats, isc_sockstatscounter_max);
+	isc_nm_setstats(netmgr, udp_batched_stats);
+
+	return (r);
+}
+
+static int
+udp_recv_send_batched_teardown(void **state) {
+	uint64_t batches = isc_stats_get_counter(
+		udp_batched_stats, isc_sockstatscounter_udp6sendbatch);
+	uint64_t batched = isc_stats_get_counter(
+		udp_batched_stats, isc_sockstatscounter_udp6sendbatchmsg);
+	uint64_t gso = isc_stats_get_counter(udp_batched_stats,
+					     isc_sockstatscounter_udp6sendgso);
+
+	/* The datagrams must have gone out through sendmmsg() */
+	assert_true(batches > 0);
+	assert_true(batched >= batches);
+	assert_true(gso <= batched);
+
+	isc_stats_detach(&udp_batched_stats);
+
+	return (udp_recv_send_teardown(state));
+}
+
+ISC_LOOP_TEST_IMPL(udp_recv_send_batched) { udp_recv_send(arg); }
+#endif /* HAVE_UDP_SEND_BATCHING */
+
+#if HAVE_RAW_UDP_LISTENER
+static bool udp_raw_skip = false;
+
+static int
+udp_recv_send_raw_setup(void **state) {
+	int fd = socket(AF_PACKET, SOCK_DGRAM, 0);
+
+	/* Opening packet sockets requires CAP_NET_RAW */
+	if (fd == -1) {
+		udp_raw_skip = true;
+		return (0);
+	}
+	close(fd);
+
+	udp_use_raw = true;
+	return (udp_recv_send_setup(state));
+}
+
+static int
+udp_recv_send_raw_teardown(void **state) {
+	if (udp_raw_skip) {
+		return (0);
+	}
+
+	udp_use_raw = false;
+	return (udp_recv_send_teardown(state));
+}
+
+static void
+udp_recv_send_raw_loop(void *arg) {
+	udp_recv_send(arg);
+}
+
+ISC_RUN_TEST_IMPL(udp_recv_send_raw) {
+	if (udp_raw_skip) {
+		skip();
+		return;
+	}
+
+	isc_loop_setup(mainloop, udp_recv_send_raw_loop, state);
+	isc_loopmgr_run(loopmgr);
+}
+#endif /* HAVE_RAW_UDP_LISTENER */
+
+#if HAVE_REUSEPORT_STEERING
+static bool udp_steered_skip = false;
+
+static int
+udp_recv_send_steered_setup(void **state) {
+	union bpf_attr attr = {
+		.map_type = BPF_MAP_TYPE_REUSEPORT_SOCKARRAY,
+		.key_size = sizeof(uint32_t),
+		.value_size = sizeof(uint64_t),
+		.max_entries = 1,
+	};
+	int fd = syscall(__NR_bpf, BPF_MAP_CREATE, &attr, sizeof(attr));
+
+	/*
+	 * Steering needs CAP_BPF and a kernel with socket arrays, which
+	 * unprivileged BPF or plain array maps don't tell us about.
+	 */
+	if (fd == -1) {
+		udp_steered_skip = true;
+		return (0);
+	}
+	close(fd);
+
+	udp_use_steering = true;
+	return (udp_recv_send_setup(state));
+}
+
+static int
+udp_recv_send_steered_teardown(void **state) {
+	if (udp_steered_skip) {
+		return (0);
+	}
+
+	udp_use_steering = false;
+	return (udp_recv_send_teardown(state));
+}
+
+static void
+udp_recv_send_steered_loop(void *arg) {
+	udp_recv_send(arg);
+}
+
+ISC_RUN_TEST_IMPL(udp_recv_send_steered) {
+	if (udp_steered_skip) {
+		skip();
+		return;
+	}
+
+	isc_loop_setup(mainloop, udp_recv_send_steered_loop, state);
+	isc_loopmgr_run(loopmgr);
+}
+#endif /* HAVE_REUSEPORT_STEERING */
+
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY_CUSTOM(mock_listenudp_uv_udp_open, setup_udp_test,
@@ -230,6 +371,18 @@ ISC_TEST_ENTRY_CUSTOM(udp_recv_one, udp_recv_one_setup, udp_recv_one_teardown)
 ISC_TEST_ENTRY_CUSTOM(udp_recv_two, udp_recv_two_setup, udp_recv_two_teardown)
 ISC_TEST_ENTRY_CUSTOM(udp_recv_send, udp_recv_send_setup,
 		      udp_recv_send_teardown)
+#if HAVE_UDP_SEND_BATCHING
+ISC_TEST_ENTRY_CUSTOM(udp_recv_send_batched, udp_recv_send_batched_setup,
+		      udp_recv_send_batched_teardown)
+#endif /* HAVE_UDP_SEND_BATCHING */
+#if HAVE_RAW_UDP_LISTENER
+ISC_TEST_ENTRY_CUSTOM(udp_recv_send_raw, udp_recv_send_raw_setup,
+		      udp_recv_send_raw_teardown)
+#endif /* HAVE_RAW_UDP_LISTENER */
+#if HAVE_REUSEPORT_STEERING
+ISC_TEST_ENTRY_CUSTOM(udp_recv_send_steered, udp_recv_send_steered_setup,
+		      udp_recv_send_steered_teardown)
+#endif /* HAVE_REUSEPORT_STEERING */
 
 ISC_TEST_LIST_END
 
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/name.h>
+
+#include <ns/xfrcache.h>
+
+#include <tests/ns.h>
+
+/* Stand-ins for zones; the cache only compares the pointers */
+static int zone1, zone2;
+
+static unsigned char qbuf[64], abuf[1024];
+
+static dns_db_t *
+makedb(void) {
+	dns_db_t *db = NULL;
+	isc_result_t result;
+
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	return (db);
+}
+
+static void
+makekey(ns_xfrkey_t *key, int *zone, dns_db_t *db, const dns_name_t *qname,
+	uint32_t begin, uint32_t end) {
+	*key = (ns_xfrkey_t){
+		.zone = (const dns_zone_t *)zone,
+		.db = db,
+		.qname = qname,
+		.rdclass = dns_rdataclass_in,
+		.qtype = begin != 0 ? dns_rdatatype_ixfr : dns_rdatatype_axfr,
+		.incremental = (begin != 0),
+		.begin_serial = begin,
+		.end_serial = end,
+		.many_answers = true,
+		.msgsize = 20480,
+	};
+}
+
+/* Record and publish a transfer of 'nmsgs' messages of 'size' bytes */
+static void
+record(ns_xfrcache_t *cache, const ns_xfrkey_t *key, unsigned int nmsgs,
+       unsigned int size) {
+	ns_xfrentry_t *entry = NULL;
+	isc_region_t question = { qbuf, sizeof(qbuf) };
+	isc_region_t answer = { abuf, size };
+	isc_result_t result;
+
+	result = ns_xfrcache_begin(cache, key, &entry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (unsigned int i = 0; i < nmsgs; i++) {
+		result = ns_xfrentry_addmsg(entry, &question, i == 0 ? 1 : 0,
+					    &answer, 10);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		question.length = 0;
+	}
+
+	ns_xfrcache_publish(cache, entry);
+	ns_xfrentry_detach(&entry);
+}
+
+static bool
+cached(ns_xfrcache_t *cache, const ns_xfrkey_t *key) {
+	ns_xfrentry_t *entry = NULL;
+
+	if (ns_xfrcache_find(cache, key, &entry) != ISC_R_SUCCESS) {
+		return (false);
+	}
+	ns_xfrentry_detach(&entry);
+	return (true);
+}
+
+/* a published transfer is found only with exactly the same key */
+ISC_RUN_TEST_IMPL(ns_xfrcache_find) {
+	ns_xfrcache_t *cache = NULL;
+	ns_xfrentry_t *entry = NULL;
+	ns_xfrkey_t key, other;
+	dns_fixedname_t f1, f2;
+	dns_name_t *qname = dns_fixedname_initname(&f1);
+	dns_name_t *upper = dns_fixedname_initname(&f2);
+	dns_db_t *db = makedb();
+	isc_region_t question = { qbuf, sizeof(qbuf) };
+	isc_region_t answer = { abuf, sizeof(abuf) };
+	isc_region_t q, a;
+	unsigned int qdcount, ancount;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	memset(qbuf, 'q', sizeof(qbuf));
+	memset(abuf, 'a', sizeof(abuf));
+	dns_test_namefromstring("example.", &f1);
+	dns_test_namefromstring("EXAMPLE.", &f2);
+
+	ns_xfrcache_create(mctx, &cache);
+	makekey(&key, &zone1, db, qname, 1, 2);
+
+	/* Disabled until a size is set */
+	result = ns_xfrcache_begin(cache, &key, &entry);
+	assert_int_equal(result, ISC_R_DISABLED);
+
+	ns_xfrcache_setsize(cache, 1024 * 1024);
+
+	result = ns_xfrcache_begin(cache, &key, &entry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = ns_xfrentry_addmsg(entry, &question, 1, &answer, 20);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	question.length = 0;
+	answer.length = 100;
+	result = ns_xfrentry_addmsg(entry, &question, 0, &answer, 2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Not visible until it is published */
+	assert_false(cached(cache, &key));
+	ns_xfrcache_publish(cache, entry);
+	ns_xfrentry_detach(&entry);
+
+	result = ns_xfrcache_find(cache, &key, &entry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(ns_xfrentry_count(entry), 2);
+
+	result = ns_xfrentry_getmsg(entry, 0, &q, &qdcount, &a, &ancount);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(q.length, sizeof(qbuf));
+	assert_memory_equal(q.base, qbuf, sizeof(qbuf));
+	assert_int_equal(qdcount, 1);
+	assert_int_equal(a.length, sizeof(abuf));
+	assert_memory_equal(a.base, abuf, sizeof(abuf));
+	assert_int_equal(ancount, 20);
+
+	result = ns_xfrentry_getmsg(entry, 1, &q, &qdcount, &a, &ancount);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(q.length, 0);
+	assert_int_equal(qdcount, 0);
+	assert_int_equal(a.length, 100);
+	assert_int_equal(ancount, 2);
+
+	result = ns_xfrentry_getmsg(entry, 2, &q, &qdcount, &a, &ancount);
+	assert_int_equal(result, ISC_R_NOMORE);
+	ns_xfrentry_detach(&entry);
+
+	/* The question is echoed as it was, so the case must match */
+	makekey(&other, &zone1, db, upper, 1, 2);
+	assert_false(cached(cache, &other));
+
+	/* Another delta, or the whole zone */
+	makekey(&other, &zone1, db, qname, 3, 2);
+	assert_false(cached(cache, &other));
+	makekey(&other, &zone1, db, qname, 0, 2);
+	assert_false(cached(cache, &other));
+
+	/* Another format */
+	makekey(&other, &zone1, db, qname, 1, 2);
+	other.many_answers = false;
+	assert_false(cached(cache, &other));
+
+	/* Disabling the cache flushes it */
+	ns_xfrcache_setsize(cache, 0);
+	assert_false(cached(cache, &key));
+
+	ns_xfrcache_destroy(&cache);
+	assert_null(cache);
+	dns_db_detach(&db);
+}
+
+/* publishing a newer version of a zone removes the older ones */
+ISC_RUN_TEST_IMPL(ns_xfrcache_stale) {
+	ns_xfrcache_t *cache = NULL;
+	ns_xfrkey_t ixfr, axfr, newer, reload, other;
+	dns_fixedname_t f1, f2;
+	dns_name_t *qname = dns_fixedname_initname(&f1);
+	dns_name_t *qname2 = dns_fixedname_initname(&f2);
+	dns_db_t *db = makedb(), *db2 = makedb();
+
+	UNUSED(state);
+
+	dns_test_namefromstring("example.", &f1);
+	dns_test_namefromstring("example.net.", &f2);
+
+	ns_xfrcache_create(mctx, &cache);
+	ns_xfrcache_setsize(cache, 1024 * 1024);
+
+	makekey(&ixfr, &zone1, db, qname, 1, 2);
+	makekey(&axfr, &zone1, db, qname, 0, 2);
+	makekey(&other, &zone2, db2, qname2, 0, 7);
+	record(cache, &ixfr, 1, 100);
+	record(cache, &axfr, 3, 100);
+	record(cache, &other, 1, 100);
+	assert_true(cached(cache, &ixfr));
+	assert_true(cached(cache, &axfr));
+	assert_true(cached(cache, &other));
+
+	/* The serial changed */
+	makekey(&newer, &zone1, db, qname, 2, 3);
+	record(cache, &newer, 1, 100);
+	assert_false(cached(cache, &ixfr));
+	assert_false(cached(cache, &axfr));
+	assert_true(cached(cache, &newer));
+	assert_true(cached(cache, &other));
+
+	/* The zone was reloaded into a new database */
+	makekey(&reload, &zone1, db2, qname, 0, 3);
+	record(cache, &reload, 1, 100);
+	assert_false(cached(cache, &newer));
+	assert_true(cached(cache, &reload));
+	assert_true(cached(cache, &other));
+
+	/* A database at the same address, loaded again */
+	reload.loadtime.seconds++;
+	assert_false(cached(cache, &reload));
+
+	/* Looking up the new version of a zone drops the old one */
+	makekey(&newer, &zone2, db2, qname2, 0, 8);
+	assert_false(cached(cache, &newer));
+	assert_false(cached(cache, &other));
+
+	ns_xfrcache_destroy(&cache);
+	dns_db_detach(&db);
+	dns_db_detach(&db2);
+}
+
+/* the cache stays within its size, dropping the least recently used */
+ISC_RUN_TEST_IMPL(ns_xfrcache_size) {
+	ns_xfrcache_t *cache = NULL;
+	ns_xfrentry_t *entry = NULL;
+	ns_xfrkey_t key1, key2, key3;
+	dns_fixedname_t f1, f2, f3;
+	dns_name_t *qname1 = dns_fixedname_initname(&f1);
+	dns_name_t *qname2 = dns_fixedname_initname(&f2);
+	dns_name_t *qname3 = dns_fixedname_initname(&f3);
+	dns_db_t *db = makedb();
+	isc_region_t question = { qbuf, 0 };
+	isc_region_t answer = { abuf, sizeof(abuf) };
+	isc_result_t result;
+	static int zone3;
+
+	UNUSED(state);
+
+	dns_test_namefromstring("one.", &f1);
+	dns_test_namefromstring("two.", &f2);
+	dns_test_namefromstring("three.", &f3);
+
+	ns_xfrcache_create(mctx, &cache);
+	ns_xfrcache_setsize(cache, 12 * 1024);
+
+	makekey(&key1, &zone1, db, qname1, 0, 1);
+	makekey(&key2, &zone2, db, qname2, 0, 1);
+	makekey(&key3, &zone3, db, qname3, 0, 1);
+
+	/* A transfer larger than the cache is dropped while recording */
+	result = ns_xfrcache_begin(cache, &key1, &entry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	do {
+		result = ns_xfrentry_addmsg(entry, &question, 0, &answer, 1);
+	} while (result == ISC_R_SUCCESS);
+	assert_int_equal(result, ISC_R_NOSPACE);
+	result = ns_xfrentry_addmsg(entry, &question, 0, &answer, 1);
+	assert_int_equal(result, ISC_R_NOSPACE);
+	ns_xfrcache_publish(cache, entry);
+	ns_xfrentry_detach(&entry);
+	assert_false(cached(cache, &key1));
+
+	/* Each of these takes up a little under half of the cache */
+	record(cache, &key1, 5, sizeof(abuf));
+	record(cache, &key2, 5, sizeof(abuf));
+	assert_true(cached(cache, &key1));
+	assert_true(cached(cache, &key2));
+
+	/* key1 was used last, so key2 makes room for key3 */
+	assert_true(cached(cache, &key1));
+	record(cache, &key3, 5, sizeof(abuf));
+	assert_true(cached(cache, &key1));
+	assert_false(cached(cache, &key2));
+	assert_true(cached(cache, &key3));
+
+	/* Shrinking the cache drops entries */
+	ns_xfrcache_setsize(cache, 8 * 1024);
+	assert_true(cached(cache, &key1) != cached(cache, &key3));
+
+	ns_xfrcache_destroy(&cache);
+	dns_db_detach(&db);
+}
+
+/* transfers being recorded share the cache with the published ones */
+ISC_RUN_TEST_IMPL(ns_xfrcache_recording) {
+	ns_xfrcache_t *cache = NULL;
+	ns_xfrentry_t *entry1 = NULL, *entry2 = NULL, *entry3 = NULL;
+	ns_xfrkey_t key1, key2, key3;
+	dns_fixedname_t f1, f2, f3;
+	dns_name_t *qname1 = dns_fixedname_initname(&f1);
+	dns_name_t *qname2 = dns_fixedname_initname(&f2);
+	dns_name_t *qname3 = dns_fixedname_initname(&f3);
+	dns_db_t *db = makedb();
+	isc_region_t question = { qbuf, 0 };
+	isc_region_t answer = { abuf, sizeof(abuf) };
+	isc_result_t result;
+	static int zone3;
+
+	UNUSED(state);
+
+	dns_test_namefromstring("one.", &f1);
+	dns_test_namefromstring("two.", &f2);
+	dns_test_namefromstring("three.", &f3);
+
+	ns_xfrcache_create(mctx, &cache);
+	ns_xfrcache_setsize(cache, 12 * 1024);
+
+	makekey(&key1, &zone1, db, qname1, 0, 1);
+	makekey(&key2, &zone2, db, qname2, 0, 1);
+	makekey(&key3, &zone3, db, qname3, 0, 1);
+
+	/* Only one transfer records a key at a time */
+	result = ns_xfrcache_begin(cache, &key1, &entry1);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = ns_xfrcache_begin(cache, &key1, &entry2);
+	assert_int_equal(result, ISC_R_EXISTS);
+	assert_null(entry2);
+
+	/* An abandoned recording can be started again */
+	ns_xfrentry_detach(&entry1);
+	result = ns_xfrcache_begin(cache, &key1, &entry1);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = ns_xfrcache_begin(cache, &key2, &entry2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Two recordings of half of the cache don't both fit */
+	for (unsigned int i = 0; i < 5; i++) {
+		result = ns_xfrentry_addmsg(entry1, &question, 0, &answer, 1);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	do {
+		result = ns_xfrentry_addmsg(entry2, &question, 0, &answer, 1);
+	} while (result == ISC_R_SUCCESS);
+	assert_int_equal(result, ISC_R_NOSPACE);
+	ns_xfrcache_publish(cache, entry2);
+	ns_xfrentry_detach(&entry2);
+	assert_false(cached(cache, &key2));
+
+	ns_xfrcache_publish(cache, entry1);
+	ns_xfrentry_detach(&entry1);
+	assert_true(cached(cache, &key1));
+
+	/* A recording makes room by removing published entries */
+	result = ns_xfrcache_begin(cache, &key3, &entry3);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (unsigned int i = 0; i < 8; i++) {
+		result = ns_xfrentry_addmsg(entry3, &question, 0, &answer, 1);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	assert_false(cached(cache, &key1));
+	ns_xfrcache_publish(cache, entry3);
+	assert_int_equal(ns_xfrentry_maxlength(entry3), sizeof(abuf));
+	ns_xfrentry_detach(&entry3);
+	assert_true(cached(cache, &key3));
+
+	ns_xfrcache_destroy(&cache);
+	dns_db_detach(&db);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(ns_xfrcache_find)
+ISC_TEST_ENTRY(ns_xfrcache_stale)
+ISC_TEST_ENTRY(ns_xfrcache_size)
+ISC_TEST_ENTRY(ns_xfrcache_recording)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN